@@ -0,0 +1,201 @@
+#include "atlaspacker.h"
+
+#include <algorithm>
+
+#include "tracer.h"
+
+AtlasPacker::AtlasPacker()
+{
+    m_padding = 0;
+}
+
+AtlasPacker::AtlasPacker(QSize const& _pageSize, int _padding)
+{
+    m_pageSize = _pageSize;
+    m_padding = qMax(0, _padding);
+}
+
+QVector<AtlasPacker::Placement> AtlasPacker::Pack(QVector<QSize> const& _sizes, SortMode _sort)
+{
+    m_pages.clear();
+    return Append(_sizes, _sort);
+}
+
+//-----------------------------------------------------
+// Largest rectangles first, padding only goes to the
+// right and below so it may run off the page edge.
+// Sorting only covers the new rectangles, an appended
+// layout can differ from packing everything at once
+//-----------------------------------------------------
+QVector<AtlasPacker::Placement> AtlasPacker::Append(QVector<QSize> const& _sizes, SortMode _sort)
+{
+    TRACE_SCOPE("atlas", "Pack");
+
+    QVector<int> order(_sizes.size());
+    for (int i = 0; i < order.size(); i++)
+    {
+        order[i] = i;
+    }
+
+    auto const key = [&_sizes, _sort](int _index) -> qint64
+    {
+        QSize const& size = _sizes[_index];
+        switch (_sort)
+        {
+        case SM_Height: return (qint64(size.height()) << 32) | size.width();
+        case SM_Area:   return qint64(size.width()) * size.height();
+        case SM_Width:  return (qint64(size.width()) << 32) | size.height();
+        default:        return 0;
+        }
+    };
+    if (_sort != SM_None)
+    {
+        std::stable_sort(order.begin(), order.end(), [&key](int _a, int _b)
+        {
+            return key(_a) > key(_b);
+        });
+    }
+
+    int minHeight = m_pageSize.height() + m_padding;
+    for (QSize const& size : _sizes)
+    {
+        if (!size.isEmpty()) minHeight = qMin(minHeight, size.height() + m_padding);
+    }
+
+    QVector<Placement> placements(_sizes.size());
+    int firstOpenPage = qMax(0, m_pages.size() - 1);
+    for (int index : order)
+    {
+        Placement& placement = placements[index];
+        placement.m_page = -1;
+
+        QSize const& size = _sizes[index];
+        int const width = size.width() + m_padding;
+        int const height = size.height() + m_padding;
+        if (size.isEmpty() || size.width() > m_pageSize.width() || size.height() > m_pageSize.height())
+        {
+            continue;
+        }
+
+        for (int page = firstOpenPage; page <= m_pages.size(); page++)
+        {
+            if (page == m_pages.size())
+            {
+                Page newPage;
+                newPage.m_skyline.push_back(Segment{0, 0, m_pageSize.width() + m_padding});
+                newPage.m_usedArea = 0;
+                m_pages.push_back(newPage);
+            }
+
+            int segment = 0;
+            QPoint pos;
+            if (FindPosition(m_pages[page], width, height, segment, pos))
+            {
+                Place(m_pages[page], segment, QRect(pos, QSize(width, height)));
+                m_pages[page].m_usedArea += qint64(size.width()) * size.height();
+                placement.m_page = page;
+                placement.m_rect = QRect(pos, size);
+                break;
+            }
+        }
+
+        // Pages too full for the shortest rectangle are skipped for good
+        while (firstOpenPage < m_pages.size() && IsFull(m_pages[firstOpenPage], minHeight))
+        {
+            firstOpenPage++;
+        }
+    }
+
+    return placements;
+}
+
+double AtlasPacker::GetOccupancy(int _page) const
+{
+    return double(m_pages[_page].m_usedArea) / (double(m_pageSize.width()) * m_pageSize.height());
+}
+
+bool AtlasPacker::IsFull(Page const& _page, int _height) const
+{
+    int lowest = m_pageSize.height() + m_padding;
+    for (Segment const& segment : _page.m_skyline)
+    {
+        lowest = qMin(lowest, segment.m_y);
+    }
+    return lowest + _height > m_pageSize.height() + m_padding;
+}
+
+//-----------------------------------------------------
+// Bottom-left rule: the spot whose bottom edge is the
+// highest on the page, then the leftmost one
+//-----------------------------------------------------
+bool AtlasPacker::FindPosition(Page const& _page, int _width, int _height, int& _segment, QPoint& _pos) const
+{
+    int const pageWidth = m_pageSize.width() + m_padding;
+    int const pageHeight = m_pageSize.height() + m_padding;
+    QVector<Segment> const& skyline = _page.m_skyline;
+
+    int bestBottom = pageHeight + 1;
+    for (int i = 0; i < skyline.size(); i++)
+    {
+        int const x = skyline[i].m_x;
+        if (x + _width > pageWidth) break;
+
+        // Resting height over every segment the rectangle spans
+        int y = 0;
+        int remaining = _width;
+        for (int j = i; remaining > 0; j++)
+        {
+            y = qMax(y, skyline[j].m_y);
+            remaining -= skyline[j].m_width;
+        }
+
+        int const bottom = y + _height;
+        if (bottom <= pageHeight && bottom < bestBottom)
+        {
+            bestBottom = bottom;
+            _segment = i;
+            _pos = QPoint(x, y);
+        }
+    }
+
+    return bestBottom <= pageHeight;
+}
+
+//-----------------------------------------------------
+// Raise the skyline under the rectangle, then merge
+// neighbours left at the same height
+//-----------------------------------------------------
+void AtlasPacker::Place(Page& _page, int _segment, QRect const& _rect)
+{
+    QVector<Segment>& skyline = _page.m_skyline;
+    skyline.insert(_segment, Segment{_rect.x(), _rect.y() + _rect.height(), _rect.width()});
+
+    int const right = _rect.x() + _rect.width();
+    int i = _segment + 1;
+    while (i < skyline.size() && skyline[i].m_x < right)
+    {
+        int const overlap = right - skyline[i].m_x;
+        if (overlap >= skyline[i].m_width)
+        {
+            skyline.removeAt(i);
+            continue;
+        }
+
+        skyline[i].m_x += overlap;
+        skyline[i].m_width -= overlap;
+        break;
+    }
+
+    for (i = 1; i < skyline.size();)
+    {
+        if (skyline[i - 1].m_y == skyline[i].m_y)
+        {
+            skyline[i - 1].m_width += skyline[i].m_width;
+            skyline.removeAt(i);
+        }
+        else
+        {
+            i++;
+        }
+    }
+}
@@ -0,0 +1,66 @@
+#ifndef ATLASPACKER_H
+#define ATLASPACKER_H
+
+#include <QRect>
+#include <QSize>
+#include <QVector>
+
+//-----------------------------------------------------
+// Skyline packer for glyph pages, each rectangle goes to
+// the lowest spot of the first page it fits on
+//-----------------------------------------------------
+class AtlasPacker
+{
+public:
+    enum SortMode : int
+    {
+        SM_Height = 0,
+        SM_Area,
+        SM_Width,
+        SM_None
+    };
+
+    struct Placement
+    {
+        int m_page;     // -1 if larger than a page
+        QRect m_rect;
+    };
+
+    AtlasPacker();
+    AtlasPacker(QSize const& _pageSize, int _padding);
+
+    // Placements are returned in input order
+    QVector<Placement> Pack(QVector<QSize> const& _sizes, SortMode _sort);
+
+    // Packs more rectangles after the last page's, earlier
+    // pages are left as they are
+    QVector<Placement> Append(QVector<QSize> const& _sizes, SortMode _sort);
+
+    int GetPageCount() const { return m_pages.size(); }
+    double GetOccupancy(int _page) const;
+
+private:
+    struct Segment
+    {
+        int m_x;
+        int m_y;
+        int m_width;
+    };
+
+    struct Page
+    {
+        QVector<Segment> m_skyline;
+        qint64 m_usedArea;
+    };
+
+    bool IsFull(Page const& _page, int _height) const;
+    bool FindPosition(Page const& _page, int _width, int _height, int& _segment, QPoint& _pos) const;
+    void Place(Page& _page, int _segment, QRect const& _rect);
+
+private:
+    QSize m_pageSize;
+    int m_padding;
+    QVector<Page> m_pages;
+};
+
+#endif // ATLASPACKER_H
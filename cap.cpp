@@ -0,0 +1,179 @@
+#include "cap.h"
+#include "tracer.h"
+
+#include <QFile>
+#include <QSaveFile>
+#include <QXmlStreamReader>
+#include <QXmlStreamWriter>
+
+cap::cap()
+{
+    Reset();
+}
+
+void cap::Reset()
+{
+    m_fcoFile.clear();
+    m_captions.clear();
+}
+
+//-----------------------------------------------------
+// Read a .cap file in one pass
+//-----------------------------------------------------
+bool cap::Load
+(
+    QString const& _fileName,
+    QString& _errorMsg
+)
+{
+    TRACE_SCOPE("cap", "Read");
+    Reset();
+
+    QFile file(_fileName);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        _errorMsg = "Fail to load .cap file!";
+        return false;
+    }
+
+    QXmlStreamReader reader(&file);
+
+    // <CaptionList File="..." TimeUnit="frame">
+    if (!reader.readNextStartElement() || reader.name() != QLatin1String("CaptionList"))
+    {
+        _errorMsg = reader.hasError() ? reader.errorString() : "Missing element \"CaptionList\"!";
+        return false;
+    }
+
+    m_fcoFile = reader.attributes().value("File").toString();
+    if (m_fcoFile.isEmpty())
+    {
+        _errorMsg = "CaptionList missing attribute \"File\"!";
+        return false;
+    }
+
+    while (reader.readNextStartElement())
+    {
+        if (reader.name() != QLatin1String("Caption"))
+        {
+            reader.skipCurrentElement();
+            continue;
+        }
+
+        // <Caption Name="..." Group="...">
+        Caption caption;
+        QXmlStreamAttributes const captionAttributes = reader.attributes();
+        caption.m_name = captionAttributes.value("Name").toString();
+        caption.m_group = captionAttributes.value("Group").toString();
+        if (caption.m_name.isEmpty())
+        {
+            _errorMsg = "Caption missing attribute \"Name\"!";
+            Reset();
+            return false;
+        }
+
+        while (reader.readNextStartElement())
+        {
+            if (reader.name() != QLatin1String("Text"))
+            {
+                reader.skipCurrentElement();
+                continue;
+            }
+
+            // <Text Start="..." Length="..." Group="..." Cell="..."/>
+            QXmlStreamAttributes const textAttributes = reader.attributes();
+            bool startIsNumber = false;
+            bool lengthIsNumber = false;
+
+            Text text;
+            text.m_start = textAttributes.value("Start").toInt(&startIsNumber);
+            text.m_length = textAttributes.value("Length").toInt(&lengthIsNumber);
+            text.m_cell = textAttributes.value("Cell").toString();
+            text.m_group = textAttributes.value("Group").toString();
+            if (!startIsNumber || !lengthIsNumber || text.m_cell.isEmpty())
+            {
+                _errorMsg = "In Caption (Name: " + caption.m_name + "):\nText has invalid attribute \"Start\", \"Length\" or \"Cell\"!";
+                Reset();
+                return false;
+            }
+
+            caption.m_texts.push_back(text);
+            reader.skipCurrentElement();
+        }
+
+        m_captions.push_back(caption);
+    }
+
+    if (reader.hasError())
+    {
+        _errorMsg = "Line " + QString::number(reader.lineNumber()) + ": " + reader.errorString();
+        Reset();
+        return false;
+    }
+
+    return true;
+}
+
+//-----------------------------------------------------
+// Write a .cap file in one pass, the old file is only
+// replaced once everything was written
+//-----------------------------------------------------
+bool cap::Save
+(
+    QString const& _fileName,
+    QString& _errorMsg
+) const
+{
+    TRACE_SCOPE("cap", "Write");
+
+    QSaveFile file(_fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
+    {
+        _errorMsg = "Fail to write .cap file!";
+        return false;
+    }
+
+    // Same layout QDomDocument::toString() used to produce
+    QXmlStreamWriter writer(&file);
+    writer.setAutoFormatting(true);
+    writer.setAutoFormattingIndent(1);
+    writer.writeProcessingInstruction("xml", "version=\"1.0\" encoding=\"utf-8\" standalone=\"no\"");
+
+    writer.writeStartElement("CaptionList");
+    writer.writeAttribute("File", m_fcoFile);
+    writer.writeAttribute("TimeUnit", "frame");
+
+    for (Caption const& caption : m_captions)
+    {
+        writer.writeStartElement("Caption");
+        writer.writeAttribute("Name", caption.m_name);
+        if (!caption.m_group.isEmpty())
+        {
+            writer.writeAttribute("Group", caption.m_group);
+        }
+
+        for (Text const& text : caption.m_texts)
+        {
+            writer.writeEmptyElement("Text");
+            writer.writeAttribute("Start", QString::number(text.m_start));
+            writer.writeAttribute("Length", QString::number(text.m_length));
+            if (!text.m_group.isEmpty())
+            {
+                writer.writeAttribute("Group", text.m_group);
+            }
+            writer.writeAttribute("Cell", text.m_cell);
+        }
+
+        writer.writeEndElement();
+    }
+
+    writer.writeEndDocument();
+
+    if (writer.hasError() || !file.commit())
+    {
+        _errorMsg = "Fail to write .cap file!";
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,41 @@
+#ifndef CAP_H
+#define CAP_H
+
+#include <QString>
+#include <QVector>
+
+//-----------------------------------------------------
+// Event caption list (.cap), streamed straight between
+// the xml file and these structures
+//-----------------------------------------------------
+class cap
+{
+public:
+    struct Text
+    {
+        int m_start;
+        int m_length;
+        QString m_cell;
+        QString m_group;    // Empty uses the caption's group
+    };
+
+    struct Caption
+    {
+        QString m_name;
+        QString m_group;
+        QVector<Text> m_texts;
+    };
+
+    cap();
+    void Reset();
+
+    // Import & Export
+    bool Load(QString const& _fileName, QString& _errorMsg);
+    bool Save(QString const& _fileName, QString& _errorMsg) const;
+
+public:
+    QString m_fcoFile;
+    QVector<Caption> m_captions;
+};
+
+#endif // CAP_H
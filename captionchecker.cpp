@@ -0,0 +1,354 @@
+#include "captionchecker.h"
+
+#include <QtConcurrent>
+
+#include "tracer.h"
+
+CaptionIntervalTree::CaptionIntervalTree()
+{
+    m_root = -1;
+    m_seed = 2463534242u;
+}
+
+//-----------------------------------------------------
+// Index all texts of a cutscene
+//-----------------------------------------------------
+void CaptionIntervalTree::Build(QVector<cap::Text> const& _texts)
+{
+    Clear();
+    m_nodes.reserve(_texts.size());
+    for (int i = 0; i < _texts.size(); i++)
+    {
+        Insert(i, _texts[i].m_start, _texts[i].m_start + _texts[i].m_length);
+    }
+}
+
+void CaptionIntervalTree::Clear()
+{
+    m_nodes.clear();
+    m_freeNodes.clear();
+    m_nodeOf.clear();
+    m_root = -1;
+}
+
+void CaptionIntervalTree::Insert(int _id, int _start, int _end)
+{
+    int const node = AllocNode();
+    m_nodes[node] = Node{_id, _start, _end, _end, 0, -1, -1};
+
+    // xorshift32, only needs to look random to the treap
+    m_seed ^= m_seed << 13;
+    m_seed ^= m_seed >> 17;
+    m_seed ^= m_seed << 5;
+    m_nodes[node].m_priority = m_seed;
+
+    if (_id >= m_nodeOf.size())
+    {
+        m_nodeOf.resize(_id + 1);
+    }
+    m_nodeOf[_id] = node;
+
+    int left = -1;
+    int right = -1;
+    Split(m_root, _start, _id, left, right);
+    m_root = Merge(Merge(left, node), right);
+}
+
+//-----------------------------------------------------
+// Cut the single node keyed (start, id) out of the tree
+//-----------------------------------------------------
+void CaptionIntervalTree::Remove(int _id)
+{
+    int const node = m_nodeOf[_id];
+    int const start = m_nodes[node].m_start;
+
+    int left = -1;
+    int middle = -1;
+    int right = -1;
+    Split(m_root, start, _id, left, right);
+    Split(right, start, _id + 1, middle, right);
+    m_root = Merge(left, right);
+
+    m_nodeOf[_id] = -1;
+    m_freeNodes.push_back(node);
+}
+
+//-----------------------------------------------------
+// Texts after a removed one move down by one index,
+// this keeps the relative order of every key
+//-----------------------------------------------------
+void CaptionIntervalTree::RemoveAndRenumber(int _id)
+{
+    Remove(_id);
+    m_nodeOf.removeAt(_id);
+    for (int i = _id; i < m_nodeOf.size(); i++)
+    {
+        m_nodes[m_nodeOf[i]].m_id = i;
+    }
+}
+
+bool CaptionIntervalTree::HasOverlap(int _id, int _start, int _end) const
+{
+    return FindOverlaps(m_root, _id, _start, _end, nullptr);
+}
+
+void CaptionIntervalTree::FindOverlaps(int _id, int _start, int _end, QVector<int>& _ids) const
+{
+    FindOverlaps(m_root, _id, _start, _end, &_ids);
+}
+
+//-----------------------------------------------------
+// Walk towards the key, every left turn skipped leaves
+// a whole subtree that is ordered before it
+//-----------------------------------------------------
+int CaptionIntervalTree::PreviousEnd(int _id, int _start) const
+{
+    int result = -1;
+    int node = m_root;
+    while (node != -1)
+    {
+        Node const& current = m_nodes[node];
+        if (IsBefore(current, _start, _id))
+        {
+            result = qMax(result, current.m_end);
+            if (current.m_left != -1)
+            {
+                result = qMax(result, m_nodes[current.m_left].m_maxEnd);
+            }
+            node = current.m_right;
+        }
+        else
+        {
+            node = current.m_left;
+        }
+    }
+    return result;
+}
+
+bool CaptionIntervalTree::IsBefore(Node const& _node, int _start, int _id) const
+{
+    return _node.m_start < _start || (_node.m_start == _start && _node.m_id < _id);
+}
+
+void CaptionIntervalTree::Update(int _node)
+{
+    Node& node = m_nodes[_node];
+    node.m_maxEnd = node.m_end;
+    if (node.m_left != -1) node.m_maxEnd = qMax(node.m_maxEnd, m_nodes[node.m_left].m_maxEnd);
+    if (node.m_right != -1) node.m_maxEnd = qMax(node.m_maxEnd, m_nodes[node.m_right].m_maxEnd);
+}
+
+//-----------------------------------------------------
+// _left gets keys before (_start, _id), _right the rest
+//-----------------------------------------------------
+void CaptionIntervalTree::Split(int _node, int _start, int _id, int& _left, int& _right)
+{
+    if (_node == -1)
+    {
+        _left = -1;
+        _right = -1;
+        return;
+    }
+
+    if (IsBefore(m_nodes[_node], _start, _id))
+    {
+        int right = -1;
+        Split(m_nodes[_node].m_right, _start, _id, m_nodes[_node].m_right, right);
+        _left = _node;
+        _right = right;
+    }
+    else
+    {
+        int left = -1;
+        Split(m_nodes[_node].m_left, _start, _id, left, m_nodes[_node].m_left);
+        _left = left;
+        _right = _node;
+    }
+    Update(_node);
+}
+
+//-----------------------------------------------------
+// Every key in _left is ordered before every key in _right
+//-----------------------------------------------------
+int CaptionIntervalTree::Merge(int _left, int _right)
+{
+    if (_left == -1) return _right;
+    if (_right == -1) return _left;
+
+    if (m_nodes[_left].m_priority > m_nodes[_right].m_priority)
+    {
+        int const right = Merge(m_nodes[_left].m_right, _right);
+        m_nodes[_left].m_right = right;
+        Update(_left);
+        return _left;
+    }
+
+    int const left = Merge(_left, m_nodes[_right].m_left);
+    m_nodes[_right].m_left = left;
+    Update(_right);
+    return _right;
+}
+
+int CaptionIntervalTree::AllocNode()
+{
+    if (!m_freeNodes.isEmpty())
+    {
+        return m_freeNodes.takeLast();
+    }
+
+    m_nodes.push_back(Node());
+    return m_nodes.size() - 1;
+}
+
+//-----------------------------------------------------
+// Subtrees ending before _start or starting after _end
+// are never visited, returns early without _ids
+//-----------------------------------------------------
+bool CaptionIntervalTree::FindOverlaps(int _node, int _id, int _start, int _end, QVector<int>* _ids) const
+{
+    if (_node == -1 || m_nodes[_node].m_maxEnd <= _start)
+    {
+        return false;
+    }
+
+    Node const& node = m_nodes[_node];
+    bool found = FindOverlaps(node.m_left, _id, _start, _end, _ids);
+    if (found && !_ids) return true;
+
+    if (node.m_start >= _end)
+    {
+        return found;
+    }
+
+    if (node.m_id != _id && node.m_end > _start)
+    {
+        if (!_ids) return true;
+        _ids->push_back(node.m_id);
+        found = true;
+    }
+
+    return FindOverlaps(node.m_right, _id, _start, _end, _ids) || found;
+}
+
+//-----------------------------------------------------
+// Flags of one text, optionally listing each issue
+//-----------------------------------------------------
+int CaptionChecker::CheckText
+(
+    CaptionIntervalTree const& _tree,
+    QVector<cap::Text> const& _texts,
+    int _index,
+    QVector<Issue>* _issues
+)
+{
+    cap::Text const& text = _texts[_index];
+    int const end = text.m_start + text.m_length;
+    int flags = 0;
+
+    if (text.m_length < c_minLength)
+    {
+        flags |= IF_TooShort;
+        if (_issues) _issues->push_back(Issue{IF_TooShort, -1, _index, -1, text.m_length});
+    }
+
+    if (_issues)
+    {
+        QVector<int> others;
+        _tree.FindOverlaps(_index, text.m_start, end, others);
+        for (int other : others)
+        {
+            flags |= IF_Overlap;
+            _issues->push_back(Issue{IF_Overlap, -1, _index, other, 0});
+        }
+    }
+    else if (_tree.HasOverlap(_index, text.m_start, end))
+    {
+        flags |= IF_Overlap;
+    }
+
+    int const previousEnd = _tree.PreviousEnd(_index, text.m_start);
+    int const gap = text.m_start - previousEnd;
+    if (previousEnd != -1 && gap > 0 && gap < c_minGap)
+    {
+        flags |= IF_Gap;
+        if (_issues) _issues->push_back(Issue{IF_Gap, -1, _index, -1, gap});
+    }
+
+    return flags;
+}
+
+//-----------------------------------------------------
+// All issues of a cutscene, each overlapping pair is
+// only reported by the text that starts first
+//-----------------------------------------------------
+QVector<CaptionChecker::Issue> CaptionChecker::CheckCaption(cap::Caption const& _caption)
+{
+    QVector<cap::Text> const& texts = _caption.m_texts;
+    CaptionIntervalTree tree;
+    tree.Build(texts);
+
+    QVector<Issue> issues;
+    QVector<Issue> textIssues;
+    for (int i = 0; i < texts.size(); i++)
+    {
+        textIssues.clear();
+        CheckText(tree, texts, i, &textIssues);
+        for (Issue const& issue : textIssues)
+        {
+            if (issue.m_type == IF_Overlap)
+            {
+                cap::Text const& other = texts[issue.m_other];
+                bool const otherFirst = other.m_start < texts[i].m_start || (other.m_start == texts[i].m_start && issue.m_other < i);
+                if (otherFirst) continue;
+            }
+            issues.push_back(issue);
+        }
+    }
+
+    return issues;
+}
+
+//-----------------------------------------------------
+// Check every cutscene of a file in parallel
+//-----------------------------------------------------
+QVector<CaptionChecker::Issue> CaptionChecker::CheckCap(cap const& _cap)
+{
+    TRACE_SCOPE("cap", "Check");
+
+    QVector<QVector<Issue>> const results = QtConcurrent::blockingMapped<QVector<QVector<Issue>>>(_cap.m_captions, &CaptionChecker::CheckCaption);
+
+    QVector<Issue> issues;
+    for (int i = 0; i < results.size(); i++)
+    {
+        for (Issue issue : results[i])
+        {
+            issue.m_cutscene = i;
+            issues.push_back(issue);
+        }
+    }
+
+    return issues;
+}
+
+//-----------------------------------------------------
+// One line for the report and the editor
+//-----------------------------------------------------
+QString CaptionChecker::Describe(Issue const& _issue, QVector<cap::Text> const& _texts)
+{
+    switch (_issue.m_type)
+    {
+    case IF_Overlap:
+    {
+        cap::Text const& other = _texts[_issue.m_other];
+        return "Overlaps " + other.m_cell + " (" + QString::number(other.m_start) + "-" + QString::number(other.m_start + other.m_length - 1) + ")";
+    }
+    case IF_Gap:
+        return "Gap of " + QString::number(_issue.m_frames) + " frame(s) before it, at least " + QString::number(c_minGap) + " needed";
+    case IF_TooShort:
+        return "Shown for " + QString::number(_issue.m_frames) + " frame(s), at least " + QString::number(c_minLength) + " needed";
+    case IF_Missing:
+        return "Not found in the .fco file";
+    }
+
+    return QString();
+}
@@ -0,0 +1,97 @@
+#ifndef CAPTIONCHECKER_H
+#define CAPTIONCHECKER_H
+
+#include <QString>
+#include <QVector>
+
+#include "cap.h"
+
+//-----------------------------------------------------
+// Treap of the texts of one cutscene keyed by start,
+// each node keeps the latest end of its subtree so
+// overlap queries skip whole branches
+//-----------------------------------------------------
+class CaptionIntervalTree
+{
+public:
+    CaptionIntervalTree();
+
+    void Build(QVector<cap::Text> const& _texts);
+    void Clear();
+
+    // Ids are text indices, [_start, _end) in frames
+    void Insert(int _id, int _start, int _end);
+    void Remove(int _id);
+    void RemoveAndRenumber(int _id);
+
+    // Texts other than _id overlapping [_start, _end)
+    bool HasOverlap(int _id, int _start, int _end) const;
+    void FindOverlaps(int _id, int _start, int _end, QVector<int>& _ids) const;
+
+    // Latest end of the texts ordered before (_start, _id), -1 if none
+    int PreviousEnd(int _id, int _start) const;
+
+private:
+    struct Node
+    {
+        int m_id;
+        int m_start;
+        int m_end;
+        int m_maxEnd;
+        quint32 m_priority;
+        int m_left;
+        int m_right;
+    };
+
+    bool IsBefore(Node const& _node, int _start, int _id) const;
+    void Update(int _node);
+    void Split(int _node, int _start, int _id, int& _left, int& _right);
+    int Merge(int _left, int _right);
+    int AllocNode();
+    bool FindOverlaps(int _node, int _id, int _start, int _end, QVector<int>* _ids) const;
+
+private:
+    QVector<Node> m_nodes;
+    QVector<int> m_freeNodes;
+    QVector<int> m_nodeOf;
+    int m_root;
+    quint32 m_seed;
+};
+
+//-----------------------------------------------------
+// Timing checks of texts in a cutscene
+//-----------------------------------------------------
+class CaptionChecker
+{
+public:
+    enum IssueFlag : int
+    {
+        IF_Overlap  = 1 << 0,
+        IF_Gap      = 1 << 1,
+        IF_TooShort = 1 << 2,
+        IF_Missing  = 1 << 3,
+    };
+
+    struct Issue
+    {
+        IssueFlag m_type;
+        int m_cutscene;
+        int m_text;
+        int m_other;    // overlapping text, -1 otherwise
+        int m_frames;   // gap or length in frames
+    };
+
+    // Texts shorter than this can't be read in time
+    static int const c_minLength = 30;
+
+    // Gaps shorter than this make the subtitle flicker
+    static int const c_minGap = 3;
+
+    static int CheckText(CaptionIntervalTree const& _tree, QVector<cap::Text> const& _texts, int _index, QVector<Issue>* _issues = nullptr);
+    static QVector<Issue> CheckCaption(cap::Caption const& _caption);
+    static QVector<Issue> CheckCap(cap const& _cap);
+
+    static QString Describe(Issue const& _issue, QVector<cap::Text> const& _texts);
+};
+
+#endif // CAPTIONCHECKER_H
@@ -0,0 +1,111 @@
+#include "captionframeindex.h"
+
+#include <algorithm>
+
+#include "tracer.h"
+
+CaptionFrameIndex::CaptionFrameIndex()
+{
+    Clear();
+}
+
+//-----------------------------------------------------
+// Sweep the start and end frames in order, the active
+// list at each boundary becomes one segment
+//-----------------------------------------------------
+void CaptionFrameIndex::Build(QVector<cap::Text> const& _texts)
+{
+    TRACE_SCOPE("cap", "Frame Index");
+
+    m_starts.clear();
+    m_activeBegin.clear();
+    m_active.clear();
+    m_lastFrame = 0;
+
+    // Frames before the first text are an empty segment
+    int const count = _texts.size();
+    m_starts.reserve(count * 2 + 1);
+    m_starts.push_back(0);
+    QVector<int> byStart(count);
+    QVector<int> byEnd(count);
+    for (int i = 0; i < count; i++)
+    {
+        byStart[i] = i;
+        byEnd[i] = i;
+        m_starts.push_back(_texts[i].m_start);
+        m_starts.push_back(_texts[i].m_start + _texts[i].m_length);
+        m_lastFrame = qMax(m_lastFrame, _texts[i].m_start + _texts[i].m_length - 1);
+    }
+    std::sort(m_starts.begin(), m_starts.end());
+    m_starts.erase(std::unique(m_starts.begin(), m_starts.end()), m_starts.end());
+
+    std::sort(byStart.begin(), byStart.end(), [&_texts](int _a, int _b)
+    {
+        return _texts[_a].m_start < _texts[_b].m_start || (_texts[_a].m_start == _texts[_b].m_start && _a < _b);
+    });
+    std::sort(byEnd.begin(), byEnd.end(), [&_texts](int _a, int _b)
+    {
+        return _texts[_a].m_start + _texts[_a].m_length < _texts[_b].m_start + _texts[_b].m_length;
+    });
+
+    QVector<int> active;
+    int nextStart = 0;
+    int nextEnd = 0;
+    m_activeBegin.reserve(m_starts.size() + 1);
+    for (int frame : m_starts)
+    {
+        // Starts are appended in order, so active stays sorted by start
+        while (nextStart < count && _texts[byStart[nextStart]].m_start <= frame)
+        {
+            active.push_back(byStart[nextStart++]);
+        }
+        while (nextEnd < count && _texts[byEnd[nextEnd]].m_start + _texts[byEnd[nextEnd]].m_length <= frame)
+        {
+            active.removeOne(byEnd[nextEnd++]);
+        }
+
+        m_activeBegin.push_back(m_active.size());
+        m_active += active;
+    }
+    m_activeBegin.push_back(m_active.size());
+}
+
+//-----------------------------------------------------
+// A single empty segment from frame 0
+//-----------------------------------------------------
+void CaptionFrameIndex::Clear()
+{
+    m_starts.clear();
+    m_activeBegin.clear();
+    m_active.clear();
+    m_starts.push_back(0);
+    m_activeBegin.push_back(0);
+    m_activeBegin.push_back(0);
+    m_lastFrame = 0;
+}
+
+void CaptionFrameIndex::GetActive(int _segment, QVector<int>& _texts) const
+{
+    _texts.clear();
+    for (int i = m_activeBegin[_segment]; i < m_activeBegin[_segment + 1]; i++)
+    {
+        _texts.push_back(m_active[i]);
+    }
+}
+
+int CaptionFrameIndex::SegmentAt(int _frame, int _hint) const
+{
+    auto const contains = [this, _frame](int _segment)
+    {
+        return m_starts[_segment] <= _frame && (_segment + 1 == m_starts.size() || _frame < m_starts[_segment + 1]);
+    };
+
+    if (_hint >= 0 && _hint < m_starts.size())
+    {
+        if (contains(_hint)) return _hint;
+        if (_hint + 1 < m_starts.size() && contains(_hint + 1)) return _hint + 1;
+    }
+
+    auto const next = std::upper_bound(m_starts.begin(), m_starts.end(), _frame);
+    return qMax(0, static_cast<int>(next - m_starts.begin()) - 1);
+}
@@ -0,0 +1,41 @@
+#ifndef CAPTIONFRAMEINDEX_H
+#define CAPTIONFRAMEINDEX_H
+
+#include <QVector>
+
+#include "cap.h"
+
+//-----------------------------------------------------
+// Frames of a cutscene split into segments wherever a
+// text starts or ends, every frame of a segment shows
+// the same texts so playback only looks up segments
+//-----------------------------------------------------
+class CaptionFrameIndex
+{
+public:
+    CaptionFrameIndex();
+
+    void Build(QVector<cap::Text> const& _texts);
+    void Clear();
+
+    int GetSegmentCount() const { return m_starts.size(); }
+    int GetSegmentStart(int _segment) const { return m_starts[_segment]; }
+    int GetLastFrame() const { return m_lastFrame; }
+
+    // Texts shown in a segment, ordered by start
+    void GetActive(int _segment, QVector<int>& _texts) const;
+
+    // _hint is the previous segment, sequential frames
+    // are answered without searching
+    int SegmentAt(int _frame, int _hint = -1) const;
+
+private:
+    // Segment i covers [m_starts[i], m_starts[i + 1]) and
+    // shows m_active[m_activeBegin[i] .. m_activeBegin[i + 1])
+    QVector<int> m_starts;
+    QVector<int> m_activeBegin;
+    QVector<int> m_active;
+    int m_lastFrame;
+};
+
+#endif // CAPTIONFRAMEINDEX_H
@@ -0,0 +1,443 @@
+#include "captionmodel.h"
+
+#include <algorithm>
+
+#include "tracer.h"
+
+//-----------------------------------------------------
+// Cutscene rows have no internal pointer, text rows
+// point to the CutsceneNode of their parent
+//-----------------------------------------------------
+CaptionModel::CaptionModel(QObject *parent) :
+    QAbstractItemModel(parent)
+{
+    m_highlight = -1;
+    m_references = Q_NULLPTR;
+}
+
+CaptionModel::~CaptionModel()
+{
+    ClearNodes();
+}
+
+//-----------------------------------------------------
+// Take over a loaded .cap file
+//-----------------------------------------------------
+void CaptionModel::SetCap(cap const& _cap)
+{
+    TRACE_SCOPE("cap", "Model Reset");
+
+    beginResetModel();
+    ClearNodes();
+    m_cap = _cap;
+    m_highlight = -1;
+    m_nodes.reserve(m_cap.m_captions.size());
+    for (int i = 0; i < m_cap.m_captions.size(); i++)
+    {
+        m_nodes.push_back(new CutsceneNode{i});
+    }
+    endResetModel();
+}
+
+void CaptionModel::Clear()
+{
+    SetCap(cap());
+}
+
+//-----------------------------------------------------
+// Append a cutscene without texts
+//-----------------------------------------------------
+int CaptionModel::AddCutscene(QString const& _name, QString const& _group)
+{
+    int const row = m_nodes.size();
+    beginInsertRows(QModelIndex(), row, row);
+    cap::Caption caption;
+    caption.m_name = _name;
+    caption.m_group = _group;
+    m_cap.m_captions.push_back(caption);
+    m_nodes.push_back(new CutsceneNode{row});
+    endInsertRows();
+
+    return row;
+}
+
+//-----------------------------------------------------
+// Remove a cutscene and its texts
+//-----------------------------------------------------
+void CaptionModel::DeleteCutscene(int _row)
+{
+    if (_row < 0 || _row >= m_nodes.size())
+    {
+        return;
+    }
+
+    beginRemoveRows(QModelIndex(), _row, _row);
+    m_cap.m_captions.removeAt(_row);
+    delete m_nodes.takeAt(_row);
+    UpdateNodeRows(_row);
+
+    if (m_highlight == _row)
+    {
+        m_highlight = -1;
+    }
+    else if (m_highlight > _row)
+    {
+        m_highlight--;
+    }
+    endRemoveRows();
+}
+
+//-----------------------------------------------------
+// Cutscene name and default group
+//-----------------------------------------------------
+void CaptionModel::SetCutscene(int _row, QString const& _name, QString const& _group)
+{
+    cap::Caption& caption = m_cap.m_captions[_row];
+    caption.m_name = _name;
+    caption.m_group = _group;
+
+    emit dataChanged(CutsceneIndex(_row, CT_Name), CutsceneIndex(_row, CT_Group));
+}
+
+//-----------------------------------------------------
+// Replace the texts of a cutscene, rows that still
+// exist are updated in place
+//-----------------------------------------------------
+void CaptionModel::SetTexts(int _row, QVector<cap::Text> const& _texts)
+{
+    QVector<cap::Text>& texts = m_cap.m_captions[_row].m_texts;
+    QModelIndex const parent = CutsceneIndex(_row);
+    int const oldCount = texts.size();
+    int const newCount = _texts.size();
+
+    if (newCount < oldCount)
+    {
+        beginRemoveRows(parent, newCount, oldCount - 1);
+        texts = _texts;
+        endRemoveRows();
+    }
+    else if (newCount > oldCount)
+    {
+        beginInsertRows(parent, oldCount, newCount - 1);
+        texts = _texts;
+        endInsertRows();
+    }
+    else
+    {
+        texts = _texts;
+    }
+
+    int const common = qMin(oldCount, newCount);
+    if (common > 0)
+    {
+        emit dataChanged(index(0, CT_Group, parent), index(common - 1, CT_Length, parent));
+    }
+}
+
+//-----------------------------------------------------
+// Reorder cutscenes, texts keep their own order
+//-----------------------------------------------------
+void CaptionModel::SortByName(Qt::SortOrder _order)
+{
+    TRACE_SCOPE("cap", "Sort");
+
+    emit layoutAboutToBeChanged(QList<QPersistentModelIndex>(), QAbstractItemModel::VerticalSortHint);
+
+    // Sort a permutation so nodes and captions move together
+    QVector<int> order(m_nodes.size());
+    for (int i = 0; i < order.size(); i++)
+    {
+        order[i] = i;
+    }
+    QVector<cap::Caption> const& captions = m_cap.m_captions;
+    std::stable_sort(order.begin(), order.end(), [&captions, _order](int _a, int _b)
+    {
+        return _order == Qt::AscendingOrder ? captions[_a].m_name < captions[_b].m_name : captions[_b].m_name < captions[_a].m_name;
+    });
+
+    QVector<cap::Caption> sortedCaptions;
+    QVector<CutsceneNode*> sortedNodes;
+    sortedCaptions.reserve(order.size());
+    sortedNodes.reserve(order.size());
+    for (int oldRow : order)
+    {
+        sortedCaptions.push_back(m_cap.m_captions[oldRow]);
+        sortedNodes.push_back(m_nodes[oldRow]);
+    }
+    m_cap.m_captions = sortedCaptions;
+    m_nodes = sortedNodes;
+
+    // Text indices follow their node, only cutscene indices move
+    QVector<int> newRows(m_nodes.size());
+    for (int i = 0; i < m_nodes.size(); i++)
+    {
+        newRows[m_nodes[i]->m_row] = i;
+        m_nodes[i]->m_row = i;
+    }
+
+    QModelIndexList const oldIndices = persistentIndexList();
+    QModelIndexList newIndices;
+    newIndices.reserve(oldIndices.size());
+    for (QModelIndex const& oldIndex : oldIndices)
+    {
+        newIndices.push_back(IsText(oldIndex) ? oldIndex : createIndex(newRows[oldIndex.row()], oldIndex.column(), nullptr));
+    }
+    changePersistentIndexList(oldIndices, newIndices);
+
+    if (m_highlight != -1)
+    {
+        m_highlight = newRows[m_highlight];
+    }
+
+    emit layoutChanged(QList<QPersistentModelIndex>(), QAbstractItemModel::VerticalSortHint);
+}
+
+void CaptionModel::SetReferences(CaptionReferences const* _references)
+{
+    m_references = _references;
+}
+
+//-----------------------------------------------------
+// Repaint only the texts whose fco entry came or went
+//-----------------------------------------------------
+void CaptionModel::ReferencesChanged(QVector<CaptionReferences::Ref> const& _refs)
+{
+    for (CaptionReferences::Ref const& ref : _refs)
+    {
+        QModelIndex const cutscene = CutsceneIndex(ref.m_cutscene);
+        if (!cutscene.isValid() || ref.m_text >= m_cap.m_captions[ref.m_cutscene].m_texts.size()) continue;
+
+        emit dataChanged(index(ref.m_text, CT_Name, cutscene), index(ref.m_text, CT_COUNT - 1, cutscene));
+    }
+}
+
+//-----------------------------------------------------
+// Mark the cutscene currently loaded in the editor
+//-----------------------------------------------------
+void CaptionModel::SetHighlight(int _row)
+{
+    int const oldRow = m_highlight;
+    m_highlight = _row;
+
+    EmitCutsceneChanged(oldRow);
+    EmitCutsceneChanged(_row);
+}
+
+//-----------------------------------------------------
+// Index of a cutscene row
+//-----------------------------------------------------
+QModelIndex CaptionModel::CutsceneIndex(int _row, int _column) const
+{
+    if (_row < 0 || _row >= m_nodes.size())
+    {
+        return QModelIndex();
+    }
+
+    return createIndex(_row, _column, nullptr);
+}
+
+//-----------------------------------------------------
+// Index type helpers
+//-----------------------------------------------------
+bool CaptionModel::IsText(QModelIndex const& _index) const
+{
+    return _index.isValid() && _index.internalPointer() != nullptr;
+}
+
+int CaptionModel::GetCutsceneRow(QModelIndex const& _index) const
+{
+    if (!_index.isValid()) return -1;
+    return IsText(_index) ? static_cast<CutsceneNode*>(_index.internalPointer())->m_row : _index.row();
+}
+
+int CaptionModel::GetTextRow(QModelIndex const& _index) const
+{
+    return IsText(_index) ? _index.row() : -1;
+}
+
+//-----------------------------------------------------
+// QAbstractItemModel
+//-----------------------------------------------------
+QModelIndex CaptionModel::index(int row, int column, QModelIndex const& parent) const
+{
+    if (row < 0 || column < 0 || column >= CT_COUNT)
+    {
+        return QModelIndex();
+    }
+
+    if (!parent.isValid())
+    {
+        return row < m_nodes.size() ? createIndex(row, column, nullptr) : QModelIndex();
+    }
+
+    // Texts have no children
+    if (IsText(parent) || row >= m_cap.m_captions[parent.row()].m_texts.size())
+    {
+        return QModelIndex();
+    }
+
+    return createIndex(row, column, m_nodes[parent.row()]);
+}
+
+QModelIndex CaptionModel::parent(QModelIndex const& child) const
+{
+    if (!IsText(child))
+    {
+        return QModelIndex();
+    }
+
+    CutsceneNode const* node = static_cast<CutsceneNode const*>(child.internalPointer());
+    return createIndex(node->m_row, CT_Name, nullptr);
+}
+
+int CaptionModel::rowCount(QModelIndex const& parent) const
+{
+    if (!parent.isValid())
+    {
+        return m_nodes.size();
+    }
+
+    if (IsText(parent) || parent.column() != CT_Name)
+    {
+        return 0;
+    }
+
+    return m_cap.m_captions[parent.row()].m_texts.size();
+}
+
+int CaptionModel::columnCount(QModelIndex const& parent) const
+{
+    Q_UNUSED(parent);
+    return CT_COUNT;
+}
+
+QVariant CaptionModel::data(QModelIndex const& index, int role) const
+{
+    if (!index.isValid())
+    {
+        return QVariant();
+    }
+
+    bool const isText = IsText(index);
+    int const cutsceneRow = GetCutsceneRow(index);
+    cap::Caption const& caption = m_cap.m_captions[cutsceneRow];
+
+    switch (role)
+    {
+    case Qt::DisplayRole:
+    {
+        if (isText)
+        {
+            cap::Text const& text = caption.m_texts[index.row()];
+            switch (index.column())
+            {
+            case CT_Group:  return text.m_group.isEmpty() ? QString("(default)") : text.m_group;
+            case CT_Cell:   return text.m_cell;
+            case CT_Start:  return text.m_start;
+            case CT_Length: return text.m_length;
+            }
+        }
+        else
+        {
+            switch (index.column())
+            {
+            case CT_Name:   return caption.m_name;
+            case CT_Group:  return caption.m_group;
+            }
+        }
+        break;
+    }
+    case Qt::ForegroundRole:
+    {
+        // Cutscene row only highlights name and group
+        bool const highlighted = cutsceneRow == m_highlight && (isText ? index.column() != CT_Name : index.column() <= CT_Group);
+        if (highlighted)
+        {
+            return QColor(255,0,0);
+        }
+        if (isText && m_references && !m_references->IsResolved(cutsceneRow, index.row()))
+        {
+            return QColor(160,160,160);
+        }
+        break;
+    }
+    case Qt::FontRole:
+    {
+        if (isText && m_references && !m_references->IsResolved(cutsceneRow, index.row()))
+        {
+            QFont font;
+            font.setStrikeOut(true);
+            return font;
+        }
+        break;
+    }
+    case Qt::ToolTipRole:
+    {
+        if (isText && m_references && !m_references->IsResolved(cutsceneRow, index.row()))
+        {
+            return QString("Not found in the .fco file");
+        }
+        break;
+    }
+    }
+
+    return QVariant();
+}
+
+QVariant CaptionModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole)
+    {
+        return QVariant();
+    }
+
+    switch (section)
+    {
+    case CT_Name:   return QString("Name");
+    case CT_Group:  return QString("Group");
+    case CT_Cell:   return QString("Cell");
+    case CT_Start:  return QString("Start");
+    case CT_Length: return QString("Length");
+    }
+
+    return QVariant();
+}
+
+//-----------------------------------------------------
+// Free all cutscene nodes
+//-----------------------------------------------------
+void CaptionModel::ClearNodes()
+{
+    qDeleteAll(m_nodes);
+    m_nodes.clear();
+}
+
+//-----------------------------------------------------
+// Re-number cutscene nodes from _first onwards
+//-----------------------------------------------------
+void CaptionModel::UpdateNodeRows(int _first)
+{
+    for (int i = _first; i < m_nodes.size(); i++)
+    {
+        m_nodes[i]->m_row = i;
+    }
+}
+
+//-----------------------------------------------------
+// Repaint a cutscene row and its texts
+//-----------------------------------------------------
+void CaptionModel::EmitCutsceneChanged(int _row)
+{
+    QModelIndex const cutscene = CutsceneIndex(_row);
+    if (!cutscene.isValid())
+    {
+        return;
+    }
+
+    emit dataChanged(cutscene, CutsceneIndex(_row, CT_COUNT - 1));
+    int const textCount = m_cap.m_captions[_row].m_texts.size();
+    if (textCount > 0)
+    {
+        emit dataChanged(index(0, CT_Name, cutscene), index(textCount - 1, CT_COUNT - 1, cutscene));
+    }
+}
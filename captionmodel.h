@@ -0,0 +1,92 @@
+#ifndef CAPTIONMODEL_H
+#define CAPTIONMODEL_H
+
+#include <QAbstractItemModel>
+#include <QColor>
+#include <QFont>
+#include <QVector>
+
+#include "cap.h"
+#include "captionreferences.h"
+
+//-----------------------------------------------------
+// Tree model owning the captions of a .cap file,
+// cutscenes on top and their texts as children
+//-----------------------------------------------------
+class CaptionModel : public QAbstractItemModel
+{
+    Q_OBJECT
+
+public:
+    enum ColumnType : int
+    {
+        CT_Name = 0,
+        CT_Group,
+        CT_Cell,
+        CT_Start,
+        CT_Length,
+
+        CT_COUNT
+    };
+
+public:
+    explicit CaptionModel(QObject *parent = nullptr);
+    ~CaptionModel() override;
+
+    // Document
+    void SetCap(cap const& _cap);
+    cap const& GetCap() const { return m_cap; }
+    void Clear();
+    void SetFcoFile(QString const& _fcoFile) { m_cap.m_fcoFile = _fcoFile; }
+
+    // Cutscenes
+    int GetCutsceneCount() const { return m_cap.m_captions.size(); }
+    cap::Caption const& GetCutscene(int _row) const { return m_cap.m_captions[_row]; }
+    int AddCutscene(QString const& _name, QString const& _group);
+    void DeleteCutscene(int _row);
+    void SetCutscene(int _row, QString const& _name, QString const& _group);
+    void SetTexts(int _row, QVector<cap::Text> const& _texts);
+    void SortByName(Qt::SortOrder _order);
+
+    // Texts without an fco entry are marked
+    void SetReferences(CaptionReferences const* _references);
+    void ReferencesChanged(QVector<CaptionReferences::Ref> const& _refs);
+
+    // Cutscene loaded in the editor
+    void SetHighlight(int _row);
+    int GetHighlight() const { return m_highlight; }
+
+    // Index helpers
+    QModelIndex CutsceneIndex(int _row, int _column = CT_Name) const;
+    bool IsText(QModelIndex const& _index) const;
+    int GetCutsceneRow(QModelIndex const& _index) const;
+    int GetTextRow(QModelIndex const& _index) const;
+
+    // QAbstractItemModel
+    QModelIndex index(int row, int column, QModelIndex const& parent = QModelIndex()) const override;
+    QModelIndex parent(QModelIndex const& child) const override;
+    int rowCount(QModelIndex const& parent = QModelIndex()) const override;
+    int columnCount(QModelIndex const& parent = QModelIndex()) const override;
+    QVariant data(QModelIndex const& index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+private:
+    // Text indices point to their cutscene node, so they
+    // stay valid while cutscenes are removed or sorted
+    struct CutsceneNode
+    {
+        int m_row;
+    };
+
+    void ClearNodes();
+    void UpdateNodeRows(int _first);
+    void EmitCutsceneChanged(int _row);
+
+private:
+    cap m_cap;
+    QVector<CutsceneNode*> m_nodes;
+    int m_highlight;
+    CaptionReferences const* m_references;
+};
+
+#endif // CAPTIONMODEL_H
@@ -0,0 +1,631 @@
+#include "captionreferences.h"
+
+#include <QDir>
+#include <QFileInfo>
+
+#include <algorithm>
+
+#include "tracer.h"
+
+CaptionReferences::CaptionReferences(QObject *parent) :
+    QObject(parent)
+{
+    m_referenceCount = 0;
+    m_danglingCount = 0;
+}
+
+CaptionReferences::~CaptionReferences()
+{
+    for (File* file : m_files)
+    {
+        DeleteFile(file);
+    }
+}
+
+//-----------------------------------------------------
+// Labels of the open document, a standalone document
+// it replaces is dropped, project files are kept
+//-----------------------------------------------------
+void CaptionReferences::SetDocumentLabels(QString const& _fileName, QVector<fcoProject::Label> const& _labels)
+{
+    TRACE_SCOPE("cap", "Document Labels");
+
+    QString const fileKey = FileKey(_fileName);
+    if (!m_documentFile.isEmpty() && m_documentFile != fileKey && !m_projectFiles.contains(m_documentFile))
+    {
+        RemoveFile(m_documentFile);
+    }
+
+    m_documentFile = fileKey;
+    m_documentName = _fileName;
+    SetFile(fileKey, _fileName, _labels);
+    UpdateCaptionFile();
+}
+
+void CaptionReferences::SetProjectLabels(QString const& _fileName, QVector<fcoProject::Label> const& _labels)
+{
+    QString const fileKey = FileKey(_fileName);
+    if (!m_projectFiles.contains(fileKey))
+    {
+        m_projectFiles.push_back(fileKey);
+    }
+
+    // The open document has newer labels than the project index
+    if (fileKey != m_documentFile)
+    {
+        SetFile(fileKey, _fileName, _labels);
+    }
+    UpdateCaptionFile();
+}
+
+void CaptionReferences::ClearProjectLabels()
+{
+    for (QString const& fileKey : m_projectFiles)
+    {
+        if (fileKey != m_documentFile)
+        {
+            RemoveFile(fileKey);
+        }
+    }
+    m_projectFiles.clear();
+    UpdateCaptionFile();
+}
+
+//-----------------------------------------------------
+// First of duplicate labels wins, like a linear search
+//-----------------------------------------------------
+bool CaptionReferences::Find(QString const& _fileName, QString const& _group, QString const& _cell, unsigned int& _groupID, unsigned int& _subtitleID) const
+{
+    QString const fileKey = _fileName == m_documentName ? m_documentFile : FileKey(_fileName);
+    File const* file = m_files.value(fileKey, Q_NULLPTR);
+    if (!file)
+    {
+        return false;
+    }
+
+    auto locations = file->m_labels.constFind(Key(_group, _cell));
+    if (locations == file->m_labels.constEnd())
+    {
+        return false;
+    }
+
+    Location const* first = Q_NULLPTR;
+    for (Location const& location : *locations)
+    {
+        if (!first || location.m_group->m_groupID < first->m_group->m_groupID
+         || (location.m_group == first->m_group && location.m_subtitleID < first->m_subtitleID))
+        {
+            first = &location;
+        }
+    }
+
+    _groupID = first->m_group->m_groupID;
+    _subtitleID = first->m_subtitleID;
+    return true;
+}
+
+//-----------------------------------------------------
+// A group of the document renamed or its subtitles
+// added, removed or moved, only its labels are redone
+//-----------------------------------------------------
+void CaptionReferences::SetGroup(unsigned int _groupID, QString const& _group, QStringList const& _cells)
+{
+    File* file = m_files.value(m_documentFile, Q_NULLPTR);
+    if (!file || _groupID >= static_cast<unsigned int>(file->m_groups.size())) return;
+
+    Group* group = file->m_groups[_groupID];
+    QSet<QString> toggled;
+    for (int i = 0; i < group->m_cells.size(); i++)
+    {
+        RemoveLabel(file, group, i, toggled);
+    }
+    group->m_name = _group;
+    group->m_cells = _cells;
+    for (int i = 0; i < group->m_cells.size(); i++)
+    {
+        AddLabel(file, group, i, toggled);
+    }
+
+    FileChanged(m_documentFile, toggled);
+}
+
+void CaptionReferences::InsertGroup(unsigned int _groupID, QString const& _group, QStringList const& _cells)
+{
+    File* file = m_files.value(m_documentFile, Q_NULLPTR);
+    if (!file || _groupID > static_cast<unsigned int>(file->m_groups.size())) return;
+
+    Group* group = new Group{_groupID, _group, _cells};
+    file->m_groups.insert(_groupID, group);
+    for (int i = _groupID + 1; i < file->m_groups.size(); i++)
+    {
+        file->m_groups[i]->m_groupID = i;
+    }
+
+    QSet<QString> toggled;
+    for (int i = 0; i < group->m_cells.size(); i++)
+    {
+        AddLabel(file, group, i, toggled);
+    }
+    FileChanged(m_documentFile, toggled);
+}
+
+void CaptionReferences::RemoveGroup(unsigned int _groupID)
+{
+    File* file = m_files.value(m_documentFile, Q_NULLPTR);
+    if (!file || _groupID >= static_cast<unsigned int>(file->m_groups.size())) return;
+
+    Group* group = file->m_groups.takeAt(_groupID);
+    QSet<QString> toggled;
+    for (int i = 0; i < group->m_cells.size(); i++)
+    {
+        RemoveLabel(file, group, i, toggled);
+    }
+    delete group;
+    for (int i = _groupID; i < file->m_groups.size(); i++)
+    {
+        file->m_groups[i]->m_groupID = i;
+    }
+
+    FileChanged(m_documentFile, toggled);
+}
+
+//-----------------------------------------------------
+// Labels stay, only which one is found first can change
+//-----------------------------------------------------
+void CaptionReferences::SwapGroups(unsigned int _groupID1, unsigned int _groupID2)
+{
+    File* file = m_files.value(m_documentFile, Q_NULLPTR);
+    unsigned int const count = file ? static_cast<unsigned int>(file->m_groups.size()) : 0;
+    if (_groupID1 >= count || _groupID2 >= count) return;
+
+    std::swap(file->m_groups[_groupID1], file->m_groups[_groupID2]);
+    file->m_groups[_groupID1]->m_groupID = _groupID1;
+    file->m_groups[_groupID2]->m_groupID = _groupID2;
+}
+
+//-----------------------------------------------------
+// A label renamed in place, only texts using the old
+// or the new name are revalidated
+//-----------------------------------------------------
+void CaptionReferences::RenameLabel(unsigned int _groupID, unsigned int _subtitleID, QString const& _cell)
+{
+    File* file = m_files.value(m_documentFile, Q_NULLPTR);
+    if (!file || _groupID >= static_cast<unsigned int>(file->m_groups.size())) return;
+
+    Group* group = file->m_groups[_groupID];
+    if (_subtitleID >= static_cast<unsigned int>(group->m_cells.size()) || group->m_cells[_subtitleID] == _cell) return;
+
+    QSet<QString> toggled;
+    RemoveLabel(file, group, _subtitleID, toggled);
+    group->m_cells[_subtitleID] = _cell;
+    AddLabel(file, group, _subtitleID, toggled);
+    FileChanged(m_documentFile, toggled);
+}
+
+//-----------------------------------------------------
+// Texts of a .cap file, one hash lookup each
+//-----------------------------------------------------
+void CaptionReferences::SetCaptions(cap const& _cap, QString const& _capFile)
+{
+    TRACE_SCOPE("cap", "Caption References");
+
+    m_capDirectory = _capFile.isEmpty() ? QString() : QFileInfo(_capFile).absolutePath();
+    m_fcoFile = _cap.m_fcoFile;
+    m_captionFile = ResolveCaptionFile();
+
+    m_references.clear();
+    m_textKeys.clear();
+    m_referenceCount = 0;
+    m_danglingCount = 0;
+    for (int i = 0; i < _cap.m_captions.size(); i++)
+    {
+        m_textKeys.push_back(QVector<QString>());
+        AddTexts(i, _cap.m_captions[i]);
+    }
+
+    emit DanglingCountChanged(m_danglingCount);
+}
+
+//-----------------------------------------------------
+// Texts keep their keys, only the file they are looked
+// up in can change
+//-----------------------------------------------------
+void CaptionReferences::SetFcoFile(QString const& _fcoFile, QString const& _capFile)
+{
+    m_capDirectory = _capFile.isEmpty() ? QString() : QFileInfo(_capFile).absolutePath();
+    m_fcoFile = _fcoFile;
+    UpdateCaptionFile();
+}
+
+//-----------------------------------------------------
+// Texts of one cutscene replaced
+//-----------------------------------------------------
+void CaptionReferences::SetCutscene(int _cutscene, cap::Caption const& _caption)
+{
+    if (_cutscene < 0 || _cutscene >= m_textKeys.size()) return;
+
+    int const dangling = m_danglingCount;
+    RemoveTexts(_cutscene);
+    AddTexts(_cutscene, _caption);
+
+    if (m_danglingCount != dangling)
+    {
+        emit DanglingCountChanged(m_danglingCount);
+    }
+}
+
+//-----------------------------------------------------
+// Cutscenes after an inserted or removed one are
+// renumbered, nothing is looked up again
+//-----------------------------------------------------
+void CaptionReferences::InsertCutscene(int _cutscene, cap::Caption const& _caption)
+{
+    if (_cutscene < 0 || _cutscene > m_textKeys.size()) return;
+
+    if (_cutscene < m_textKeys.size())
+    {
+        for (QVector<Ref>& refs : m_references)
+        {
+            for (Ref& ref : refs)
+            {
+                if (ref.m_cutscene >= _cutscene) ref.m_cutscene++;
+            }
+        }
+    }
+    m_textKeys.insert(_cutscene, QVector<QString>());
+
+    int const dangling = m_danglingCount;
+    AddTexts(_cutscene, _caption);
+    if (m_danglingCount != dangling)
+    {
+        emit DanglingCountChanged(m_danglingCount);
+    }
+}
+
+void CaptionReferences::RemoveCutscene(int _cutscene)
+{
+    if (_cutscene < 0 || _cutscene >= m_textKeys.size()) return;
+
+    int const dangling = m_danglingCount;
+    RemoveTexts(_cutscene);
+    m_textKeys.remove(_cutscene);
+    if (_cutscene < m_textKeys.size())
+    {
+        for (QVector<Ref>& refs : m_references)
+        {
+            for (Ref& ref : refs)
+            {
+                if (ref.m_cutscene > _cutscene) ref.m_cutscene--;
+            }
+        }
+    }
+
+    if (m_danglingCount != dangling)
+    {
+        emit DanglingCountChanged(m_danglingCount);
+    }
+}
+
+bool CaptionReferences::IsResolved(int _cutscene, int _text) const
+{
+    if (_cutscene < 0 || _cutscene >= m_textKeys.size() || _text < 0 || _text >= m_textKeys[_cutscene].size())
+    {
+        return true;
+    }
+
+    return IsKnown(m_textKeys[_cutscene][_text]);
+}
+
+QVector<CaptionReferences::Ref> CaptionReferences::GetDangling() const
+{
+    QVector<Ref> dangling;
+    dangling.reserve(m_danglingCount);
+    for (int i = 0; i < m_textKeys.size(); i++)
+    {
+        for (int j = 0; j < m_textKeys[i].size(); j++)
+        {
+            if (!IsKnown(m_textKeys[i][j])) dangling.push_back(Ref{i, j});
+        }
+    }
+    return dangling;
+}
+
+//-----------------------------------------------------
+// Canonical path, Windows file names ignore case
+//-----------------------------------------------------
+QString CaptionReferences::FileKey(QString const& _fileName)
+{
+    if (_fileName.isEmpty())
+    {
+        return "<untitled>";
+    }
+
+    QFileInfo const info(_fileName);
+    QString const path = info.canonicalFilePath();
+    return (path.isEmpty() ? info.absoluteFilePath() : path).toLower();
+}
+
+//-----------------------------------------------------
+// Captions name the fco file with or without path and
+// extension
+//-----------------------------------------------------
+QString CaptionReferences::BaseName(QString const& _fileName)
+{
+    return QFileInfo(_fileName).completeBaseName().toLower();
+}
+
+QString CaptionReferences::Key(QString const& _group, QString const& _cell)
+{
+    return _group + QChar('\x1f') + _cell;
+}
+
+//-----------------------------------------------------
+// A key that appears and disappears in one edit is not
+// a change
+//-----------------------------------------------------
+void CaptionReferences::Toggle(QSet<QString>& _toggled, QString const& _key)
+{
+    if (!_toggled.remove(_key))
+    {
+        _toggled.insert(_key);
+    }
+}
+
+//-----------------------------------------------------
+// Replace the labels of one file, only keys that came
+// or went are revalidated
+//-----------------------------------------------------
+void CaptionReferences::SetFile(QString const& _fileKey, QString const& _fileName, QVector<fcoProject::Label> const& _labels)
+{
+    File* file = new File;
+    file->m_baseName = _fileName.isEmpty() ? QString() : BaseName(_fileName);
+
+    // Labels come in group then subtitle order
+    QSet<QString> unused;
+    for (fcoProject::Label const& label : _labels)
+    {
+        while (static_cast<unsigned int>(file->m_groups.size()) <= label.m_groupID)
+        {
+            file->m_groups.push_back(new Group{static_cast<unsigned int>(file->m_groups.size()), QString(), QStringList()});
+        }
+
+        Group* group = file->m_groups[label.m_groupID];
+        group->m_name = label.m_group;
+        while (static_cast<unsigned int>(group->m_cells.size()) <= label.m_subtitleID)
+        {
+            group->m_cells.push_back(QString());
+        }
+        group->m_cells[label.m_subtitleID] = label.m_cell;
+        AddLabel(file, group, label.m_subtitleID, unused);
+    }
+
+    File* old = m_files.value(_fileKey, Q_NULLPTR);
+    m_files.insert(_fileKey, file);
+
+    QSet<QString> toggled;
+    if (_fileKey == m_captionFile)
+    {
+        for (auto it = file->m_labels.constBegin(); it != file->m_labels.constEnd(); ++it)
+        {
+            if (!old || !old->m_labels.contains(it.key())) toggled.insert(it.key());
+        }
+        if (old)
+        {
+            for (auto it = old->m_labels.constBegin(); it != old->m_labels.constEnd(); ++it)
+            {
+                if (!file->m_labels.contains(it.key())) toggled.insert(it.key());
+            }
+        }
+    }
+
+    if (old)
+    {
+        DeleteFile(old);
+    }
+    FileChanged(_fileKey, toggled);
+}
+
+void CaptionReferences::RemoveFile(QString const& _fileKey)
+{
+    File* file = m_files.take(_fileKey);
+    if (!file) return;
+
+    if (_fileKey == m_captionFile)
+    {
+        QSet<QString> toggled;
+        for (auto it = file->m_labels.constBegin(); it != file->m_labels.constEnd(); ++it)
+        {
+            toggled.insert(it.key());
+        }
+        Revalidate(toggled);
+    }
+    DeleteFile(file);
+}
+
+void CaptionReferences::DeleteFile(File* _file)
+{
+    qDeleteAll(_file->m_groups);
+    delete _file;
+}
+
+void CaptionReferences::AddLabel(File* _file, Group* _group, unsigned int _subtitleID, QSet<QString>& _toggled)
+{
+    QString const key = Key(_group->m_name, _group->m_cells[_subtitleID]);
+    QVector<Location>& locations = _file->m_labels[key];
+    if (locations.isEmpty())
+    {
+        Toggle(_toggled, key);
+    }
+    locations.push_back(Location{_group, _subtitleID});
+}
+
+void CaptionReferences::RemoveLabel(File* _file, Group* _group, unsigned int _subtitleID, QSet<QString>& _toggled)
+{
+    QString const key = Key(_group->m_name, _group->m_cells[_subtitleID]);
+    auto locations = _file->m_labels.find(key);
+    if (locations == _file->m_labels.end()) return;
+
+    for (int i = 0; i < locations->size(); i++)
+    {
+        if ((*locations)[i].m_group == _group && (*locations)[i].m_subtitleID == _subtitleID)
+        {
+            locations->remove(i);
+            break;
+        }
+    }
+
+    if (locations->isEmpty())
+    {
+        _file->m_labels.erase(locations);
+        Toggle(_toggled, key);
+    }
+}
+
+//-----------------------------------------------------
+// Only the file captions resolve to affects them
+//-----------------------------------------------------
+void CaptionReferences::FileChanged(QString const& _fileKey, QSet<QString> const& _toggled)
+{
+    if (_fileKey == m_captionFile && !_toggled.isEmpty())
+    {
+        Revalidate(_toggled);
+    }
+}
+
+//-----------------------------------------------------
+// The file next to the .cap file if it is open or
+// indexed, otherwise any file of that name with the
+// open document first
+//-----------------------------------------------------
+QString CaptionReferences::ResolveCaptionFile() const
+{
+    if (m_fcoFile.isEmpty())
+    {
+        return QString();
+    }
+
+    QString const path = m_capDirectory.isEmpty() ? m_fcoFile : QDir(m_capDirectory).filePath(m_fcoFile);
+    QString const pathKey = FileKey(path);
+    if (m_files.contains(pathKey))
+    {
+        return pathKey;
+    }
+    QString const fcoKey = FileKey(path + ".fco");
+    if (m_files.contains(fcoKey))
+    {
+        return fcoKey;
+    }
+
+    QString const baseName = BaseName(m_fcoFile);
+    File const* document = m_files.value(m_documentFile, Q_NULLPTR);
+    if (document && document->m_baseName == baseName)
+    {
+        return m_documentFile;
+    }
+    for (QString const& fileKey : m_projectFiles)
+    {
+        File const* file = m_files.value(fileKey, Q_NULLPTR);
+        if (file && file->m_baseName == baseName)
+        {
+            return fileKey;
+        }
+    }
+    return QString();
+}
+
+//-----------------------------------------------------
+// Captions now resolve to another file, every text is
+// looked up again
+//-----------------------------------------------------
+void CaptionReferences::UpdateCaptionFile()
+{
+    QString const captionFile = ResolveCaptionFile();
+    if (captionFile == m_captionFile) return;
+    m_captionFile = captionFile;
+
+    QVector<Ref> changed;
+    changed.reserve(m_referenceCount);
+    m_danglingCount = 0;
+    for (int i = 0; i < m_textKeys.size(); i++)
+    {
+        for (int j = 0; j < m_textKeys[i].size(); j++)
+        {
+            if (!IsKnown(m_textKeys[i][j])) m_danglingCount++;
+            changed.push_back(Ref{i, j});
+        }
+    }
+
+    if (!changed.isEmpty())
+    {
+        emit ReferencesChanged(changed);
+    }
+    emit DanglingCountChanged(m_danglingCount);
+}
+
+bool CaptionReferences::IsKnown(QString const& _key) const
+{
+    File const* file = m_files.value(m_captionFile, Q_NULLPTR);
+    return file && file->m_labels.contains(_key);
+}
+
+void CaptionReferences::AddTexts(int _cutscene, cap::Caption const& _caption)
+{
+    QVector<QString>& keys = m_textKeys[_cutscene];
+    keys.resize(_caption.m_texts.size());
+    for (int j = 0; j < _caption.m_texts.size(); j++)
+    {
+        cap::Text const& text = _caption.m_texts[j];
+        keys[j] = Key(text.m_group.isEmpty() ? _caption.m_group : text.m_group, text.m_cell);
+        m_references[keys[j]].push_back(Ref{_cutscene, j});
+
+        m_referenceCount++;
+        if (!IsKnown(keys[j])) m_danglingCount++;
+    }
+}
+
+void CaptionReferences::RemoveTexts(int _cutscene)
+{
+    QVector<QString>& keys = m_textKeys[_cutscene];
+    for (int j = 0; j < keys.size(); j++)
+    {
+        auto refs = m_references.find(keys[j]);
+        if (refs != m_references.end())
+        {
+            for (int i = 0; i < refs->size(); i++)
+            {
+                if ((*refs)[i].m_cutscene == _cutscene && (*refs)[i].m_text == j)
+                {
+                    refs->remove(i);
+                    break;
+                }
+            }
+            if (refs->isEmpty()) m_references.erase(refs);
+        }
+
+        m_referenceCount--;
+        if (!IsKnown(keys[j])) m_danglingCount--;
+    }
+    keys.clear();
+}
+
+//-----------------------------------------------------
+// Keys that appeared or disappeared flip their texts
+//-----------------------------------------------------
+void CaptionReferences::Revalidate(QSet<QString> const& _toggled)
+{
+    QVector<Ref> changed;
+    for (QString const& key : _toggled)
+    {
+        auto references = m_references.constFind(key);
+        if (references == m_references.constEnd()) continue;
+
+        m_danglingCount += IsKnown(key) ? -references->size() : references->size();
+        changed += *references;
+    }
+
+    if (!changed.isEmpty())
+    {
+        emit ReferencesChanged(changed);
+        emit DanglingCountChanged(m_danglingCount);
+    }
+}
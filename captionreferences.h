@@ -0,0 +1,127 @@
+#ifndef CAPTIONREFERENCES_H
+#define CAPTIONREFERENCES_H
+
+#include <QHash>
+#include <QObject>
+#include <QSet>
+#include <QStringList>
+#include <QVector>
+
+#include "cap.h"
+#include "fcoproject.h"
+
+//-----------------------------------------------------
+// Hash index between the Group/Cell a caption text
+// names and the fco labels of the document and project,
+// files are keyed by path and every edit only touches
+// the labels and texts it changed
+//-----------------------------------------------------
+class CaptionReferences : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Ref
+    {
+        int m_cutscene;
+        int m_text;
+    };
+
+public:
+    explicit CaptionReferences(QObject *parent = nullptr);
+    ~CaptionReferences() override;
+
+    // fco side, a file replaces its previous labels (an
+    // untitled document is indexed too)
+    void SetDocumentLabels(QString const& _fileName, QVector<fcoProject::Label> const& _labels);
+    void SetProjectLabels(QString const& _fileName, QVector<fcoProject::Label> const& _labels);
+    void ClearProjectLabels();
+    bool Find(QString const& _fileName, QString const& _group, QString const& _cell, unsigned int& _groupID, unsigned int& _subtitleID) const;
+
+    // Edits of the open document
+    void SetGroup(unsigned int _groupID, QString const& _group, QStringList const& _cells);
+    void InsertGroup(unsigned int _groupID, QString const& _group, QStringList const& _cells);
+    void RemoveGroup(unsigned int _groupID);
+    void SwapGroups(unsigned int _groupID1, unsigned int _groupID2);
+    void RenameLabel(unsigned int _groupID, unsigned int _subtitleID, QString const& _cell);
+
+    // Caption side, the .cap file locates the fco file it names
+    void SetCaptions(cap const& _cap, QString const& _capFile);
+    void SetFcoFile(QString const& _fcoFile, QString const& _capFile);
+    void SetCutscene(int _cutscene, cap::Caption const& _caption);
+    void InsertCutscene(int _cutscene, cap::Caption const& _caption);
+    void RemoveCutscene(int _cutscene);
+    bool IsResolved(int _cutscene, int _text) const;
+    int GetReferenceCount() const { return m_referenceCount; }
+    int GetDanglingCount() const { return m_danglingCount; }
+    QVector<Ref> GetDangling() const;
+
+signals:
+    // Texts that became resolved or dangling
+    void ReferencesChanged(QVector<CaptionReferences::Ref> const& _refs);
+    void DanglingCountChanged(int _count);
+
+private:
+    struct Group
+    {
+        unsigned int m_groupID;
+        QString m_name;
+        QStringList m_cells;
+    };
+
+    // Groups are shared by their labels so moving a group
+    // only renumbers it
+    struct Location
+    {
+        Group* m_group;
+        unsigned int m_subtitleID;
+    };
+
+    struct File
+    {
+        QString m_baseName;     // How captions may name it
+        QVector<Group*> m_groups;
+        QHash<QString, QVector<Location>> m_labels;
+    };
+
+    static QString FileKey(QString const& _fileName);
+    static QString BaseName(QString const& _fileName);
+    static QString Key(QString const& _group, QString const& _cell);
+    static void Toggle(QSet<QString>& _toggled, QString const& _key);
+
+    // fco side
+    void SetFile(QString const& _fileKey, QString const& _fileName, QVector<fcoProject::Label> const& _labels);
+    void RemoveFile(QString const& _fileKey);
+    void DeleteFile(File* _file);
+    void AddLabel(File* _file, Group* _group, unsigned int _subtitleID, QSet<QString>& _toggled);
+    void RemoveLabel(File* _file, Group* _group, unsigned int _subtitleID, QSet<QString>& _toggled);
+    void FileChanged(QString const& _fileKey, QSet<QString> const& _toggled);
+
+    // Caption side
+    QString ResolveCaptionFile() const;
+    void UpdateCaptionFile();
+    bool IsKnown(QString const& _key) const;
+    void AddTexts(int _cutscene, cap::Caption const& _caption);
+    void RemoveTexts(int _cutscene);
+    void Revalidate(QSet<QString> const& _toggled);
+
+private:
+    // Labels of every file by key, the open document and
+    // the project files in project order
+    QHash<QString, File*> m_files;
+    QStringList m_projectFiles;
+    QString m_documentFile;
+    QString m_documentName;
+
+    // Texts by Group/Cell key, and the key of each text,
+    // resolved against one file
+    QString m_capDirectory;
+    QString m_fcoFile;
+    QString m_captionFile;
+    QHash<QString, QVector<Ref>> m_references;
+    QVector<QVector<QString>> m_textKeys;
+    int m_referenceCount;
+    int m_danglingCount;
+};
+
+#endif // CAPTIONREFERENCES_H
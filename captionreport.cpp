@@ -0,0 +1,76 @@
+#include "captionreport.h"
+
+#include <QHeaderView>
+#include <QVBoxLayout>
+
+CaptionReport::CaptionReport(QWidget *parent) :
+    QDialog(parent)
+{
+    setWindowTitle("Caption Check");
+    resize(640, 400);
+
+    QVBoxLayout* layout = new QVBoxLayout(this);
+    m_status = new QLabel(this);
+    layout->addWidget(m_status);
+
+    m_issues = new QTreeWidget(this);
+    m_issues->setRootIsDecorated(false);
+    m_issues->setUniformRowHeights(true);
+    m_issues->setHeaderLabels(QStringList() << "Cutscene" << "Cell" << "Start" << "Issue");
+    m_issues->header()->setSectionResizeMode(QHeaderView::ResizeToContents);
+    connect(m_issues, &QTreeWidget::itemActivated, this, &CaptionReport::Issues_itemActivated);
+    layout->addWidget(m_issues);
+}
+
+//-----------------------------------------------------
+// List the result of CaptionChecker::CheckCap
+//-----------------------------------------------------
+void CaptionReport::SetIssues(cap const& _cap, QVector<CaptionChecker::Issue> const& _issues)
+{
+    m_issues->clear();
+
+    int overlaps = 0;
+    int gaps = 0;
+    int tooShort = 0;
+    int missing = 0;
+    QList<QTreeWidgetItem*> items;
+    items.reserve(_issues.size());
+    for (CaptionChecker::Issue const& issue : _issues)
+    {
+        cap::Caption const& caption = _cap.m_captions[issue.m_cutscene];
+        cap::Text const& text = caption.m_texts[issue.m_text];
+
+        switch (issue.m_type)
+        {
+        case CaptionChecker::IF_Overlap:    overlaps++; break;
+        case CaptionChecker::IF_Gap:        gaps++; break;
+        case CaptionChecker::IF_TooShort:   tooShort++; break;
+        case CaptionChecker::IF_Missing:    missing++; break;
+        }
+
+        QTreeWidgetItem* item = new QTreeWidgetItem();
+        item->setText(0, caption.m_name);
+        item->setText(1, text.m_cell);
+        item->setText(2, QString::number(text.m_start));
+        item->setText(3, CaptionChecker::Describe(issue, caption.m_texts));
+        item->setData(0, Qt::UserRole, issue.m_cutscene);
+        item->setData(1, Qt::UserRole, issue.m_text);
+        items.push_back(item);
+    }
+    m_issues->addTopLevelItems(items);
+
+    if (_issues.isEmpty())
+    {
+        m_status->setText("No issues in " + QString::number(_cap.m_captions.size()) + " cutscene(s)");
+    }
+    else
+    {
+        m_status->setText(QString::number(overlaps) + " overlap(s), " + QString::number(gaps) + " gap(s), " + QString::number(tooShort) + " too short, " + QString::number(missing) + " missing, double click to open");
+    }
+}
+
+void CaptionReport::Issues_itemActivated(QTreeWidgetItem* _item, int _column)
+{
+    Q_UNUSED(_column)
+    emit IssueActivated(_item->data(0, Qt::UserRole).toInt(), _item->data(1, Qt::UserRole).toInt());
+}
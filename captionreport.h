@@ -0,0 +1,33 @@
+#ifndef CAPTIONREPORT_H
+#define CAPTIONREPORT_H
+
+#include <QDialog>
+#include <QLabel>
+#include <QTreeWidget>
+
+#include "captionchecker.h"
+
+//-----------------------------------------------------
+// Timing issues of every cutscene in a .cap file
+//-----------------------------------------------------
+class CaptionReport : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit CaptionReport(QWidget *parent = nullptr);
+
+    void SetIssues(cap const& _cap, QVector<CaptionChecker::Issue> const& _issues);
+
+signals:
+    void IssueActivated(int _cutscene, int _text);
+
+private slots:
+    void Issues_itemActivated(QTreeWidgetItem* _item, int _column);
+
+private:
+    QLabel* m_status;
+    QTreeWidget* m_issues;
+};
+
+#endif // CAPTIONREPORT_H
@@ -0,0 +1,128 @@
+#include "captionretime.h"
+
+#include <QDirIterator>
+
+#include "tracer.h"
+
+CaptionRetime::Settings::Settings()
+{
+    m_offset = 0;
+    m_useRange = false;
+    m_rangeStart = 0;
+    m_rangeEnd = c_maxFrame;
+    m_fromFps = 30;
+    m_toFps = 30;
+    m_rounding = RM_Nearest;
+}
+
+//-----------------------------------------------------
+// Start and end are converted separately so texts that
+// touched before still touch afterwards
+//-----------------------------------------------------
+bool CaptionRetime::RetimeText(Settings const& _settings, cap::Text& _text)
+{
+    int start = _text.m_start;
+    int end = _text.m_start + _text.m_length;
+    if (_settings.m_fromFps != _settings.m_toFps)
+    {
+        start = ConvertFrame(_settings, start);
+        end = ConvertFrame(_settings, end);
+    }
+
+    bool const inRange = !_settings.m_useRange || (_text.m_start >= _settings.m_rangeStart && _text.m_start <= _settings.m_rangeEnd);
+    if (inRange)
+    {
+        start += _settings.m_offset;
+        end += _settings.m_offset;
+    }
+
+    // Keep the length when clamping to the timeline
+    int const length = qBound(1, end - start, c_maxFrame + 1);
+    start = qBound(0, start, c_maxFrame - length + 1);
+    if (start == _text.m_start && length == _text.m_length)
+    {
+        return false;
+    }
+
+    _text.m_start = start;
+    _text.m_length = length;
+    return true;
+}
+
+int CaptionRetime::RetimeTexts(Settings const& _settings, QVector<cap::Text>& _texts)
+{
+    int count = 0;
+    for (cap::Text& text : _texts)
+    {
+        if (RetimeText(_settings, text)) count++;
+    }
+    return count;
+}
+
+int CaptionRetime::RetimeCap(Settings const& _settings, cap& _cap)
+{
+    int count = 0;
+    for (cap::Caption& caption : _cap.m_captions)
+    {
+        count += RetimeTexts(_settings, caption.m_texts);
+    }
+    return count;
+}
+
+//-----------------------------------------------------
+// Load, retime and save one file (worker thread), files
+// without changes are left untouched
+//-----------------------------------------------------
+CaptionRetime::FileResult CaptionRetime::RetimeFile(Settings const& _settings, QString const& _fileName)
+{
+    TRACE_SCOPE("cap", "RetimeFile");
+
+    FileResult result;
+    result.m_fileName = _fileName;
+    result.m_textCount = 0;
+
+    cap capData;
+    if (!capData.Load(_fileName, result.m_errorMsg))
+    {
+        return result;
+    }
+
+    result.m_textCount = RetimeCap(_settings, capData);
+    if (result.m_textCount > 0 && !capData.Save(_fileName, result.m_errorMsg))
+    {
+        result.m_textCount = 0;
+    }
+
+    return result;
+}
+
+QStringList CaptionRetime::FindCapFiles(QString const& _directory, bool _recursive)
+{
+    QStringList fileNames;
+    QDirIterator it(_directory, QStringList() << "*.cap", QDir::Files, _recursive ? QDirIterator::Subdirectories : QDirIterator::NoIteratorFlags);
+    while (it.hasNext())
+    {
+        fileNames << it.next();
+    }
+    fileNames.sort();
+    return fileNames;
+}
+
+//-----------------------------------------------------
+// frame * to / from in 64 bit with the chosen rounding
+//-----------------------------------------------------
+int CaptionRetime::ConvertFrame(Settings const& _settings, int _frame)
+{
+    qint64 const numerator = static_cast<qint64>(_frame) * _settings.m_toFps;
+    qint64 const denominator = _settings.m_fromFps;
+
+    qint64 result = 0;
+    switch (_settings.m_rounding)
+    {
+    case RM_Nearest:    result = (numerator * 2 + denominator) / (denominator * 2); break;
+    case RM_Down:       result = numerator / denominator; break;
+    case RM_Up:         result = (numerator + denominator - 1) / denominator; break;
+    }
+
+    return static_cast<int>(qMin<qint64>(result, c_maxFrame + 1));
+}
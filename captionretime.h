@@ -0,0 +1,72 @@
+#ifndef CAPTIONRETIME_H
+#define CAPTIONRETIME_H
+
+#include <QStringList>
+#include <QVector>
+
+#include "cap.h"
+
+//-----------------------------------------------------
+// Shifts and frame rate conversion of caption texts,
+// from a single cutscene up to directories of files
+//-----------------------------------------------------
+class CaptionRetime
+{
+public:
+    enum RoundingMode : int
+    {
+        RM_Nearest = 0,
+        RM_Down,
+        RM_Up
+    };
+
+    struct Settings
+    {
+        Settings();
+
+        // Added after conversion, in target frames
+        int m_offset;
+
+        // Only shift texts starting in [start, end] (source frames)
+        bool m_useRange;
+        int m_rangeStart;
+        int m_rangeEnd;
+
+        // Equal rates skip conversion
+        int m_fromFps;
+        int m_toFps;
+        RoundingMode m_rounding;
+    };
+
+    struct FileResult
+    {
+        QString m_fileName;
+        int m_textCount;
+        QString m_errorMsg;
+    };
+
+    // Functor for QtConcurrent::mapped
+    struct FileJob
+    {
+        typedef FileResult result_type;
+
+        FileJob(Settings const& _settings) : m_settings(_settings) {}
+        FileResult operator()(QString const& _fileName) const { return RetimeFile(m_settings, _fileName); }
+
+        Settings m_settings;
+    };
+
+    static int const c_maxFrame = 99999;
+
+    static bool RetimeText(Settings const& _settings, cap::Text& _text);
+    static int RetimeTexts(Settings const& _settings, QVector<cap::Text>& _texts);
+    static int RetimeCap(Settings const& _settings, cap& _cap);
+    static FileResult RetimeFile(Settings const& _settings, QString const& _fileName);
+
+    static QStringList FindCapFiles(QString const& _directory, bool _recursive);
+
+private:
+    static int ConvertFrame(Settings const& _settings, int _frame);
+};
+
+#endif // CAPTIONRETIME_H
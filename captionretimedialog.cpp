@@ -0,0 +1,121 @@
+#include "captionretimedialog.h"
+
+#include <QDialogButtonBox>
+#include <QFormLayout>
+#include <QHBoxLayout>
+#include <QLabel>
+#include <QStandardItemModel>
+
+CaptionRetimeDialog::CaptionRetimeDialog(QWidget *parent) :
+    QDialog(parent)
+{
+    setWindowTitle("Retime Captions");
+
+    QFormLayout* layout = new QFormLayout(this);
+
+    // Scope, items follow RetimeScope
+    m_scope = new QComboBox(this);
+    m_scope->addItem("Current cutscene");
+    m_scope->addItem("All cutscenes in file");
+    m_scope->addItem("All .cap files in a directory...");
+    connect(m_scope, static_cast<void (QComboBox::*)(int)>(&QComboBox::currentIndexChanged), this, &CaptionRetimeDialog::UpdateEnability);
+    layout->addRow("Apply to:", m_scope);
+
+    m_recursive = new QCheckBox("Include subdirectories", this);
+    layout->addRow(QString(), m_recursive);
+
+    // Frame rate conversion
+    m_fromFps = new QSpinBox(this);
+    m_fromFps->setRange(1, 240);
+    m_fromFps->setValue(30);
+    m_toFps = new QSpinBox(this);
+    m_toFps->setRange(1, 240);
+    m_toFps->setValue(30);
+    connect(m_fromFps, static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged), this, &CaptionRetimeDialog::UpdateEnability);
+    connect(m_toFps, static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged), this, &CaptionRetimeDialog::UpdateEnability);
+    QHBoxLayout* fpsLayout = new QHBoxLayout();
+    fpsLayout->addWidget(m_fromFps);
+    fpsLayout->addWidget(new QLabel("fps to", this));
+    fpsLayout->addWidget(m_toFps);
+    fpsLayout->addWidget(new QLabel("fps", this));
+    layout->addRow("Convert:", fpsLayout);
+
+    // Items follow CaptionRetime::RoundingMode
+    m_rounding = new QComboBox(this);
+    m_rounding->addItem("Nearest");
+    m_rounding->addItem("Down");
+    m_rounding->addItem("Up");
+    layout->addRow("Rounding:", m_rounding);
+
+    // Shift
+    m_offset = new QSpinBox(this);
+    m_offset->setRange(-CaptionRetime::c_maxFrame, CaptionRetime::c_maxFrame);
+    m_offset->setSuffix(" frames");
+    layout->addRow("Shift by:", m_offset);
+
+    m_useRange = new QCheckBox("Only texts starting from", this);
+    m_rangeStart = new QSpinBox(this);
+    m_rangeStart->setRange(0, CaptionRetime::c_maxFrame);
+    m_rangeEnd = new QSpinBox(this);
+    m_rangeEnd->setRange(0, CaptionRetime::c_maxFrame);
+    m_rangeEnd->setValue(CaptionRetime::c_maxFrame);
+    connect(m_useRange, &QCheckBox::toggled, this, &CaptionRetimeDialog::UpdateEnability);
+    QHBoxLayout* rangeLayout = new QHBoxLayout();
+    rangeLayout->addWidget(m_useRange);
+    rangeLayout->addWidget(m_rangeStart);
+    rangeLayout->addWidget(new QLabel("to", this));
+    rangeLayout->addWidget(m_rangeEnd);
+    layout->addRow(QString(), rangeLayout);
+
+    QDialogButtonBox* buttons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, this);
+    connect(buttons, &QDialogButtonBox::accepted, this, &QDialog::accept);
+    connect(buttons, &QDialogButtonBox::rejected, this, &QDialog::reject);
+    layout->addRow(buttons);
+
+    UpdateEnability();
+}
+
+//-----------------------------------------------------
+// Scopes without anything loaded can't be picked
+//-----------------------------------------------------
+void CaptionRetimeDialog::SetScopeEnabled(RetimeScope _scope, bool _enabled)
+{
+    QStandardItemModel* model = qobject_cast<QStandardItemModel*>(m_scope->model());
+    model->item(_scope)->setEnabled(_enabled);
+
+    if (!_enabled && m_scope->currentIndex() == _scope)
+    {
+        m_scope->setCurrentIndex(RS_Directory);
+    }
+}
+
+CaptionRetime::Settings CaptionRetimeDialog::GetSettings() const
+{
+    CaptionRetime::Settings settings;
+    settings.m_offset = m_offset->value();
+    settings.m_useRange = m_useRange->isChecked();
+    settings.m_rangeStart = m_rangeStart->value();
+    settings.m_rangeEnd = m_rangeEnd->value();
+    settings.m_fromFps = m_fromFps->value();
+    settings.m_toFps = m_toFps->value();
+    settings.m_rounding = static_cast<CaptionRetime::RoundingMode>(m_rounding->currentIndex());
+    return settings;
+}
+
+CaptionRetimeDialog::RetimeScope CaptionRetimeDialog::GetScope() const
+{
+    return static_cast<RetimeScope>(m_scope->currentIndex());
+}
+
+bool CaptionRetimeDialog::IsRecursive() const
+{
+    return m_recursive->isChecked();
+}
+
+void CaptionRetimeDialog::UpdateEnability()
+{
+    m_recursive->setEnabled(GetScope() == RS_Directory);
+    m_rounding->setEnabled(m_fromFps->value() != m_toFps->value());
+    m_rangeStart->setEnabled(m_useRange->isChecked());
+    m_rangeEnd->setEnabled(m_useRange->isChecked());
+}
@@ -0,0 +1,50 @@
+#ifndef CAPTIONRETIMEDIALOG_H
+#define CAPTIONRETIMEDIALOG_H
+
+#include <QCheckBox>
+#include <QComboBox>
+#include <QDialog>
+#include <QSpinBox>
+
+#include "captionretime.h"
+
+//-----------------------------------------------------
+// Settings and target of a batch retime
+//-----------------------------------------------------
+class CaptionRetimeDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    enum RetimeScope : int
+    {
+        RS_Cutscene = 0,
+        RS_File,
+        RS_Directory
+    };
+
+public:
+    explicit CaptionRetimeDialog(QWidget *parent = nullptr);
+
+    void SetScopeEnabled(RetimeScope _scope, bool _enabled);
+
+    CaptionRetime::Settings GetSettings() const;
+    RetimeScope GetScope() const;
+    bool IsRecursive() const;
+
+private slots:
+    void UpdateEnability();
+
+private:
+    QComboBox* m_scope;
+    QCheckBox* m_recursive;
+    QSpinBox* m_offset;
+    QCheckBox* m_useRange;
+    QSpinBox* m_rangeStart;
+    QSpinBox* m_rangeEnd;
+    QSpinBox* m_fromFps;
+    QSpinBox* m_toFps;
+    QComboBox* m_rounding;
+};
+
+#endif // CAPTIONRETIMEDIALOG_H
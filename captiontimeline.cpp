@@ -0,0 +1,634 @@
+#include "captiontimeline.h"
+
+#include <QMouseEvent>
+#include <QPainter>
+#include <QScrollBar>
+#include <QWheelEvent>
+
+#include <algorithm>
+
+#include "tracer.h"
+
+//-----------------------------------------------------
+// Frames to (min:sec:frame) for the ruler
+//-----------------------------------------------------
+static QString FrameLabel(int _frames)
+{
+    return QString("%1:%2:%3").arg(_frames / 30 / 60, 2, 10, QChar('0')).arg((_frames / 30) % 60, 2, 10, QChar('0')).arg(_frames % 30, 2, 10, QChar('0'));
+}
+
+CaptionTimeline::CaptionTimeline(QWidget *parent) :
+    QAbstractScrollArea(parent)
+{
+    m_laneCount = 0;
+    m_maxLength = 1;
+    m_lastFrame = 0;
+    m_frameWidth = 4.0;
+    m_selected = -1;
+    m_hovered = -1;
+    m_playhead = -1;
+    m_dragMode = DM_None;
+    m_dragFrame = 0;
+
+    viewport()->setMouseTracking(true);
+    setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOn);
+    UpdateLayout();
+}
+
+//-----------------------------------------------------
+// Show the texts of another cutscene
+//-----------------------------------------------------
+void CaptionTimeline::SetTexts(QVector<cap::Text> const& _texts)
+{
+    m_texts = _texts;
+    m_tree.Build(m_texts);
+    m_selected = -1;
+    m_hovered = -1;
+    m_playhead = -1;
+    m_dragMode = DM_None;
+    horizontalScrollBar()->setValue(0);
+    verticalScrollBar()->setValue(0);
+    UpdateLayout();
+}
+
+//-----------------------------------------------------
+// Same texts with new values, keeps selection and view
+//-----------------------------------------------------
+void CaptionTimeline::UpdateTexts(QVector<cap::Text> const& _texts)
+{
+    Q_ASSERT(_texts.size() == m_texts.size());
+    m_texts = _texts;
+    m_tree.Build(m_texts);
+    UpdateLayout();
+}
+
+void CaptionTimeline::SetText(int _index, cap::Text const& _text)
+{
+    cap::Text& current = m_texts[_index];
+    if (current.m_start != _text.m_start || current.m_length != _text.m_length)
+    {
+        m_tree.Remove(_index);
+        m_tree.Insert(_index, _text.m_start, _text.m_start + _text.m_length);
+    }
+    current = _text;
+    UpdateLayout();
+}
+
+int CaptionTimeline::AddText(cap::Text const& _text)
+{
+    m_texts.push_back(_text);
+    m_tree.Insert(m_texts.size() - 1, _text.m_start, _text.m_start + _text.m_length);
+    UpdateLayout();
+    return m_texts.size() - 1;
+}
+
+void CaptionTimeline::RemoveText(int _index)
+{
+    m_texts.removeAt(_index);
+    m_tree.RemoveAndRenumber(_index);
+    m_hovered = -1;
+    m_dragMode = DM_None;
+    UpdateLayout();
+
+    if (m_selected == _index)
+    {
+        m_selected = -1;
+        emit SelectionChanged(-1);
+    }
+    else if (m_selected > _index)
+    {
+        m_selected--;
+        emit SelectionChanged(m_selected);
+    }
+}
+
+//-----------------------------------------------------
+// Texts without group override fall back to this
+//-----------------------------------------------------
+void CaptionTimeline::SetDefaultGroup(QString const& _group)
+{
+    m_defaultGroup = _group;
+    viewport()->update();
+}
+
+int CaptionTimeline::GetIssueFlags(int _index) const
+{
+    return CaptionChecker::CheckText(m_tree, m_texts, _index);
+}
+
+QVector<CaptionChecker::Issue> CaptionTimeline::GetIssues(int _index) const
+{
+    QVector<CaptionChecker::Issue> issues;
+    if (_index >= 0 && _index < m_texts.size())
+    {
+        CaptionChecker::CheckText(m_tree, m_texts, _index, &issues);
+    }
+    return issues;
+}
+
+void CaptionTimeline::SetSelected(int _index)
+{
+    if (m_selected == _index)
+    {
+        return;
+    }
+
+    m_selected = _index;
+    viewport()->update();
+    emit SelectionChanged(_index);
+}
+
+//-----------------------------------------------------
+// Scroll until a text is on screen
+//-----------------------------------------------------
+void CaptionTimeline::EnsureVisible(int _index)
+{
+    if (_index < 0 || _index >= m_texts.size())
+    {
+        return;
+    }
+
+    QRect const rect = TextRect(_index);
+    QRect const view = viewport()->rect();
+    if (rect.left() < 0 || rect.left() > view.right())
+    {
+        horizontalScrollBar()->setValue(horizontalScrollBar()->value() + rect.left() - view.width() / 4);
+    }
+    if (rect.top() < c_rulerHeight)
+    {
+        verticalScrollBar()->setValue(verticalScrollBar()->value() + rect.top() - c_rulerHeight - 2);
+    }
+    else if (rect.bottom() > view.bottom())
+    {
+        verticalScrollBar()->setValue(verticalScrollBar()->value() + rect.bottom() - view.bottom() + 2);
+    }
+}
+
+//-----------------------------------------------------
+// Only the columns of the old and new line are repainted
+// unless following it scrolls the view
+//-----------------------------------------------------
+void CaptionTimeline::SetPlayhead(int _frame, bool _follow)
+{
+    if (m_playhead == _frame)
+    {
+        return;
+    }
+
+    int const width = viewport()->width();
+    if (m_playhead != -1)
+    {
+        viewport()->update(FrameX(m_playhead) - 1, 0, 3, viewport()->height());
+    }
+    m_playhead = _frame;
+    if (m_playhead == -1)
+    {
+        return;
+    }
+
+    int const x = FrameX(m_playhead);
+    if (_follow && (x < 0 || x >= width))
+    {
+        horizontalScrollBar()->setValue(horizontalScrollBar()->value() + x - width / 4);
+    }
+    else
+    {
+        viewport()->update(x - 1, 0, 3, viewport()->height());
+    }
+}
+
+//-----------------------------------------------------
+// Only lanes and frames inside the exposed rect are drawn
+//-----------------------------------------------------
+void CaptionTimeline::paintEvent(QPaintEvent *event)
+{
+    TRACE_SCOPE("ui", "Timeline Paint");
+
+    QPainter painter(viewport());
+    QRect const area = event->rect();
+    painter.fillRect(area, palette().base());
+
+    int const firstFrame = qMax(0, FrameAt(area.left()));
+    int const lastFrame = FrameAt(area.right());
+    int const scrollY = verticalScrollBar()->value();
+
+    // Lanes
+    for (int lane = 0; lane < m_laneCount; lane++)
+    {
+        int const y = c_rulerHeight + lane * c_laneHeight - scrollY;
+        if (y + c_laneHeight < area.top() || y > area.bottom()) continue;
+        if (lane % 2 == 1)
+        {
+            painter.fillRect(QRect(area.left(), y, area.width(), c_laneHeight), palette().alternateBase());
+        }
+    }
+
+    // Grid lines at least 60 pixels apart
+    static int const c_steps[] = {1, 2, 5, 10, 15, 30, 60, 150, 300, 600, 900, 1800, 3600, 9000, 18000};
+    int step = c_steps[0];
+    for (int candidate : c_steps)
+    {
+        step = candidate;
+        if (candidate * m_frameWidth >= 60.0) break;
+    }
+    painter.setPen(palette().mid().color());
+    for (int frame = (firstFrame / step) * step; frame <= lastFrame; frame += step)
+    {
+        int const x = FrameX(frame);
+        painter.drawLine(x, c_rulerHeight, x, area.bottom());
+    }
+
+    // Bars, the one being dragged may be out of sort order
+    int begin = 0;
+    int end = 0;
+    VisibleRange(firstFrame, lastFrame, begin, end);
+    QFontMetrics const metrics = painter.fontMetrics();
+    auto drawText = [&](int _index)
+    {
+        QRect const rect = TextRect(_index);
+        if (!rect.intersects(area)) return;
+
+        QColor color = IsValid(m_texts[_index]) ? QColor(70,130,180) : QColor(255,60,60);
+        if (_index == m_selected) color = QColor(255,150,0);
+        if (_index == m_hovered) color = color.lighter(120);
+
+        painter.fillRect(rect, color);
+        painter.setPen(color.darker(150));
+        painter.drawRect(rect.adjusted(0, 0, -1, -1));
+
+        // Timing issues as a strip on top, overlaps win
+        int const flags = GetIssueFlags(_index);
+        if (flags != 0)
+        {
+            QColor const strip = (flags & CaptionChecker::IF_Overlap) ? QColor(200,0,200) : QColor(255,210,0);
+            painter.fillRect(QRect(rect.left(), rect.top(), rect.width(), 4), strip);
+        }
+        painter.setPen(Qt::white);
+        painter.drawText(rect.adjusted(3, 0, -3, 0), Qt::AlignVCenter | Qt::AlignLeft, metrics.elidedText(m_texts[_index].m_cell, Qt::ElideRight, rect.width() - 6));
+    };
+    bool const dragging = m_dragMode != DM_None && m_dragMode != DM_Playhead;
+    for (int i = begin; i < end; i++)
+    {
+        if (dragging && m_order[i] == m_selected) continue;
+        drawText(m_order[i]);
+    }
+    if (dragging)
+    {
+        drawText(m_selected);
+    }
+
+    // Ruler stays on top while scrolling lanes
+    QRect const ruler(area.left(), 0, area.width(), c_rulerHeight);
+    if (ruler.intersects(area))
+    {
+        painter.fillRect(ruler, palette().button());
+        painter.setPen(palette().buttonText().color());
+        painter.drawLine(area.left(), c_rulerHeight - 1, area.right(), c_rulerHeight - 1);
+        for (int frame = (firstFrame / step) * step; frame <= lastFrame; frame += step)
+        {
+            int const x = FrameX(frame);
+            painter.drawLine(x, c_rulerHeight - 6, x, c_rulerHeight - 1);
+            painter.drawText(x + 2, c_rulerHeight - 6, FrameLabel(frame));
+        }
+    }
+
+    // Playhead over everything
+    if (m_playhead != -1)
+    {
+        int const x = FrameX(m_playhead);
+        if (x >= area.left() - 1 && x <= area.right() + 1)
+        {
+            painter.setPen(QColor(220,0,0));
+            painter.drawLine(x, 0, x, area.bottom());
+        }
+    }
+}
+
+void CaptionTimeline::resizeEvent(QResizeEvent *event)
+{
+    QAbstractScrollArea::resizeEvent(event);
+    UpdateScrollBars();
+}
+
+//-----------------------------------------------------
+// Select a bar and start dragging it, the ruler moves
+// the playhead instead
+//-----------------------------------------------------
+void CaptionTimeline::mousePressEvent(QMouseEvent *event)
+{
+    if (event->button() != Qt::LeftButton)
+    {
+        return;
+    }
+
+    if (event->y() < c_rulerHeight)
+    {
+        m_dragMode = DM_Playhead;
+        SetPlayhead(qBound(0, FrameAt(event->x()), c_maxFrame));
+        emit PlayheadMoved(m_playhead);
+        return;
+    }
+
+    DragMode mode = DM_None;
+    int const index = TextAt(event->pos(), mode);
+    SetSelected(index);
+    if (index != -1)
+    {
+        m_dragMode = mode;
+        m_dragFrame = FrameAt(event->x());
+        m_dragOrigin = m_texts[index];
+    }
+}
+
+//-----------------------------------------------------
+// Drag the selected bar or update hover
+//-----------------------------------------------------
+void CaptionTimeline::mouseMoveEvent(QMouseEvent *event)
+{
+    if (m_dragMode == DM_None)
+    {
+        DragMode mode = DM_None;
+        SetHovered(TextAt(event->pos(), mode));
+        switch (mode)
+        {
+        case DM_Move:           viewport()->setCursor(Qt::OpenHandCursor); break;
+        case DM_ResizeStart:
+        case DM_ResizeEnd:      viewport()->setCursor(Qt::SizeHorCursor); break;
+        default:                viewport()->setCursor(Qt::ArrowCursor); break;
+        }
+        return;
+    }
+
+    if (m_dragMode == DM_Playhead)
+    {
+        int const frame = qBound(0, FrameAt(event->x()), c_maxFrame);
+        if (frame != m_playhead)
+        {
+            SetPlayhead(frame);
+            emit PlayheadMoved(frame);
+        }
+        return;
+    }
+
+    int const delta = FrameAt(event->x()) - m_dragFrame;
+    int const originEnd = m_dragOrigin.m_start + m_dragOrigin.m_length - 1;
+    cap::Text text = m_dragOrigin;
+    switch (m_dragMode)
+    {
+    case DM_Move:
+        text.m_start = qBound(0, m_dragOrigin.m_start + delta, c_maxFrame - m_dragOrigin.m_length + 1);
+        break;
+    case DM_ResizeStart:
+        text.m_start = qBound(0, m_dragOrigin.m_start + delta, originEnd);
+        text.m_length = originEnd - text.m_start + 1;
+        break;
+    case DM_ResizeEnd:
+        text.m_length = qBound(1, m_dragOrigin.m_length + delta, c_maxFrame - m_dragOrigin.m_start + 1);
+        break;
+    default:
+        break;
+    }
+
+    cap::Text& current = m_texts[m_selected];
+    if (current.m_start != text.m_start || current.m_length != text.m_length)
+    {
+        current = text;
+        m_tree.Remove(m_selected);
+        m_tree.Insert(m_selected, text.m_start, text.m_start + text.m_length);
+        m_lastFrame = qMax(m_lastFrame, text.m_start + text.m_length - 1);
+        m_maxLength = qMax(m_maxLength, text.m_length);
+        UpdateOrder(m_selected);
+        viewport()->update();
+        emit TextsEdited();
+    }
+}
+
+//-----------------------------------------------------
+// Lanes are only re-packed once a drag is over
+//-----------------------------------------------------
+void CaptionTimeline::mouseReleaseEvent(QMouseEvent *event)
+{
+    Q_UNUSED(event)
+    if (m_dragMode == DM_Playhead)
+    {
+        m_dragMode = DM_None;
+    }
+    else if (m_dragMode != DM_None)
+    {
+        m_dragMode = DM_None;
+        UpdateLayout();
+    }
+}
+
+//-----------------------------------------------------
+// Ctrl zooms around the mouse, otherwise scroll frames
+//-----------------------------------------------------
+void CaptionTimeline::wheelEvent(QWheelEvent *event)
+{
+    int const delta = event->angleDelta().y();
+    if (event->modifiers() & Qt::ControlModifier)
+    {
+        int const x = event->pos().x();
+        double const frame = (x + horizontalScrollBar()->value()) / m_frameWidth;
+        m_frameWidth = qBound(0.25, delta > 0 ? m_frameWidth * 1.25 : m_frameWidth / 1.25, 40.0);
+        UpdateScrollBars();
+        horizontalScrollBar()->setValue(static_cast<int>(frame * m_frameWidth) - x);
+        viewport()->update();
+    }
+    else if (event->modifiers() & Qt::ShiftModifier)
+    {
+        verticalScrollBar()->setValue(verticalScrollBar()->value() - delta / 4);
+    }
+    else
+    {
+        horizontalScrollBar()->setValue(horizontalScrollBar()->value() - delta);
+    }
+    event->accept();
+}
+
+void CaptionTimeline::leaveEvent(QEvent *event)
+{
+    QAbstractScrollArea::leaveEvent(event);
+    if (m_dragMode == DM_None)
+    {
+        SetHovered(-1);
+    }
+}
+
+//-----------------------------------------------------
+// Sort by start and pack texts into the first free lane
+//-----------------------------------------------------
+void CaptionTimeline::UpdateLayout()
+{
+    m_order.resize(m_texts.size());
+    for (int i = 0; i < m_order.size(); i++)
+    {
+        m_order[i] = i;
+    }
+    QVector<cap::Text> const& texts = m_texts;
+    std::stable_sort(m_order.begin(), m_order.end(), [&texts](int _a, int _b)
+    {
+        return texts[_a].m_start < texts[_b].m_start;
+    });
+
+    QVector<int> laneEnds;
+    m_lanes.resize(m_texts.size());
+    m_maxLength = 1;
+    m_lastFrame = 0;
+    for (int index : m_order)
+    {
+        cap::Text const& text = m_texts[index];
+        int const end = text.m_start + text.m_length - 1;
+        m_maxLength = qMax(m_maxLength, text.m_length);
+        m_lastFrame = qMax(m_lastFrame, end);
+
+        int lane = 0;
+        while (lane < laneEnds.size() && laneEnds[lane] >= text.m_start)
+        {
+            lane++;
+        }
+        if (lane == laneEnds.size())
+        {
+            laneEnds.push_back(end);
+        }
+        else
+        {
+            laneEnds[lane] = end;
+        }
+        m_lanes[index] = lane;
+    }
+    m_laneCount = laneEnds.size();
+
+    UpdateScrollBars();
+    viewport()->update();
+}
+
+//-----------------------------------------------------
+// One minute past the last text is always scrollable
+//-----------------------------------------------------
+void CaptionTimeline::UpdateScrollBars()
+{
+    int const frameCount = qMax(m_lastFrame + 1 + 1800, 3600);
+    int const contentWidth = static_cast<int>(frameCount * m_frameWidth);
+    int const contentHeight = c_rulerHeight + m_laneCount * c_laneHeight + 2;
+    QSize const view = viewport()->size();
+
+    horizontalScrollBar()->setRange(0, qMax(0, contentWidth - view.width()));
+    horizontalScrollBar()->setPageStep(view.width());
+    horizontalScrollBar()->setSingleStep(qMax(1, static_cast<int>(30 * m_frameWidth)));
+    verticalScrollBar()->setRange(0, qMax(0, contentHeight - view.height()));
+    verticalScrollBar()->setPageStep(view.height());
+    verticalScrollBar()->setSingleStep(c_laneHeight);
+}
+
+void CaptionTimeline::SetHovered(int _index)
+{
+    if (m_hovered == _index)
+    {
+        return;
+    }
+
+    m_hovered = _index;
+    viewport()->update();
+    emit HoverChanged(_index);
+}
+
+//-----------------------------------------------------
+// Move one text to its sorted place in m_order after its
+// start changed, lanes stay as they are until the drag ends
+//-----------------------------------------------------
+void CaptionTimeline::UpdateOrder(int _index)
+{
+    m_order.removeOne(_index);
+
+    QVector<cap::Text> const& texts = m_texts;
+    auto const iter = std::lower_bound(m_order.begin(), m_order.end(), _index, [&texts](int _a, int _b)
+    {
+        return texts[_a].m_start < texts[_b].m_start || (texts[_a].m_start == texts[_b].m_start && _a < _b);
+    });
+    m_order.insert(iter, _index);
+}
+
+//-----------------------------------------------------
+// Range of m_order that may overlap [first, last]
+//-----------------------------------------------------
+void CaptionTimeline::VisibleRange(int _firstFrame, int _lastFrame, int& _begin, int& _end) const
+{
+    QVector<cap::Text> const& texts = m_texts;
+    auto const beginIter = std::lower_bound(m_order.begin(), m_order.end(), _firstFrame - m_maxLength + 1, [&texts](int _index, int _frame)
+    {
+        return texts[_index].m_start < _frame;
+    });
+    auto const endIter = std::upper_bound(beginIter, m_order.end(), _lastFrame, [&texts](int _frame, int _index)
+    {
+        return _frame < texts[_index].m_start;
+    });
+    _begin = static_cast<int>(beginIter - m_order.begin());
+    _end = static_cast<int>(endIter - m_order.begin());
+}
+
+//-----------------------------------------------------
+// Viewport x <-> frame
+//-----------------------------------------------------
+int CaptionTimeline::FrameAt(int _x) const
+{
+    return static_cast<int>((_x + horizontalScrollBar()->value()) / m_frameWidth);
+}
+
+int CaptionTimeline::FrameX(int _frame) const
+{
+    return static_cast<int>(_frame * m_frameWidth) - horizontalScrollBar()->value();
+}
+
+QRect CaptionTimeline::TextRect(int _index) const
+{
+    cap::Text const& text = m_texts[_index];
+    int const left = FrameX(text.m_start);
+    int const right = FrameX(text.m_start + text.m_length);
+    int const top = c_rulerHeight + m_lanes[_index] * c_laneHeight - verticalScrollBar()->value() + 2;
+    return QRect(left, top, qMax(right - left, 3), c_laneHeight - 4);
+}
+
+//-----------------------------------------------------
+// Text under a point and which part of it was hit
+//-----------------------------------------------------
+int CaptionTimeline::TextAt(QPoint const& _pos, DragMode& _mode) const
+{
+    _mode = DM_None;
+    if (_pos.y() < c_rulerHeight)
+    {
+        return -1;
+    }
+
+    int begin = 0;
+    int end = 0;
+    VisibleRange(FrameAt(_pos.x() - c_edgeGrab), FrameAt(_pos.x() + c_edgeGrab), begin, end);
+    for (int i = begin; i < end; i++)
+    {
+        int const index = m_order[i];
+        QRect const rect = TextRect(index);
+        if (_pos.y() < rect.top() || _pos.y() > rect.bottom()) continue;
+        if (_pos.x() < rect.left() - c_edgeGrab || _pos.x() > rect.right() + c_edgeGrab) continue;
+
+        if (_pos.x() >= rect.right() - c_edgeGrab)
+        {
+            _mode = DM_ResizeEnd;
+        }
+        else if (_pos.x() <= rect.left() + c_edgeGrab && rect.width() > c_edgeGrab * 3)
+        {
+            _mode = DM_ResizeStart;
+        }
+        else
+        {
+            _mode = DM_Move;
+        }
+        return index;
+    }
+
+    return -1;
+}
+
+bool CaptionTimeline::IsValid(cap::Text const& _text) const
+{
+    return !_text.m_cell.isEmpty() && (!_text.m_group.isEmpty() || !m_defaultGroup.isEmpty());
+}
@@ -0,0 +1,113 @@
+#ifndef CAPTIONTIMELINE_H
+#define CAPTIONTIMELINE_H
+
+#include <QAbstractScrollArea>
+#include <QVector>
+
+#include "cap.h"
+#include "captionchecker.h"
+
+//-----------------------------------------------------
+// Texts of one cutscene painted as bars on a frame
+// axis, bars can be dragged to move or resize them
+//-----------------------------------------------------
+class CaptionTimeline : public QAbstractScrollArea
+{
+    Q_OBJECT
+
+public:
+    explicit CaptionTimeline(QWidget *parent = nullptr);
+
+    // Texts of the loaded cutscene
+    void SetTexts(QVector<cap::Text> const& _texts);
+    void UpdateTexts(QVector<cap::Text> const& _texts);
+    QVector<cap::Text> const& GetTexts() const { return m_texts; }
+    int GetTextCount() const { return m_texts.size(); }
+    cap::Text const& GetText(int _index) const { return m_texts[_index]; }
+    void SetText(int _index, cap::Text const& _text);
+    int AddText(cap::Text const& _text);
+    void RemoveText(int _index);
+    void SetDefaultGroup(QString const& _group);
+
+    // Overlap, gap and length checks of one text
+    int GetIssueFlags(int _index) const;
+    QVector<CaptionChecker::Issue> GetIssues(int _index) const;
+
+    // Selection and hover (-1 for none)
+    void SetSelected(int _index);
+    int GetSelected() const { return m_selected; }
+    int GetHovered() const { return m_hovered; }
+    void EnsureVisible(int _index);
+
+    // Playback position (-1 for none), scrolls along if asked
+    void SetPlayhead(int _frame, bool _follow = false);
+    int GetPlayhead() const { return m_playhead; }
+
+signals:
+    void SelectionChanged(int _index);
+    void TextsEdited();
+    void HoverChanged(int _index);
+    void PlayheadMoved(int _frame);
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+    void mousePressEvent(QMouseEvent *event) override;
+    void mouseMoveEvent(QMouseEvent *event) override;
+    void mouseReleaseEvent(QMouseEvent *event) override;
+    void wheelEvent(QWheelEvent *event) override;
+    void leaveEvent(QEvent *event) override;
+
+private:
+    enum DragMode : int
+    {
+        DM_None = 0,
+        DM_Move,
+        DM_ResizeStart,
+        DM_ResizeEnd,
+        DM_Playhead
+    };
+
+    void UpdateLayout();
+    void UpdateOrder(int _index);
+    void UpdateScrollBars();
+    void SetHovered(int _index);
+
+    void VisibleRange(int _firstFrame, int _lastFrame, int& _begin, int& _end) const;
+    int FrameAt(int _x) const;
+    int FrameX(int _frame) const;
+    QRect TextRect(int _index) const;
+    int TextAt(QPoint const& _pos, DragMode& _mode) const;
+    bool IsValid(cap::Text const& _text) const;
+
+private:
+    static int const c_rulerHeight = 20;
+    static int const c_laneHeight = 22;
+    static int const c_edgeGrab = 4;
+    static int const c_maxFrame = 99999;
+
+    QVector<cap::Text> m_texts;
+    QString m_defaultGroup;
+
+    // Kept in sync with every edit for live checks
+    CaptionIntervalTree m_tree;
+
+    // Texts sorted by start and the lane each one is drawn in
+    QVector<int> m_order;
+    QVector<int> m_lanes;
+    int m_laneCount;
+    int m_maxLength;
+    int m_lastFrame;
+
+    double m_frameWidth;
+    int m_selected;
+    int m_hovered;
+    int m_playhead;
+
+    // Dragging a bar
+    DragMode m_dragMode;
+    int m_dragFrame;
+    cap::Text m_dragOrigin;
+};
+
+#endif // CAPTIONTIMELINE_H
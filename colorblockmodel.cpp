@@ -0,0 +1,409 @@
+#include "colorblockmodel.h"
+
+#include <climits>
+
+#include <QColorDialog>
+#include <QMouseEvent>
+#include <QSpinBox>
+
+#include "tracer.h"
+
+ColorBlockModel::ColorBlockModel(QObject *parent) :
+    QAbstractTableModel(parent)
+{
+    m_symbolCount = 0;
+    m_textIsOmochao = true;
+}
+
+//-----------------------------------------------------
+// Replace all blocks (subtitle loaded)
+//-----------------------------------------------------
+void ColorBlockModel::SetColorBlocks(vector<fco::ColorBlock> const& _colorBlocks)
+{
+    TRACE_SCOPE("ui", "Color Blocks Load");
+
+    beginResetModel();
+    m_colorBlocks = _colorBlocks;
+    endResetModel();
+}
+
+//-----------------------------------------------------
+// Remove all blocks (subtitle unloaded or text emptied)
+//-----------------------------------------------------
+void ColorBlockModel::Clear()
+{
+    beginResetModel();
+    m_colorBlocks.clear();
+    endResetModel();
+}
+
+//-----------------------------------------------------
+// Append a default block
+//-----------------------------------------------------
+void ColorBlockModel::AddColorBlock()
+{
+    fco::ColorBlock colorBlock;
+    if (m_symbolCount > 0)
+    {
+        colorBlock.m_end = min(colorBlock.m_end, m_symbolCount - 1);
+    }
+
+    int const row = static_cast<int>(m_colorBlocks.size());
+    beginInsertRows(QModelIndex(), row, row);
+    m_colorBlocks.push_back(colorBlock);
+    endInsertRows();
+}
+
+//-----------------------------------------------------
+// Remove one block
+//-----------------------------------------------------
+void ColorBlockModel::RemoveColorBlock(int _row)
+{
+    if (_row < 0 || _row >= static_cast<int>(m_colorBlocks.size())) return;
+
+    beginRemoveRows(QModelIndex(), _row, _row);
+    m_colorBlocks.erase(m_colorBlocks.begin() + _row);
+    endRemoveRows();
+}
+
+//-----------------------------------------------------
+// Swap a block with its neighbour (later blocks win)
+//-----------------------------------------------------
+void ColorBlockModel::MoveColorBlock(int _row, int _newRow)
+{
+    int const count = static_cast<int>(m_colorBlocks.size());
+    if (_row < 0 || _newRow < 0 || _row >= count || _newRow >= count || qAbs(_row - _newRow) != 1)
+    {
+        return;
+    }
+
+    // Destination is the row before which the moved row is placed
+    if (!beginMoveRows(QModelIndex(), _row, _row, QModelIndex(), _newRow > _row ? _newRow + 1 : _newRow))
+    {
+        return;
+    }
+    swap(m_colorBlocks[static_cast<size_t>(_row)], m_colorBlocks[static_cast<size_t>(_newRow)]);
+    endMoveRows();
+}
+
+//-----------------------------------------------------
+// Clamp start/end of every block to the symbol count
+//-----------------------------------------------------
+void ColorBlockModel::SetSymbolCount(unsigned int _count)
+{
+    m_symbolCount = _count;
+    if (m_symbolCount == 0) return;
+
+    for (size_t i = 0; i < m_colorBlocks.size(); i++)
+    {
+        fco::ColorBlock& colorBlock = m_colorBlocks[i];
+        unsigned int const end = min(colorBlock.m_end, m_symbolCount - 1);
+        unsigned int const start = min(colorBlock.m_start, end);
+        if (start != colorBlock.m_start || end != colorBlock.m_end)
+        {
+            colorBlock.m_start = start;
+            colorBlock.m_end = end;
+            int const row = static_cast<int>(i);
+            emit dataChanged(index(row, CT_Start), index(row, CT_End));
+        }
+    }
+}
+
+int ColorBlockModel::rowCount(QModelIndex const& parent) const
+{
+    return parent.isValid() ? 0 : static_cast<int>(m_colorBlocks.size());
+}
+
+int ColorBlockModel::columnCount(QModelIndex const& parent) const
+{
+    return parent.isValid() ? 0 : CT_COUNT;
+}
+
+QVariant ColorBlockModel::data(QModelIndex const& index, int role) const
+{
+    if (!index.isValid() || index.row() >= static_cast<int>(m_colorBlocks.size()))
+    {
+        return QVariant();
+    }
+
+    fco::ColorBlock const& colorBlock = m_colorBlocks[static_cast<size_t>(index.row())];
+    fco::Color color = colorBlock.m_color;
+
+    switch (index.column())
+    {
+    case CT_Hardcoded:
+        if (role == Qt::CheckStateRole) return color.IsHardcoded() ? Qt::Checked : Qt::Unchecked;
+        break;
+    case CT_Color:
+        if (role == Qt::BackgroundRole || role == Qt::EditRole)
+        {
+            return color.IsHardcoded() ? QColor(240, 240, 240) : QColor(color.r, color.g, color.b);
+        }
+        break;
+    case CT_Alpha:
+        if (role == Qt::DisplayRole || role == Qt::EditRole) return static_cast<int>(color.a);
+        break;
+    case CT_Start:
+        if (role == Qt::DisplayRole || role == Qt::EditRole) return static_cast<int>(colorBlock.m_start);
+        break;
+    case CT_End:
+        if (role == Qt::DisplayRole || role == Qt::EditRole) return static_cast<int>(colorBlock.m_end);
+        break;
+    default: break;
+    }
+
+    return QVariant();
+}
+
+bool ColorBlockModel::setData(QModelIndex const& index, QVariant const& value, int role)
+{
+    if (!index.isValid() || index.row() >= static_cast<int>(m_colorBlocks.size()))
+    {
+        return false;
+    }
+
+    fco::ColorBlock& colorBlock = m_colorBlocks[static_cast<size_t>(index.row())];
+    fco::Color& color = colorBlock.m_color;
+    int const maxIndex = m_symbolCount > 0 ? static_cast<int>(m_symbolCount) - 1 : INT_MAX;
+
+    switch (index.column())
+    {
+    case CT_Hardcoded:
+    {
+        if (role != Qt::CheckStateRole) return false;
+        if (value.toInt() == Qt::Unchecked)
+        {
+            if (m_textIsOmochao)
+            {
+                color.SetWhite();
+            }
+            else
+            {
+                color.SetBlack();
+            }
+        }
+        else
+        {
+            color.SetHardcoded();
+        }
+        emit dataChanged(index, index.sibling(index.row(), CT_Color));
+        return true;
+    }
+    case CT_Color:
+    {
+        QColor const newColor = value.value<QColor>();
+        if (role != Qt::EditRole || !newColor.isValid() || color.IsHardcoded()) return false;
+        color.r = static_cast<unsigned char>(newColor.red());
+        color.g = static_cast<unsigned char>(newColor.green());
+        color.b = static_cast<unsigned char>(newColor.blue());
+        if (color.IsHardcoded()) color.r = 0x01;
+        break;
+    }
+    case CT_Alpha:
+        if (role != Qt::EditRole) return false;
+        color.a = static_cast<unsigned char>(qBound(0, value.toInt(), 255));
+        break;
+    case CT_Start:
+        if (role != Qt::EditRole) return false;
+        colorBlock.m_start = static_cast<unsigned int>(qBound(0, value.toInt(), qMin(static_cast<int>(colorBlock.m_end), maxIndex)));
+        break;
+    case CT_End:
+        if (role != Qt::EditRole) return false;
+        colorBlock.m_end = static_cast<unsigned int>(qBound(static_cast<int>(colorBlock.m_start), value.toInt(), maxIndex));
+        break;
+    default:
+        return false;
+    }
+
+    emit dataChanged(index, index);
+    return true;
+}
+
+Qt::ItemFlags ColorBlockModel::flags(QModelIndex const& index) const
+{
+    if (!index.isValid()) return Qt::NoItemFlags;
+
+    switch (index.column())
+    {
+    case CT_Hardcoded:
+        return Qt::ItemIsEnabled | Qt::ItemIsSelectable | Qt::ItemIsUserCheckable;
+    case CT_Color:
+    {
+        // Same as the disabled color browser of hardcoded colors
+        fco::Color color = m_colorBlocks[static_cast<size_t>(index.row())].m_color;
+        return color.IsHardcoded() ? Qt::ItemIsSelectable : Qt::ItemIsEnabled | Qt::ItemIsSelectable;
+    }
+    default:
+        return Qt::ItemIsEnabled | Qt::ItemIsSelectable | Qt::ItemIsEditable;
+    }
+}
+
+QVariant ColorBlockModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (role != Qt::DisplayRole) return QVariant();
+
+    if (orientation == Qt::Vertical)
+    {
+        return QString::number(section + 1) + ":";
+    }
+
+    switch (section)
+    {
+    case CT_Hardcoded:  return "Hardcoded";
+    case CT_Color:      return "Color";
+    case CT_Alpha:      return "Alpha";
+    case CT_Start:      return "Start";
+    case CT_End:        return "End";
+    default:            return QVariant();
+    }
+}
+
+//-----------------------------------------------------
+// Color block delegate
+//-----------------------------------------------------
+ColorBlockDelegate::ColorBlockDelegate(QObject *parent) :
+    QStyledItemDelegate(parent)
+{
+    m_initValue = 0;
+    m_mouseY = 0;
+    m_dragScale = 0;
+    m_dragSpinBox = Q_NULLPTR;
+}
+
+//-----------------------------------------------------
+// Spin box limited to the values the model accepts
+//-----------------------------------------------------
+QWidget* ColorBlockDelegate::createEditor(QWidget* parent, QStyleOptionViewItem const& option, QModelIndex const& index) const
+{
+    Q_UNUSED(option)
+
+    int minimum = 0;
+    int maximum = 255;
+    int dragScale = 1;
+    switch (index.column())
+    {
+    case ColorBlockModel::CT_Alpha:
+        break;
+    case ColorBlockModel::CT_Start:
+    case ColorBlockModel::CT_End:
+    {
+        ColorBlockModel const* model = qobject_cast<ColorBlockModel const*>(index.model());
+        int const maxIndex = (model && model->GetSymbolCount() > 0) ? static_cast<int>(model->GetSymbolCount()) - 1 : 0;
+        int const start = index.sibling(index.row(), ColorBlockModel::CT_Start).data(Qt::EditRole).toInt();
+        int const end = index.sibling(index.row(), ColorBlockModel::CT_End).data(Qt::EditRole).toInt();
+        minimum = (index.column() == ColorBlockModel::CT_Start) ? 0 : start;
+        maximum = (index.column() == ColorBlockModel::CT_Start) ? qMin(end, maxIndex) : maxIndex;
+        dragScale = 6;
+        break;
+    }
+    default:
+        return Q_NULLPTR;
+    }
+
+    QSpinBox* spinBox = new QSpinBox(parent);
+    spinBox->setFrame(false);
+    spinBox->setRange(minimum, maximum);
+    spinBox->setCursor(Qt::SizeVerCursor);
+    spinBox->setProperty("dragScale", dragScale);
+
+    // Write back while the value changes so the preview follows
+    ColorBlockDelegate* delegate = const_cast<ColorBlockDelegate*>(this);
+    connect(spinBox, QOverload<int>::of(&QSpinBox::valueChanged), delegate, [delegate, spinBox]()
+    {
+        emit delegate->commitData(spinBox);
+    });
+
+    return spinBox;
+}
+
+void ColorBlockDelegate::setEditorData(QWidget* editor, QModelIndex const& index) const
+{
+    QSpinBox* spinBox = qobject_cast<QSpinBox*>(editor);
+    if (spinBox)
+    {
+        QSignalBlocker blocker(spinBox);
+        spinBox->setValue(index.data(Qt::EditRole).toInt());
+    }
+}
+
+void ColorBlockDelegate::setModelData(QWidget* editor, QAbstractItemModel* model, QModelIndex const& index) const
+{
+    QSpinBox* spinBox = qobject_cast<QSpinBox*>(editor);
+    if (spinBox && spinBox->value() != index.data(Qt::EditRole).toInt())
+    {
+        model->setData(index, spinBox->value(), Qt::EditRole);
+    }
+}
+
+//-----------------------------------------------------
+// Clicking the color cell picks a new color
+//-----------------------------------------------------
+bool ColorBlockDelegate::editorEvent(QEvent* event, QAbstractItemModel* model, QStyleOptionViewItem const& option, QModelIndex const& index)
+{
+    if (index.column() == ColorBlockModel::CT_Color && event->type() == QEvent::MouseButtonRelease)
+    {
+        QMouseEvent* e = static_cast<QMouseEvent*>(event);
+        if (e->button() == Qt::LeftButton && (index.flags() & Qt::ItemIsEnabled))
+        {
+            QColor const color = index.data(Qt::EditRole).value<QColor>();
+            QColor const newColor = QColorDialog::getColor(color, const_cast<QWidget*>(option.widget), "Pick a Color");
+            if (newColor.isValid())
+            {
+                model->setData(index, newColor, Qt::EditRole);
+            }
+            return true;
+        }
+    }
+
+    return QStyledItemDelegate::editorEvent(event, model, option, index);
+}
+
+//-----------------------------------------------------
+// Dragging spin box editors up/down changes the value
+//-----------------------------------------------------
+bool ColorBlockDelegate::eventFilter(QObject* object, QEvent* event)
+{
+    QSpinBox* spinBox = qobject_cast<QSpinBox*>(object);
+    if (spinBox)
+    {
+        if (!m_dragSpinBox && event->type() == QEvent::MouseButtonPress && spinBox->property("dragScale").toInt() > 0)
+        {
+            QMouseEvent *e = static_cast<QMouseEvent*>(event);
+            m_dragScale = spinBox->property("dragScale").toInt();
+            m_mouseY = e->y();
+            m_dragSpinBox = spinBox;
+            m_initValue = spinBox->value();
+        }
+        else if (m_dragSpinBox == spinBox && event->type() == QEvent::MouseButtonRelease)
+        {
+            m_dragSpinBox = Q_NULLPTR;
+        }
+        else if (m_dragSpinBox == spinBox && event->type() == QEvent::MouseMove)
+        {
+            QMouseEvent *e = static_cast<QMouseEvent*>(event);
+            int newVar = m_initValue + (m_mouseY - e->y()) / m_dragScale;
+
+            if (newVar < spinBox->minimum())
+            {
+                m_initValue = spinBox->minimum();
+                m_mouseY = e->y();
+                newVar = m_initValue;
+            }
+            else if (newVar > spinBox->maximum())
+            {
+                m_initValue = spinBox->maximum();
+                m_mouseY = e->y();
+                newVar = m_initValue;
+            }
+
+            spinBox->setValue(newVar);
+        }
+        else if (m_dragSpinBox == spinBox && event->type() == QEvent::Hide)
+        {
+            // Editor closed mid drag
+            m_dragSpinBox = Q_NULLPTR;
+        }
+    }
+
+    return QStyledItemDelegate::eventFilter(object, event);
+}
@@ -0,0 +1,91 @@
+#ifndef COLORBLOCKMODEL_H
+#define COLORBLOCKMODEL_H
+
+#include <QAbstractTableModel>
+#include <QColor>
+#include <QStyledItemDelegate>
+
+#include "fco.h"
+
+//-----------------------------------------------------
+// Table model owning the color blocks of the subtitle
+// being edited, one row per fco::ColorBlock
+//-----------------------------------------------------
+class ColorBlockModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    enum ColumnType : int
+    {
+        CT_Hardcoded = 0,
+        CT_Color,
+        CT_Alpha,
+        CT_Start,
+        CT_End,
+
+        CT_COUNT
+    };
+
+public:
+    explicit ColorBlockModel(QObject *parent = nullptr);
+
+    // Blocks
+    void SetColorBlocks(vector<fco::ColorBlock> const& _colorBlocks);
+    vector<fco::ColorBlock> const& GetColorBlocks() const { return m_colorBlocks; }
+    void Clear();
+
+    // Edits
+    void AddColorBlock();
+    void RemoveColorBlock(int _row);
+    void MoveColorBlock(int _row, int _newRow);
+
+    // Start/end are clamped to the symbol count of the text
+    void SetSymbolCount(unsigned int _count);
+    unsigned int GetSymbolCount() const { return m_symbolCount; }
+
+    // Unchecking hardcoded picks white (Omochao box) or black
+    void SetTextIsOmochao(bool _textIsOmochao) { m_textIsOmochao = _textIsOmochao; }
+
+    // QAbstractItemModel
+    int rowCount(QModelIndex const& parent = QModelIndex()) const override;
+    int columnCount(QModelIndex const& parent = QModelIndex()) const override;
+    QVariant data(QModelIndex const& index, int role = Qt::DisplayRole) const override;
+    bool setData(QModelIndex const& index, QVariant const& value, int role = Qt::EditRole) override;
+    Qt::ItemFlags flags(QModelIndex const& index) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+private:
+    vector<fco::ColorBlock> m_colorBlocks;
+    unsigned int m_symbolCount;
+    bool m_textIsOmochao;
+};
+
+//-----------------------------------------------------
+// Spin box editors for alpha/start/end (draggable like
+// the default alpha), color dialog for the color cell
+//-----------------------------------------------------
+class ColorBlockDelegate : public QStyledItemDelegate
+{
+    Q_OBJECT
+
+public:
+    explicit ColorBlockDelegate(QObject *parent = nullptr);
+
+    QWidget* createEditor(QWidget* parent, QStyleOptionViewItem const& option, QModelIndex const& index) const override;
+    void setEditorData(QWidget* editor, QModelIndex const& index) const override;
+    void setModelData(QWidget* editor, QAbstractItemModel* model, QModelIndex const& index) const override;
+    bool editorEvent(QEvent* event, QAbstractItemModel* model, QStyleOptionViewItem const& option, QModelIndex const& index) override;
+
+protected:
+    bool eventFilter(QObject* object, QEvent* event) override;
+
+private:
+    // Dragging spin box
+    int m_initValue;
+    int m_mouseY;
+    int m_dragScale;
+    QWidget* m_dragSpinBox;
+};
+
+#endif // COLORBLOCKMODEL_H
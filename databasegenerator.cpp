@@ -1,6 +1,10 @@
 #include "databasegenerator.h"
 #include "ui_databasegenerator.h"
 
+#include "tracer.h"
+
+#include <QtConcurrent>
+
 DatabaseGenerator::DatabaseGenerator(QWidget *parent) :
     QDialog(parent),
     ui(new Ui::DatabaseGenerator)
@@ -11,6 +15,19 @@ DatabaseGenerator::DatabaseGenerator(QWidget *parent) :
     ui->GV_Preview->setScene(m_graphic);
     connect(ui->GV_Preview, SIGNAL(previewScreenPressed(QPoint)), this, SLOT(on_Preview_pressed(QPoint)));
     m_buttonPixmap = Q_NULLPTR;
+    m_selectedItem = -1;
+
+    // Font atlas follows the settings shortly after they stop changing
+    m_atlas = AtlasBuild();
+    m_atlasGeneration = 0;
+    m_atlasBuilding = false;
+    m_atlasSetToZero = false;
+    m_atlasTimer = new QTimer(this);
+    m_atlasTimer->setSingleShot(true);
+    m_atlasTimer->setInterval(c_rebuildDelay);
+    connect(m_atlasTimer, &QTimer::timeout, this, &DatabaseGenerator::StartFontTextures);
+    m_atlasWatcher = new QFutureWatcher<AtlasBuild>(this);
+    connect(m_atlasWatcher, &QFutureWatcher<AtlasBuild>::finished, this, &DatabaseGenerator::FontTexturesFinished);
 
     m_settings = new QSettings("brianuuu", "fcoEditor", this);
     m_ftePath = m_settings->value("DatabaseDefaultDirectory", QString()).toString();
@@ -65,6 +82,7 @@ void DatabaseGenerator::Reset()
     m_fte.Reset();
 
     ClearGraphicScene();
+    m_selectedItem = -1;
     for (int i = 0; i < BT_COUNT; i++)
     {
         qobject_cast<QSpinBox*>(ui->GL_Button->itemAtPosition(i + 1, CT_X)->widget())->setValue(0);
@@ -76,9 +94,13 @@ void DatabaseGenerator::Reset()
     ui->LE_Font->clear();
     ui->LE_ButtonTexture->clear();
     ui->TE_Characters->clear();
+    ui->L_Occupancy->clear();
     ui->RB_Button->setChecked(true);
 
     m_fontTextures.clear();
+    m_atlas = AtlasBuild();
+    m_atlasGeneration++;
+    m_atlasTimer->stop();
     ui->SB_FontIndex->setMaximum(0);
 
     ui->PB_Texture->setEnabled(false);
@@ -160,6 +182,8 @@ void DatabaseGenerator::on_PB_Import_clicked()
 
 void DatabaseGenerator::on_PB_Export_clicked()
 {
+    TRACE_SCOPE("atlas", "Export");
+
     QString path = "";
     if (!m_ftePath.isEmpty())
     {
@@ -172,27 +196,38 @@ void DatabaseGenerator::on_PB_Export_clicked()
 
     if (ui->RB_ModeNew->isChecked())
     {
+        FinishFontTextures();
+
+        // Pages are single channel, the button sheet keeps its alpha
+        DdsWriter::Format const pageFormat = ui->CB_TextureFormat->currentIndex() == 1 ? DdsWriter::DF_BC4 : DdsWriter::DF_BC1;
+        QVector<DdsWriter::File> textureFiles;
+
+        // Records keep the character list order, the packer doesn't
+        QString const characters = ui->TE_Characters->toPlainText();
         uint32_t textureIndex = 0;
-        m_fte.m_data.clear();
+        m_fte.m_data.assign(size_t(characters.size()), fte::Data());
         m_fte.m_textures.clear();
+        for (int i = 0; i < characters.size(); i++)
+        {
+            m_fte.m_data[size_t(i)].m_wchar = characters[i].unicode();
+        }
+
         for (int i = 0; i < m_fontTextures.size(); i++)
         {
             FontTextureData const& fontTex = m_fontTextures[i];
             QSize size = fontTex.m_texture.size();
             for (CharacterData const& characterData : fontTex.m_characterData)
             {
-                fte::Data data;
+                fte::Data& data = m_fte.m_data[size_t(characterData.m_databaseIndex - 0x82)];
                 data.m_left = characterData.m_x / float(size.width());
                 data.m_top = characterData.m_y / float(size.height());
                 data.m_right = (characterData.m_x + characterData.m_width) / float(size.width());
                 data.m_bottom = (characterData.m_y + characterData.m_height) / float(size.height());
                 data.m_textureIndex = textureIndex;
-                data.m_wchar = characterData.m_char.unicode();
-                m_fte.m_data.push_back(data);
             }
 
             QString name = "All_" + QStringLiteral("%1").arg(i, 3, 10, QLatin1Char('0'));
-            fontTex.m_texture.save(dir + "/" + name + ".dds");
+            textureFiles.push_back(DdsWriter::File{fontTex.m_texture, dir + "/" + name + ".dds", pageFormat});
             fte::Texture texture;
             texture.m_name = name.toStdString();
             texture.m_width = uint32_t(size.width());
@@ -220,48 +255,50 @@ void DatabaseGenerator::on_PB_Export_clicked()
             m_fte.m_buttonData.push_back(data);
         }
 
-        m_buttonImage.save(dir + "/" + ui->LE_ButtonTexture->text() + ".dds");
+        textureFiles.push_back(DdsWriter::File{m_buttonImage, dir + "/" + ui->LE_ButtonTexture->text() + ".dds", DdsWriter::DF_BC3});
         fte::Texture texture;
         texture.m_name = ui->LE_ButtonTexture->text().toStdString();
         texture.m_width = uint32_t(size.width());
         texture.m_height = uint32_t(size.height());
         m_fte.m_textures.push_back(texture);
         textureIndex++;
+
+        QStringList const errors = DdsWriter::SaveAll(textureFiles, ui->CHB_Mipmaps->isChecked());
+        if (!errors.isEmpty())
+        {
+            QMessageBox::critical(this, "Export .fte and Textures", errors.join("\n"));
+        }
     }
     else
     {
-        int index = 0x82;
-        for (fte::Data& data : m_fte.m_data)
+        // Records are in database order from 0x82, the first
+        // page listing a character wins
+        QVector<bool> found(int(m_fte.m_data.size()), false);
+        for (FontTextureData const& fontTextures : m_fontTextures)
         {
-            // Find the character we want
-            bool found = false;
-            for (FontTextureData const& fontTextures : m_fontTextures)
+            QSize size = fontTextures.m_texture.size();
+            for (CharacterData const& characterData : fontTextures.m_characterData)
             {
-                for (CharacterData const& characterData : fontTextures.m_characterData)
-                {
-                    if (index == characterData.m_databaseIndex)
-                    {
-                        QSize size = fontTextures.m_texture.size();
-                        data.m_left = characterData.m_x / float(size.width());
-                        data.m_top = characterData.m_y / float(size.height());
-                        data.m_right = (characterData.m_x + characterData.m_width) / float(size.width());
-                        data.m_bottom = (characterData.m_y + characterData.m_height) / float(size.height());
-
-                        found = true;
-                        break;
-                    }
-                }
+                int const record = characterData.m_databaseIndex - 0x82;
+                if (record < 0 || record >= found.size() || found[record]) continue;
 
-                if (found) break;
+                fte::Data& data = m_fte.m_data[size_t(record)];
+                data.m_left = characterData.m_x / float(size.width());
+                data.m_top = characterData.m_y / float(size.height());
+                data.m_right = (characterData.m_x + characterData.m_width) / float(size.width());
+                data.m_bottom = (characterData.m_y + characterData.m_height) / float(size.height());
+                found[record] = true;
             }
+        }
 
-            if (!found)
+        for (int i = 0; i < found.size(); i++)
+        {
+            if (!found[i])
             {
                 // We really shouldn't be here
+                fte::Data const& data = m_fte.m_data[size_t(i)];
                 QMessageBox::critical(this, "Export .fte", "Unable to find data for character '" + QString::fromWCharArray(&data.m_wchar, 1) + "'");
             }
-
-            index++;
         }
 
         QSize size = m_buttonImage.size();
@@ -287,6 +324,7 @@ void DatabaseGenerator::on_PB_Export_clicked()
 void DatabaseGenerator::on_SB_FontSize_valueChanged(int arg1)
 {
     m_font.setPixelSize(arg1);
+    m_advances.clear();
 
     QFontMetrics fontMetrics(m_font);
     ui->SB_OffsetY->setValue(int(fontMetrics.height() * 23.0f / 28.0f));
@@ -297,6 +335,7 @@ void DatabaseGenerator::on_SB_FontSize_valueChanged(int arg1)
 void DatabaseGenerator::on_SB_Spacing_valueChanged(int arg1)
 {
     m_font.setLetterSpacing(QFont::SpacingType::AbsoluteSpacing, arg1);
+    m_advances.clear();
     UpdateFontTextures(false);
 }
 
@@ -310,6 +349,21 @@ void DatabaseGenerator::on_SB_OffsetY_valueChanged(int arg1)
     UpdateFontTextures(false);
 }
 
+void DatabaseGenerator::on_CB_PageSize_currentIndexChanged(int index)
+{
+    UpdateFontTextures(false);
+}
+
+void DatabaseGenerator::on_SB_Padding_valueChanged(int arg1)
+{
+    UpdateFontTextures(false);
+}
+
+void DatabaseGenerator::on_CB_Sort_currentIndexChanged(int index)
+{
+    UpdateFontTextures(false);
+}
+
 void DatabaseGenerator::on_TE_Characters_textChanged()
 {
     UpdateFontTextures(false);
@@ -390,6 +444,7 @@ void DatabaseGenerator::on_PB_Font_clicked()
     m_font = QFont(family);
     m_font.setPixelSize(ui->SB_FontSize->value());
     m_font.setLetterSpacing(QFont::SpacingType::AbsoluteSpacing, ui->SB_Spacing->value());
+    m_advances.clear();
 
     QFontMetrics fontMetrics(m_font);
     ui->SB_OffsetY->setValue(int(fontMetrics.height() * 23.0f / 28.0f));
@@ -426,7 +481,7 @@ void DatabaseGenerator::on_RB_Button_toggled(bool checked)
     if (checked)
     {
         UpdateDrawButtonTexture();
-        SetSelected(nullptr);
+        SetSelected(-1);
     }
 }
 
@@ -448,7 +503,7 @@ void DatabaseGenerator::on_RB_Font_toggled(bool checked)
 void DatabaseGenerator::on_SB_FontIndex_valueChanged(int arg1)
 {
     UpdateDrawFontTexture(arg1);
-    SetSelected(nullptr);
+    SetSelected(-1);
 }
 
 void DatabaseGenerator::on_Preview_pressed(QPoint pos)
@@ -468,19 +523,17 @@ void DatabaseGenerator::on_Preview_pressed(QPoint pos)
         if (index < m_fontTextures.size())
         {
             //qDebug() << pos;
-            FontTextureData const& fontTex = m_fontTextures[index];
-            for (CharacterData const& data : fontTex.m_characterData)
+            FontTextureData const& fontTex = m_fontTextures.at(index);
+            int const id = fontTex.m_grid.Find(pos);
+            if (id != -1)
             {
-                if (pos.x() >= data.m_x && pos.x() < data.m_x + data.m_width && pos.y() >= data.m_y && pos.y() < data.m_y + data.m_height)
-                {
-                    SetSelected(&data);
-                    return;
-                }
+                SetSelected(id);
+                return;
             }
         }
     }
 
-    SetSelected(nullptr);
+    SetSelected(-1);
 }
 
 void DatabaseGenerator::on_SB_SelectedX_valueChanged(int arg1)
@@ -511,10 +564,13 @@ void DatabaseGenerator::ClearGraphicScene()
     {
         m_buttonHighlightPixmap[i] = Q_NULLPTR;
     }
+    m_glyphItems.clear();
 }
 
 void DatabaseGenerator::LoadFontTextures()
 {
+    TRACE_SCOPE("atlas", "Load Atlas");
+
     m_fontTextures.clear();
     int textureIndex = 0;
     QMap<uint32_t, int> fteTextureIndexMap;
@@ -537,7 +593,7 @@ void DatabaseGenerator::LoadFontTextures()
             else
             {
                 FontTextureData textureData;
-                textureData.m_texture = QImage(imagePath);
+                textureData.m_texture = DdsReader::Load(imagePath);
                 m_fontTextures.push_back(textureData);
             }
         }
@@ -557,39 +613,32 @@ void DatabaseGenerator::LoadFontTextures()
     ui->SB_FontIndex->setMaximum(m_fontTextures.size() - 1);
     for (int i = 0; i < m_fontTextures.size(); i++)
     {
-        UpdateFontHighlight(i);
+        BuildGrid(m_fontTextures[i]);
     }
 
     UpdateDrawFontTexture(0);
     UpdateDrawButtonTexture();
 }
 
-void DatabaseGenerator::UpdateFontHighlight(int id)
+void DatabaseGenerator::BuildGrid(FontTextureData& _page)
 {
-    FontTextureData& textureData = m_fontTextures[id];
-
-    textureData.m_highlight = QImage(textureData.m_texture.width(), textureData.m_texture.height(), QImage::Format_RGBA8888);
-    textureData.m_highlight.fill(0);
-    QPainter painterHighlight(&textureData.m_highlight);
-
-    for (CharacterData const& characterData : textureData.m_characterData)
+    _page.m_grid.Reset(_page.m_texture.size());
+    for (int i = 0; i < _page.m_characterData.size(); i++)
     {
-        painterHighlight.setPen(characterData.m_char == m_selectedChar ? COLOR_SELECTED : COLOR_HIGHLIGHT);
-        painterHighlight.drawRect(characterData.m_x, characterData.m_y, characterData.m_width - 1, characterData.m_height - 1);
+        CharacterData const& data = _page.m_characterData[i];
+        _page.m_grid.Insert(i, QRect(data.m_x, data.m_y, data.m_width, data.m_height));
     }
-
-    UpdateDrawFontTexture(id);
 }
 
-void DatabaseGenerator::SetSelected(const CharacterData *data)
+void DatabaseGenerator::SetSelected(int index)
 {
-    QChar charPrev = m_selectedChar;
-    if (data)
+    if (index != -1)
     {
+        FontTextureData const& fontTex = m_fontTextures.at(ui->SB_FontIndex->value());
+        CharacterData const* data = &fontTex.m_characterData.at(index);
         m_selectedChar = data->m_char;
         ui->L_Selected->setText("Selected (" + QString(m_selectedChar) + ")");
 
-        FontTextureData const& fontTex = m_fontTextures[ui->SB_FontIndex->value()];
         QSize size = fontTex.m_texture.size();
 
         ui->SB_SelectedX->blockSignals(true);
@@ -628,119 +677,309 @@ void DatabaseGenerator::SetSelected(const CharacterData *data)
         ui->SB_SelectedHeight->setEnabled(false);
     }
 
-    if (charPrev != m_selectedChar && ui->RB_Font->isChecked())
+    if (index != m_selectedItem)
     {
-        UpdateFontHighlight(ui->SB_FontIndex->value());
+        if (m_selectedItem != -1 && m_selectedItem < m_glyphItems.size())
+        {
+            m_glyphItems[m_selectedItem]->setPen(QPen(COLOR_HIGHLIGHT));
+        }
+        if (index != -1 && index < m_glyphItems.size())
+        {
+            m_glyphItems[index]->setPen(QPen(COLOR_SELECTED));
+        }
+        m_selectedItem = index;
     }
 }
 
+//-----------------------------------------------------
+// Outline inside the glyph box, drawn on pixel centres
+//-----------------------------------------------------
+QRectF DatabaseGenerator::GetOutlineRect(CharacterData const& _data)
+{
+    return QRectF(_data.m_x + 0.5, _data.m_y + 0.5, _data.m_width - 1, _data.m_height - 1);
+}
+
 void DatabaseGenerator::UpdateCharacterData()
 {
     if (m_selectedChar == QChar(0)) return;
 
-    bool found = false;
     int index = ui->SB_FontIndex->value();
     if (index < m_fontTextures.size())
     {
         FontTextureData& fontTex = m_fontTextures[index];
-        for (CharacterData& data : fontTex.m_characterData)
+        for (int i = 0; i < fontTex.m_characterData.size(); i++)
         {
+            CharacterData& data = fontTex.m_characterData[i];
             if (data.m_char == m_selectedChar)
             {
-                found = true;
                 data.m_x = ui->SB_SelectedX->value();
                 data.m_y = ui->SB_SelectedY->value();
                 data.m_width = ui->SB_SelectedWidth->value();
                 data.m_height = ui->SB_SelectedHeight->value();
+                fontTex.m_grid.Move(i, QRect(data.m_x, data.m_y, data.m_width, data.m_height));
+                if (i < m_glyphItems.size())
+                {
+                    m_glyphItems[i]->setRect(GetOutlineRect(data));
+                }
             }
         }
     }
+}
+
+//-----------------------------------------------------
+// Called on every change, the atlas is only rebuilt
+// once the changes stop for a moment
+//-----------------------------------------------------
+void DatabaseGenerator::UpdateFontTextures(bool setToZero)
+{
+    if (ui->LE_Font->text().isEmpty()) return;
+
+    m_atlasGeneration++;
+    m_atlasSetToZero |= setToZero;
+    m_atlasTimer->start();
+}
+
+//-----------------------------------------------------
+// Build on a worker, one build at a time so the next
+// can start from its result
+//-----------------------------------------------------
+void DatabaseGenerator::StartFontTextures()
+{
+    if (m_atlasBuilding || ui->LE_Font->text().isEmpty()) return;
 
-    if (found)
+    AtlasBuild const build = PrepareAtlasBuild();
+    m_atlasBuilding = true;
+    m_atlasWatcher->setFuture(QtConcurrent::run([build]()
     {
-        UpdateFontHighlight(index);
+        return BuildAtlas(build);
+    }));
+}
+
+void DatabaseGenerator::FontTexturesFinished()
+{
+    // Already taken by FinishFontTextures
+    if (!m_atlasBuilding) return;
+    m_atlasBuilding = false;
+
+    AtlasBuild const build = m_atlasWatcher->result();
+    if (build.m_generation == m_atlasGeneration)
+    {
+        ApplyAtlasBuild(build);
+    }
+    else if (!m_atlasTimer->isActive())
+    {
+        StartFontTextures();
     }
 }
 
-void DatabaseGenerator::UpdateFontTextures(bool setToZero)
+//-----------------------------------------------------
+// Bring the atlas up to date right away, for export.
+// Appends pack around the earlier pages, so exporting
+// packs everything again to not depend on edit history
+//-----------------------------------------------------
+void DatabaseGenerator::FinishFontTextures()
 {
-    if (ui->LE_Font->text().isEmpty()) return;
+    if (m_atlasBuilding)
+    {
+        m_atlasWatcher->waitForFinished();
+        m_atlasBuilding = false;
 
-    QImage image(512, 512, QImage::Format_RGB888);
-    image.fill(0);
-    QPainter painterImage(&image);
-    painterImage.setFont(m_font);
-    painterImage.setPen(Qt::white);
+        AtlasBuild const build = m_atlasWatcher->result();
+        if (build.m_generation == m_atlasGeneration)
+        {
+            ApplyAtlasBuild(build);
+        }
+    }
 
-    m_fontTextures.clear();
-    QFontMetrics fontMetrics(m_font);
-    int fontHeight = fontMetrics.height() + 1;
-    int maxCountY = 512 / fontHeight;
+    bool const stale = m_atlasTimer->isActive() || m_atlas.m_generation != m_atlasGeneration;
+    if (stale || m_atlas.m_appended)
+    {
+        m_atlasTimer->stop();
+        if (!ui->LE_Font->text().isEmpty())
+        {
+            ApplyAtlasBuild(BuildAtlas(PrepareAtlasBuild(true)));
+        }
+    }
+}
 
-    QImage highlight(512, 512, QImage::Format_RGBA8888);
-    highlight.fill(0);
-    QPainter painterHighlight(&highlight);
-    painterHighlight.setPen(COLOR_HIGHLIGHT);
+//-----------------------------------------------------
+// Characters added to the end are packed after the
+// current ones, offsets alone only need a redraw.
+// _fullPack always packs from scratch
+//-----------------------------------------------------
+DatabaseGenerator::AtlasBuild DatabaseGenerator::PrepareAtlasBuild(bool _fullPack)
+{
+    AtlasBuild build;
+    build.m_font = m_font;
+    build.m_offset = QPoint(ui->SB_OffsetX->value(), ui->SB_OffsetY->value());
+    build.m_pageSize = ui->CB_PageSize->currentText().toInt();
+    build.m_padding = ui->SB_Padding->value();
+    build.m_sort = static_cast<AtlasPacker::SortMode>(ui->CB_Sort->currentIndex());
+    build.m_characters = ui->TE_Characters->toPlainText();
+    build.m_generation = m_atlasGeneration;
+    build.m_packer = m_atlas.m_packer;
+    build.m_pages = m_fontTextures;
+    build.m_unplaced = m_atlas.m_unplaced;
+    build.m_appended = m_atlas.m_appended;
+
+    bool const sameLayout = !_fullPack && !m_atlas.m_characters.isEmpty()
+            && build.m_font == m_atlas.m_font
+            && build.m_pageSize == m_atlas.m_pageSize
+            && build.m_padding == m_atlas.m_padding
+            && build.m_sort == m_atlas.m_sort;
+    if (sameLayout && build.m_characters == m_atlas.m_characters)
+    {
+        build.m_mode = BM_Redraw;
+    }
+    else if (sameLayout && build.m_offset == m_atlas.m_offset && build.m_characters.startsWith(m_atlas.m_characters))
+    {
+        build.m_mode = BM_Append;
+    }
+    else
+    {
+        build.m_mode = BM_Full;
+    }
 
-    int countY = 0;
-    QString allCharacters = ui->TE_Characters->toPlainText();
-    FontTextureData data;
-    int databaseIndex = 0x82;
-    while (!allCharacters.isEmpty())
+    // Same box the row layout gave each character
+    if (build.m_mode != BM_Redraw)
     {
-        QString subCharacters;
-        int stringWidth = 0;
-        while (!allCharacters.isEmpty())
+        QFontMetrics fontMetrics(m_font);
+        int const first = (build.m_mode == BM_Append) ? m_atlas.m_characters.size() : 0;
+        build.m_sizes.reserve(build.m_characters.size() - first);
+        for (int i = first; i < build.m_characters.size(); i++)
         {
-            int posXStart = stringWidth;
-            if (posXStart > 0) posXStart += 2;
-            int newStringWidth = fontMetrics.horizontalAdvance(allCharacters.front());
-            stringWidth = fontMetrics.horizontalAdvance(subCharacters) + newStringWidth;
-            if (stringWidth >= 512)
-            {
-                break;
-            }
-            else
-            {
-                int posXEnd = stringWidth;
-                CharacterData characterData;
-                characterData.m_char = allCharacters.front();
-                characterData.m_x = posXStart;
-                characterData.m_y = countY * fontHeight;
-                characterData.m_width = posXEnd - posXStart + 1;
-                characterData.m_height = fontHeight - 1;
-                characterData.m_databaseIndex = databaseIndex;
-                databaseIndex++;
-                data.m_characterData.push_back(characterData);
-                painterHighlight.drawRect(characterData.m_x, characterData.m_y, characterData.m_width - 1, characterData.m_height - 1);
-
-                subCharacters.append(allCharacters.front());
-                allCharacters = allCharacters.mid(1);
-            }
+            build.m_sizes.push_back(QSize(qMax(1, GetAdvance(build.m_characters[i], fontMetrics) - 1), fontMetrics.height()));
         }
+    }
 
-        // Draw current row
-        painterImage.drawText(ui->SB_OffsetX->value(), countY * fontHeight + ui->SB_OffsetY->value(), subCharacters);
+    return build;
+}
 
-        // Next row
-        countY++;
-        if (countY == maxCountY || allCharacters.isEmpty())
+//-----------------------------------------------------
+// Runs on a worker, only touches its own copies
+//-----------------------------------------------------
+DatabaseGenerator::AtlasBuild DatabaseGenerator::BuildAtlas(AtlasBuild _build)
+{
+    TRACE_SCOPE("atlas", "Generate Atlas");
+
+    int firstIndex = 0;
+    QVector<AtlasPacker::Placement> placements;
+    switch (_build.m_mode)
+    {
+    case BM_Full:
+        _build.m_packer = AtlasPacker(QSize(_build.m_pageSize, _build.m_pageSize), _build.m_padding);
+        _build.m_pages.clear();
+        _build.m_unplaced = 0;
+        _build.m_appended = false;
+        placements = _build.m_packer.Pack(_build.m_sizes, _build.m_sort);
+        break;
+    case BM_Append:
+        firstIndex = _build.m_characters.size() - _build.m_sizes.size();
+        _build.m_appended = true;
+        placements = _build.m_packer.Append(_build.m_sizes, _build.m_sort);
+        break;
+    case BM_Redraw:
+        for (FontTextureData& page : _build.m_pages)
         {
-            // Image is filled
-            data.m_texture = image;
-            data.m_highlight = highlight;
-            m_fontTextures.push_back(data);
-
-            data.m_characterData.clear();
-            image.fill(0);
-            highlight.fill(0);
-            countY = 0;
+            page.m_drawn = 0;
         }
+        break;
     }
 
+    _build.m_pages.resize(_build.m_packer.GetPageCount());
+    for (int i = 0; i < placements.size(); i++)
+    {
+        AtlasPacker::Placement const& placement = placements[i];
+        if (placement.m_page == -1)
+        {
+            _build.m_unplaced++;
+            continue;
+        }
+
+        CharacterData characterData;
+        characterData.m_char = _build.m_characters[firstIndex + i];
+        characterData.m_x = placement.m_rect.x();
+        characterData.m_y = placement.m_rect.y();
+        characterData.m_width = placement.m_rect.width();
+        characterData.m_height = placement.m_rect.height();
+        characterData.m_databaseIndex = 0x82 + firstIndex + i;
+        _build.m_pages[placement.m_page].m_characterData.push_back(characterData);
+    }
+
+    // Every page into its own images on a worker thread
+    PageRasterizer const rasterizer{_build.m_font, _build.m_offset, _build.m_pageSize};
+    QtConcurrent::blockingMap(_build.m_pages, rasterizer);
+
+    _build.m_sizes.clear();
+    return _build;
+}
+
+void DatabaseGenerator::ApplyAtlasBuild(AtlasBuild const& _build)
+{
+    m_fontTextures = _build.m_pages;
+    m_atlas = _build;
+    m_atlas.m_pages.clear();
+
+    int const pageSize = _build.m_pageSize;
+    QStringList occupancy;
+    for (int page = 0; page < m_fontTextures.size(); page++)
+    {
+        occupancy << QString::number(qRound(_build.m_packer.GetOccupancy(page) * 100.0)) + "%";
+    }
+
+    QString status = QString::number(m_fontTextures.size()) + " page(s) of " + QString::number(pageSize) + "x" + QString::number(pageSize) + ", used " + occupancy.join(" / ");
+    if (_build.m_unplaced > 0)
+    {
+        status += ", " + QString::number(_build.m_unplaced) + " character(s) larger than a page";
+    }
+    ui->L_Occupancy->setText(m_fontTextures.isEmpty() ? QString() : status);
+
     ui->SB_FontIndex->setMaximum(m_fontTextures.size() - 1);
-    UpdateDrawFontTexture(setToZero ? 0 : ui->SB_FontIndex->value());
-    SetSelected(nullptr);
+    SetSelected(-1);
+    UpdateDrawFontTexture(m_atlasSetToZero ? 0 : qMin(ui->SB_FontIndex->value(), m_fontTextures.size() - 1));
+    m_atlasSetToZero = false;
+}
+
+int DatabaseGenerator::GetAdvance(QChar _char, QFontMetrics const& _metrics)
+{
+    auto iter = m_advances.constFind(_char.unicode());
+    if (iter != m_advances.constEnd())
+    {
+        return iter.value();
+    }
+
+    int const advance = _metrics.horizontalAdvance(_char);
+    m_advances.insert(_char.unicode(), advance);
+    return advance;
+}
+
+//-----------------------------------------------------
+// Glyphs and hit test grid of one page, only touches
+// the page it is given. Drawn characters are kept,
+// pages with none start over
+//-----------------------------------------------------
+void DatabaseGenerator::PageRasterizer::operator()(FontTextureData& _page) const
+{
+    if (_page.m_drawn == _page.m_characterData.size()) return;
+    TRACE_SCOPE("atlas", "Rasterize Page");
+
+    if (_page.m_drawn == 0)
+    {
+        _page.m_texture = QImage(m_pageSize, m_pageSize, QImage::Format_RGB888);
+        _page.m_texture.fill(0);
+        _page.m_grid.Reset(_page.m_texture.size());
+    }
+
+    QPainter painterImage(&_page.m_texture);
+    painterImage.setFont(m_font);
+    painterImage.setPen(Qt::white);
+    for (int i = _page.m_drawn; i < _page.m_characterData.size(); i++)
+    {
+        CharacterData const& characterData = _page.m_characterData[i];
+        painterImage.drawText(characterData.m_x + m_offset.x(), characterData.m_y + m_offset.y(), QString(characterData.m_char));
+        _page.m_grid.Insert(i, QRect(characterData.m_x, characterData.m_y, characterData.m_width, characterData.m_height));
+    }
+    _page.m_drawn = _page.m_characterData.size();
 }
 
 void DatabaseGenerator::UpdateDrawButtonTexture()
@@ -771,7 +1010,7 @@ void DatabaseGenerator::UpdateDrawButtonTexture()
             }
             else
             {
-                m_buttonImage = QImage(buttonImagePath);
+                m_buttonImage = DdsReader::Load(buttonImagePath);
                 buttonImageWidth = m_buttonImage.width();
                 buttonImageHeight = m_buttonImage.height();
                 m_graphic->setSceneRect(m_buttonImage.rect());
@@ -810,9 +1049,16 @@ void DatabaseGenerator::UpdateDrawFontTexture(int id)
     if (!m_fontTextures.isEmpty() && id < m_fontTextures.size())
     {
         ClearGraphicScene();
-        m_graphic->setSceneRect(0,0,512,512);
-        m_graphic->addPixmap(QPixmap::fromImage(m_fontTextures[id].m_texture));
-        m_graphic->addPixmap(QPixmap::fromImage(m_fontTextures[id].m_highlight));
+        FontTextureData const& fontTex = m_fontTextures.at(id);
+        m_graphic->setSceneRect(fontTex.m_texture.rect());
+        m_graphic->addPixmap(QPixmap::fromImage(fontTex.m_texture));
+
+        m_glyphItems.reserve(fontTex.m_characterData.size());
+        for (int i = 0; i < fontTex.m_characterData.size(); i++)
+        {
+            QPen const pen(i == m_selectedItem ? COLOR_SELECTED : COLOR_HIGHLIGHT);
+            m_glyphItems.push_back(m_graphic->addRect(GetOutlineRect(fontTex.m_characterData.at(i)), pen));
+        }
     }
 }
 
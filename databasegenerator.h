@@ -5,14 +5,20 @@
 #include <QDebug>
 #include <QFileDialog>
 #include <QFontDatabase>
+#include <QFutureWatcher>
 #include <QGraphicsScene>
 #include <QGraphicsPixmapItem>
 #include <QImageReader>
 #include <QMessageBox>
 #include <QSettings>
 #include <QSpinBox>
+#include <QTimer>
 
+#include "atlaspacker.h"
+#include "ddsreader.h"
+#include "ddswriter.h"
 #include "fte.h"
+#include "glyphgrid.h"
 
 #define COLOR_HIGHLIGHT QColor::fromRgb(255, 0, 0, 150)
 #define COLOR_SELECTED QColor::fromRgb(0, 255, 0, 255)
@@ -66,8 +72,48 @@ public:
     struct FontTextureData
     {
         QImage m_texture;
-        QImage m_highlight;
         QVector<CharacterData> m_characterData;
+        GlyphGrid m_grid;   // hit testing, ids index m_characterData
+        int m_drawn = 0;    // characters already on the texture
+    };
+
+    enum BuildMode : int
+    {
+        BM_Full,        // pack and draw every character
+        BM_Append,      // pack and draw characters added to the end
+        BM_Redraw       // same layout, draw every page again
+    };
+
+    // Everything a font atlas is built from, the worker
+    // only gets copies so editing goes on while it runs
+    struct AtlasBuild
+    {
+        QFont m_font;
+        QPoint m_offset;
+        int m_pageSize;
+        int m_padding;
+        AtlasPacker::SortMode m_sort;
+        QString m_characters;
+        int m_generation;
+
+        BuildMode m_mode;
+        QVector<QSize> m_sizes;     // of the characters to pack
+
+        // Results, appending and redrawing start from the last ones
+        AtlasPacker m_packer;
+        QVector<FontTextureData> m_pages;
+        int m_unplaced;
+        bool m_appended = false;    // layout differs from a full pack
+    };
+
+    // Functor for QtConcurrent::blockingMap, draws one page
+    struct PageRasterizer
+    {
+        QFont m_font;
+        QPoint m_offset;
+        int m_pageSize;
+
+        void operator()(FontTextureData& _page) const;
     };
 
 public:
@@ -82,11 +128,17 @@ public:
 
     // Edit mode only
     void LoadFontTextures();
-    void UpdateFontHighlight(int id);
-    void SetSelected(CharacterData const* data);
+    void SetSelected(int index);
+    static QRectF GetOutlineRect(CharacterData const& _data);
     void UpdateCharacterData();
+    static void BuildGrid(FontTextureData& _page);
 
     void UpdateFontTextures(bool setToZero = true);
+    void FinishFontTextures();
+    AtlasBuild PrepareAtlasBuild(bool _fullPack = false);
+    static AtlasBuild BuildAtlas(AtlasBuild _build);
+    void ApplyAtlasBuild(AtlasBuild const& _build);
+    int GetAdvance(QChar _char, QFontMetrics const& _metrics);
     void UpdateDrawButtonTexture();
     void UpdateDrawFontTexture(int id);
     void UpdateExportEnabled();
@@ -107,6 +159,9 @@ private slots:
     void on_SB_Spacing_valueChanged(int arg1);
     void on_SB_OffsetX_valueChanged(int arg1);
     void on_SB_OffsetY_valueChanged(int arg1);
+    void on_CB_PageSize_currentIndexChanged(int index);
+    void on_SB_Padding_valueChanged(int arg1);
+    void on_CB_Sort_currentIndexChanged(int index);
     void on_TE_Characters_textChanged();
     void on_PB_ExportDatabase_clicked();
 
@@ -121,6 +176,9 @@ private slots:
     void on_SB_SelectedWidth_valueChanged(int arg1);
     void on_SB_SelectedHeight_valueChanged(int arg1);
 
+    void StartFontTextures();
+    void FontTexturesFinished();
+
 private:
     Ui::DatabaseGenerator *ui;
     QSettings *m_settings;
@@ -133,11 +191,27 @@ private:
     QChar m_selectedChar;
 
     QFont m_font;
+    QHash<ushort, int> m_advances;  // of m_font, cleared when it changes
     QGraphicsScene* m_graphic;
     QImage m_buttonImage;
     QGraphicsPixmapItem* m_buttonPixmap;
     QGraphicsRectItem* m_buttonHighlightPixmap[BT_COUNT];
     QVector<FontTextureData> m_fontTextures;
+
+    // Outlines of the shown font page by character index,
+    // selecting only restyles the old and new one
+    QVector<QGraphicsRectItem*> m_glyphItems;
+    int m_selectedItem;
+
+    // Font atlas, rebuilt on a worker shortly after the last
+    // change, results of outdated generations are dropped
+    static int const c_rebuildDelay = 150;
+    QTimer* m_atlasTimer;
+    QFutureWatcher<AtlasBuild>* m_atlasWatcher;
+    AtlasBuild m_atlas;     // what m_fontTextures were built from
+    int m_atlasGeneration;
+    bool m_atlasBuilding;
+    bool m_atlasSetToZero;
 };
 
 #endif // DATABASEGENERATOR_H
@@ -0,0 +1,212 @@
+#include "ddsreader.h"
+
+#include <QFile>
+
+#include "tracer.h"
+
+namespace
+{
+    // Offsets into the file, the header follows the magic
+    int const c_heightOffset = 12;
+    int const c_widthOffset = 16;
+    int const c_fourCCOffset = 84;
+    int const c_dataOffset = 128;
+
+    quint32 ReadUInt32(QByteArray const& _data, int _offset)
+    {
+        uchar const* bytes = reinterpret_cast<uchar const*>(_data.constData()) + _offset;
+        return quint32(bytes[0]) | (quint32(bytes[1]) << 8) | (quint32(bytes[2]) << 16) | (quint32(bytes[3]) << 24);
+    }
+
+    void ExpandColor(quint16 _color, int* _rgb)
+    {
+        int const r = (_color >> 11) & 0x1F;
+        int const g = (_color >> 5) & 0x3F;
+        int const b = _color & 0x1F;
+        _rgb[0] = (r << 3) | (r >> 2);
+        _rgb[1] = (g << 2) | (g >> 4);
+        _rgb[2] = (b << 3) | (b >> 2);
+    }
+}
+
+QImage DdsReader::Load(QString const& _fileName)
+{
+    QFile file(_fileName);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        return QImage();
+    }
+
+    QImage const image = Decode(file.readAll());
+    return image.isNull() ? QImage(_fileName) : image;
+}
+
+//-----------------------------------------------------
+// BC1 keeps its alpha only when a block uses the
+// transparent colour, BC4 comes back as grey
+//-----------------------------------------------------
+QImage DdsReader::Decode(QByteArray const& _data)
+{
+    TRACE_SCOPE("dds", "Decode");
+
+    if (_data.size() < c_dataOffset || !_data.startsWith("DDS "))
+    {
+        return QImage();
+    }
+
+    QByteArray const fourCC = _data.mid(c_fourCCOffset, 4);
+    int blockBytes = 8;
+    if (fourCC == "DXT5")
+    {
+        blockBytes = 16;
+    }
+    else if (fourCC != "DXT1" && fourCC != "ATI1")
+    {
+        return QImage();
+    }
+
+    int const height = int(ReadUInt32(_data, c_heightOffset));
+    int const width = int(ReadUInt32(_data, c_widthOffset));
+    if (width <= 0 || height <= 0 || width > 0x4000 || height > 0x4000)
+    {
+        return QImage();
+    }
+
+    int const blocksWide = (width + 3) / 4;
+    int const blocksHigh = (height + 3) / 4;
+    if (_data.size() - c_dataOffset < blocksWide * blocksHigh * blockBytes)
+    {
+        return QImage();
+    }
+
+    QImage image(width, height, QImage::Format_ARGB32);
+    uchar const* block = reinterpret_cast<uchar const*>(_data.constData()) + c_dataOffset;
+    bool transparent = false;
+
+    uchar rgba[64];
+    uchar alpha[16];
+    for (int blockY = 0; blockY < blocksHigh; blockY++)
+    {
+        for (int blockX = 0; blockX < blocksWide; blockX++, block += blockBytes)
+        {
+            if (fourCC == "ATI1")
+            {
+                DecodeBC4(block, alpha);
+                for (int i = 0; i < 16; i++)
+                {
+                    rgba[i * 4] = rgba[i * 4 + 1] = rgba[i * 4 + 2] = alpha[i];
+                    rgba[i * 4 + 3] = 0xFF;
+                }
+            }
+            else if (fourCC == "DXT5")
+            {
+                DecodeBC4(block, alpha);
+                DecodeBC1(block + 8, rgba);
+                for (int i = 0; i < 16; i++)
+                {
+                    rgba[i * 4 + 3] = alpha[i];
+                }
+            }
+            else
+            {
+                DecodeBC1(block, rgba);
+                for (int i = 0; i < 16; i++)
+                {
+                    transparent = transparent || rgba[i * 4 + 3] == 0;
+                }
+            }
+
+            // Edge blocks are cut at the image size
+            for (int y = 0; y < 4 && blockY * 4 + y < height; y++)
+            {
+                QRgb* line = reinterpret_cast<QRgb*>(image.scanLine(blockY * 4 + y));
+                for (int x = 0; x < 4 && blockX * 4 + x < width; x++)
+                {
+                    uchar const* pixel = rgba + (y * 4 + x) * 4;
+                    line[blockX * 4 + x] = qRgba(pixel[0], pixel[1], pixel[2], pixel[3]);
+                }
+            }
+        }
+    }
+
+    if (fourCC == "DXT5" || transparent)
+    {
+        return image;
+    }
+    return image.convertToFormat(QImage::Format_RGB32);
+}
+
+//-----------------------------------------------------
+// Four colours when color0 is the larger, otherwise
+// three and transparent black
+//-----------------------------------------------------
+void DdsReader::DecodeBC1(uchar const* _block, uchar* _rgba)
+{
+    quint16 const color0 = quint16(_block[0] | (_block[1] << 8));
+    quint16 const color1 = quint16(_block[2] | (_block[3] << 8));
+
+    int palette[4][4];
+    ExpandColor(color0, palette[0]);
+    ExpandColor(color1, palette[1]);
+    for (int c = 0; c < 3; c++)
+    {
+        if (color0 > color1)
+        {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+        else
+        {
+            palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+            palette[3][c] = 0;
+        }
+    }
+    palette[0][3] = palette[1][3] = palette[2][3] = 0xFF;
+    palette[3][3] = color0 > color1 ? 0xFF : 0;
+
+    quint32 const indices = quint32(_block[4]) | (quint32(_block[5]) << 8) | (quint32(_block[6]) << 16) | (quint32(_block[7]) << 24);
+    for (int i = 0; i < 16; i++)
+    {
+        int const* color = palette[(indices >> (i * 2)) & 0x3];
+        for (int c = 0; c < 4; c++)
+        {
+            _rgba[i * 4 + c] = uchar(color[c]);
+        }
+    }
+}
+
+//-----------------------------------------------------
+// Eight steps when red0 is the larger, otherwise six
+// and the two extremes
+//-----------------------------------------------------
+void DdsReader::DecodeBC4(uchar const* _block, uchar* _values)
+{
+    int const red0 = _block[0];
+    int const red1 = _block[1];
+
+    int palette[8] = { red0, red1, 0, 0, 0, 0, 0, 0xFF };
+    if (red0 > red1)
+    {
+        for (int i = 1; i < 7; i++)
+        {
+            palette[i + 1] = ((7 - i) * red0 + i * red1) / 7;
+        }
+    }
+    else
+    {
+        for (int i = 1; i < 5; i++)
+        {
+            palette[i + 1] = ((5 - i) * red0 + i * red1) / 5;
+        }
+    }
+
+    quint64 bits = 0;
+    for (int i = 0; i < 6; i++)
+    {
+        bits |= quint64(_block[2 + i]) << (i * 8);
+    }
+    for (int i = 0; i < 16; i++)
+    {
+        _values[i] = uchar(palette[(bits >> (i * 3)) & 0x7]);
+    }
+}
@@ -0,0 +1,26 @@
+#ifndef DDSREADER_H
+#define DDSREADER_H
+
+#include <QByteArray>
+#include <QImage>
+#include <QString>
+
+//-----------------------------------------------------
+// Reads back the block compressed DDS textures that
+// DdsWriter writes, only the top level is decoded
+//-----------------------------------------------------
+class DdsReader
+{
+public:
+    // Other DDS formats go to Qt's image plugins
+    static QImage Load(QString const& _fileName);
+
+    // Null image when the data is not DXT1, DXT5 or ATI1
+    static QImage Decode(QByteArray const& _data);
+
+    // _rgba is 16 pixels of RGBA, _values 16 bytes
+    static void DecodeBC1(uchar const* _block, uchar* _rgba);
+    static void DecodeBC4(uchar const* _block, uchar* _values);
+};
+
+#endif // DDSREADER_H
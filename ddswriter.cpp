@@ -0,0 +1,361 @@
+#include "ddswriter.h"
+
+#include <QFile>
+#include <QtConcurrent>
+
+#include <emmintrin.h>
+
+#include "tracer.h"
+
+namespace
+{
+    // DDS_HEADER and DDS_PIXELFORMAT flags that are used
+    quint32 const c_headerSize = 124;
+    quint32 const c_pixelFormatSize = 32;
+    quint32 const DDSD_CAPS = 0x1;
+    quint32 const DDSD_HEIGHT = 0x2;
+    quint32 const DDSD_WIDTH = 0x4;
+    quint32 const DDSD_PIXELFORMAT = 0x1000;
+    quint32 const DDSD_MIPMAPCOUNT = 0x20000;
+    quint32 const DDSD_LINEARSIZE = 0x80000;
+    quint32 const DDPF_FOURCC = 0x4;
+    quint32 const DDSCAPS_COMPLEX = 0x8;
+    quint32 const DDSCAPS_TEXTURE = 0x1000;
+    quint32 const DDSCAPS_MIPMAP = 0x400000;
+
+    void AppendUInt32(QByteArray& _data, quint32 _value)
+    {
+        char const bytes[4] = { char(_value), char(_value >> 8), char(_value >> 16), char(_value >> 24) };
+        _data.append(bytes, 4);
+    }
+
+    quint32 FourCC(char const* _code)
+    {
+        return quint32(uchar(_code[0])) | (quint32(uchar(_code[1])) << 8) | (quint32(uchar(_code[2])) << 16) | (quint32(uchar(_code[3])) << 24);
+    }
+
+    //-----------------------------------------------------
+    // 4x4 pixels of RGBA, edge blocks repeat the last
+    // row and column of the image
+    //-----------------------------------------------------
+    void LoadBlock(QImage const& _image, int _blockX, int _blockY, uchar* _rgba)
+    {
+        for (int y = 0; y < 4; y++)
+        {
+            int const row = qMin(_blockY * 4 + y, _image.height() - 1);
+            uchar const* line = _image.constScanLine(row);
+            for (int x = 0; x < 4; x++)
+            {
+                int const column = qMin(_blockX * 4 + x, _image.width() - 1);
+                memcpy(_rgba + (y * 4 + x) * 4, line + column * 4, 4);
+            }
+        }
+    }
+
+    //-----------------------------------------------------
+    // Functor for QtConcurrent::blockingMap, encodes one
+    // row of blocks into its own part of the output
+    //-----------------------------------------------------
+    struct RowEncoder
+    {
+        QImage const* m_image;
+        DdsWriter::Format m_format;
+        uchar* m_output;
+        int m_blocksWide;
+
+        void operator()(int const& _row) const
+        {
+            int const blockBytes = DdsWriter::GetBlockBytes(m_format);
+            uchar* block = m_output + _row * m_blocksWide * blockBytes;
+
+            alignas(16) uchar rgba[64];
+            alignas(16) uchar channel[16];
+            for (int x = 0; x < m_blocksWide; x++, block += blockBytes)
+            {
+                LoadBlock(*m_image, x, _row, rgba);
+                switch (m_format)
+                {
+                case DdsWriter::DF_BC1:
+                    DdsWriter::EncodeBC1(rgba, block);
+                    break;
+                case DdsWriter::DF_BC4:
+                    for (int i = 0; i < 16; i++) channel[i] = rgba[i * 4];
+                    DdsWriter::EncodeBC4(channel, block);
+                    break;
+                case DdsWriter::DF_BC3:
+                    for (int i = 0; i < 16; i++) channel[i] = rgba[i * 4 + 3];
+                    DdsWriter::EncodeBC4(channel, block);
+                    DdsWriter::EncodeBC1(rgba, block + 8);
+                    break;
+                }
+            }
+        }
+    };
+
+    // Functor for QtConcurrent::blockingMapped
+    struct SaveJob
+    {
+        typedef QString result_type;
+
+        bool m_mipmaps;
+
+        QString operator()(DdsWriter::File const& _file) const
+        {
+            return DdsWriter::Save(_file, m_mipmaps);
+        }
+    };
+}
+
+QStringList DdsWriter::SaveAll(QVector<File> const& _files, bool _mipmaps)
+{
+    QStringList errors = QtConcurrent::blockingMapped<QStringList>(_files, SaveJob{_mipmaps});
+    errors.removeAll(QString());
+    return errors;
+}
+
+QString DdsWriter::Save(File const& _file, bool _mipmaps)
+{
+    if (_file.m_image.isNull())
+    {
+        return "No image to write to " + _file.m_fileName + "!";
+    }
+
+    QByteArray const data = Encode(_file.m_image, _file.m_format, _mipmaps);
+    QFile file(_file.m_fileName);
+    if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size())
+    {
+        return "Unable to write " + _file.m_fileName + "!";
+    }
+
+    return QString();
+}
+
+//-----------------------------------------------------
+// Each smaller level is smooth scaled from the one above
+//-----------------------------------------------------
+QByteArray DdsWriter::Encode(QImage const& _image, Format _format, bool _mipmaps)
+{
+    TRACE_SCOPE("dds", "Encode");
+
+    QImage level = _image.convertToFormat(QImage::Format_RGBA8888);
+    int levelCount = 1;
+    if (_mipmaps)
+    {
+        for (int size = qMax(level.width(), level.height()); size > 1; size /= 2)
+        {
+            levelCount++;
+        }
+    }
+
+    int const blockBytes = GetBlockBytes(_format);
+    quint32 const topSize = quint32(qMax(1, (level.width() + 3) / 4) * qMax(1, (level.height() + 3) / 4) * blockBytes);
+    char const* fourCC = _format == DF_BC1 ? "DXT1" : (_format == DF_BC4 ? "ATI1" : "DXT5");
+
+    QByteArray data;
+    data.append("DDS ", 4);
+    AppendUInt32(data, c_headerSize);
+    AppendUInt32(data, DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_LINEARSIZE | (_mipmaps ? DDSD_MIPMAPCOUNT : 0));
+    AppendUInt32(data, quint32(level.height()));
+    AppendUInt32(data, quint32(level.width()));
+    AppendUInt32(data, topSize);
+    AppendUInt32(data, 0);
+    AppendUInt32(data, quint32(levelCount));
+    for (int i = 0; i < 11; i++) AppendUInt32(data, 0);
+    AppendUInt32(data, c_pixelFormatSize);
+    AppendUInt32(data, DDPF_FOURCC);
+    AppendUInt32(data, FourCC(fourCC));
+    for (int i = 0; i < 5; i++) AppendUInt32(data, 0);
+    AppendUInt32(data, DDSCAPS_TEXTURE | (_mipmaps ? DDSCAPS_COMPLEX | DDSCAPS_MIPMAP : 0));
+    for (int i = 0; i < 4; i++) AppendUInt32(data, 0);
+
+    for (int i = 0; i < levelCount; i++)
+    {
+        if (i > 0)
+        {
+            level = level.scaled(qMax(1, level.width() / 2), qMax(1, level.height() / 2), Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+        }
+
+        int const blocksWide = (level.width() + 3) / 4;
+        int const blocksHigh = (level.height() + 3) / 4;
+        int const offset = data.size();
+        data.resize(offset + blocksWide * blocksHigh * blockBytes);
+
+        QVector<int> rows(blocksHigh);
+        for (int row = 0; row < blocksHigh; row++)
+        {
+            rows[row] = row;
+        }
+        RowEncoder const encoder{&level, _format, reinterpret_cast<uchar*>(data.data()) + offset, blocksWide};
+        QtConcurrent::blockingMap(rows, encoder);
+    }
+
+    return data;
+}
+
+//-----------------------------------------------------
+// Endpoints from the bounding box of the colours, not
+// inset so black and white glyph edges stay exact.
+// Each pixel is projected onto the line between them
+// and rounded to the nearest of the four steps
+//-----------------------------------------------------
+void DdsWriter::EncodeBC1(uchar const* _rgba, uchar* _block)
+{
+    __m128i const row0 = _mm_loadu_si128(reinterpret_cast<__m128i const*>(_rgba));
+    __m128i const row1 = _mm_loadu_si128(reinterpret_cast<__m128i const*>(_rgba + 16));
+    __m128i const row2 = _mm_loadu_si128(reinterpret_cast<__m128i const*>(_rgba + 32));
+    __m128i const row3 = _mm_loadu_si128(reinterpret_cast<__m128i const*>(_rgba + 48));
+
+    __m128i minColor = _mm_min_epu8(_mm_min_epu8(row0, row1), _mm_min_epu8(row2, row3));
+    __m128i maxColor = _mm_max_epu8(_mm_max_epu8(row0, row1), _mm_max_epu8(row2, row3));
+    minColor = _mm_min_epu8(minColor, _mm_shuffle_epi32(minColor, _MM_SHUFFLE(1, 0, 3, 2)));
+    maxColor = _mm_max_epu8(maxColor, _mm_shuffle_epi32(maxColor, _MM_SHUFFLE(1, 0, 3, 2)));
+    minColor = _mm_min_epu8(minColor, _mm_shuffle_epi32(minColor, _MM_SHUFFLE(2, 3, 0, 1)));
+    maxColor = _mm_max_epu8(maxColor, _mm_shuffle_epi32(maxColor, _MM_SHUFFLE(2, 3, 0, 1)));
+
+    quint32 const minPixel = quint32(_mm_cvtsi128_si32(minColor));
+    quint32 const maxPixel = quint32(_mm_cvtsi128_si32(maxColor));
+
+    // To 5:6:5 and back
+    int endpoint[2][3];
+    quint16 color[2] = { 0, 0 };
+    int const bits[3] = { 5, 6, 5 };
+    for (int c = 0; c < 3; c++)
+    {
+        int const low = int((minPixel >> (c * 8)) & 0xFF);
+        int const high = int((maxPixel >> (c * 8)) & 0xFF);
+
+        int const levels = (1 << bits[c]) - 1;
+        int const shift = c == 0 ? 11 : (c == 1 ? 5 : 0);
+        int const quantized[2] = { (high * levels + 127) / 255, (low * levels + 127) / 255 };
+        for (int e = 0; e < 2; e++)
+        {
+            color[e] = quint16(color[e] | (quantized[e] << shift));
+            endpoint[e][c] = (quantized[e] << (8 - bits[c])) | (quantized[e] >> (2 * bits[c] - 8));
+        }
+    }
+
+    _block[0] = uchar(color[0]);
+    _block[1] = uchar(color[0] >> 8);
+    _block[2] = uchar(color[1]);
+    _block[3] = uchar(color[1] >> 8);
+
+    // Colours of the block the endpoints can't tell apart
+    if (color[0] == color[1])
+    {
+        _block[4] = _block[5] = _block[6] = _block[7] = 0;
+        return;
+    }
+
+    int const axisR = endpoint[0][0] - endpoint[1][0];
+    int const axisG = endpoint[0][1] - endpoint[1][1];
+    int const axisB = endpoint[0][2] - endpoint[1][2];
+    int const length = axisR * axisR + axisG * axisG + axisB * axisB;
+
+    __m128i const zero = _mm_setzero_si128();
+    __m128i const base = _mm_setr_epi16(short(endpoint[1][0]), short(endpoint[1][1]), short(endpoint[1][2]), 0, short(endpoint[1][0]), short(endpoint[1][1]), short(endpoint[1][2]), 0);
+    __m128i const axis = _mm_setr_epi16(short(axisR), short(axisG), short(axisB), 0, short(axisR), short(axisG), short(axisB), 0);
+
+    // Six times the projection against the odd multiples
+    // of the length rounds to the nearest of 0..3
+    __m128i const threshold0 = _mm_set1_epi32(length - 1);
+    __m128i const threshold1 = _mm_set1_epi32(length * 3 - 1);
+    __m128i const threshold2 = _mm_set1_epi32(length * 5 - 1);
+
+    __m128i const rows[4] = { row0, row1, row2, row3 };
+    alignas(16) qint32 steps[16];
+    for (int r = 0; r < 4; r++)
+    {
+        __m128i const low = _mm_madd_epi16(_mm_sub_epi16(_mm_unpacklo_epi8(rows[r], zero), base), axis);
+        __m128i const high = _mm_madd_epi16(_mm_sub_epi16(_mm_unpackhi_epi8(rows[r], zero), base), axis);
+        __m128i const even = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(low), _mm_castsi128_ps(high), _MM_SHUFFLE(2, 0, 2, 0)));
+        __m128i const odd = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(low), _mm_castsi128_ps(high), _MM_SHUFFLE(3, 1, 3, 1)));
+        __m128i const dot = _mm_add_epi32(even, odd);
+        __m128i const dot6 = _mm_add_epi32(_mm_slli_epi32(dot, 2), _mm_slli_epi32(dot, 1));
+
+        __m128i step = _mm_cmpgt_epi32(dot6, threshold0);
+        step = _mm_add_epi32(step, _mm_cmpgt_epi32(dot6, threshold1));
+        step = _mm_add_epi32(step, _mm_cmpgt_epi32(dot6, threshold2));
+        _mm_store_si128(reinterpret_cast<__m128i*>(steps + r * 4), _mm_sub_epi32(zero, step));
+    }
+
+    // Steps count from color1, the palette is c0, c1, 2/3 c0, 1/3 c0
+    static int const c_stepIndex[4] = { 1, 3, 2, 0 };
+    quint32 indices = 0;
+    for (int i = 0; i < 16; i++)
+    {
+        indices |= quint32(c_stepIndex[steps[i]]) << (i * 2);
+    }
+    _block[4] = uchar(indices);
+    _block[5] = uchar(indices >> 8);
+    _block[6] = uchar(indices >> 16);
+    _block[7] = uchar(indices >> 24);
+}
+
+//-----------------------------------------------------
+// Eight step mode between the lowest and highest value,
+// all sixteen values are rounded in two registers
+//-----------------------------------------------------
+void DdsWriter::EncodeBC4(uchar const* _values, uchar* _block)
+{
+    __m128i const values = _mm_loadu_si128(reinterpret_cast<__m128i const*>(_values));
+
+    __m128i low = _mm_min_epu8(values, _mm_shuffle_epi32(values, _MM_SHUFFLE(1, 0, 3, 2)));
+    __m128i high = _mm_max_epu8(values, _mm_shuffle_epi32(values, _MM_SHUFFLE(1, 0, 3, 2)));
+    low = _mm_min_epu8(low, _mm_shuffle_epi32(low, _MM_SHUFFLE(2, 3, 0, 1)));
+    high = _mm_max_epu8(high, _mm_shuffle_epi32(high, _MM_SHUFFLE(2, 3, 0, 1)));
+    low = _mm_min_epu8(low, _mm_shufflelo_epi16(low, _MM_SHUFFLE(2, 3, 0, 1)));
+    high = _mm_max_epu8(high, _mm_shufflelo_epi16(high, _MM_SHUFFLE(2, 3, 0, 1)));
+    low = _mm_min_epu8(low, _mm_srli_epi16(low, 8));
+    high = _mm_max_epu8(high, _mm_srli_epi16(high, 8));
+
+    int const minValue = _mm_cvtsi128_si32(low) & 0xFF;
+    int const maxValue = _mm_cvtsi128_si32(high) & 0xFF;
+
+    _block[0] = uchar(maxValue);
+    _block[1] = uchar(minValue);
+    if (minValue == maxValue)
+    {
+        memset(_block + 2, 0, 6);
+        return;
+    }
+
+    // Fourteen times the distance from the lowest value
+    // against odd multiples of the range rounds to 0..7
+    int const range = maxValue - minValue;
+    __m128i const zero = _mm_setzero_si128();
+    __m128i const distance = _mm_subs_epu8(values, _mm_set1_epi8(char(minValue)));
+    __m128i const fourteen = _mm_set1_epi16(14);
+    __m128i const distanceLow = _mm_mullo_epi16(_mm_unpacklo_epi8(distance, zero), fourteen);
+    __m128i const distanceHigh = _mm_mullo_epi16(_mm_unpackhi_epi8(distance, zero), fourteen);
+
+    __m128i stepLow = zero;
+    __m128i stepHigh = zero;
+    for (int k = 0; k < 7; k++)
+    {
+        __m128i const threshold = _mm_set1_epi16(short((2 * k + 1) * range - 1));
+        stepLow = _mm_sub_epi16(stepLow, _mm_cmpgt_epi16(distanceLow, threshold));
+        stepHigh = _mm_sub_epi16(stepHigh, _mm_cmpgt_epi16(distanceHigh, threshold));
+    }
+
+    // Step 7 is red0, step 0 red1, the rest count down from 2
+    __m128i const seven = _mm_set1_epi16(7);
+    __m128i const one = _mm_set1_epi16(1);
+    __m128i const two = _mm_set1_epi16(2);
+    __m128i indexLow = _mm_and_si128(_mm_sub_epi16(_mm_set1_epi16(8), stepLow), seven);
+    __m128i indexHigh = _mm_and_si128(_mm_sub_epi16(_mm_set1_epi16(8), stepHigh), seven);
+    indexLow = _mm_xor_si128(indexLow, _mm_and_si128(_mm_cmpgt_epi16(two, indexLow), one));
+    indexHigh = _mm_xor_si128(indexHigh, _mm_and_si128(_mm_cmpgt_epi16(two, indexHigh), one));
+
+    alignas(16) uchar indices[16];
+    _mm_store_si128(reinterpret_cast<__m128i*>(indices), _mm_packus_epi16(indexLow, indexHigh));
+
+    quint64 bits = 0;
+    for (int i = 0; i < 16; i++)
+    {
+        bits |= quint64(indices[i]) << (i * 3);
+    }
+    for (int i = 0; i < 6; i++)
+    {
+        _block[2 + i] = uchar(bits >> (i * 8));
+    }
+}
@@ -0,0 +1,44 @@
+#ifndef DDSWRITER_H
+#define DDSWRITER_H
+
+#include <QByteArray>
+#include <QImage>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+//-----------------------------------------------------
+// Block compressed DDS textures, every 4x4 block is
+// encoded with SSE2 and rows of blocks in parallel
+//-----------------------------------------------------
+class DdsWriter
+{
+public:
+    enum Format : int
+    {
+        DF_BC1 = 0,     // DXT1, colour without alpha
+        DF_BC4,         // ATI1, red channel only
+        DF_BC3          // DXT5, colour and alpha
+    };
+
+    struct File
+    {
+        QImage m_image;
+        QString m_fileName;
+        Format m_format;
+    };
+
+    // Files are written in parallel, returns the errors
+    static QStringList SaveAll(QVector<File> const& _files, bool _mipmaps);
+    static QString Save(File const& _file, bool _mipmaps);
+
+    // Header and every level, mipmaps go down to 1x1
+    static QByteArray Encode(QImage const& _image, Format _format, bool _mipmaps);
+    static int GetBlockBytes(Format _format) { return _format == DF_BC3 ? 16 : 8; }
+
+    // _rgba is 16 pixels of RGBA, _values 16 bytes
+    static void EncodeBC1(uchar const* _rgba, uchar* _block);
+    static void EncodeBC4(uchar const* _values, uchar* _block);
+};
+
+#endif // DDSWRITER_H
@@ -1,6 +1,12 @@
 #include "eventcaptioneditor.h"
 #include "ui_eventcaptioneditor.h"
 
+#include "captionretimedialog.h"
+#include "tracer.h"
+
+#include <QPainter>
+#include <QtConcurrent>
+
 //---------------------------------------------------------------------------
 // Constructor
 //---------------------------------------------------------------------------
@@ -11,11 +17,13 @@ EventCaptionEditor::EventCaptionEditor(QWidget *parent) :
     ui->setupUi(this);
 
     // Tree view
-    ui->TW_TreeWidget->setColumnWidth(0, 80);
-    ui->TW_TreeWidget->setColumnWidth(1, 80);
-    ui->TW_TreeWidget->setColumnWidth(2, 100);
-    ui->TW_TreeWidget->setColumnWidth(3, 52);
-    ui->TW_TreeWidget->setColumnWidth(4, 52);
+    m_captionModel = new CaptionModel(this);
+    ui->TV_Captions->setModel(m_captionModel);
+    ui->TV_Captions->setColumnWidth(CaptionModel::CT_Name, 80);
+    ui->TV_Captions->setColumnWidth(CaptionModel::CT_Group, 80);
+    ui->TV_Captions->setColumnWidth(CaptionModel::CT_Cell, 100);
+    ui->TV_Captions->setColumnWidth(CaptionModel::CT_Start, 52);
+    ui->TV_Captions->setColumnWidth(CaptionModel::CT_Length, 52);
 
     // Create a label layout on top of the subtitle background
     QHBoxLayout* textHLayout = new QHBoxLayout(ui->L_Preview);
@@ -25,7 +33,30 @@ EventCaptionEditor::EventCaptionEditor(QWidget *parent) :
     m_previewLabel = new QLabel();
     m_previewLabel->setStyleSheet("font: 15px \"FOT-Seurat Pro B\"; color: white;");
     textHLayout->insertWidget(1, m_previewLabel);
-    m_previewIndex = 0;
+
+    // Playback renders with the same font as the preview label
+    m_playbackFont = QFont("FOT-Seurat Pro B");
+    m_playbackFont.setPixelSize(15);
+    m_playbackDirty = true;
+    m_playbackStart = 0;
+    m_playbackSegment = -1;
+
+    // Ticks twice per frame so timer jitter never skips one
+    m_playbackTimer = new QTimer(this);
+    m_playbackTimer->setTimerType(Qt::PreciseTimer);
+    m_playbackTimer->setInterval(1000 / c_playbackFps / 2);
+    connect(m_playbackTimer, &QTimer::timeout, this, &EventCaptionEditor::PlaybackTick);
+
+    // Check report is created on first use
+    m_report = Q_NULLPTR;
+
+    // fco labels are indexed by the main window
+    m_references = Q_NULLPTR;
+
+    // Directory retime runs on worker threads
+    m_retimeProgress = Q_NULLPTR;
+    m_retimeWatcher = new QFutureWatcher<CaptionRetime::FileResult>(this);
+    connect(m_retimeWatcher, &QFutureWatcher<CaptionRetime::FileResult>::finished, this, &EventCaptionEditor::RetimeDirectoryFinished);
 
     ResetEditor();
 }
@@ -35,58 +66,21 @@ EventCaptionEditor::EventCaptionEditor(QWidget *parent) :
 //---------------------------------------------------------------------------
 EventCaptionEditor::~EventCaptionEditor()
 {
+    m_retimeWatcher->waitForFinished();
     delete ui;
 }
 
 //---------------------------------------------------------------------------
-// Event filter
+// Index of fco labels kept by the main window
 //---------------------------------------------------------------------------
-bool EventCaptionEditor::eventFilter(QObject *object, QEvent *event)
+void EventCaptionEditor::SetReferences(CaptionReferences *_references)
 {
-    if (event->type() == QEvent::HoverEnter || event->type() == QEvent::HoverLeave || event->type() == QEvent::FocusIn)
-    {
-        if (m_previewIndex >= ui->VL_Cell->layout()->count() - 1)
-        {
-            m_previewIndex = 0;
-            SetPreviewText("");
-        }
-
-        QWidget* widget = qobject_cast<QWidget*>(object);
-        int index = ui->VL_Group->indexOf(widget);
-        if (index == -1) index = ui->VL_Cell->indexOf(widget);
-        if (index == -1) index = ui->VL_Start->indexOf(widget);
-        if (index == -1) index = ui->VL_StartTime->indexOf(widget);
-        if (index == -1) index = ui->VL_End->indexOf(widget);
-        if (index == -1) index = ui->VL_EndTime->indexOf(widget);
-        if (index == -1) index = ui->VL_Length->indexOf(widget);
-        if (index == -1) index = ui->VL_Delete->indexOf(widget);
-
-        if (event->type() == QEvent::FocusIn)
-        {
-            m_previewIndex = index;
-        }
+    m_references = _references;
+    m_captionModel->SetReferences(_references);
+    connect(m_references, &CaptionReferences::ReferencesChanged, m_captionModel, &CaptionModel::ReferencesChanged);
+    connect(m_references, &CaptionReferences::DanglingCountChanged, this, &EventCaptionEditor::References_DanglingCountChanged);
 
-        if (event->type() == QEvent::HoverLeave)
-        {
-            if (m_previewIndex > 0)
-            {
-                index = m_previewIndex;
-            }
-            else
-            {
-                m_previewIndex = 0;
-                index = -1;
-                SetPreviewText("");
-            }
-        }
-
-        if (index != -1)
-        {
-            UpdateSubtitlePreview(index);
-        }
-    }
-
-    return false;
+    UpdateReferences();
 }
 
 //---------------------------------------------------------------------------
@@ -97,6 +91,14 @@ void EventCaptionEditor::SetPreviewText(QString _text)
     m_previewLabel->setText(_text);
 }
 
+//---------------------------------------------------------------------------
+// Subtitles of every text requested by PreparePlayback
+//---------------------------------------------------------------------------
+void EventCaptionEditor::SetPlaybackSubtitles(QStringList _subtitles)
+{
+    m_playbackSubtitles = _subtitles;
+}
+
 //---------------------------------------------------------------------------
 // Reset Editor
 //---------------------------------------------------------------------------
@@ -114,10 +116,11 @@ void EventCaptionEditor::ResetEditor()
     ui->LE_fcoFile->setText("");
     ui->LE_Cutscene->setText("");
     ui->LE_Group->setText("");
-    ui->TW_TreeWidget->clear();
+    ui->TL_Timeline->SetDefaultGroup("");
+    m_captionModel->Clear();
+    UpdateReferences();
 
     // Preview
-    m_previewIndex = 0;
     SetPreviewText("");
 
     ClearSubtitles();
@@ -139,115 +142,45 @@ void EventCaptionEditor::on_PB_Open_clicked()
     if (capFile == Q_NULLPTR) return;
 
     ResetEditor();
+    TRACE_SCOPE("cap", "Open");
 
     // Save directory
     QFileInfo info(capFile);
     m_path = info.dir().absolutePath();
 
     // Read .cap file
-    QDomDocument document;
-    QFile file(capFile);
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+    cap capData;
+    QString errorMsg;
+    if (!capData.Load(capFile, errorMsg))
     {
-        QMessageBox::critical(this, "Error", "Fail to load .cap file!", QMessageBox::Ok);
+        QMessageBox::critical(this, "Error", errorMsg, QMessageBox::Ok);
         ResetEditor();
         return;
     }
-    else
-    {
-        document.setContent(&file);
-        file.close();
-    }
-
-    // version="1.0" encoding="utf-8" standalone="no"
-    QDomProcessingInstruction processingInstruction = document.firstChild().toProcessingInstruction();
-    QString instruction = processingInstruction.data();
 
-    // Read associated fco file name
-    QDomElement captionList = document.firstChildElement();
-    QString fcoFile = captionList.attribute("File");
-    if (!fcoFile.isEmpty())
-    {
-        ui->LE_fcoFile->setText(fcoFile);
-    }
-    else
-    {
-        QMessageBox::critical(this, "Error", "CaptionList missing attribute \"File\"!", QMessageBox::Ok);
-        ResetEditor();
-        return;
-    }
+    // Associated fco file name
+    ui->LE_fcoFile->setText(capData.m_fcoFile);
 
-    // Captions
-    QDomNodeList captions = captionList.elementsByTagName("Caption");
-    for (int i = 0; i < captions.count(); i++)
+    // Texts need a group to fall back to
+    for (cap::Caption& caption : capData.m_captions)
     {
-        QDomElement caption = captions.at(i).toElement();
-        QString name = caption.attribute("Name");
-        QString groupDefault = caption.attribute("Group");
-        if (!name.isEmpty())
-        {
-            TW_AddCutscene(name, groupDefault);
-        }
-        else
+        if (!caption.m_group.isEmpty()) continue;
+        for (cap::Text& text : caption.m_texts)
         {
-            QMessageBox::critical(this, "Error", "Caption missing attribute \"Name\"!", QMessageBox::Ok);
-            ResetEditor();
-            return;
-        }
-
-        QDomNodeList texts = caption.elementsByTagName("Text");
-        for (int j = 0; j < texts.count(); j++)
-        {
-            QDomElement text = texts.at(j).toElement();
-            QString start = text.attribute("Start");
-            QString length = text.attribute("Length");
-            QString cell = text.attribute("Cell");
-            QString groupOverride = text.attribute("Group");
-
-            bool valid = !start.isEmpty() && !length.isEmpty() && !cell.isEmpty();
-            if (valid)
+            if (text.m_group.isEmpty())
             {
-                bool startIsNumber = false;
-                start.toInt(&startIsNumber);
-                bool lengthIsNumber = false;
-                length.toInt(&lengthIsNumber);
-
-                valid &= startIsNumber;
-                valid &= lengthIsNumber;
-            }
-
-            if (valid)
-            {
-                if (groupOverride.isEmpty())
-                {
-                    if (groupDefault.isEmpty())
-                    {
-                        QMessageBox::warning(this, "Warning", "In Caption (Name: " + name + ") -> Text (Start: " + start + ", Length: " + length + ", Cell: " + cell + "):\nGroup override is empty and no default to fall back to, adding dummy override!", QMessageBox::Ok);
-                        TW_AddSubtitle(i, start.toInt(), length.toInt(), cell, "evXXX");
-                    }
-                    else
-                    {
-                        TW_AddSubtitle(i, start.toInt(), length.toInt(), cell);
-                    }
-                }
-                else
-                {
-                    TW_AddSubtitle(i, start.toInt(), length.toInt(), cell, groupOverride);
-                }
-            }
-            else
-            {
-                QMessageBox::critical(this, "Error", "In Caption (Name: " + name + "):\nText has invalid attribute \"Start\", \"Length\" or \"Cell\"!", QMessageBox::Ok);
-                ResetEditor();
-                return;
+                QMessageBox::warning(this, "Warning", "In Caption (Name: " + caption.m_name + ") -> Text (Start: " + QString::number(text.m_start) + ", Length: " + QString::number(text.m_length) + ", Cell: " + text.m_cell + "):\nGroup override is empty and no default to fall back to, adding dummy override!", QMessageBox::Ok);
+                text.m_group = "evXXX";
             }
         }
     }
+    m_captionModel->SetCap(capData);
 
     m_fileName = capFile;
     int index = m_fileName.lastIndexOf('/');
     if (index == -1) index = m_fileName.lastIndexOf('\\');
     ui->L_FileName->setText("File Name: " + m_fileName.mid(index + 1));
+    UpdateReferences();
 
     CheckAllEnablility();
 }
@@ -298,69 +231,110 @@ void EventCaptionEditor::on_PB_SaveAs_clicked()
 //---------------------------------------------------------------------------
 void EventCaptionEditor::on_PB_Apply_clicked()
 {
-    QTreeWidgetItem* caption = ui->TW_TreeWidget->topLevelItem(m_id);
-    if (caption == Q_NULLPTR) return;
-
-    caption->setText(0, ui->LE_Cutscene->text());
-    caption->setText(1, ui->LE_Group->text());
+    if (m_id < 0 || m_id >= m_captionModel->GetCutsceneCount()) return;
 
-    while (caption->childCount() > 0)
+    // Group override same as default is not written
+    QVector<cap::Text> texts = ui->TL_Timeline->GetTexts();
+    for (cap::Text& text : texts)
     {
-        delete caption->takeChild(0);
+        if (text.m_group == ui->LE_Group->text())
+        {
+            text.m_group.clear();
+        }
     }
 
-    for (int i = 1; i < ui->VL_Group->layout()->count() - 1; i++)
-    {
-        QSpinBox* start = reinterpret_cast<QSpinBox*>(ui->VL_Start->layout()->itemAt(i)->widget());
-        QSpinBox* length = reinterpret_cast<QSpinBox*>(ui->VL_Length->layout()->itemAt(i)->widget());
-        QLineEdit* cell = reinterpret_cast<QLineEdit*>(ui->VL_Cell->layout()->itemAt(i)->widget());
-        QLineEdit* groupOverride = reinterpret_cast<QLineEdit*>(ui->VL_Group->layout()->itemAt(i)->widget());
-
-        TW_AddSubtitle(m_id, start->value(), length->value(), cell->text(), (groupOverride->text().isEmpty() || groupOverride->text() == ui->LE_Group->text()) ? "(default)" : groupOverride->text());
-
-        // Re-highlight the subtitle in tree widget
-        QTreeWidgetItem* child = caption->child(i - 1);
-        child->setForeground(1, QColor(255,0,0));
-        child->setForeground(2, QColor(255,0,0));
-        child->setForeground(3, QColor(255,0,0));
-        child->setForeground(4, QColor(255,0,0));
-    }
+    m_captionModel->SetCutscene(m_id, ui->LE_Cutscene->text(), ui->LE_Group->text());
+    m_captionModel->SetTexts(m_id, texts);
+    UpdateCutsceneReferences(m_id);
 
     m_edited = false;
     CheckAllEnablility();
 }
 
 //---------------------------------------------------------------------------
-// Add subtitle
+// Add subtitle after the last one on the timeline
 //---------------------------------------------------------------------------
 void EventCaptionEditor::on_PB_AddSubtitle_clicked()
 {
-    int id = ui->VL_Group->layout()->count() - 1;
-    AddSubtitle(0, 1, "Subtitle" + (((id < 10) ? "0" : "") + QString::number(id)));
+    int const id = ui->TL_Timeline->GetTextCount() + 1;
+
+    cap::Text text;
+    text.m_start = 0;
+    text.m_length = 1;
+    text.m_cell = "Subtitle" + (((id < 10) ? "0" : "") + QString::number(id));
+    for (cap::Text const& other : ui->TL_Timeline->GetTexts())
+    {
+        text.m_start = qMax(text.m_start, other.m_start + other.m_length);
+    }
+    text.m_start = qMin(text.m_start, ui->SB_TextStart->maximum());
+
+    int const index = ui->TL_Timeline->AddText(text);
+    ui->TL_Timeline->SetSelected(index);
+    ui->TL_Timeline->EnsureVisible(index);
 
     m_edited = true;
     CheckAllEnablility();
 }
 
 //---------------------------------------------------------------------------
-// Save as
+// Clear all subtitles
 //---------------------------------------------------------------------------
 void EventCaptionEditor::on_PB_Clear_clicked()
 {
     ClearSubtitles();
-    QTreeWidgetItem* caption = ui->TW_TreeWidget->topLevelItem(m_id);
-    if (caption == Q_NULLPTR) return;
+    if (m_id < 0 || m_id >= m_captionModel->GetCutsceneCount()) return;
 
-    caption->setText(0, ui->LE_Cutscene->text());
-    caption->setText(1, ui->LE_Group->text());
+    m_captionModel->SetCutscene(m_id, ui->LE_Cutscene->text(), ui->LE_Group->text());
+    m_captionModel->SetTexts(m_id, QVector<cap::Text>());
+    UpdateCutsceneReferences(m_id);
 
-    while (caption->childCount() > 0)
+    m_edited = true;
+    CheckAllEnablility();
+}
+
+//---------------------------------------------------------------------------
+// Play the loaded cutscene from the playhead
+//---------------------------------------------------------------------------
+void EventCaptionEditor::on_PB_Play_toggled(bool checked)
+{
+    if (!checked)
     {
-        delete caption->takeChild(0);
+        m_playbackTimer->stop();
+        ui->PB_Play->setText("Play");
+
+        // Back to the hovered or selected text
+        m_playbackSegment = -1;
+        int const preview = ui->TL_Timeline->GetHovered();
+        UpdateSubtitlePreview(preview != -1 ? preview : ui->TL_Timeline->GetSelected());
+        return;
     }
 
-    m_edited = true;
-    CheckAllEnablility();
+    // Subtitles may have changed in the fco file since last time
+    PreparePlayback();
+
+    int const playhead = ui->TL_Timeline->GetPlayhead();
+    m_playbackStart = (playhead < 0 || playhead >= m_frameIndex.GetLastFrame()) ? 0 : playhead;
+    m_playbackSegment = -1;
+    m_playbackClock.start();
+    m_playbackTimer->start();
+    ui->PB_Play->setText("Stop");
+    PlaybackTick();
+}
+
+//---------------------------------------------------------------------------
+// Frame comes from the clock so late ticks catch up instead of drifting
+//---------------------------------------------------------------------------
+void EventCaptionEditor::PlaybackTick()
+{
+    int const frame = m_playbackStart + static_cast<int>(m_playbackClock.elapsed() * c_playbackFps / 1000);
+    if (frame > m_frameIndex.GetLastFrame())
+    {
+        ui->PB_Play->setChecked(false);
+        return;
+    }
+
+    ui->TL_Timeline->SetPlayhead(frame, true);
+    ShowPlaybackFrame(frame);
 }
 
 //---------------------------------------------------------------------------
@@ -368,7 +342,11 @@ void EventCaptionEditor::on_PB_Clear_clicked()
 //---------------------------------------------------------------------------
 void EventCaptionEditor::on_PB_AddCutscene_clicked()
 {
-    TW_AddCutscene();
+    int const row = m_captionModel->AddCutscene("evXXX", "evXXX");
+    if (m_references)
+    {
+        m_references->InsertCutscene(row, m_captionModel->GetCap().m_captions[row]);
+    }
 
     CheckAllEnablility();
 }
@@ -379,7 +357,11 @@ void EventCaptionEditor::on_PB_AddCutscene_clicked()
 void EventCaptionEditor::on_PB_DeleteCutscene_clicked()
 {
     ClearSubtitles();
-    delete ui->TW_TreeWidget->takeTopLevelItem(m_id);
+    m_captionModel->DeleteCutscene(m_id);
+    if (m_references)
+    {
+        m_references->RemoveCutscene(m_id);
+    }
 
     m_id = -1;
     m_edited = false;
@@ -391,7 +373,7 @@ void EventCaptionEditor::on_PB_DeleteCutscene_clicked()
 //---------------------------------------------------------------------------
 void EventCaptionEditor::on_PB_Expand_clicked()
 {
-    ui->TW_TreeWidget->expandAll();
+    ui->TV_Captions->expandAll();
 }
 
 //---------------------------------------------------------------------------
@@ -399,7 +381,7 @@ void EventCaptionEditor::on_PB_Expand_clicked()
 //---------------------------------------------------------------------------
 void EventCaptionEditor::on_PB_Collapse_clicked()
 {
-    ui->TW_TreeWidget->collapseAll();
+    ui->TV_Captions->collapseAll();
 }
 
 //---------------------------------------------------------------------------
@@ -407,18 +389,62 @@ void EventCaptionEditor::on_PB_Collapse_clicked()
 //---------------------------------------------------------------------------
 void EventCaptionEditor::on_PB_Sort_clicked()
 {
-    QTreeWidgetItem* item = Q_NULLPTR;
-    if (m_id != -1)
+    // Loaded cutscene is followed through the highlight
+    m_captionModel->SortByName(m_sortAscending ? Qt::SortOrder::AscendingOrder : Qt::SortOrder::DescendingOrder);
+    m_sortAscending = !m_sortAscending;
+    m_id = m_captionModel->GetHighlight();
+    UpdateReferences();
+}
+
+//---------------------------------------------------------------------------
+// Check timing of every cutscene in the file
+//---------------------------------------------------------------------------
+void EventCaptionEditor::on_PB_CheckFile_clicked()
+{
+    if (m_edited)
     {
-        item = ui->TW_TreeWidget->topLevelItem(m_id);
+        QMessageBox::warning(this, "Check File", "Changes to the current cutscene are not applied yet and will not be checked.", QMessageBox::Ok);
     }
 
-    ui->TW_TreeWidget->sortByColumn(0, m_sortAscending ? Qt::SortOrder::AscendingOrder : Qt::SortOrder::DescendingOrder);
-    m_sortAscending = !m_sortAscending;
+    QVector<CaptionChecker::Issue> issues = CaptionChecker::CheckCap(m_captionModel->GetCap());
+    if (m_references)
+    {
+        for (CaptionReferences::Ref const& ref : m_references->GetDangling())
+        {
+            issues.push_back(CaptionChecker::Issue{CaptionChecker::IF_Missing, ref.m_cutscene, ref.m_text, -1, 0});
+        }
+    }
 
-    if (item != Q_NULLPTR)
+    if (!m_report)
+    {
+        m_report = new CaptionReport(this);
+        connect(m_report, &CaptionReport::IssueActivated, this, &EventCaptionEditor::Report_IssueActivated);
+    }
+    m_report->SetIssues(m_captionModel->GetCap(), issues);
+    m_report->show();
+    m_report->raise();
+}
+
+//---------------------------------------------------------------------------
+// Number of texts without an fco entry changed
+//---------------------------------------------------------------------------
+void EventCaptionEditor::References_DanglingCountChanged(int _count)
+{
+    int const total = m_references->GetReferenceCount();
+    if (m_captionModel->GetCutsceneCount() == 0)
+    {
+        ui->L_References->setText("References: ---");
+        ui->L_References->setStyleSheet("");
+    }
+    else if (_count == 0)
+    {
+        ui->L_References->setText("References: all " + QString::number(total) + " found");
+        ui->L_References->setStyleSheet("");
+    }
+    else
     {
-        m_id = ui->TW_TreeWidget->indexOfTopLevelItem(item);
+        ui->L_References->setText("References: " + QString::number(_count) + " of " + QString::number(total) + " not found in .fco");
+        ui->L_References->setStyleSheet("color: rgb(255, 0, 0)");
     }
 }
 
@@ -439,46 +465,153 @@ void EventCaptionEditor::on_PB_ShiftRight_clicked()
 }
 
 //---------------------------------------------------------------------------
-// Double clicked an entry in tree widget
+// Batch retime the cutscene, the file or a directory
 //---------------------------------------------------------------------------
-void EventCaptionEditor::on_TW_TreeWidget_itemDoubleClicked(QTreeWidgetItem *item, int column)
+void EventCaptionEditor::on_PB_Retime_clicked()
 {
-    // Un-highlight previous selection
-    if (m_id != -1)
+    if (m_retimeWatcher->isRunning()) return;
+
+    CaptionRetimeDialog dialog(this);
+    dialog.SetScopeEnabled(CaptionRetimeDialog::RS_Cutscene, m_id != -1);
+    dialog.SetScopeEnabled(CaptionRetimeDialog::RS_File, m_captionModel->GetCutsceneCount() > 0);
+    if (dialog.exec() != QDialog::Accepted) return;
+
+    CaptionRetime::Settings const settings = dialog.GetSettings();
+    switch (dialog.GetScope())
+    {
+    case CaptionRetimeDialog::RS_Cutscene:
     {
-        QTreeWidgetItem* parent = ui->TW_TreeWidget->topLevelItem(m_id);
-        parent->setForeground(0, QColor(0,0,0));
-        parent->setForeground(1, QColor(0,0,0));
-        for (int i = 0; i < parent->childCount(); i++)
+        RetimeLoadedTexts(settings);
+        break;
+    }
+    case CaptionRetimeDialog::RS_File:
+    {
+        if (m_edited && QMessageBox::warning(this, "Retime", "Changes to the current cutscene are not applied yet and will be discarded, continue?", QMessageBox::Yes | QMessageBox::No) != QMessageBox::Yes)
+        {
+            return;
+        }
+
+        TRACE_SCOPE("cap", "Retime File");
+
+        // Update rows in place so the tree keeps its expansion
+        cap capData = m_captionModel->GetCap();
+        int const count = CaptionRetime::RetimeCap(settings, capData);
+        for (int i = 0; i < capData.m_captions.size(); i++)
+        {
+            m_captionModel->SetTexts(i, capData.m_captions[i].m_texts);
+        }
+
+        if (m_id != -1)
         {
-            QTreeWidgetItem* child = parent->child(i);
-            child->setForeground(1, QColor(0,0,0));
-            child->setForeground(2, QColor(0,0,0));
-            child->setForeground(3, QColor(0,0,0));
-            child->setForeground(4, QColor(0,0,0));
+            LoadCutscene(m_id);
         }
+        QMessageBox::information(this, "Retime", "Retimed " + QString::number(count) + " text(s) in " + QString::number(capData.m_captions.size()) + " cutscene(s).", QMessageBox::Ok);
+        break;
     }
+    case CaptionRetimeDialog::RS_Directory:
+    {
+        QString const directory = QFileDialog::getExistingDirectory(this, tr("Retime Directory"), m_path);
+        if (directory.isEmpty()) return;
 
-    QTreeWidgetItem* caption = item->parent() == Q_NULLPTR ? item : item->parent();
-    caption->setForeground(0, QColor(255,0,0));
-    caption->setForeground(1, QColor(255,0,0));
-    ui->LE_Cutscene->setText(caption->text(0));
-    ui->LE_Group->setText(caption->text(1));
+        QStringList const fileNames = CaptionRetime::FindCapFiles(directory, dialog.IsRecursive());
+        if (fileNames.isEmpty())
+        {
+            QMessageBox::information(this, "Retime", "No .cap files found.", QMessageBox::Ok);
+            return;
+        }
 
-    ClearSubtitles();
-    for (int i = 0; i < caption->childCount(); i++)
+        QString const message = "Retime " + QString::number(fileNames.size()) + " .cap file(s)? Files are overwritten in place.";
+        if (QMessageBox::question(this, "Retime", message, QMessageBox::Yes | QMessageBox::No) != QMessageBox::Yes)
+        {
+            return;
+        }
+
+        m_retimeProgress = new QProgressDialog("Retiming " + QString::number(fileNames.size()) + " files...", QString(), 0, fileNames.size(), this);
+        m_retimeProgress->setWindowTitle("Retime");
+        m_retimeProgress->setWindowModality(Qt::WindowModal);
+        m_retimeProgress->setMinimumDuration(500);
+        m_retimeProgress->setValue(0);
+        connect(m_retimeWatcher, &QFutureWatcher<CaptionRetime::FileResult>::progressValueChanged, m_retimeProgress, &QProgressDialog::setValue);
+
+        m_retimeWatcher->setFuture(QtConcurrent::mapped(fileNames, CaptionRetime::FileJob(settings)));
+        break;
+    }
+    }
+}
+
+//---------------------------------------------------------------------------
+// Parallel directory retime finished, results are in file order
+//---------------------------------------------------------------------------
+void EventCaptionEditor::RetimeDirectoryFinished()
+{
+    m_retimeProgress->deleteLater();
+    m_retimeProgress = Q_NULLPTR;
+
+    QList<CaptionRetime::FileResult> const results = m_retimeWatcher->future().results();
+    int fileCount = 0;
+    int textCount = 0;
+    bool openFileChanged = false;
+    QStringList errors;
+    for (CaptionRetime::FileResult const& result : results)
     {
-        QTreeWidgetItem* text = caption->child(i);
-        text->setForeground(1, QColor(255,0,0));
-        text->setForeground(2, QColor(255,0,0));
-        text->setForeground(3, QColor(255,0,0));
-        text->setForeground(4, QColor(255,0,0));
-        AddSubtitle(text->text(3).toInt(), text->text(4).toInt(), text->text(2), text->text(1));
+        if (!result.m_errorMsg.isEmpty())
+        {
+            errors << QFileInfo(result.m_fileName).fileName() + ": " + result.m_errorMsg;
+            continue;
+        }
+
+        if (result.m_textCount > 0)
+        {
+            fileCount++;
+            textCount += result.m_textCount;
+            openFileChanged |= !m_fileName.isEmpty() && QFileInfo(result.m_fileName) == QFileInfo(m_fileName);
+        }
     }
 
+    QString message = "Retimed " + QString::number(textCount) + " text(s) in " + QString::number(fileCount) + " of " + QString::number(results.size()) + " file(s).";
+    if (openFileChanged)
+    {
+        message += "\nThe open file was changed on disk, open it again to see the result.";
+    }
+    if (!errors.isEmpty())
+    {
+        message += "\n\nFailed:\n" + errors.join("\n");
+        QMessageBox::warning(this, "Retime", message, QMessageBox::Ok);
+        return;
+    }
+    QMessageBox::information(this, "Retime", message, QMessageBox::Ok);
+}
+
+//---------------------------------------------------------------------------
+// Double clicked an entry in tree view
+//---------------------------------------------------------------------------
+void EventCaptionEditor::on_TV_Captions_doubleClicked(const QModelIndex &index)
+{
+    int const row = m_captionModel->GetCutsceneRow(index);
+    if (row == -1) return;
+
+    LoadCutscene(row);
+}
+
+//---------------------------------------------------------------------------
+// Load a cutscene into the editor
+//---------------------------------------------------------------------------
+void EventCaptionEditor::LoadCutscene(int _row)
+{
+    cap::Caption const& caption = m_captionModel->GetCutscene(_row);
+    m_captionModel->SetHighlight(_row);
+    ui->LE_Cutscene->setText(caption.m_name);
+    ui->LE_Group->setText(caption.m_group);
+
+    ui->PB_Play->setChecked(false);
+    ui->TL_Timeline->SetDefaultGroup(caption.m_group);
+    ui->TL_Timeline->SetTexts(caption.m_texts);
+    ui->L_PlaybackTime->setText(ConvertFramesToTime(0));
+    LoadTextEditor();
+
     m_edited = false;
-    m_id = ui->TW_TreeWidget->indexOfTopLevelItem(item);
-    ui->TW_TreeWidget->expandItem(caption);
+    m_id = _row;
+    ui->TV_Captions->expand(m_captionModel->CutsceneIndex(_row));
     CheckAllEnablility();
 }
 
@@ -487,6 +620,12 @@ void EventCaptionEditor::on_TW_TreeWidget_itemDoubleClicked(QTreeWidgetItem *ite
 //---------------------------------------------------------------------------
 void EventCaptionEditor::on_LE_fcoFile_textEdited(const QString &arg1)
 {
+    m_captionModel->SetFcoFile(arg1);
+    if (m_references)
+    {
+        m_references->SetFcoFile(arg1, m_fileName);
+    }
+
     CheckAllEnablility();
 }
 
@@ -504,174 +643,233 @@ void EventCaptionEditor::on_LE_Cutscene_textEdited(const QString &arg1)
 //---------------------------------------------------------------------------
 void EventCaptionEditor::on_LE_Group_textEdited(const QString &arg1)
 {
+    ui->TL_Timeline->SetDefaultGroup(arg1);
+
     m_edited = true;
     CheckAllEnablility();
 }
 
 //---------------------------------------------------------------------------
-// Used changed a line edit that doesn't need to update other things
+// Group override of the selected text edited
 //---------------------------------------------------------------------------
-void EventCaptionEditor::on_Generic_textEdited()
+void EventCaptionEditor::on_LE_TextGroup_textEdited(const QString &arg1)
 {
-    m_edited = true;
-    CheckAllEnablility();
+    ApplyTextEditor();
+}
+
+//---------------------------------------------------------------------------
+// Cell of the selected text edited
+//---------------------------------------------------------------------------
+void EventCaptionEditor::on_LE_TextCell_textEdited(const QString &arg1)
+{
+    ApplyTextEditor();
 }
 
 //---------------------------------------------------------------------------
-// Spinbox of start, length
+// Start frame of the selected text changed
 //---------------------------------------------------------------------------
-void EventCaptionEditor::on_SpinBox_valueChanged(int i)
+void EventCaptionEditor::on_SB_TextStart_valueChanged(int arg1)
 {
-    QWidget* widget = reinterpret_cast<QWidget*>(sender());
-    int index1 = ui->VL_Start->indexOf(widget);
-    int index2 = ui->VL_End->indexOf(widget);
-    int index3 = ui->VL_Length->indexOf(widget);
+    ui->LE_TextStartTime->blockSignals(true);
+    ui->LE_TextStartTime->setText(ConvertFramesToTime(arg1));
+    ui->LE_TextStartTime->blockSignals(false);
 
-    if (index1 != -1)
+    if (arg1 <= ui->SB_TextEnd->value())
     {
-        QSpinBox* start = reinterpret_cast<QSpinBox*>(ui->VL_Start->layout()->itemAt(index1)->widget());
-        QSpinBox* end = reinterpret_cast<QSpinBox*>(ui->VL_End->layout()->itemAt(index1)->widget());
+        ui->SB_TextLength->blockSignals(true);
+        ui->SB_TextLength->setValue(ui->SB_TextEnd->value() - arg1 + 1);
+        ui->SB_TextLength->blockSignals(false);
+    }
 
-        QLineEdit* startTime = reinterpret_cast<QLineEdit*>(ui->VL_StartTime->layout()->itemAt(index1)->widget());
-        startTime->blockSignals(true);
-        startTime->setText(ConvertFramesToTime(start->value()));
-        startTime->blockSignals(false);
+    ApplyTextEditor();
+}
 
-        if (start->value() <= end->value())
-        {
-            QSpinBox* length = reinterpret_cast<QSpinBox*>(ui->VL_Length->layout()->itemAt(index1)->widget());
-            length->blockSignals(true);
-            length->setValue(end->value() - start->value() + 1);
-            length->blockSignals(false);
-        }
-    }
-    else if (index2 != -1)
+//---------------------------------------------------------------------------
+// End frame of the selected text changed
+//---------------------------------------------------------------------------
+void EventCaptionEditor::on_SB_TextEnd_valueChanged(int arg1)
+{
+    ui->LE_TextEndTime->blockSignals(true);
+    ui->LE_TextEndTime->setText(ConvertFramesToTime(arg1));
+    ui->LE_TextEndTime->blockSignals(false);
+
+    if (ui->SB_TextStart->value() <= arg1)
     {
-        QSpinBox* start = reinterpret_cast<QSpinBox*>(ui->VL_Start->layout()->itemAt(index2)->widget());
-        QSpinBox* end = reinterpret_cast<QSpinBox*>(ui->VL_End->layout()->itemAt(index2)->widget());
+        ui->SB_TextLength->blockSignals(true);
+        ui->SB_TextLength->setValue(arg1 - ui->SB_TextStart->value() + 1);
+        ui->SB_TextLength->blockSignals(false);
+    }
 
-        QLineEdit* endTime = reinterpret_cast<QLineEdit*>(ui->VL_EndTime->layout()->itemAt(index2)->widget());
-        endTime->blockSignals(true);
-        endTime->setText(ConvertFramesToTime(end->value()));
-        endTime->blockSignals(false);
+    ApplyTextEditor();
+}
 
-        if (start->value() <= end->value())
-        {
-            QSpinBox* length = reinterpret_cast<QSpinBox*>(ui->VL_Length->layout()->itemAt(index2)->widget());
-            length->blockSignals(true);
-            length->setValue(end->value() - start->value() + 1);
-            length->blockSignals(false);
-        }
-    }
-    else if (index3 != -1)
+//---------------------------------------------------------------------------
+// Length of the selected text changed, moves the end
+//---------------------------------------------------------------------------
+void EventCaptionEditor::on_SB_TextLength_valueChanged(int arg1)
+{
+    ui->SB_TextEnd->setValue(ui->SB_TextStart->value() + arg1 - 1);
+}
+
+//---------------------------------------------------------------------------
+// Start time edited in (min:sec:frame)
+//---------------------------------------------------------------------------
+void EventCaptionEditor::on_LE_TextStartTime_textEdited(const QString &arg1)
+{
+    int frames = ConvertTimeToFrames(arg1, ui->SB_TextStart->maximum());
+    if (frames != -1)
     {
-        QSpinBox* length = reinterpret_cast<QSpinBox*>(ui->VL_Length->layout()->itemAt(index3)->widget());
-        QSpinBox* start = reinterpret_cast<QSpinBox*>(ui->VL_Start->layout()->itemAt(index3)->widget());
-        QSpinBox* end = reinterpret_cast<QSpinBox*>(ui->VL_End->layout()->itemAt(index3)->widget());
-        end->setValue(start->value() + length->value() - 1);
+        ui->SB_TextStart->setValue(frames);
     }
-    else
+
+    CheckAllEnablility();
+}
+
+//---------------------------------------------------------------------------
+// End time edited in (min:sec:frame)
+//---------------------------------------------------------------------------
+void EventCaptionEditor::on_LE_TextEndTime_textEdited(const QString &arg1)
+{
+    int frames = ConvertTimeToFrames(arg1, ui->SB_TextEnd->maximum());
+    if (frames != -1)
     {
-        return;
+        ui->SB_TextEnd->setValue(frames);
     }
 
-    m_edited = true;
     CheckAllEnablility();
 }
 
 //---------------------------------------------------------------------------
-// Start time or end time edited
+// Start time pressed enter, also accepts XXYYZZ format
 //---------------------------------------------------------------------------
-void EventCaptionEditor::on_StartEndTime_textEdited()
+void EventCaptionEditor::on_LE_TextStartTime_returnPressed()
 {
-    QWidget* widget = reinterpret_cast<QWidget*>(sender());
-    int index1 = ui->VL_StartTime->indexOf(widget);
-    int index2 = ui->VL_EndTime->indexOf(widget);
+    int frames = ConvertTimeToFrames(ui->LE_TextStartTime->text(), ui->SB_TextStart->maximum());
+    if (frames == -1)
+    {
+        frames = ConvertTimeToFramesSimple(ui->LE_TextStartTime->text(), ui->SB_TextStart->maximum());
+    }
 
-    if (index1 != -1)
+    if (frames != -1)
     {
-        QSpinBox* start = reinterpret_cast<QSpinBox*>(ui->VL_Start->layout()->itemAt(index1)->widget());
-        QLineEdit* startTime = reinterpret_cast<QLineEdit*>(ui->VL_StartTime->layout()->itemAt(index1)->widget());
+        ui->SB_TextStart->setValue(frames);
 
-        int frames = ConvertTimeToFrames(startTime->text(), start->maximum());
-        if (frames != -1)
-        {
-            start->setValue(frames);
-        }
+        // Goto the end box and highlight
+        ui->LE_TextEndTime->setFocus();
+        ui->LE_TextEndTime->selectAll();
+    }
+
+    CheckAllEnablility();
+}
+
+//---------------------------------------------------------------------------
+// End time pressed enter, also accepts XXYYZZ format
+//---------------------------------------------------------------------------
+void EventCaptionEditor::on_LE_TextEndTime_returnPressed()
+{
+    int frames = ConvertTimeToFrames(ui->LE_TextEndTime->text(), ui->SB_TextEnd->maximum());
+    if (frames == -1)
+    {
+        frames = ConvertTimeToFramesSimple(ui->LE_TextEndTime->text(), ui->SB_TextEnd->maximum());
     }
-    else if (index2 != -1)
+
+    if (frames != -1)
     {
-        QSpinBox* end = reinterpret_cast<QSpinBox*>(ui->VL_End->layout()->itemAt(index2)->widget());
-        QLineEdit* endTime = reinterpret_cast<QLineEdit*>(ui->VL_EndTime->layout()->itemAt(index2)->widget());
+        ui->SB_TextEnd->setValue(frames);
 
-        int frames = ConvertTimeToFrames(endTime->text(), end->maximum());
-        if (frames != -1)
+        // Try goto the next text start box and highlight
+        int const next = ui->TL_Timeline->GetSelected() + 1;
+        if (next > 0 && next < ui->TL_Timeline->GetTextCount())
         {
-            end->setValue(frames);
+            ui->TL_Timeline->SetSelected(next);
+            ui->TL_Timeline->EnsureVisible(next);
+            ui->LE_TextStartTime->setFocus();
+            ui->LE_TextStartTime->selectAll();
         }
     }
 
+    CheckAllEnablility();
+}
+
+//---------------------------------------------------------------------------
+// Delete the selected text
+//---------------------------------------------------------------------------
+void EventCaptionEditor::on_PB_DeleteText_clicked()
+{
+    int const index = ui->TL_Timeline->GetSelected();
+    if (index == -1) return;
+
+    ui->TL_Timeline->RemoveText(index);
+
     m_edited = true;
     CheckAllEnablility();
 }
 
 //---------------------------------------------------------------------------
-// Start time or end time pressed enter in XXYYZZ format
+// Text selected on the timeline
 //---------------------------------------------------------------------------
-void EventCaptionEditor::on_StartEndTime_returnPressed()
+void EventCaptionEditor::on_TL_Timeline_SelectionChanged(int _index)
 {
-    QWidget* widget = reinterpret_cast<QWidget*>(sender());
-    int index1 = ui->VL_StartTime->indexOf(widget);
-    int index2 = ui->VL_EndTime->indexOf(widget);
+    LoadTextEditor();
+    UpdateTextIssues();
+    UpdateSubtitlePreview(_index);
+}
 
-    if (index1 != -1)
-    {
-        QSpinBox* start = reinterpret_cast<QSpinBox*>(ui->VL_Start->layout()->itemAt(index1)->widget());
-        QLineEdit* startTime = reinterpret_cast<QLineEdit*>(ui->VL_StartTime->layout()->itemAt(index1)->widget());
+//---------------------------------------------------------------------------
+// Text dragged on the timeline
+//---------------------------------------------------------------------------
+void EventCaptionEditor::on_TL_Timeline_TextsEdited()
+{
+    LoadTextEditor();
 
-        int frames = ConvertTimeToFrames(startTime->text(), start->maximum());
-        if (frames == -1)
-        {
-            frames = ConvertTimeToFramesSimple(startTime->text(), start->maximum());
-        }
+    m_edited = true;
+    CheckAllEnablility();
+}
 
-        if (frames != -1)
-        {
-            start->setValue(frames);
+//---------------------------------------------------------------------------
+// Preview the hovered text, or the selected one after leaving
+//---------------------------------------------------------------------------
+void EventCaptionEditor::on_TL_Timeline_HoverChanged(int _index)
+{
+    UpdateSubtitlePreview(_index != -1 ? _index : ui->TL_Timeline->GetSelected());
+}
 
-            // Goto the next end box and highlight
-            QLineEdit* endTime = reinterpret_cast<QLineEdit*>(ui->VL_EndTime->layout()->itemAt(index1)->widget());
-            endTime->setFocus();
-            endTime->selectAll();
-        }
-    }
-    else if (index2 != -1)
+//---------------------------------------------------------------------------
+// Scrub on the ruler, playback continues from there
+//---------------------------------------------------------------------------
+void EventCaptionEditor::on_TL_Timeline_PlayheadMoved(int _frame)
+{
+    if (m_playbackDirty)
     {
-        QSpinBox* end = reinterpret_cast<QSpinBox*>(ui->VL_End->layout()->itemAt(index2)->widget());
-        QLineEdit* endTime = reinterpret_cast<QLineEdit*>(ui->VL_EndTime->layout()->itemAt(index2)->widget());
+        PreparePlayback();
+    }
 
-        int frames = ConvertTimeToFrames(endTime->text(), end->maximum());
-        if (frames == -1)
-        {
-            frames = ConvertTimeToFramesSimple(endTime->text(), end->maximum());
-        }
+    if (ui->PB_Play->isChecked())
+    {
+        m_playbackStart = _frame;
+        m_playbackClock.restart();
+    }
+    else
+    {
+        // Hover may have replaced the image
+        m_playbackSegment = -1;
+    }
+    ShowPlaybackFrame(_frame);
+}
 
-        if (frames != -1)
-        {
-            end->setValue(frames);
+//---------------------------------------------------------------------------
+// Open the text of an issue from the check report
+//---------------------------------------------------------------------------
+void EventCaptionEditor::Report_IssueActivated(int _cutscene, int _text)
+{
+    if (_cutscene < 0 || _cutscene >= m_captionModel->GetCutsceneCount()) return;
 
-            // Try goto the next row start box and highlight
-            if (index2 < ui->VL_Group->layout()->count() - 2)
-            {
-                QLineEdit* startTime = reinterpret_cast<QLineEdit*>(ui->VL_StartTime->layout()->itemAt(index2 + 1)->widget());
-                startTime->setFocus();
-                startTime->selectAll();
-            }
-        }
+    LoadCutscene(_cutscene);
+    if (_text < ui->TL_Timeline->GetTextCount())
+    {
+        ui->TL_Timeline->SetSelected(_text);
+        ui->TL_Timeline->EnsureVisible(_text);
     }
-
-    m_edited = true;
-    CheckAllEnablility();
 }
 
 //---------------------------------------------------------------------------
@@ -679,11 +877,12 @@ void EventCaptionEditor::on_StartEndTime_returnPressed()
 //---------------------------------------------------------------------------
 void EventCaptionEditor::CheckAllEnablility()
 {
-    bool treeWidgetEmpty = ui->TW_TreeWidget->topLevelItemCount() == 0;
+    bool treeWidgetEmpty = m_captionModel->GetCutsceneCount() == 0;
     ui->PB_Sort->setEnabled(!treeWidgetEmpty);
+    ui->PB_CheckFile->setEnabled(!treeWidgetEmpty);
 
     bool cutsceneLoaded = m_id != -1;
-    bool hasSubtitles = ui->VL_Group->layout()->count() > 2;
+    bool hasSubtitles = ui->TL_Timeline->GetTextCount() > 0;
     bool applyValid = !ui->LE_Cutscene->text().isEmpty() && ValidateAllSubtitles();
     ui->LE_fcoFile->setEnabled(!treeWidgetEmpty);
     ui->LE_Cutscene->setEnabled(cutsceneLoaded);
@@ -693,6 +892,20 @@ void EventCaptionEditor::CheckAllEnablility()
     ui->PB_Clear->setEnabled(cutsceneLoaded && hasSubtitles);
     ui->PB_DeleteCutscene->setEnabled(cutsceneLoaded && !treeWidgetEmpty);
 
+    // Texts changed while playing are picked up right away
+    ui->PB_Play->setEnabled(cutsceneLoaded && hasSubtitles);
+    if (!ui->PB_Play->isEnabled())
+    {
+        ui->PB_Play->setChecked(false);
+    }
+    m_playbackDirty = true;
+    if (ui->PB_Play->isChecked())
+    {
+        PreparePlayback();
+        m_playbackSegment = -1;
+        ShowPlaybackFrame(ui->TL_Timeline->GetPlayhead());
+    }
+
     bool saveValid = !treeWidgetEmpty && !ui->LE_fcoFile->text().isEmpty() && !m_edited;
     ui->PB_Save->setEnabled(saveValid && !m_fileName.isEmpty());
     ui->PB_SaveAs->setEnabled(saveValid);
@@ -734,263 +947,283 @@ void EventCaptionEditor::CheckAllEnablility()
     ui->LE_Cutscene->setPalette(pal);
 
     // Preview text
-    if (m_previewIndex >= ui->VL_Cell->layout()->count() - 1)
+    int const preview = ui->TL_Timeline->GetHovered();
+    UpdateSubtitlePreview(preview != -1 ? preview : ui->TL_Timeline->GetSelected());
+
+    UpdateTextIssues();
+}
+
+//---------------------------------------------------------------------------
+// Save .cap file with specified file name
+//---------------------------------------------------------------------------
+void EventCaptionEditor::SaveFile(const QString &_fileName)
+{
+    TRACE_SCOPE("cap", "Save");
+
+    // Captions are kept in the model
+    m_captionModel->SetFcoFile(ui->LE_fcoFile->text());
+
+    QString errorMsg;
+    if (!m_captionModel->GetCap().Save(_fileName, errorMsg))
     {
-        m_previewIndex = 0;
-        SetPreviewText("");
+        QMessageBox::critical(this, "Error", errorMsg, QMessageBox::Ok);
+        ResetEditor();
+        return;
     }
-    else
+
+    // Update file name
+    m_fileName = _fileName;
+    int index = m_fileName.lastIndexOf('/');
+    if (index == -1) index = m_fileName.lastIndexOf('\\');
+    ui->L_FileName->setText("File Name: " + m_fileName.mid(index + 1));
+
+    // The fco file is looked up next to the new location
+    if (m_references)
     {
-        UpdateSubtitlePreview(m_previewIndex);
+        m_references->SetFcoFile(ui->LE_fcoFile->text(), m_fileName);
     }
+    CheckAllEnablility();
 }
 
 //---------------------------------------------------------------------------
-// Save .cap file with specified file name
+// Clear all subtitles in the editor
 //---------------------------------------------------------------------------
-void EventCaptionEditor::SaveFile(const QString &_fileName)
+void EventCaptionEditor::ClearSubtitles()
+{
+    ui->TL_Timeline->SetTexts(QVector<cap::Text>());
+    ui->L_PlaybackTime->setText(ConvertFramesToTime(0));
+    LoadTextEditor();
+
+    m_edited = true;
+    CheckAllEnablility();
+}
+
+//---------------------------------------------------------------------------
+// Emits a singal to find the subtitle for preview
+//---------------------------------------------------------------------------
+void EventCaptionEditor::UpdateSubtitlePreview(int _index)
+{
+    // Playback owns the preview
+    if (ui->PB_Play->isChecked()) return;
+
+    if (_index < 0 || _index >= ui->TL_Timeline->GetTextCount())
+    {
+        SetPreviewText("");
+        return;
+    }
+
+    cap::Text const& text = ui->TL_Timeline->GetText(_index);
+    emit UpdatePreview(text.m_group.isEmpty() ? ui->LE_Group->text() : text.m_group, text.m_cell);
+}
+
+//---------------------------------------------------------------------------
+// Frame index and images of every segment, overlapping texts are stacked
+//---------------------------------------------------------------------------
+void EventCaptionEditor::PreparePlayback()
 {
-    // Save .cap file
-    QDomDocument document;
+    TRACE_SCOPE("ui", "Playback Prepare");
 
-    // Processing Instruction
-    QDomProcessingInstruction processingInstruction = document.createProcessingInstruction("xml", "version=\"1.0\" encoding=\"utf-8\" standalone=\"no\"");
-    document.appendChild(processingInstruction);
+    QVector<cap::Text> const& texts = ui->TL_Timeline->GetTexts();
+    m_frameIndex.Build(texts);
 
-    // Caption List
-    QDomElement captionList = document.createElement("CaptionList");
-    captionList.setAttribute("File", ui->LE_fcoFile->text());
-    captionList.setAttribute("TimeUnit", "frame");
-    document.appendChild(captionList);
+    // One round trip to the main window for every subtitle
+    QStringList groups;
+    QStringList cells;
+    for (cap::Text const& text : texts)
+    {
+        groups << (text.m_group.isEmpty() ? ui->LE_Group->text() : text.m_group);
+        cells << text.m_cell;
+    }
+    m_playbackSubtitles.clear();
+    emit UpdatePlaybackSubtitles(groups, cells);
+    if (m_playbackSubtitles.size() != texts.size())
+    {
+        m_playbackSubtitles = cells;
+    }
 
-    // Captions
-    for (int i = 0; i < ui->TW_TreeWidget->topLevelItemCount(); i++)
+    if (m_renderCache.size() >= c_maxCachedRenders)
     {
-        QTreeWidgetItem const* captionItem = ui->TW_TreeWidget->topLevelItem(i);
-        QString name = captionItem->text(0);
-        QString groupDefault = captionItem->text(1);
+        m_renderCache.clear();
+    }
 
-        QDomElement caption = document.createElement("Caption");
-        caption.setAttribute("Name", name);
-        if (!groupDefault.isEmpty())
+    QVector<int> active;
+    m_segmentPixmaps.resize(m_frameIndex.GetSegmentCount());
+    for (int i = 0; i < m_segmentPixmaps.size(); i++)
+    {
+        m_frameIndex.GetActive(i, active);
+        QStringList lines;
+        for (int text : active)
         {
-            caption.setAttribute("Group", groupDefault);
+            lines << m_playbackSubtitles[text];
         }
-        captionList.appendChild(caption);
 
-        // Texts
-        for (int j = 0; j < captionItem->childCount(); j++)
+        if (lines.isEmpty())
         {
-            QTreeWidgetItem const* textItem = captionItem->child(j);
-            QString start = textItem->text(3);
-            QString length = textItem->text(4);
-            QString cell = textItem->text(2);
-            QString groupOverride = textItem->text(1);
-
-            QDomElement text = document.createElement("Text");
-            text.setAttribute("Start", start);
-            text.setAttribute("Length", length);
-            if (groupOverride != "(default)")
-            {
-                text.setAttribute("Group", groupOverride);
-            }
-            text.setAttribute("Cell", cell);
-            caption.appendChild(text);
+            m_segmentPixmaps[i] = QPixmap();
+            continue;
         }
+
+        QString const key = lines.join('\n');
+        QPixmap& pixmap = m_renderCache[key];
+        if (pixmap.isNull())
+        {
+            pixmap = RenderPlaybackText(key);
+        }
+        m_segmentPixmaps[i] = pixmap;
     }
 
-    QFile file(_fileName);
-    if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
+    m_playbackDirty = false;
+}
+
+//---------------------------------------------------------------------------
+// Only touches the preview when the frame enters another segment
+//---------------------------------------------------------------------------
+void EventCaptionEditor::ShowPlaybackFrame(int _frame)
+{
+    if (_frame < 0) return;
+
+    ui->L_PlaybackTime->setText(ConvertFramesToTime(_frame));
+
+    int const segment = m_frameIndex.SegmentAt(_frame, m_playbackSegment);
+    if (segment == m_playbackSegment) return;
+    m_playbackSegment = segment;
+
+    QPixmap const& pixmap = m_segmentPixmaps[segment];
+    if (pixmap.isNull())
     {
-        QMessageBox::critical(this, "Error", "Fail to write .cap file!", QMessageBox::Ok);
-        ResetEditor();
-        return;
+        m_previewLabel->clear();
     }
     else
     {
-        QTextStream stream(&file);
-        stream << document.toString();
-        file.close();
+        m_previewLabel->setPixmap(pixmap);
     }
+}
 
-    // Update file name
-    m_fileName = _fileName;
-    int index = m_fileName.lastIndexOf('/');
-    if (index == -1) index = m_fileName.lastIndexOf('\\');
-    ui->L_FileName->setText("File Name: " + m_fileName.mid(index + 1));
-    CheckAllEnablility();
+QPixmap EventCaptionEditor::RenderPlaybackText(QString const& _text) const
+{
+    QFontMetrics const metrics(m_playbackFont);
+    QRect const bounds = metrics.boundingRect(QRect(0, 0, 4096, 4096), Qt::AlignLeft | Qt::AlignTop, _text);
+
+    QPixmap pixmap(bounds.size().expandedTo(QSize(1, 1)));
+    pixmap.fill(Qt::transparent);
+    QPainter painter(&pixmap);
+    painter.setFont(m_playbackFont);
+    painter.setPen(Qt::white);
+    painter.drawText(pixmap.rect(), Qt::AlignLeft | Qt::AlignTop, _text);
+    return pixmap;
 }
 
 //---------------------------------------------------------------------------
-// Add a new subtitle to the editor
+// List timing issues of the selected text
 //---------------------------------------------------------------------------
-void EventCaptionEditor::AddSubtitle(int _start, int _length, const QString &_cell, const QString &_groupOverride)
+void EventCaptionEditor::UpdateTextIssues()
 {
-    // ALL WIDGETS MUST HAVE MINIMUM HEIGHT 26
-    // 0: Group override, 1: Cell, 2: Start, 3: Start(time), 4: End, 5: End(time), 6: Length, 7: Delete
+    QVector<CaptionChecker::Issue> const issues = ui->TL_Timeline->GetIssues(ui->TL_Timeline->GetSelected());
 
-    int const insertTo = ui->VL_Group->layout()->count() - 1;
+    QStringList lines;
+    for (CaptionChecker::Issue const& issue : issues)
+    {
+        lines << CaptionChecker::Describe(issue, ui->TL_Timeline->GetTexts());
+    }
+    ui->L_TextIssues->setText(lines.join(", "));
+}
 
-    // Group override
-    QLineEdit *group = new QLineEdit();
-    group->setSizePolicy(QSizePolicy::Ignored, QSizePolicy::Fixed);
-    group->setAlignment(Qt::AlignHCenter | Qt::AlignVCenter);
-    group->setMinimumHeight(26);
-    group->setText(_groupOverride == "(default)" ? "" : _groupOverride);
-    group->installEventFilter(this);
-    ui->VL_Group->insertWidget(insertTo, group);
-    connect(group, SIGNAL(textEdited(QString)), this, SLOT(on_Generic_textEdited()));
-
-    QFont font = group->font();
-    font.setPointSize(8);
-    group->setFont(font);
+//---------------------------------------------------------------------------
+// Re-resolve every text after the model changed
+//---------------------------------------------------------------------------
+void EventCaptionEditor::UpdateReferences()
+{
+    if (!m_references) return;
 
-    // Cell
-    QLineEdit *cell = new QLineEdit();
-    cell->setSizePolicy(QSizePolicy::Ignored, QSizePolicy::Fixed);
-    cell->setAlignment(Qt::AlignHCenter | Qt::AlignVCenter);
-    cell->setMinimumHeight(26);
-    cell->setText(_cell);
-    cell->installEventFilter(this);
-    cell->setFont(font);
-    ui->VL_Cell->insertWidget(insertTo, cell);
-    connect(cell, SIGNAL(textEdited(QString)), this, SLOT(on_Generic_textEdited()));
-
-    // Start
-    QSpinBox *start = new QSpinBox();
-    start->setSizePolicy(QSizePolicy::Ignored, QSizePolicy::Fixed);
-    start->setMinimumHeight(26);
-    start->setMinimum(0);
-    start->setMaximum(99999);
-    qBound(0, _start, 99999);
-    start->setValue(_start);
-    start->installEventFilter(this);
-    start->setFont(font);
-    ui->VL_Start->insertWidget(insertTo, start);
-    connect(start, SIGNAL(valueChanged(int)), this, SLOT(on_SpinBox_valueChanged(int)));
-
-    // Start in (min:sec:frame)
-    QLineEdit *startTime = new QLineEdit();
-    startTime->setSizePolicy(QSizePolicy::Ignored, QSizePolicy::Fixed);
-    startTime->setAlignment(Qt::AlignHCenter | Qt::AlignVCenter);
-    startTime->setMinimumHeight(26);
-    startTime->setText(ConvertFramesToTime(_start));
-    startTime->installEventFilter(this);
-    startTime->setFont(font);
-    ui->VL_StartTime->insertWidget(insertTo, startTime);
-    connect(startTime, SIGNAL(textEdited(QString)), this, SLOT(on_StartEndTime_textEdited()));
-    connect(startTime, SIGNAL(returnPressed()), this, SLOT(on_StartEndTime_returnPressed()));
-
-    // Length
-    QSpinBox *length = new QSpinBox();
-    length->setSizePolicy(QSizePolicy::Ignored, QSizePolicy::Fixed);
-    length->setMinimumHeight(26);
-    length->setMinimum(1);
-    length->setMaximum(100000);
-    qBound(1, _length, 100000);
-    length->setValue(_length);
-    length->installEventFilter(this);
-    length->setFont(font);
-    ui->VL_Length->insertWidget(insertTo, length);
-    connect(length, SIGNAL(valueChanged(int)), this, SLOT(on_SpinBox_valueChanged(int)));
-
-    // End
-    int _end = _start + _length - 1;
-    QSpinBox *end = new QSpinBox();
-    end->setSizePolicy(QSizePolicy::Ignored, QSizePolicy::Fixed);
-    end->setMinimumHeight(26);
-    end->setMinimum(0);
-    end->setMaximum(99999);
-    end->setValue(_end);
-    end->installEventFilter(this);
-    end->setFont(font);
-    ui->VL_End->insertWidget(insertTo, end);
-    connect(end, SIGNAL(valueChanged(int)), this, SLOT(on_SpinBox_valueChanged(int)));
-
-    // End in (min:sec:frame)
-    QLineEdit *endTime = new QLineEdit();
-    endTime->setSizePolicy(QSizePolicy::Ignored, QSizePolicy::Fixed);
-    endTime->setAlignment(Qt::AlignHCenter | Qt::AlignVCenter);
-    endTime->setMinimumHeight(26);
-    endTime->setText(ConvertFramesToTime(_end));
-    endTime->installEventFilter(this);
-    endTime->setFont(font);
-    ui->VL_EndTime->insertWidget(insertTo, endTime);
-    connect(endTime, SIGNAL(textEdited(QString)), this, SLOT(on_StartEndTime_textEdited()));
-    connect(endTime, SIGNAL(returnPressed()), this, SLOT(on_StartEndTime_returnPressed()));
-
-    // Delete
-    QPushButton *del = new QPushButton();
-    del->setSizePolicy(QSizePolicy::Ignored, QSizePolicy::Fixed);
-    del->setMinimumHeight(26);
-    del->setMaximumHeight(26);
-    del->setText("X");
-    del->setMaximumWidth(20);
-    del->installEventFilter(this);
-    del->setFont(font);
-    ui->VL_Delete->insertWidget(insertTo, del);
-    connect(del, SIGNAL(clicked()), this, SLOT(DeleteSubtitle()));
-}
-
-//---------------------------------------------------------------------------
-// Signal sent when delete button is pressed
-//---------------------------------------------------------------------------
-void EventCaptionEditor::DeleteSubtitle()
-{
-    QWidget* widget = reinterpret_cast<QWidget*>(sender());
-    int index = ui->VL_Delete->indexOf(widget);
-    if (index != -1)
-    {
-        int layoutID[8] = {0, 2, 4, 5, 7, 8, 10, 12};
-        for (int i = 0; i < 8; i++)
-        {
-            QLayout* vBox = ui->HL_Subtitles->layout()->itemAt(layoutID[i])->layout();
-            delete vBox->takeAt(index)->widget();
-        }
+    m_references->SetCaptions(m_captionModel->GetCap(), m_fileName);
+    ui->TV_Captions->viewport()->update();
+}
 
-        m_edited = true;
-        CheckAllEnablility();
-    }
+//---------------------------------------------------------------------------
+// Only the texts of one cutscene changed
+//---------------------------------------------------------------------------
+void EventCaptionEditor::UpdateCutsceneReferences(int _id)
+{
+    if (!m_references) return;
+
+    m_references->SetCutscene(_id, m_captionModel->GetCap().m_captions[_id]);
+    ui->TV_Captions->viewport()->update();
 }
 
 //---------------------------------------------------------------------------
-// Clear all subtitles in the editor
+// Fill the editor with the selected text
 //---------------------------------------------------------------------------
-void EventCaptionEditor::ClearSubtitles()
+void EventCaptionEditor::LoadTextEditor()
 {
-    int layoutID[8] = {0, 2, 4, 5, 7, 8, 10, 12};
-    for (int i = 0; i < 8; i++)
+    int const index = ui->TL_Timeline->GetSelected();
+    bool const selected = index != -1;
+
+    cap::Text text;
+    text.m_start = 0;
+    text.m_length = 1;
+    if (selected)
     {
-        QLayout* vBox = ui->HL_Subtitles->layout()->itemAt(layoutID[i])->layout();
-        while (vBox->count() > 2)
-        {
-            delete vBox->takeAt(1)->widget();
-        }
+        text = ui->TL_Timeline->GetText(index);
     }
 
-    m_edited = true;
-    CheckAllEnablility();
+    QWidget* widgets[] = {ui->LE_TextGroup, ui->LE_TextCell, ui->SB_TextStart, ui->LE_TextStartTime, ui->SB_TextEnd, ui->LE_TextEndTime, ui->SB_TextLength, ui->PB_DeleteText};
+    for (QWidget* widget : widgets)
+    {
+        widget->blockSignals(true);
+        widget->setEnabled(selected);
+    }
+
+    int const end = text.m_start + text.m_length - 1;
+    ui->LE_TextGroup->setText(text.m_group);
+    ui->LE_TextCell->setText(text.m_cell);
+    ui->SB_TextStart->setValue(text.m_start);
+    ui->LE_TextStartTime->setText(ConvertFramesToTime(text.m_start));
+    ui->SB_TextEnd->setValue(end);
+    ui->LE_TextEndTime->setText(ConvertFramesToTime(end));
+    ui->SB_TextLength->setValue(text.m_length);
+
+    for (QWidget* widget : widgets)
+    {
+        widget->blockSignals(false);
+    }
+
+    ValidateTextEditor();
 }
 
 //---------------------------------------------------------------------------
-// Emits a singal to find the subtitle for preview
+// Write the editor back to the selected text
 //---------------------------------------------------------------------------
-void EventCaptionEditor::UpdateSubtitlePreview(int _index)
+void EventCaptionEditor::ApplyTextEditor()
 {
-    if (_index != 0 && _index < ui->VL_Group->layout()->count() - 1)
+    int const index = ui->TL_Timeline->GetSelected();
+    if (index != -1 && ui->SB_TextStart->value() <= ui->SB_TextEnd->value())
     {
-        QLineEdit* group = reinterpret_cast<QLineEdit*>(ui->VL_Group->layout()->itemAt(_index)->widget());
-        QLineEdit* cell = reinterpret_cast<QLineEdit*>(ui->VL_Cell->layout()->itemAt(_index)->widget());
-        emit UpdatePreview(group->text().isEmpty() ? ui->LE_Group->text() : group->text(), cell->text());
+        cap::Text text;
+        text.m_start = ui->SB_TextStart->value();
+        text.m_length = ui->SB_TextEnd->value() - ui->SB_TextStart->value() + 1;
+        text.m_cell = ui->LE_TextCell->text();
+        text.m_group = ui->LE_TextGroup->text();
+        ui->TL_Timeline->SetText(index, text);
     }
+
+    m_edited = true;
+    CheckAllEnablility();
 }
 
 //---------------------------------------------------------------------------
-// Validate one row of subtitle
+// Validate the selected text editor
 //---------------------------------------------------------------------------
-bool EventCaptionEditor::ValidateSubtitle(int _id)
+bool EventCaptionEditor::ValidateTextEditor()
 {
-    if (ui->VL_Group->layout()->count() <= 2 || _id == 0 || _id == ui->VL_Group->layout()->count() - 1) return false;
+    QWidget* widgets[] = {ui->LE_TextGroup, ui->LE_TextCell, ui->SB_TextStart, ui->LE_TextStartTime, ui->SB_TextEnd, ui->LE_TextEndTime};
+    if (ui->TL_Timeline->GetSelected() == -1)
+    {
+        for (QWidget* widget : widgets)
+        {
+            widget->setPalette(palette());
+        }
+        return true;
+    }
 
     QPalette palRed = palette();
     QPalette palWhite = palette();
@@ -1000,80 +1233,74 @@ bool EventCaptionEditor::ValidateSubtitle(int _id)
     bool valid = true;
 
     // Group override
-    QLineEdit* groupOverride = reinterpret_cast<QLineEdit*>(ui->VL_Group->layout()->itemAt(_id)->widget());
-    if (groupOverride->text().isEmpty() && ui->LE_Group->text().isEmpty())
+    if (ui->LE_TextGroup->text().isEmpty() && ui->LE_Group->text().isEmpty())
     {
-        groupOverride->setPalette(palRed);
+        ui->LE_TextGroup->setPalette(palRed);
         valid = false;
     }
     else
     {
-        groupOverride->setPalette(palWhite);
+        ui->LE_TextGroup->setPalette(palWhite);
     }
 
     // Cell
-    QLineEdit* cell = reinterpret_cast<QLineEdit*>(ui->VL_Cell->layout()->itemAt(_id)->widget());
-    if (cell->text().isEmpty())
+    if (ui->LE_TextCell->text().isEmpty())
     {
-        cell->setPalette(palRed);
+        ui->LE_TextCell->setPalette(palRed);
         valid = false;
     }
     else
     {
-        cell->setPalette(palWhite);
+        ui->LE_TextCell->setPalette(palWhite);
     }
 
     // Start and End
-    QSpinBox* start = reinterpret_cast<QSpinBox*>(ui->VL_Start->layout()->itemAt(_id)->widget());
-    QSpinBox* end = reinterpret_cast<QSpinBox*>(ui->VL_End->layout()->itemAt(_id)->widget());
-    if (start->value() > end->value())
+    if (ui->SB_TextStart->value() > ui->SB_TextEnd->value())
     {
-        start->setPalette(palRed);
-        end->setPalette(palRed);
+        ui->SB_TextStart->setPalette(palRed);
+        ui->SB_TextEnd->setPalette(palRed);
         valid = false;
     }
     else
     {
-        start->setPalette(palWhite);
-        end->setPalette(palWhite);
+        ui->SB_TextStart->setPalette(palWhite);
+        ui->SB_TextEnd->setPalette(palWhite);
     }
 
     // Start time
-    QLineEdit* startTime = reinterpret_cast<QLineEdit*>(ui->VL_StartTime->layout()->itemAt(_id)->widget());
-    if (ConvertTimeToFrames(startTime->text(), start->maximum()) == -1)
+    if (ConvertTimeToFrames(ui->LE_TextStartTime->text(), ui->SB_TextStart->maximum()) == -1)
     {
-        startTime->setPalette(palRed);
+        ui->LE_TextStartTime->setPalette(palRed);
         valid = false;
     }
     else
     {
-        startTime->setPalette(palWhite);
+        ui->LE_TextStartTime->setPalette(palWhite);
     }
 
     // End time
-    QLineEdit* endTime = reinterpret_cast<QLineEdit*>(ui->VL_EndTime->layout()->itemAt(_id)->widget());
-    if (ConvertTimeToFrames(endTime->text(), end->maximum()) == -1)
+    if (ConvertTimeToFrames(ui->LE_TextEndTime->text(), ui->SB_TextEnd->maximum()) == -1)
     {
-        endTime->setPalette(palRed);
+        ui->LE_TextEndTime->setPalette(palRed);
         valid = false;
     }
     else
     {
-        endTime->setPalette(palWhite);
+        ui->LE_TextEndTime->setPalette(palWhite);
     }
 
     return valid;
 }
 
 //---------------------------------------------------------------------------
-// Validate all rows of subtitle
+// Validate all subtitles, the timeline paints invalid ones red
 //---------------------------------------------------------------------------
 bool EventCaptionEditor::ValidateAllSubtitles()
 {
-    bool valid = true;
-    for (int i = 1; i < ui->VL_Group->layout()->count() - 1; i++)
+    bool valid = ValidateTextEditor();
+    for (cap::Text const& text : ui->TL_Timeline->GetTexts())
     {
-        valid &= ValidateSubtitle(i);
+        valid &= !text.m_cell.isEmpty() && (!text.m_group.isEmpty() || !ui->LE_Group->text().isEmpty());
     }
     return valid;
 }
@@ -1158,47 +1385,25 @@ QString EventCaptionEditor::ConvertFramesToTime(int _frames)
 }
 
 //---------------------------------------------------------------------------
-// Add a new cutscene to tree widget
-//---------------------------------------------------------------------------
-void EventCaptionEditor::TW_AddCutscene(const QString &_name, const QString &_group)
-{
-    QTreeWidgetItem *item = new QTreeWidgetItem(ui->TW_TreeWidget);
-    item->setText(0, _name);
-    item->setText(1, _group);
-    ui->TW_TreeWidget->addTopLevelItem(item);
-}
-
-//---------------------------------------------------------------------------
-// Add a new subtitle to tree widget
+// Shift amount of frames
 //---------------------------------------------------------------------------
-void EventCaptionEditor::TW_AddSubtitle(int _id, int _start, int _length, const QString &_cell, const QString &_groupOverride)
+void EventCaptionEditor::ShiftFrames(bool _backward)
 {
-    QTreeWidgetItem *parent = ui->TW_TreeWidget->topLevelItem(_id);
-    if (parent)
-    {
-        QTreeWidgetItem *item = new QTreeWidgetItem();
-        item->setText(1, _groupOverride);
-        item->setText(2, _cell);
-        item->setText(3, QString::number(_start));
-        item->setText(4, QString::number(_length));
-        parent->addChild(item);
-    }
+    CaptionRetime::Settings settings;
+    settings.m_offset = (_backward ? -1 : 1) * ui->SB_Shift->value();
+    RetimeLoadedTexts(settings);
 }
 
 //---------------------------------------------------------------------------
-// Shift amount of frames
+// Retime the texts on the timeline, not applied yet
 //---------------------------------------------------------------------------
-void EventCaptionEditor::ShiftFrames(bool _backward)
+void EventCaptionEditor::RetimeLoadedTexts(CaptionRetime::Settings const& _settings)
 {
-    int count = ui->VL_Group->layout()->count() - 1;
-    int shift = (_backward ? -1 : 1) * ui->SB_Shift->value();
-
-    for (int i = 1; i < count; i++)
-    {
-        QSpinBox* start = reinterpret_cast<QSpinBox*>(ui->VL_Start->layout()->itemAt(i)->widget());
-        start->setValue(start->value() + shift);
+    QVector<cap::Text> texts = ui->TL_Timeline->GetTexts();
+    if (CaptionRetime::RetimeTexts(_settings, texts) == 0) return;
 
-        QSpinBox* end = reinterpret_cast<QSpinBox*>(ui->VL_End->layout()->itemAt(i)->widget());
-        end->setValue(end->value() + shift);
-    }
+    ui->TL_Timeline->UpdateTexts(texts);
+    LoadTextEditor();
+    m_edited = true;
+    CheckAllEnablility();
 }
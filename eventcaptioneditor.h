@@ -9,8 +9,17 @@
 #include <QFontDatabase>
 #include <QSpinBox>
 #include <QMessageBox>
-#include <QTreeWidgetItem>
-#include <QtXml>
+#include <QTreeView>
+#include <QFutureWatcher>
+#include <QProgressDialog>
+#include <QElapsedTimer>
+#include <QTimer>
+
+#include "captionframeindex.h"
+#include "captionmodel.h"
+#include "captionreport.h"
+#include "captionretime.h"
+#include "captiontimeline.h"
 
 namespace Ui {
 class EventCaptionEditor;
@@ -24,14 +33,15 @@ public:
     explicit EventCaptionEditor(QWidget *parent = nullptr);
     ~EventCaptionEditor();
 
-    bool eventFilter(QObject *object, QEvent *event);
-
     void SetDefaultPath(QString _path) {m_path = _path;}
+    void SetReferences(CaptionReferences* _references);
     void SetPreviewText(QString _text);
+    void SetPlaybackSubtitles(QStringList _subtitles);
     void ResetEditor();
 
 signals:
     void UpdatePreview(QString _group, QString _cell);
+    void UpdatePlaybackSubtitles(QStringList _groups, QStringList _cells);
 
 private slots:
     void on_PB_Open_clicked();
@@ -42,6 +52,8 @@ private slots:
     void on_PB_Apply_clicked();
     void on_PB_AddSubtitle_clicked();
     void on_PB_Clear_clicked();
+    void on_PB_Play_toggled(bool checked);
+    void PlaybackTick();
 
     void on_PB_AddCutscene_clicked();
     void on_PB_DeleteCutscene_clicked();
@@ -49,41 +61,71 @@ private slots:
     void on_PB_Expand_clicked();
     void on_PB_Collapse_clicked();
     void on_PB_Sort_clicked();
+    void on_PB_CheckFile_clicked();
 
     void on_PB_ShiftLeft_clicked();
     void on_PB_ShiftRight_clicked();
+    void on_PB_Retime_clicked();
+    void RetimeDirectoryFinished();
 
-    void on_TW_TreeWidget_itemDoubleClicked(QTreeWidgetItem *item, int column);
+    void on_TV_Captions_doubleClicked(const QModelIndex &index);
 
     void on_LE_fcoFile_textEdited(const QString &arg1);
     void on_LE_Cutscene_textEdited(const QString &arg1);
     void on_LE_Group_textEdited(const QString &arg1);
 
-    void on_Generic_textEdited();
-    void on_SpinBox_valueChanged(int i);
-    void on_StartEndTime_textEdited();
-    void on_StartEndTime_returnPressed();
-
-    void DeleteSubtitle();
+    // Selected text editor
+    void on_LE_TextGroup_textEdited(const QString &arg1);
+    void on_LE_TextCell_textEdited(const QString &arg1);
+    void on_SB_TextStart_valueChanged(int arg1);
+    void on_SB_TextEnd_valueChanged(int arg1);
+    void on_SB_TextLength_valueChanged(int arg1);
+    void on_LE_TextStartTime_textEdited(const QString &arg1);
+    void on_LE_TextEndTime_textEdited(const QString &arg1);
+    void on_LE_TextStartTime_returnPressed();
+    void on_LE_TextEndTime_returnPressed();
+    void on_PB_DeleteText_clicked();
+
+    // Timeline
+    void on_TL_Timeline_SelectionChanged(int _index);
+    void on_TL_Timeline_TextsEdited();
+    void on_TL_Timeline_HoverChanged(int _index);
+    void on_TL_Timeline_PlayheadMoved(int _frame);
+
+    // Check report
+    void Report_IssueActivated(int _cutscene, int _text);
+
+    // fco references
+    void References_DanglingCountChanged(int _count);
 
 private:
     void CheckAllEnablility();
     void SaveFile(QString const& _fileName);
-    void AddSubtitle(int _start, int _length, QString const& _cell, QString const& _groupOverride = "");
     void ClearSubtitles();
     void UpdateSubtitlePreview(int _index);
+    void UpdateTextIssues();
+    void UpdateReferences();
+    void UpdateCutsceneReferences(int _id);
+    void LoadCutscene(int _row);
+
+    // Selected text editor
+    void LoadTextEditor();
+    void ApplyTextEditor();
 
-    bool ValidateSubtitle(int _id);
+    bool ValidateTextEditor();
     bool ValidateAllSubtitles();
 
     int ConvertTimeToFramesSimple(QString const& _time, int const _max);
     int ConvertTimeToFrames(QString const& _time, int const _max);
     QString ConvertFramesToTime(int _frames);
 
-    void TW_AddCutscene(QString const& _name = "evXXX", QString const& _group = "evXXX");
-    void TW_AddSubtitle(int _id, int _start, int _length, QString const& _cell, QString const& _groupOverride = "(default)");
+    // Playback preview
+    void PreparePlayback();
+    void ShowPlaybackFrame(int _frame);
+    QPixmap RenderPlaybackText(QString const& _text) const;
 
     void ShiftFrames(bool _backward);
+    void RetimeLoadedTexts(CaptionRetime::Settings const& _settings);
 
 private:
     Ui::EventCaptionEditor *ui;
@@ -94,9 +136,30 @@ private:
     bool m_sortAscending;
     QString m_path;
     QString m_fileName;
+    CaptionModel* m_captionModel;
+    CaptionReferences* m_references;
 
     QLabel* m_previewLabel;
-    int m_previewIndex;
+    CaptionReport* m_report;
+
+    // Playback, one pre-rendered image per segment of the
+    // frame index, images are shared by subtitle text
+    static int const c_playbackFps = 30;
+    static int const c_maxCachedRenders = 512;
+    QFont m_playbackFont;
+    CaptionFrameIndex m_frameIndex;
+    QStringList m_playbackSubtitles;
+    QVector<QPixmap> m_segmentPixmaps;
+    QHash<QString, QPixmap> m_renderCache;
+    bool m_playbackDirty;
+    QTimer* m_playbackTimer;
+    QElapsedTimer m_playbackClock;
+    int m_playbackStart;
+    int m_playbackSegment;
+
+    // Retiming a directory
+    QFutureWatcher<CaptionRetime::FileResult>* m_retimeWatcher;
+    QProgressDialog* m_retimeProgress;
 };
 
 #endif // EVENTCAPTIONEDITOR_H
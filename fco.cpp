@@ -5,12 +5,14 @@
 //-----------------------------------------------------
 
 #include "fco.h"
+#include "tracer.h"
 
 #include <assert.h>
 #include <stdlib.h>
 
 #include <algorithm>
 #include <cstring>
+#include <queue>
 #include <sstream>
 #include <fstream>
 #include <iostream>
@@ -24,10 +26,24 @@ fco::fco()
 {
     //DumpFteFile();
     //GenerateDatabase();
+    m_database = make_shared<map<wstring, unsigned int> const>();
+    m_databaseRev = make_shared<map<unsigned int, wstring> const>();
     m_init = Init();
     m_loaded = false;
 }
 
+//-----------------------------------------------------
+// Empty document sharing the database of another one
+// (documents can then be loaded away from the GUI)
+//-----------------------------------------------------
+fco::fco(fco const* _database)
+{
+    m_database = _database->m_database;
+    m_databaseRev = _database->m_databaseRev;
+    m_init = _database->m_init;
+    m_loaded = false;
+}
+
 //-----------------------------------------------------
 // Destructor
 //-----------------------------------------------------
@@ -40,19 +56,21 @@ fco::~fco()
 //-----------------------------------------------------
 bool fco::Init()
 {
-    ifstream database("fcoDatabase.txt");
+    TRACE_SCOPE("fco", "Init Database");
+
+    ifstream databaseFile("fcoDatabase.txt");
 
-    if (!database.is_open())
+    if (!databaseFile.is_open())
     {
         // Missing database file
         return false;
     }
 
-    m_database.clear();
-    m_databaseRev.clear();
+    shared_ptr<map<wstring, unsigned int>> database = make_shared<map<wstring, unsigned int>>();
+    shared_ptr<map<unsigned int, wstring>> databaseRev = make_shared<map<unsigned int, wstring>>();
 
     stringstream ss;
-    ss << database.rdbuf();
+    ss << databaseFile.rdbuf();
 
     // Compiler dependent!
     wstring_convert< codecvt_utf8<wchar_t> > utfconv;
@@ -85,9 +103,9 @@ bool fco::Init()
         index = keyEndIndex;
 
         // Insert symbol to int mapping
-        if (m_database.find(key) == m_database.end())
+        if (database->find(key) == database->end())
         {
-            m_database[key] = value;
+            (*database)[key] = value;
         }
         else
         {
@@ -98,14 +116,14 @@ bool fco::Init()
             {
                 printf("%02X", c);
             }
-            unsigned int existEncoding = m_database[key];
+            unsigned int existEncoding = (*database)[key];
             printf(" with 0x%08X encoding exist at 0x%08X\n", value, existEncoding);
         }
 
         // Insert int to symbol mapping
-        if (m_databaseRev.find(value) == m_databaseRev.end())
+        if (databaseRev->find(value) == databaseRev->end())
         {
-            m_databaseRev[value] = key;
+            (*databaseRev)[value] = key;
         }
         else
         {
@@ -119,22 +137,28 @@ bool fco::Init()
 
     // Hardcode line break
     wstring lineBreak(L"\n");
-    m_database[lineBreak] = 0x00000000;
-    m_databaseRev[0x00000000] = lineBreak;
+    (*database)[lineBreak] = 0x00000000;
+    (*databaseRev)[0x00000000] = lineBreak;
 
-    database.close();
+    databaseFile.close();
+    m_database = database;
+    m_databaseRev = databaseRev;
     return true;
 }
 
 //-----------------------------------------------------
-// Load an fco file, return false if fail
+// Load an fco file, return false if fail or cancelled
 //-----------------------------------------------------
 bool fco::Load
 (
     string const& _fileName,
-    string& _errorMsg
+    string& _errorMsg,
+    LoadProgress const& _progress,
+    atomic<bool> const* _cancel
 )
 {
+    TRACE_SCOPE("fco", "Load");
+
     FILE* fcoFile;
     fopen_s(&fcoFile, _fileName.c_str(), "rb");
     if (!fcoFile)
@@ -143,6 +167,10 @@ bool fco::Load
         return false;
     }
 
+    // File size for progress
+    fseek(fcoFile, 0, SEEK_END);
+    long const fileSize = ftell(fcoFile);
+
     // Header
     fseek(fcoFile, 0x0C, SEEK_SET);
 
@@ -163,6 +191,14 @@ bool fco::Load
         subgroup.m_subtitles.reserve(subtitlesCount);
         for (unsigned int j = 0; j < subtitlesCount; j++)
         {
+            if (_cancel && *_cancel)
+            {
+                _errorMsg = "Loading cancelled.";
+                m_subgroups.clear();
+                fclose(fcoFile);
+                return false;
+            }
+
             Subtitle subtitle;
             subtitle.m_label = ReadAscii(fcoFile);
 
@@ -175,17 +211,18 @@ bool fco::Load
                 if (encodedInt != 0x00000004)
                 {
                     // Ignore premature termination of text
-                    if (m_databaseRev.find(encodedInt) == m_databaseRev.end())
+                    if (m_databaseRev->find(encodedInt) == m_databaseRev->end())
                     {
                         char buff[200];
                         snprintf(buff, sizeof(buff), "0x%08x is missing reference symbol, find the respective character in All.fte and update fcoDatabase.txt.\n", encodedInt);
                         _errorMsg = buff;
                         m_subgroups.clear();
+                        fclose(fcoFile);
                         return false;
                         //encodedInt = m_database[L"?"];
                     }
 
-                    subtitle.m_subtitle.append(m_databaseRev[encodedInt]);
+                    subtitle.m_subtitle.append(m_databaseRev->at(encodedInt));
                     subtitle.m_subtitleSize++;
                 }
             }
@@ -230,6 +267,11 @@ bool fco::Load
 
             // Store subtitle
             subgroup.m_subtitles.push_back(subtitle);
+
+            if (_progress)
+            {
+                _progress(ftell(fcoFile), fileSize);
+            }
         }
 
         // Store sub group
@@ -241,6 +283,33 @@ bool fco::Load
     return true;
 }
 
+//-----------------------------------------------------
+// Read the main group name and sub group count only
+//-----------------------------------------------------
+bool fco::ReadHeader
+(
+    string const& _fileName,
+    string& _groupName,
+    unsigned int& _subgroupCount
+)
+{
+    FILE* fcoFile;
+    fopen_s(&fcoFile, _fileName.c_str(), "rb");
+    if (!fcoFile)
+    {
+        return false;
+    }
+
+    // Same layout as Load()
+    fseek(fcoFile, 0x0C, SEEK_SET);
+    _groupName = ReadAscii(fcoFile);
+    _subgroupCount = ReadInt(fcoFile);
+
+    bool const valid = !ferror(fcoFile) && !feof(fcoFile);
+    fclose(fcoFile);
+    return valid;
+}
+
 //-----------------------------------------------------
 // Read an int from 4 bytes
 //-----------------------------------------------------
@@ -287,53 +356,88 @@ string fco::ReadAscii
 }
 
 //-----------------------------------------------------
-// Save an fco file
+// Save an fco file, nothing is written if the document
+// can't be encoded
 //-----------------------------------------------------
 bool fco::Save
 (
     string const& _fileName,
     string& _errorMsg
-)
+) const
 {
+    TRACE_SCOPE("fco", "Save");
+
+    string bytes;
+    if (!Serialize(bytes, _errorMsg))
+    {
+        return false;
+    }
+
     FILE* output;
     fopen_s(&output, _fileName.c_str(), "wb");
+    if (!output)
+    {
+        _errorMsg = "Unable to write file!";
+        return false;
+    }
+
+    bool const written = fwrite(bytes.data(), 1, bytes.size(), output) == bytes.size();
+    fclose(output);
+    if (!written)
+    {
+        _errorMsg = "Unable to write file!";
+        return false;
+    }
+
+    return true;
+}
+
+//-----------------------------------------------------
+// Encode the document as the bytes of an fco file
+//-----------------------------------------------------
+bool fco::Serialize
+(
+    string& _bytes,
+    string& _errorMsg
+) const
+{
+    _bytes.clear();
 
     // Header
-    WriteInt(output, 0x04);
-    WriteInt(output, 0x01);
-    WriteInt(output, 0x01);
+    WriteInt(_bytes, 0x04);
+    WriteInt(_bytes, 0x01);
+    WriteInt(_bytes, 0x01);
 
     // Group Name
-    WriteAscii(output, m_groupName);
+    WriteAscii(_bytes, m_groupName);
 
     // Write each sub-groups
-    WriteInt(output, m_subgroups.size());
+    WriteInt(_bytes, m_subgroups.size());
     for (unsigned int subgroupID = 0; subgroupID < m_subgroups.size(); subgroupID++)
     {
-        Subgroup& subgroup = m_subgroups[subgroupID];
+        Subgroup const& subgroup = m_subgroups[subgroupID];
 
         // Sub-group name
-        WriteAscii(output, subgroup.m_name);
+        WriteAscii(_bytes, subgroup.m_name);
 
         // Write each subtitles
-        WriteInt(output, subgroup.m_subtitles.size());
+        WriteInt(_bytes, subgroup.m_subtitles.size());
         for (unsigned int subtitleID = 0; subtitleID < subgroup.m_subtitles.size(); subtitleID++)
         {
-            Subtitle& subtitle = subgroup.m_subtitles[subtitleID];
+            Subtitle const& subtitle = subgroup.m_subtitles[subtitleID];
 
             // Subtitle label
-            WriteAscii(output, subtitle.m_label);
+            WriteAscii(_bytes, subtitle.m_label);
 
             // Subtitle size check
             /*if (subtitle.m_subtitle.size() == 0)
             {
-                fclose(output);
                 _errorMsg = "(GroupID: " + to_string(subgroupID) + ", SubtitleID: " + to_string(subtitleID) + ") Subtitle cannot be empty!\n";
                 return false;
             }*/
 
             // Write each symbols
-            WriteInt(output, subtitle.m_subtitleSize);
+            WriteInt(_bytes, subtitle.m_subtitleSize);
             unsigned int index = 0;
             while(index < subtitle.m_subtitle.size())
             {
@@ -349,7 +453,6 @@ bool fco::Save
                     }
                     else
                     {
-                        fclose(output);
                         _errorMsg = "(GroupID: " + to_string(subgroupID) + ", SubtitleID: " + to_string(subtitleID) + ") Error in special character formating, must be \\xxxx\\!\n";
                         return false;
                     }
@@ -361,13 +464,13 @@ bool fco::Save
                 }
 
                 // Retrieve and write encoded int
-                if (m_database.find(subString) != m_database.end())
+                map<wstring, unsigned int>::const_iterator encoding = m_database->find(subString);
+                if (encoding != m_database->end())
                 {
-                    WriteInt(output, m_database[subString]);
+                    WriteInt(_bytes, encoding->second);
                 }
                 else
                 {
-                    fclose(output);
                     _errorMsg = "(GroupID: " + to_string(subgroupID) + ", SubtitleID: " + to_string(subtitleID) + ") Unsupported character found at index " + to_string(index) + "!\n";
                     return false;
                 }
@@ -376,7 +479,7 @@ bool fco::Save
             }
 
             // 00 00 00 04 Termination
-            WriteInt(output, 0x04);
+            WriteInt(_bytes, 0x04);
 
             // Write unknown data, update size blocks
             unsigned char charBuffer[4];
@@ -396,33 +499,34 @@ bool fco::Save
             unknownData[0x0E] = static_cast<unsigned char>(subtitle.m_defaultColor.g);
             unknownData[0x0F] = static_cast<unsigned char>(subtitle.m_defaultColor.b);
 
-            fwrite(unknownData, 1, 0x40, output);
+            _bytes.append(reinterpret_cast<char const*>(unknownData), 0x40);
 
-            // Write each color blocks
-            WriteInt(output, subtitle.m_colorBlocks.size());
-            for (unsigned int colorBlockID = 0; colorBlockID < subtitle.m_colorBlocks.size(); colorBlockID++)
+            // Write each color blocks, overlapping and redundant blocks are merged
+            vector<ColorBlock> colorBlocks = subtitle.m_colorBlocks;
+            NormalizeColorBlocks(colorBlocks, subtitle.m_subtitleSize);
+            WriteInt(_bytes, colorBlocks.size());
+            for (unsigned int colorBlockID = 0; colorBlockID < colorBlocks.size(); colorBlockID++)
             {
-                ColorBlock& colorBlock = subtitle.m_colorBlocks[colorBlockID];
+                ColorBlock const& colorBlock = colorBlocks[colorBlockID];
 
-                WriteInt(output, colorBlock.m_start);
-                WriteInt(output, colorBlock.m_end);
+                WriteInt(_bytes, colorBlock.m_start);
+                WriteInt(_bytes, colorBlock.m_end);
 
                 // 00 00 00 02 Unknown data
-                WriteInt(output, 0x02);
+                WriteInt(_bytes, 0x02);
 
                 // Write ARGB value
-                fwrite(&colorBlock.m_color.a, 1, 1, output);
-                fwrite(&colorBlock.m_color.r, 1, 1, output);
-                fwrite(&colorBlock.m_color.g, 1, 1, output);
-                fwrite(&colorBlock.m_color.b, 1, 1, output);
+                _bytes.push_back(static_cast<char>(colorBlock.m_color.a));
+                _bytes.push_back(static_cast<char>(colorBlock.m_color.r));
+                _bytes.push_back(static_cast<char>(colorBlock.m_color.g));
+                _bytes.push_back(static_cast<char>(colorBlock.m_color.b));
             }
 
             // 00 00 00 00 Termination?
-            WriteInt(output, 0x00);
+            WriteInt(_bytes, 0x00);
         }
     }
 
-    fclose(output);
     return true;
 }
 
@@ -431,12 +535,12 @@ bool fco::Save
 //-----------------------------------------------------
 void fco::WriteInt
 (
-    FILE * _file,
+    string& _bytes,
     unsigned int _writeInt
 )
 {
     _writeInt = _byteswap_ulong(_writeInt);
-    fwrite(&_writeInt, sizeof(unsigned int), 1, _file);
+    _bytes.append(reinterpret_cast<char const*>(&_writeInt), sizeof(unsigned int));
 }
 
 //-----------------------------------------------------
@@ -444,27 +548,22 @@ void fco::WriteInt
 //-----------------------------------------------------
 void fco::WriteAscii
 (
-    FILE * _file,
-    string _writeString
+    string& _bytes,
+    string const& _writeString
 )
 {
     // Write length
     unsigned int stringLength = _writeString.size();
-    WriteInt(_file, stringLength);
+    WriteInt(_bytes, stringLength);
 
     // Write ascii bytes
-    char *stringBuffer = new char[stringLength + 1];
-    strcpy_s(stringBuffer, stringLength + 1, _writeString.c_str());
-    fwrite(stringBuffer, 1, stringLength, _file);
+    _bytes.append(_writeString);
 
     // Write @ paddings
-    while (ftell(_file) % 0x04 != 0x00)
+    while (_bytes.size() % 0x04 != 0x00)
     {
-        char padding = '@';
-        fwrite(&padding, 1, 1, _file);
+        _bytes.push_back('@');
     }
-
-    delete[] stringBuffer;
 }
 
 
@@ -505,6 +604,8 @@ bool fco::ValidateString
     vector<wstring>& _characterArray
 )
 {
+    TRACE_SCOPE("fco", "ValidateString");
+
     _characterArray.clear();
 
     // Size check
@@ -541,7 +642,7 @@ bool fco::ValidateString
         }
 
         // Retrieve from database
-        if (m_database.find(subString) == m_database.end())
+        if (m_database->find(subString) == m_database->end())
         {
             _errorMsg = L"Unsupported character \"" + subString + L"\"";
             _characterArray.clear();
@@ -555,6 +656,17 @@ bool fco::ValidateString
     return true;
 }
 
+//-----------------------------------------------------
+// Check a single symbol (character or \xxxx\) against the database
+//-----------------------------------------------------
+bool fco::IsSymbolSupported
+(
+    wstring const& _symbol
+) const
+{
+    return m_database->find(_symbol) != m_database->end();
+}
+
 //-----------------------------------------------------
 // Retrieve all sub-group names (for toolbar)
 //-----------------------------------------------------
@@ -570,6 +682,47 @@ void fco::GetGroupNames
     }
 }
 
+//-----------------------------------------------------
+// Number of sub-groups
+//-----------------------------------------------------
+unsigned int fco::GetGroupCount()
+{
+    return m_subgroups.size();
+}
+
+//-----------------------------------------------------
+// Retrieve one sub-group name
+//-----------------------------------------------------
+string fco::GetGroupName
+(
+    unsigned int _subgroupID
+)
+{
+    string str;
+    if (_subgroupID < m_subgroups.size())
+    {
+        str = m_subgroups[_subgroupID].m_name;
+    }
+
+    return str;
+}
+
+//-----------------------------------------------------
+// Number of subtitles in a sub-group
+//-----------------------------------------------------
+unsigned int fco::GetSubtitleCount
+(
+    unsigned int _subgroupID
+)
+{
+    if (_subgroupID < m_subgroups.size())
+    {
+        return m_subgroups[_subgroupID].m_subtitles.size();
+    }
+
+    return 0;
+}
+
 //-----------------------------------------------------
 // Retrieve all subtitles of a sub-group (for toolbar)
 //-----------------------------------------------------
@@ -663,6 +816,102 @@ void fco::GetSubtitleColorBlocks
     }
 }
 
+//-----------------------------------------------------
+// Sweep block boundaries, the active block with the
+// highest ID owns each span until the next boundary
+//-----------------------------------------------------
+void fco::ResolveColorRuns
+(
+    vector<ColorBlock> const& _colorBlocks,
+    unsigned int _symbolCount,
+    vector<ColorRun>& _colorRuns
+)
+{
+    _colorRuns.clear();
+    if (_symbolCount == 0) return;
+
+    // Clip blocks to the text, empty ones never become active
+    vector<unsigned int> ends(_colorBlocks.size());
+    vector<pair<unsigned int, int>> starts;
+    vector<unsigned int> boundaries;
+    starts.reserve(_colorBlocks.size());
+    boundaries.reserve(_colorBlocks.size() * 2 + 2);
+    boundaries.push_back(0);
+    boundaries.push_back(_symbolCount);
+    for (unsigned int id = 0; id < _colorBlocks.size(); id++)
+    {
+        ColorBlock const& colorBlock = _colorBlocks[id];
+        ends[id] = min(colorBlock.m_end, _symbolCount - 1);
+        if (colorBlock.m_start > ends[id]) continue;
+
+        starts.push_back(pair<unsigned int, int>(colorBlock.m_start, static_cast<int>(id)));
+        boundaries.push_back(colorBlock.m_start);
+        boundaries.push_back(ends[id] + 1);
+    }
+    sort(starts.begin(), starts.end());
+    sort(boundaries.begin(), boundaries.end());
+    boundaries.erase(unique(boundaries.begin(), boundaries.end()), boundaries.end());
+
+    // Blocks that ended are only dropped once they reach the top
+    priority_queue<int> active;
+    size_t nextStart = 0;
+    for (size_t i = 0; i + 1 < boundaries.size(); i++)
+    {
+        unsigned int const position = boundaries[i];
+        while (nextStart < starts.size() && starts[nextStart].first <= position)
+        {
+            active.push(starts[nextStart].second);
+            nextStart++;
+        }
+        while (!active.empty() && ends[static_cast<size_t>(active.top())] < position)
+        {
+            active.pop();
+        }
+
+        int const id = active.empty() ? -1 : active.top();
+        if (!_colorRuns.empty() && _colorRuns.back().m_colorBlockID == id)
+        {
+            _colorRuns.back().m_end = boundaries[i + 1] - 1;
+        }
+        else
+        {
+            _colorRuns.push_back(ColorRun(position, boundaries[i + 1] - 1, id));
+        }
+    }
+}
+
+//-----------------------------------------------------
+// Rewrite blocks as the visible runs, in order and
+// without overlaps, merging neighbours of equal color
+//-----------------------------------------------------
+void fco::NormalizeColorBlocks
+(
+    vector<ColorBlock>& _colorBlocks,
+    unsigned int _symbolCount
+)
+{
+    vector<ColorRun> colorRuns;
+    ResolveColorRuns(_colorBlocks, _symbolCount, colorRuns);
+
+    vector<ColorBlock> normalized;
+    for (ColorRun const& colorRun : colorRuns)
+    {
+        if (colorRun.m_colorBlockID == -1) continue;
+
+        Color const& color = _colorBlocks[static_cast<size_t>(colorRun.m_colorBlockID)].m_color;
+        if (!normalized.empty() && normalized.back().m_end + 1 == colorRun.m_start && normalized.back().m_color == color)
+        {
+            normalized.back().m_end = colorRun.m_end;
+        }
+        else
+        {
+            normalized.push_back(ColorBlock(colorRun.m_start, colorRun.m_end, color));
+        }
+    }
+
+    _colorBlocks.swap(normalized);
+}
+
 //-----------------------------------------------------
 // Add a new group at the buttom
 //-----------------------------------------------------
@@ -699,9 +948,7 @@ void fco::SwapGroup(unsigned int _subgroupID1, unsigned int _subgroupID2)
 {
     if (_subgroupID1 < m_subgroups.size() && _subgroupID2 < m_subgroups.size())
     {
-        Subgroup temp = m_subgroups[_subgroupID1];
-        m_subgroups[_subgroupID1] = m_subgroups[_subgroupID2];
-        m_subgroups[_subgroupID2] = temp;
+        swap(m_subgroups[_subgroupID1], m_subgroups[_subgroupID2]);
     }
 }
 
@@ -772,9 +1019,7 @@ void fco::SwapSubtitle(unsigned int _subgroupID, unsigned int _subtitleID1, unsi
         Subgroup& subgroup = m_subgroups[_subgroupID];
         if (_subtitleID1 < subgroup.m_subtitles.size() && _subtitleID2 < subgroup.m_subtitles.size())
         {
-            Subtitle temp = subgroup.m_subtitles[_subtitleID1];
-            subgroup.m_subtitles[_subtitleID1] = subgroup.m_subtitles[_subtitleID2];
-            subgroup.m_subtitles[_subtitleID2] = temp;
+            swap(subgroup.m_subtitles[_subtitleID1], subgroup.m_subtitles[_subtitleID2]);
         }
     }
 }
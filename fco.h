@@ -5,8 +5,11 @@
 //-----------------------------------------------------
 
 #pragma once
+#include <atomic>
+#include <functional>
 #include <string>
 #include <map>
+#include <memory>
 #include <vector>
 
 using namespace std;
@@ -26,6 +29,8 @@ public:
         void SetWhite() { r = 0xFF; g = 0xFF; b = 0xFF; }
         void SetBlack() { r = 0x01; g = 0x00; b = 0x00; }
 
+        bool operator==(Color const& _other) const { return r == _other.r && g == _other.g && b == _other.b && a == _other.a; }
+
         unsigned char r;
         unsigned char g;
         unsigned char b;
@@ -43,26 +48,53 @@ public:
         Color m_color;
     };
 
+    // Symbols [m_start, m_end] shown with one color block, blocks
+    // overlap with the later one winning, runs never overlap
+    struct ColorRun
+    {
+        ColorRun(unsigned int _start, unsigned int _end, int _colorBlockID)
+            : m_start(_start), m_end(_end), m_colorBlockID(_colorBlockID) {}
+
+        unsigned int m_start;
+        unsigned int m_end;
+        int m_colorBlockID;     // -1 for the default color
+    };
+
+    // Bytes read so far and file size
+    typedef function<void(long, long)> LoadProgress;
+
 public:
     fco();
+    explicit fco(fco const* _database);
     ~fco();
 
     bool IsInit() { return m_init; }
     bool IsLoaded() { return m_loaded; }
 
     // Import & Export
-    bool Load(string const& _fileName, string& _errorMsg);
-    bool Save(string const& _fileName, string& _errorMsg);
+    bool Load(string const& _fileName, string& _errorMsg, LoadProgress const& _progress = nullptr, atomic<bool> const* _cancel = nullptr);
+    static bool ReadHeader(string const& _fileName, string& _groupName, unsigned int& _subgroupCount);
+    bool Save(string const& _fileName, string& _errorMsg) const;
+    bool Serialize(string& _bytes, string& _errorMsg) const;
 
     // Helpers
     bool Search(wstring const& _wstring, unsigned int& _subgroupID, unsigned int& _subtitleID);
     bool ValidateString(wstring const& _wstring, wstring& _errorMsg, vector<wstring>& _characterArray);
+    bool IsSymbolSupported(wstring const& _symbol) const;
+    string const& GetFileGroupName() const { return m_groupName; }
     void GetGroupNames(vector<string>& _groupNames);
+    unsigned int GetGroupCount();
+    string GetGroupName(unsigned int _subgroupID);
+    unsigned int GetSubtitleCount(unsigned int _subgroupID);
     void GetSubgroupSubtitles(unsigned int _subgroupID, vector<string>& _labels, vector<wstring>& _subtitles);
     string GetLabel(unsigned int _subgroupID, unsigned int _subtitleID);
     wstring GetSubtitle(unsigned int _subgroupID, unsigned int _subtitleID);
     void GetSubtitleColorBlocks(unsigned int _subgroupID, unsigned int _subtitleID, vector<ColorBlock>& _colorBlocks);
 
+    // Color spans
+    static void ResolveColorRuns(vector<ColorBlock> const& _colorBlocks, unsigned int _symbolCount, vector<ColorRun>& _colorRuns);
+    static void NormalizeColorBlocks(vector<ColorBlock>& _colorBlocks, unsigned int _symbolCount);
+
     // Modifiers for subtitles
     void AddGroup();
     void DeleteGroup(unsigned int _subgroupID);
@@ -92,16 +124,17 @@ private:
     void GenerateDatabase();
 
     // Reading from bytes
-    unsigned int ReadInt(FILE* _file);
-    string ReadAscii(FILE* _file);
+    static unsigned int ReadInt(FILE* _file);
+    static string ReadAscii(FILE* _file);
 
     // Writing bytes
-    void WriteInt(FILE* _file, unsigned int _writeInt);
-    void WriteAscii(FILE* _file, string _writeString);
+    static void WriteInt(string& _bytes, unsigned int _writeInt);
+    static void WriteAscii(string& _bytes, string const& _writeString);
 
 private:
-    map<wstring, unsigned int> m_database;
-    map<unsigned int, wstring> m_databaseRev;
+    // Shared by every document and copy, never changed after Init
+    shared_ptr<map<wstring, unsigned int> const> m_database;
+    shared_ptr<map<unsigned int, wstring> const> m_databaseRev;
 
     bool m_init;
     bool m_loaded;
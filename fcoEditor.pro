@@ -5,7 +5,7 @@
 #-------------------------------------------------
 
 QT       += core gui
-QT       += xml
+QT       += concurrent
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
@@ -25,22 +25,62 @@ DEFINES += QT_DEPRECATED_WARNINGS
 
 
 SOURCES += \
+    atlaspacker.cpp \
+    cap.cpp \
+    captionchecker.cpp \
+    captionframeindex.cpp \
+    captionmodel.cpp \
+    captionreferences.cpp \
+    captionreport.cpp \
+    captionretime.cpp \
+    captionretimedialog.cpp \
+    captiontimeline.cpp \
+    colorblockmodel.cpp \
     databasegenerator.cpp \
+    ddsreader.cpp \
+    ddswriter.cpp \
     eventcaptioneditor.cpp \
     fte.cpp \
         main.cpp \
         fcoeditorwindow.cpp \
     fco.cpp \
     fcoaboutwindow.cpp \
+    fcoproject.cpp \
+    fcoprojectpanel.cpp \
+    fcotreemodel.cpp \
+    glyphgrid.cpp \
+    subtitlerenderer.cpp \
+    subtitletokenizer.cpp \
+    tracer.cpp \
     zoomgraphicsview.cpp
 
 HEADERS += \
+    atlaspacker.h \
+    cap.h \
+    captionchecker.h \
+    captionframeindex.h \
+    captionmodel.h \
+    captionreferences.h \
+    captionreport.h \
+    captionretime.h \
+    captionretimedialog.h \
+    captiontimeline.h \
+    colorblockmodel.h \
     databasegenerator.h \
+    ddsreader.h \
+    ddswriter.h \
     eventcaptioneditor.h \
         fcoeditorwindow.h \
     fco.h \
     fcoaboutwindow.h \
+    fcoproject.h \
+    fcoprojectpanel.h \
+    fcotreemodel.h \
+    glyphgrid.h \
+    subtitlerenderer.h \
+    subtitletokenizer.h \
     fte.h \
+    tracer.h \
     zoomgraphicsview.h
 
 FORMS += \
@@ -23,6 +23,45 @@ fcoEditorWindow::fcoEditorWindow(QWidget *parent) :
     m_moveGroup = false;
     m_moveSubtitle = false;
 
+    m_loading = false;
+    m_loadingDocument = Q_NULLPTR;
+    m_loadProgress = Q_NULLPTR;
+    m_loadShowSuccess = false;
+    m_loadCancel = false;
+    m_loadRecovered = false;
+    m_loadWatcher = new QFutureWatcher<QString>(this);
+    connect(m_loadWatcher, &QFutureWatcher<QString>::finished, this, &fcoEditorWindow::LoadFinished);
+
+    // Saving and autosave (only when there is something new)
+    m_revision = 0;
+    m_savingRevision = 0;
+    m_autosavedRevision = 0;
+    m_saveWatcher = new QFutureWatcher<QString>(this);
+    connect(m_saveWatcher, &QFutureWatcher<QString>::finished, this, &fcoEditorWindow::SaveFinished);
+    m_autosaveWatcher = new QFutureWatcher<QString>(this);
+    connect(m_autosaveWatcher, &QFutureWatcher<QString>::finished, this, &fcoEditorWindow::AutosaveFinished);
+    m_autosaveTimer = new QTimer(this);
+    m_autosaveTimer->setInterval(60 * 1000);
+    connect(m_autosaveTimer, &QTimer::timeout, this, &fcoEditorWindow::Autosave);
+    m_autosaveTimer->start();
+
+    // Project panel, hidden until a project is opened
+    m_project = Q_NULLPTR;
+    m_projectIndex = -1;
+    m_projectPanel = new fcoProjectPanel(this);
+
+    // Caption references to the labels of every open fco file
+    m_references = new CaptionReferences(this);
+    addDockWidget(Qt::LeftDockWidgetArea, m_projectPanel);
+    m_projectPanel->hide();
+    connect(m_projectPanel, &fcoProjectPanel::FileActivated, this, &fcoEditorWindow::ProjectFileActivated);
+    connect(m_projectPanel, &fcoProjectPanel::ResultActivated, this, &fcoEditorWindow::ProjectResultActivated);
+    connect(m_projectPanel, &fcoProjectPanel::SearchRequested, this, &fcoEditorWindow::ProjectSearchRequested);
+    m_saveAllProgress = Q_NULLPTR;
+    m_saveAllRevision = 0;
+    m_saveAllWatcher = new QFutureWatcher<QString>(this);
+    connect(m_saveAllWatcher, &QFutureWatcher<QString>::finished, this, &fcoEditorWindow::SaveAllFinished);
+
     // Reset relative path to load database correctly
     QDir::setCurrent(QCoreApplication::applicationDirPath());
 
@@ -32,23 +71,48 @@ fcoEditorWindow::fcoEditorWindow(QWidget *parent) :
         UpdateStatus("Missing database file fcoDatabase.txt! Please reinstall!", "color: rgb(255, 0, 0);");
     }
 
+    // Text editor is tokenized as it changes, preview follows shortly after
+    m_tokenizer.SetDatabase(m_fco);
+    m_characterCount = 0;
+    connect(ui->TE_TextEditor->document(), &QTextDocument::contentsChange, this, &fcoEditorWindow::TE_TextEditor_contentsChange);
+    m_previewTimer = new QTimer(this);
+    m_previewTimer->setSingleShot(true);
+    m_previewTimer->setInterval(50);
+    connect(m_previewTimer, &QTimer::timeout, this, &fcoEditorWindow::UpdateSubtitlePreview);
+
     // Create a label layout on top of the subtitle background
     QHBoxLayout* textHLayout = new QHBoxLayout(ui->L_Preview);
     textHLayout->addStretch();
     textHLayout->addStretch();
     QFontDatabase::addApplicationFont(":/resources/FOT-SeuratPro-B.otf");
     m_previewLabel = new QLabel();
-    m_previewLabel->setStyleSheet("font: 21px \"FOT-Seurat Pro B\"; color: white;");
-    m_previewLabel->setTextFormat(Qt::TextFormat::RichText);
     textHLayout->insertWidget(1, m_previewLabel);
 
+    // Preview with the game's glyphs if the font atlas is installed
+    QString atlasError;
+    m_subtitleRenderer.LoadAtlas("All.fte", atlasError);
+
     m_initValue = 0;
     m_mouseY = 0;
     m_dragScale = 0;
     m_dragSpinBox = Q_NULLPTR;
 
     // Tree view
-    ui->TW_TreeWidget->setColumnWidth(1, 52);
+    m_treeModel = new fcoTreeModel(this);
+    m_treeModel->SetDocument(m_fco);
+    ui->TV_TreeView->setModel(m_treeModel);
+    ui->TV_TreeView->setColumnWidth(1, 52);
+
+    // Color blocks
+    m_colorBlockModel = new ColorBlockModel(this);
+    ui->TV_ColorBlocks->setModel(m_colorBlockModel);
+    ui->TV_ColorBlocks->setItemDelegate(new ColorBlockDelegate(this));
+    ui->TV_ColorBlocks->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
+    connect(m_colorBlockModel, &QAbstractItemModel::dataChanged, this, &fcoEditorWindow::ColorBlocksEdited);
+    connect(m_colorBlockModel, &QAbstractItemModel::rowsInserted, this, &fcoEditorWindow::ColorBlocksEdited);
+    connect(m_colorBlockModel, &QAbstractItemModel::rowsRemoved, this, &fcoEditorWindow::ColorBlocksEdited);
+    connect(m_colorBlockModel, &QAbstractItemModel::rowsMoved, this, &fcoEditorWindow::ColorBlocksEdited);
+    connect(ui->TV_ColorBlocks->selectionModel(), &QItemSelectionModel::currentRowChanged, this, &fcoEditorWindow::UpdateColorBlockButtons);
 
     // Default color
     ui->DefaultColor->installEventFilter(this);
@@ -82,6 +146,14 @@ fcoEditorWindow::fcoEditorWindow(QWidget *parent) :
 //---------------------------------------------------------------------------
 fcoEditorWindow::~fcoEditorWindow()
 {
+    // Stop a load in progress, let saves finish writing
+    m_loadCancel = true;
+    m_loadWatcher->waitForFinished();
+    delete m_loadingDocument;
+    m_saveWatcher->waitForFinished();
+    m_autosaveWatcher->waitForFinished();
+    m_saveAllWatcher->waitForFinished();
+
     m_settings->setValue("DefaultDirectory", m_path);
     m_settings->setValue("DefaultSize", this->size());
     delete ui;
@@ -92,13 +164,11 @@ fcoEditorWindow::~fcoEditorWindow()
 //---------------------------------------------------------------------------
 bool fcoEditorWindow::eventFilter(QObject *object, QEvent *event)
 {
-    // Changing a color of a color block
+    // Changing the default color (color blocks use ColorBlockDelegate)
     if (event->type() == QEvent::FocusIn)
     {
         QWidget* colorBrowser = qobject_cast<QWidget*>(object);
-        int index = ui->VL_Color->indexOf(colorBrowser);
-        bool isDefaultColor = (colorBrowser == ui->DefaultColor);
-        if (index != -1 || isDefaultColor)
+        if (colorBrowser == ui->DefaultColor)
         {
             colorBrowser->clearFocus();
             QPalette pal = colorBrowser->palette();
@@ -108,24 +178,11 @@ bool fcoEditorWindow::eventFilter(QObject *object, QEvent *event)
             {
                 // Update color
                 pal.setColor(QPalette::Base, newColor);
-
-                if (isDefaultColor)
-                {
-                    m_defaultColor.r = static_cast<unsigned char>(newColor.red());
-                    m_defaultColor.g = static_cast<unsigned char>(newColor.green());
-                    m_defaultColor.b = static_cast<unsigned char>(newColor.blue());
-                    ui->DefaultColor->setPalette(pal);
-                    if (m_defaultColor.IsHardcoded()) m_defaultColor.r = 0x01;
-                }
-                else
-                {
-                    unsigned int indexMinusOne = static_cast<size_t>(index) - 1;
-                    m_colorBlocks[indexMinusOne].m_color.r = static_cast<unsigned char>(newColor.red());
-                    m_colorBlocks[indexMinusOne].m_color.g = static_cast<unsigned char>(newColor.green());
-                    m_colorBlocks[indexMinusOne].m_color.b = static_cast<unsigned char>(newColor.blue());
-                    colorBrowser->setPalette(pal);
-                    if (m_colorBlocks[indexMinusOne].m_color.IsHardcoded()) m_colorBlocks[indexMinusOne].m_color.r = 0x01;
-                }
+                m_defaultColor.r = static_cast<unsigned char>(newColor.red());
+                m_defaultColor.g = static_cast<unsigned char>(newColor.green());
+                m_defaultColor.b = static_cast<unsigned char>(newColor.blue());
+                ui->DefaultColor->setPalette(pal);
+                if (m_defaultColor.IsHardcoded()) m_defaultColor.r = 0x01;
 
                 // Save & Reset buttons
                 m_colorEdited = true;
@@ -145,14 +202,10 @@ bool fcoEditorWindow::eventFilter(QObject *object, QEvent *event)
         QWidget* widget = qobject_cast<QWidget*>(object);
         m_dragScale = 0;
 
-        if (widget == ui->DefaultAlpha || ui->VL_Alpha->indexOf(widget) != -1)
+        if (widget == ui->DefaultAlpha)
         {
             m_dragScale = 1;
         }
-        else if (ui->VL_Start->indexOf(widget) != -1 || ui->VL_End->indexOf(widget) != -1)
-        {
-            m_dragScale = 6;
-        }
 
         if (m_dragScale != 0)
         {
@@ -195,9 +248,9 @@ bool fcoEditorWindow::eventFilter(QObject *object, QEvent *event)
 //---------------------------------------------------------------------------
 void fcoEditorWindow::closeEvent (QCloseEvent *event)
 {
-    if (m_fco->IsLoaded())
+    if (m_fco->IsLoaded() || m_project)
     {
-        if (!DiscardSaveMessage("Close", "Quit without saving?", true))
+        if (!DiscardSaveMessage("Close", "Quit without saving?", true, true))
         {
             event->ignore();
             return;
@@ -212,6 +265,16 @@ void fcoEditorWindow::closeEvent (QCloseEvent *event)
     {
         m_databaseGenerator->close();
     }
+
+    // Changes were saved or discarded, recovery file is not needed anymore
+    m_autosaveTimer->stop();
+    m_saveWatcher->waitForFinished();
+    m_autosaveWatcher->waitForFinished();
+    m_saveAllWatcher->waitForFinished();
+    if (m_fco->IsLoaded())
+    {
+        QFile::remove(AutosaveFile());
+    }
     event->accept();
 }
 
@@ -292,83 +355,312 @@ void fcoEditorWindow::on_actionOpen_triggered()
 //---------------------------------------------------------------------------
 void fcoEditorWindow::OpenFile(QString const& fcoFile, bool showSuccess)
 {
+    TRACE_SCOPE("ui", "OpenFile");
+
     if (fcoFile.endsWith(".fco"))
     {
+        // One file at a time, until LoadFinished has taken the result
+        if (m_loading)
+        {
+            return;
+        }
+
+        // Files of the open project keep their edits while switching
+        int const projectIndex = m_project ? m_project->FindFile(fcoFile) : -1;
+        if (projectIndex != -1)
+        {
+            m_path = QFileInfo(fcoFile).dir().absolutePath();
+            if (OpenProjectFile(projectIndex) && showSuccess)
+            {
+                QMessageBox::information(this, "Open", "File load successful!", QMessageBox::Ok);
+            }
+            return;
+        }
+
+        // Save finishing later would rename the wrong document
+        if (m_saveWatcher->isRunning())
+        {
+            QMessageBox::information(this, "Open", "Please wait for the current file operation to finish.", QMessageBox::Ok);
+            return;
+        }
+
         // Save directory
         QFileInfo info(fcoFile);
         m_path = info.dir().absolutePath();
 
-        // Load fco file
-        string errorMsg;
-        if (!m_fco->Load(fcoFile.toStdString(), errorMsg))
+        // Offer the autosave if it is newer than the file
+        QString loadFile = fcoFile;
+        QFileInfo recovery(fcoFile + ".autosave");
+        m_loadRecovered = false;
+        if (recovery.exists() && recovery.lastModified() > info.lastModified())
         {
-            ui->TW_TreeWidget->clear();
+            QMessageBox::StandardButton resBtn = QMessageBox::question(this, "Open", "Unsaved changes of this file were recovered from an autosave, open them instead?", QMessageBox::Yes | QMessageBox::No, QMessageBox::Yes);
+            if (resBtn == QMessageBox::Yes)
+            {
+                loadFile = recovery.filePath();
+                m_loadRecovered = true;
+            }
+        }
 
-            // Reset search bar
-            ui->RB_Top->setChecked(true);
+        // Parse into a new document on a worker thread, the current one is kept until it is done
+        m_loading = true;
+        m_loadingDocument = new fco(m_fco);
+        m_loadingFile = fcoFile;
+        m_loadShowSuccess = showSuccess;
+        m_loadCancel = false;
+
+        m_loadProgress = new QProgressDialog("Loading " + info.fileName() + "...", "Cancel", 0, 100, this);
+        m_loadProgress->setWindowTitle("Open");
+        m_loadProgress->setWindowModality(Qt::WindowModal);
+        m_loadProgress->setMinimumDuration(500);
+        m_loadProgress->setAutoReset(false);
+        m_loadProgress->setAutoClose(false);
+        m_loadProgress->setValue(0);
+        connect(m_loadProgress, &QProgressDialog::canceled, this, [this]()
+        {
+            m_loadCancel = true;
+        });
 
-            // Enable widgets
-            ui->PB_Find->setEnabled(false);
-            ui->PB_Expand->setEnabled(false);
-            ui->PB_Collapse->setEnabled(false);
-            ui->LE_Find->setEnabled(false);
+        fco* document = m_loadingDocument;
+        string const fileName = loadFile.toStdString();
+        m_loadWatcher->setFuture(QtConcurrent::run([this, document, fileName]() -> QString
+        {
+            // Only post when the percentage changes
+            int lastPercent = -1;
+            auto progress = [this, &lastPercent](long _done, long _total)
+            {
+                int const percent = (_total > 0) ? static_cast<int>(static_cast<long long>(_done) * 100 / _total) : 0;
+                if (percent != lastPercent)
+                {
+                    lastPercent = percent;
+                    QMetaObject::invokeMethod(this, [this, percent]()
+                    {
+                        if (m_loadProgress) m_loadProgress->setValue(percent);
+                    }, Qt::QueuedConnection);
+                }
+            };
 
-            ResetSubtitleEditor();
+            string errorMsg;
+            if (!document->Load(fileName, errorMsg, progress, &m_loadCancel))
+            {
+                return QString::fromStdString(errorMsg);
+            }
+            return QString();
+        }));
+    }
+    else
+    {
+        QMessageBox::critical(this, "Error", "Unsupported format!", QMessageBox::Ok);
+    }
+}
+
+//---------------------------------------------------------------------------
+// Worker finished parsing, swap the new document in
+//---------------------------------------------------------------------------
+void fcoEditorWindow::LoadFinished()
+{
+    TRACE_SCOPE("ui", "LoadFinished");
+
+    QString const errorMsg = m_loadWatcher->result();
+    m_loading = false;
+    m_loadProgress->deleteLater();
+    m_loadProgress = Q_NULLPTR;
+
+    // Cancelled, the current document stays as it was
+    if (m_loadCancel)
+    {
+        delete m_loadingDocument;
+        m_loadingDocument = Q_NULLPTR;
+        return;
+    }
+
+    // Detach the old document from the tree before deleting it, project documents go back to the project
+    m_treeModel->SetDocument(Q_NULLPTR);
+    if (m_projectIndex != -1)
+    {
+        m_project->ReturnDocument(m_projectIndex, m_fco, m_fileEdited);
+        m_projectIndex = -1;
+        m_projectPanel->SetCurrentFile(-1);
+    }
+    else
+    {
+        delete m_fco;
+    }
+    m_fco = m_loadingDocument;
+    m_loadingDocument = Q_NULLPTR;
+    m_tokenizer.SetDatabase(m_fco);
 
-            // Reset Tree View
-            ui->PB_NewGroup->setEnabled(false);
-            ui->PB_NewSubtitle->setEnabled(false);
-            ui->PB_DeleteGroup->setEnabled(false);
-            ui->PB_DeleteSubtitle->setEnabled(false);
-            ui->PB_GroupUp->setEnabled(false);
-            ui->PB_GroupDown->setEnabled(false);
-            ui->PB_SubtitleUp->setEnabled(false);
-            ui->PB_SubtitleDown->setEnabled(false);
+    if (!errorMsg.isEmpty())
+    {
+        // Reset search bar
+        ui->RB_Top->setChecked(true);
+
+        // Enable widgets
+        ui->PB_Find->setEnabled(false);
+        ui->PB_Expand->setEnabled(false);
+        ui->PB_Collapse->setEnabled(false);
+        ui->LE_Find->setEnabled(false);
 
-            m_fileName = "";
-            ui->L_FileName->setText("File Name: ---");
+        ResetSubtitleEditor();
 
-            QMessageBox::critical(this, "Error", QString::fromStdString(errorMsg), QMessageBox::Ok);
+        // Reset Tree View
+        ui->PB_NewGroup->setEnabled(false);
+        ui->PB_NewSubtitle->setEnabled(false);
+        ui->PB_DeleteGroup->setEnabled(false);
+        ui->PB_DeleteSubtitle->setEnabled(false);
+        ui->PB_GroupUp->setEnabled(false);
+        ui->PB_GroupDown->setEnabled(false);
+        ui->PB_SubtitleUp->setEnabled(false);
+        ui->PB_SubtitleDown->setEnabled(false);
+
+        m_fileName = "";
+        ui->L_FileName->setText("File Name: ---");
+        m_references->SetDocumentLabels(QString(), QVector<fcoProject::Label>());
+
+        QMessageBox::critical(this, "Error", errorMsg, QMessageBox::Ok);
+    }
+    else
+    {
+        ShowDocument(m_loadingFile);
+
+        // Recovered changes still need saving
+        m_autosavedRevision = m_revision;
+        if (m_loadRecovered)
+        {
+            MarkFileEdited();
         }
-        else
+
+        if (m_loadShowSuccess)
         {
-            // Reset search bar
-            ui->RB_Top->setChecked(true);
-
-            // Enable widgets
-            ui->PB_Find->setEnabled(true);
-            ui->PB_Expand->setEnabled(true);
-            ui->PB_Collapse->setEnabled(true);
-            ui->LE_Find->setEnabled(true);
-
-            ResetSubtitleEditor();
-
-            // Reset Tree View
-            ui->PB_NewGroup->setEnabled(true);
-            ui->PB_NewSubtitle->setEnabled(false);
-            ui->PB_DeleteGroup->setEnabled(false);
-            ui->PB_DeleteSubtitle->setEnabled(false);
-            ui->PB_GroupUp->setEnabled(false);
-            ui->PB_GroupDown->setEnabled(false);
-            ui->PB_SubtitleUp->setEnabled(false);
-            ui->PB_SubtitleDown->setEnabled(false);
-            TW_Refresh();
-
-            m_fileName = fcoFile;
-            int index = m_fileName.lastIndexOf('/');
-            if (index == -1) index = m_fileName.lastIndexOf('\\');
-            ui->L_FileName->setText("File Name: " + m_fileName.mid(index + 1));
-
-            if (showSuccess)
-            {
-                QMessageBox::information(this, "Open", "File load successful!", QMessageBox::Ok);
-            }
+            QMessageBox::information(this, "Open", "File load successful!", QMessageBox::Ok);
         }
     }
-    else
+}
+
+//---------------------------------------------------------------------------
+// Switch to a file of the project, the current one keeps its edits
+//---------------------------------------------------------------------------
+bool fcoEditorWindow::OpenProjectFile(int _fileIndex)
+{
+    TRACE_SCOPE("ui", "OpenProjectFile");
+
+    if (_fileIndex == m_projectIndex)
     {
-        QMessageBox::critical(this, "Error", "Unsupported format!", QMessageBox::Ok);
+        return true;
+    }
+
+    // Save finishing later would rename the wrong document
+    if (m_loading || m_saveWatcher->isRunning())
+    {
+        QMessageBox::information(this, "Open", "Please wait for the current file operation to finish.", QMessageBox::Ok);
+        return false;
+    }
+
+    // Standalone documents are lost, project documents are not
+    if (!DiscardSaveMessage("Open", "You have unsaved changes, continue without saving?", true))
+    {
+        return false;
+    }
+
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    int const previousIndex = m_projectIndex;
+    if (previousIndex != -1)
+    {
+        m_project->ReturnDocument(previousIndex, m_fco, m_fileEdited);
+    }
+
+    QString errorMsg;
+    fco* document = m_project->TakeDocument(_fileIndex, errorMsg);
+    QApplication::restoreOverrideCursor();
+    if (!document)
+    {
+        // Keep editing the previous file
+        if (previousIndex != -1)
+        {
+            QString retakeError;
+            m_fco = m_project->TakeDocument(previousIndex, retakeError);
+        }
+        QMessageBox::critical(this, "Error", errorMsg, QMessageBox::Ok);
+        return false;
+    }
+
+    m_treeModel->SetDocument(Q_NULLPTR);
+    if (previousIndex == -1)
+    {
+        delete m_fco;
+    }
+    m_fco = document;
+    m_projectIndex = _fileIndex;
+    m_tokenizer.SetDatabase(m_fco);
+
+    fcoProject::File const& file = m_project->GetFile(_fileIndex);
+    ShowDocument(file.m_fileName);
+    m_fileEdited = file.m_dirty;
+    m_autosavedRevision = m_revision;
+    m_projectPanel->SetCurrentFile(_fileIndex);
+    return true;
+}
+
+//---------------------------------------------------------------------------
+// Reset the editor for a newly opened document
+//---------------------------------------------------------------------------
+void fcoEditorWindow::ShowDocument(QString const& _fileName)
+{
+    // Reset search bar
+    ui->RB_Top->setChecked(true);
+
+    // Enable widgets
+    ui->PB_Find->setEnabled(true);
+    ui->PB_Expand->setEnabled(true);
+    ui->PB_Collapse->setEnabled(true);
+    ui->LE_Find->setEnabled(true);
+
+    ResetSubtitleEditor();
+
+    // Reset Tree View
+    ui->PB_NewGroup->setEnabled(true);
+    ui->PB_NewSubtitle->setEnabled(false);
+    ui->PB_DeleteGroup->setEnabled(false);
+    ui->PB_DeleteSubtitle->setEnabled(false);
+    ui->PB_GroupUp->setEnabled(false);
+    ui->PB_GroupDown->setEnabled(false);
+    ui->PB_SubtitleUp->setEnabled(false);
+    ui->PB_SubtitleDown->setEnabled(false);
+    m_treeModel->SetDocument(m_fco);
+
+    m_fileName = _fileName;
+    int index = m_fileName.lastIndexOf('/');
+    if (index == -1) index = m_fileName.lastIndexOf('\\');
+    ui->L_FileName->setText("File Name: " + m_fileName.mid(index + 1));
+
+    UpdateReferenceLabels();
+}
+
+//---------------------------------------------------------------------------
+// Re-index the labels of the open document for caption references
+//---------------------------------------------------------------------------
+void fcoEditorWindow::UpdateReferenceLabels()
+{
+    m_references->SetDocumentLabels(m_fileName, fcoProject::CollectLabels(m_fco));
+}
+
+//---------------------------------------------------------------------------
+// Labels of one group changed, the rest of the document is not collected
+//---------------------------------------------------------------------------
+void fcoEditorWindow::UpdateReferenceGroup(unsigned int _groupID)
+{
+    m_references->SetGroup(_groupID, QString::fromStdString(m_fco->GetGroupName(_groupID)), GetGroupLabels(_groupID));
+}
+
+QStringList fcoEditorWindow::GetGroupLabels(unsigned int _groupID)
+{
+    QStringList labels;
+    unsigned int const count = m_fco->GetSubtitleCount(_groupID);
+    for (unsigned int subtitleID = 0; subtitleID < count; subtitleID++)
+    {
+        labels << QString::fromStdString(m_fco->GetLabel(_groupID, subtitleID));
     }
+    return labels;
 }
 
 //---------------------------------------------------------------------------
@@ -387,16 +679,7 @@ void fcoEditorWindow::on_actionSave_triggered()
     }
 
     // Save fco file
-    string errorMsg;
-    if (!m_fco->Save(m_fileName.toStdString(), errorMsg))
-    {
-        QMessageBox::critical(this, "Error", QString::fromStdString(errorMsg), QMessageBox::Ok);
-    }
-    else
-    {
-        m_fileEdited = false;
-        QMessageBox::information(this, "Save", "File save successful!", QMessageBox::Ok);
-    }
+    StartSave(m_fileName, "Save");
 }
 
 //---------------------------------------------------------------------------
@@ -428,21 +711,393 @@ void fcoEditorWindow::on_actionSave_as_triggered()
     m_path = info.dir().absolutePath();
 
     // Save fco file
+    StartSave(fcoFile, "Save As");
+}
+
+//---------------------------------------------------------------------------
+// Serialize a snapshot and atomically replace the target, a failed save
+// leaves the old file untouched
+//---------------------------------------------------------------------------
+static QString SaveSnapshot(fco* _snapshot, QString const& _fileName)
+{
+    string bytes;
     string errorMsg;
-    if (!m_fco->Save(fcoFile.toStdString(), errorMsg))
+    bool const serialized = _snapshot->Serialize(bytes, errorMsg);
+    delete _snapshot;
+
+    if (!serialized)
     {
-        QMessageBox::critical(this, "Error", QString::fromStdString(errorMsg), QMessageBox::Ok);
+        return QString::fromStdString(errorMsg);
     }
-    else
+
+    QSaveFile file(_fileName);
+    if (!file.open(QIODevice::WriteOnly) || file.write(bytes.data(), static_cast<qint64>(bytes.size())) != static_cast<qint64>(bytes.size()) || !file.commit())
+    {
+        return "Unable to write " + _fileName + "!";
+    }
+    return QString();
+}
+
+//---------------------------------------------------------------------------
+// Save a copy of the document on a worker thread, editing continues (the
+// copy shares the symbol database, only the subtitles are duplicated)
+//---------------------------------------------------------------------------
+void fcoEditorWindow::StartSave(QString const& _fileName, QString const& _title)
+{
+    if (m_saveWatcher->isRunning())
+    {
+        QMessageBox::information(this, _title, "A save is already in progress.", QMessageBox::Ok);
+        return;
+    }
+
+    TRACE_SCOPE("ui", "SaveFile");
+    fco* snapshot = new fco(*m_fco);
+    m_savingFile = _fileName;
+    m_savingTitle = _title;
+    m_savingRevision = m_revision;
+    m_saveWatcher->setFuture(QtConcurrent::run([snapshot, _fileName]()
+    {
+        return SaveSnapshot(snapshot, _fileName);
+    }));
+}
+
+//---------------------------------------------------------------------------
+// Background save finished
+//---------------------------------------------------------------------------
+void fcoEditorWindow::SaveFinished()
+{
+    QString const errorMsg = m_saveWatcher->result();
+    if (!errorMsg.isEmpty())
+    {
+        QMessageBox::critical(this, "Error", errorMsg, QMessageBox::Ok);
+        return;
+    }
+
+    // Recovery file of the old name is stale now
+    bool const renamed = m_fileName != m_savingFile;
+    if (renamed)
+    {
+        QFile::remove(AutosaveFile());
+    }
+    m_fileName = m_savingFile;
+    int index = m_fileName.lastIndexOf('/');
+    if (index == -1) index = m_fileName.lastIndexOf('\\');
+    ui->L_FileName->setText("File Name: " + m_fileName.mid(index + 1));
+    if (renamed)
     {
-        m_fileName = fcoFile;
-        int index = m_fileName.lastIndexOf('/');
-        if (index == -1) index = m_fileName.lastIndexOf('\\');
-        ui->L_FileName->setText("File Name: " + m_fileName.mid(index + 1));
+        // Captions may name the new file
+        UpdateReferenceLabels();
+    }
 
+    // Edits made while saving are still unsaved, their recovery
+    // file is kept (and written again under a new name)
+    if (m_revision == m_savingRevision)
+    {
+        QFile::remove(AutosaveFile());
         m_fileEdited = false;
-        QMessageBox::information(this, "Save As", "File save successful!", QMessageBox::Ok);
+        m_autosavedRevision = m_revision;
+        if (m_projectIndex != -1)
+        {
+            m_project->SetDirty(m_projectIndex, false);
+            m_projectPanel->UpdateFiles();
+        }
+    }
+    else if (renamed)
+    {
+        m_autosavedRevision = 0;
+    }
+    QMessageBox::information(this, m_savingTitle, "File save successful!", QMessageBox::Ok);
+}
+
+//---------------------------------------------------------------------------
+// Periodic recovery save, skipped when nothing changed
+//---------------------------------------------------------------------------
+void fcoEditorWindow::Autosave()
+{
+    if (!m_fco->IsLoaded() || m_fileName.isEmpty() || !m_fileEdited || m_revision == m_autosavedRevision)
+    {
+        return;
+    }
+    if (m_autosaveWatcher->isRunning() || m_loading)
+    {
+        return;
+    }
+
+    TRACE_SCOPE("ui", "Autosave");
+    fco* snapshot = new fco(*m_fco);
+    QString const fileName = AutosaveFile();
+    m_autosavedRevision = m_revision;
+    m_autosaveWatcher->setFuture(QtConcurrent::run([snapshot, fileName]()
+    {
+        return SaveSnapshot(snapshot, fileName);
+    }));
+}
+
+//---------------------------------------------------------------------------
+// Recovery save finished
+//---------------------------------------------------------------------------
+void fcoEditorWindow::AutosaveFinished()
+{
+    QString const errorMsg = m_autosaveWatcher->result();
+    if (!errorMsg.isEmpty())
+    {
+        // Try again next time
+        m_autosavedRevision = 0;
+        UpdateStatus("Autosave failed: " + errorMsg, "color: rgb(255, 0, 0);");
+    }
+    else if (!m_fileEdited)
+    {
+        // Saved manually in the meantime
+        QFile::remove(AutosaveFile());
+    }
+}
+
+//---------------------------------------------------------------------------
+// Recovery file of the current file
+//---------------------------------------------------------------------------
+QString fcoEditorWindow::AutosaveFile() const
+{
+    return m_fileName + ".autosave";
+}
+
+//---------------------------------------------------------------------------
+// Document changed, needs saving (and autosaving)
+//---------------------------------------------------------------------------
+void fcoEditorWindow::MarkFileEdited()
+{
+    m_fileEdited = true;
+    m_revision++;
+
+    if (m_projectIndex != -1 && !m_project->GetFile(m_projectIndex).m_dirty)
+    {
+        m_project->SetDirty(m_projectIndex, true);
+        m_projectPanel->UpdateFiles();
+    }
+}
+
+//---------------------------------------------------------------------------
+// Open a directory of .fco files as a project
+//---------------------------------------------------------------------------
+void fcoEditorWindow::on_actionOpen_Project_triggered()
+{
+    if (!m_fco->IsInit() || m_loading || m_saveAllWatcher->isRunning())
+    {
+        return;
+    }
+
+    if (!DiscardSaveMessage("Open Project", "You have unsaved changes, continue without saving?", true, true))
+    {
+        return;
+    }
+
+    QString directory = QFileDialog::getExistingDirectory(this, tr("Open Project Folder"), m_path);
+    if (directory.isEmpty()) return;
+
+    fcoProject* project = new fcoProject(m_fco, this);
+    QString errorMsg;
+    if (!project->Open(directory, errorMsg))
+    {
+        delete project;
+        QMessageBox::critical(this, "Error", errorMsg, QMessageBox::Ok);
+        return;
+    }
+    m_path = project->GetDirectory();
+
+    // The current document stays open on its own
+    m_projectPanel->SetProject(Q_NULLPTR);
+    m_projectIndex = -1;
+    delete m_project;
+    m_project = project;
+
+    m_projectPanel->SetProject(m_project);
+    m_projectPanel->show();
+
+    // Labels of each project file as it is indexed
+    m_references->ClearProjectLabels();
+    connect(m_project, &fcoProject::FileIndexed, this, &fcoEditorWindow::ProjectFileIndexed);
+    m_projectPanel->raise();
+}
+
+//---------------------------------------------------------------------------
+// Save every edited file of the project in parallel
+//---------------------------------------------------------------------------
+void fcoEditorWindow::on_actionSave_All_Project_triggered()
+{
+    if (!m_project)
+    {
+        return;
+    }
+
+    if (m_saveWatcher->isRunning() || m_saveAllWatcher->isRunning())
+    {
+        QMessageBox::information(this, "Save All", "A save is already in progress.", QMessageBox::Ok);
+        return;
     }
+
+    if (!DiscardSaveMessage("Save All", "You have not \"Apply Changes\" yet, continue without applying?"))
+    {
+        return;
+    }
+
+    // Snapshots, only dirty documents are written
+    m_saveAllJobs.clear();
+    for (int fileIndex : m_project->GetDirtyDocuments())
+    {
+        ProjectSaveJob job;
+        job.m_fileIndex = fileIndex;
+        job.m_snapshot = new fco(*m_project->GetDocument(fileIndex));
+        job.m_fileName = m_project->GetFile(fileIndex).m_fileName;
+        m_saveAllJobs.push_back(job);
+    }
+    if (m_projectIndex != -1 && m_fileEdited)
+    {
+        ProjectSaveJob job;
+        job.m_fileIndex = m_projectIndex;
+        job.m_snapshot = new fco(*m_fco);
+        job.m_fileName = m_project->GetFile(m_projectIndex).m_fileName;
+        m_saveAllJobs.push_back(job);
+    }
+
+    if (m_saveAllJobs.isEmpty())
+    {
+        QMessageBox::information(this, "Save All", "No project files have unsaved changes.", QMessageBox::Ok);
+        return;
+    }
+
+    m_saveAllRevision = m_revision;
+    m_saveAllProgress = new QProgressDialog("Saving " + QString::number(m_saveAllJobs.size()) + " files...", QString(), 0, m_saveAllJobs.size(), this);
+    m_saveAllProgress->setWindowTitle("Save All");
+    m_saveAllProgress->setWindowModality(Qt::WindowModal);
+    m_saveAllProgress->setMinimumDuration(500);
+    m_saveAllProgress->setValue(0);
+    connect(m_saveAllWatcher, &QFutureWatcher<QString>::progressValueChanged, m_saveAllProgress, &QProgressDialog::setValue);
+
+    m_saveAllWatcher->setFuture(QtConcurrent::mapped(m_saveAllJobs, &SaveProjectFile));
+}
+
+//---------------------------------------------------------------------------
+// One file of Save All (worker thread)
+//---------------------------------------------------------------------------
+QString fcoEditorWindow::SaveProjectFile(ProjectSaveJob const& _job)
+{
+    TRACE_SCOPE("ui", "SaveProjectFile");
+    return SaveSnapshot(_job.m_snapshot, _job.m_fileName);
+}
+
+//---------------------------------------------------------------------------
+// Parallel save finished, results are in job order
+//---------------------------------------------------------------------------
+void fcoEditorWindow::SaveAllFinished()
+{
+    m_saveAllProgress->deleteLater();
+    m_saveAllProgress = Q_NULLPTR;
+
+    QFuture<QString> const future = m_saveAllWatcher->future();
+    QStringList errors;
+    for (int i = 0; i < m_saveAllJobs.size(); i++)
+    {
+        ProjectSaveJob const& job = m_saveAllJobs[i];
+        QString const errorMsg = future.resultAt(i);
+        if (!errorMsg.isEmpty())
+        {
+            errors << errorMsg;
+            continue;
+        }
+
+        if (job.m_fileIndex == m_projectIndex)
+        {
+            // Edits made while saving are still unsaved
+            QFile::remove(AutosaveFile());
+            if (m_revision == m_saveAllRevision)
+            {
+                m_fileEdited = false;
+                m_autosavedRevision = m_revision;
+                m_project->SetDirty(job.m_fileIndex, false);
+            }
+        }
+        else
+        {
+            m_project->SetDirty(job.m_fileIndex, false);
+        }
+    }
+
+    int const saved = m_saveAllJobs.size() - errors.size();
+    m_saveAllJobs.clear();
+    m_projectPanel->UpdateFiles();
+
+    if (!errors.isEmpty())
+    {
+        QMessageBox::critical(this, "Error", errors.join("\n"), QMessageBox::Ok);
+        return;
+    }
+    QMessageBox::information(this, "Save All", QString::number(saved) + " files saved successfully!", QMessageBox::Ok);
+}
+
+//---------------------------------------------------------------------------
+// Focus the project search
+//---------------------------------------------------------------------------
+void fcoEditorWindow::on_actionFind_in_All_Files_triggered()
+{
+    if (!m_project)
+    {
+        return;
+    }
+
+    m_projectPanel->show();
+    m_projectPanel->raise();
+    m_projectPanel->FocusSearch();
+}
+
+//---------------------------------------------------------------------------
+// Project file double clicked
+//---------------------------------------------------------------------------
+void fcoEditorWindow::ProjectFileActivated(int _fileIndex)
+{
+    OpenProjectFile(_fileIndex);
+}
+
+//---------------------------------------------------------------------------
+// Search result double clicked, open its file and subtitle
+//---------------------------------------------------------------------------
+void fcoEditorWindow::ProjectResultActivated(int _fileIndex, unsigned int _groupID, unsigned int _subtitleID)
+{
+    if (_fileIndex == m_projectIndex)
+    {
+        if (!DiscardSaveMessage("Discard", "Discard unsaved changes?"))
+        {
+            return;
+        }
+    }
+    else if (!OpenProjectFile(_fileIndex))
+    {
+        return;
+    }
+
+    // Index may be older than the document
+    if (_groupID < m_fco->GetGroupCount() && _subtitleID < m_fco->GetSubtitleCount(_groupID))
+    {
+        TV_FocusItem(_groupID, _subtitleID);
+        LoadSubtitle(_groupID, _subtitleID);
+    }
+}
+
+//---------------------------------------------------------------------------
+// Search includes unsaved edits of the current file
+//---------------------------------------------------------------------------
+void fcoEditorWindow::ProjectSearchRequested()
+{
+    if (m_projectIndex != -1 && m_fileEdited)
+    {
+        m_project->Reindex(m_projectIndex, m_fco);
+    }
+}
+
+//---------------------------------------------------------------------------
+// Make labels of a re-indexed project file resolvable from captions
+//---------------------------------------------------------------------------
+void fcoEditorWindow::ProjectFileIndexed(int _fileIndex)
+{
+    m_references->SetProjectLabels(m_project->GetFile(_fileIndex).m_fileName, m_project->GetLabels(_fileIndex));
 }
 
 //---------------------------------------------------------------------------
@@ -450,9 +1105,9 @@ void fcoEditorWindow::on_actionSave_as_triggered()
 //---------------------------------------------------------------------------
 void fcoEditorWindow::on_actionClose_triggered()
 {
-    if (m_fco->IsLoaded())
+    if (m_fco->IsLoaded() || m_project)
     {
-        if (!DiscardSaveMessage("Close", "Quit without saving?", true))
+        if (!DiscardSaveMessage("Close", "Quit without saving?", true, true))
         {
             return;
         }
@@ -517,6 +1172,8 @@ void fcoEditorWindow::on_actionEvent_Caption_Editor_cap_triggered()
     {
         m_eventCaptionEditor = new EventCaptionEditor();
         connect(m_eventCaptionEditor, SIGNAL(UpdatePreview(QString, QString)), this, SLOT(SearchForSubtitle(QString, QString)));
+        connect(m_eventCaptionEditor, SIGNAL(UpdatePlaybackSubtitles(QStringList, QStringList)), this, SLOT(SearchForSubtitles(QStringList, QStringList)));
+        m_eventCaptionEditor->SetReferences(m_references);
     }
 
     if (!m_eventCaptionEditor->isVisible())
@@ -548,6 +1205,39 @@ void fcoEditorWindow::on_actionDatabase_Generator_fte_triggered()
     m_databaseGenerator->raise();
 }
 
+//---------------------------------------------------------------------------
+// Start/stop recording a trace, dump as Chrome trace-event JSON when stopped
+//---------------------------------------------------------------------------
+void fcoEditorWindow::on_actionRecord_Performance_Trace_triggered(bool checked)
+{
+    if (checked)
+    {
+        Tracer::Start();
+        return;
+    }
+
+    Tracer::Stop();
+
+    QString path = "";
+    if (!m_path.isEmpty())
+    {
+        path = m_path;
+    }
+
+    QString traceFile = QFileDialog::getSaveFileName(this, tr("Save Performance Trace"), path, "Trace File (*.json)");
+    if (traceFile == Q_NULLPTR) return;
+
+    string errorMsg;
+    if (!Tracer::Dump(traceFile.toStdString(), errorMsg))
+    {
+        QMessageBox::critical(this, "Error", QString::fromStdString(errorMsg), QMessageBox::Ok);
+    }
+    else
+    {
+        QMessageBox::information(this, "Performance Trace", "Trace saved, open it with chrome://tracing or ui.perfetto.dev", QMessageBox::Ok);
+    }
+}
+
 //---------------------------------------------------------------------------
 // Search for subtitle
 //---------------------------------------------------------------------------
@@ -581,7 +1271,7 @@ void fcoEditorWindow::on_PB_Find_clicked()
     // Start searching
     if (m_fco->Search(str.toStdWString(), findGroupID, findSubtitleID))
     {
-        TW_FocusItem(findGroupID, findSubtitleID);
+        TV_FocusItem(findGroupID, findSubtitleID);
         LoadSubtitle(findGroupID, findSubtitleID);
         ui->RB_Current->setChecked(true);
         ui->LE_Find->setFocus();
@@ -606,21 +1296,19 @@ void fcoEditorWindow::on_PB_Save_clicked()
 
     QString const newSubtitle = ui->TE_TextEditor->toPlainText();
 
-    QTreeWidgetItem* parent = ui->TW_TreeWidget->topLevelItem(static_cast<int>(m_groupID));
-    QTreeWidgetItem* child = parent->child(static_cast<int>(m_subtitleID));
-    child->setText(2, newSubtitle);
-
     // Save and reload
+    vector<fco::ColorBlock> const& colorBlocks = m_colorBlockModel->GetColorBlocks();
     m_fco->RemoveAllColorBlocks(m_groupID, m_subtitleID);
-    for (unsigned int colorBlockID = 0; colorBlockID < m_colorBlocks.size(); colorBlockID++)
+    for (unsigned int colorBlockID = 0; colorBlockID < colorBlocks.size(); colorBlockID++)
     {
         m_fco->AddColorBlock(m_groupID, m_subtitleID);
-        m_fco->ModifyColorBlock(m_groupID, m_subtitleID, colorBlockID, m_colorBlocks[colorBlockID]);
+        m_fco->ModifyColorBlock(m_groupID, m_subtitleID, colorBlockID, colorBlocks[colorBlockID]);
     }
 
-    m_fileEdited = true;
+    MarkFileEdited();
     m_fco->ModifyDefaultColor(m_groupID, m_subtitleID, m_defaultColor);
     m_fco->ModifySubtitle(newSubtitle.toStdWString(), m_groupID, m_subtitleID);
+    m_treeModel->UpdateSubtitle(m_groupID, m_subtitleID);
     LoadSubtitle(m_groupID, m_subtitleID);
 }
 
@@ -640,13 +1328,43 @@ void fcoEditorWindow::on_PB_Reset_clicked()
 //---------------------------------------------------------------------------
 void fcoEditorWindow::on_PB_AddColorBlock_clicked()
 {
-    m_colorEdited = true;
-    m_colorBlocks.push_back(fco::ColorBlock());
-    AddColorBlock(m_colorBlocks.size() - 1);
-    EnableUpDownButtons();
-    ui->PB_Save->setEnabled(m_textEdited || m_colorEdited);
-    ui->PB_Reset->setEnabled(m_textEdited || m_colorEdited);
-    UpdateSubtitlePreview();
+    m_colorBlockModel->AddColorBlock();
+    ui->TV_ColorBlocks->setCurrentIndex(m_colorBlockModel->index(m_colorBlockModel->rowCount() - 1, ColorBlockModel::CT_Start));
+}
+
+//---------------------------------------------------------------------------
+// Delete the selected color block
+//---------------------------------------------------------------------------
+void fcoEditorWindow::on_PB_DeleteColorBlock_clicked()
+{
+    m_colorBlockModel->RemoveColorBlock(ui->TV_ColorBlocks->currentIndex().row());
+    UpdateColorBlockButtons();
+}
+
+//---------------------------------------------------------------------------
+// Move the selected color block up
+//---------------------------------------------------------------------------
+void fcoEditorWindow::on_PB_ColorBlockUp_clicked()
+{
+    QModelIndex const current = ui->TV_ColorBlocks->currentIndex();
+    if (current.row() > 0)
+    {
+        m_colorBlockModel->MoveColorBlock(current.row(), current.row() - 1);
+        ui->TV_ColorBlocks->setCurrentIndex(m_colorBlockModel->index(current.row() - 1, current.column()));
+    }
+}
+
+//---------------------------------------------------------------------------
+// Move the selected color block down
+//---------------------------------------------------------------------------
+void fcoEditorWindow::on_PB_ColorBlockDown_clicked()
+{
+    QModelIndex const current = ui->TV_ColorBlocks->currentIndex();
+    if (current.isValid() && current.row() < m_colorBlockModel->rowCount() - 1)
+    {
+        m_colorBlockModel->MoveColorBlock(current.row(), current.row() + 1);
+        ui->TV_ColorBlocks->setCurrentIndex(m_colorBlockModel->index(current.row() + 1, current.column()));
+    }
 }
 
 //---------------------------------------------------------------------------
@@ -654,7 +1372,7 @@ void fcoEditorWindow::on_PB_AddColorBlock_clicked()
 //---------------------------------------------------------------------------
 void fcoEditorWindow::on_PB_Expand_clicked()
 {
-    ui->TW_TreeWidget->expandAll();
+    ui->TV_TreeView->expandAll();
 }
 
 //---------------------------------------------------------------------------
@@ -662,7 +1380,7 @@ void fcoEditorWindow::on_PB_Expand_clicked()
 //---------------------------------------------------------------------------
 void fcoEditorWindow::on_PB_Collapse_clicked()
 {
-    ui->TW_TreeWidget->collapseAll();
+    ui->TV_TreeView->collapseAll();
 }
 
 //---------------------------------------------------------------------------
@@ -670,26 +1388,12 @@ void fcoEditorWindow::on_PB_Collapse_clicked()
 //---------------------------------------------------------------------------
 void fcoEditorWindow::on_PB_NewGroup_clicked()
 {
-    m_fileEdited = true;
-    m_fco->AddGroup();
-
-    // Update tree view
-    vector<string> groupNames;
-    m_fco->GetGroupNames(groupNames);
-
-    // Add sub-group name
-    unsigned int groupID = groupNames.size() - 1;
-    string const& groupName = groupNames[groupID];
-    TW_AddSubgroup(QString::fromStdString(groupName), groupID);
-
-    // Add subtitle (should only have one)
-    string label = m_fco->GetLabel(groupID, 0);
-    wstring subtitle = m_fco->GetSubtitle(groupID, 0);
-    QTreeWidgetItem *item = ui->TW_TreeWidget->topLevelItem(static_cast<int>(groupID));
-    TW_AddSubtitle(item, QString::fromStdString(label), QString::fromStdWString(subtitle));
+    MarkFileEdited();
+    unsigned int groupID = m_treeModel->AddGroup();
+    m_references->InsertGroup(groupID, QString::fromStdString(m_fco->GetGroupName(groupID)), GetGroupLabels(groupID));
 
     // Focus on the new subtitle
-    TW_FocusItem(groupID, 0);
+    TV_FocusItem(groupID, 0);
 }
 
 //---------------------------------------------------------------------------
@@ -702,25 +1406,23 @@ void fcoEditorWindow::on_PB_DeleteGroup_clicked()
         return;
     }
 
-    vector<string> junk;
-    m_fco->GetGroupNames(junk);
-    if (junk.size() <= 1)
+    if (m_fco->GetGroupCount() <= 1)
     {
         QMessageBox::critical(this, "Delete Group", "Cannot delete the last remaining group!");
         return;
     }
 
     QMessageBox::StandardButton resBtn = QMessageBox::Yes;
-    QString str = "Delete group \"" + ui->TW_TreeWidget->topLevelItem(static_cast<int>(m_groupID))->text(0) + "\" and all containing subtitles?\nThis may change all the SerifuID in other groups.";
+    QString str = "Delete group \"" + QString::fromStdString(m_fco->GetGroupName(m_groupID)) + "\" and all containing subtitles?\nThis may change all the SerifuID in other groups.";
     resBtn = QMessageBox::warning(this, "Delete Group", str, QMessageBox::Yes | QMessageBox::No, QMessageBox::Yes);
     if (resBtn == QMessageBox::No)
     {
         return;
     }
 
-    m_fileEdited = true;
-    m_fco->DeleteGroup(m_groupID);
-    delete ui->TW_TreeWidget->takeTopLevelItem(static_cast<int>(m_groupID));
+    MarkFileEdited();
+    m_treeModel->DeleteGroup(m_groupID);
+    m_references->RemoveGroup(m_groupID);
 
     ui->PB_NewSubtitle->setEnabled(false);
     ui->PB_DeleteGroup->setEnabled(false);
@@ -730,7 +1432,6 @@ void fcoEditorWindow::on_PB_DeleteGroup_clicked()
     ui->PB_SubtitleUp->setEnabled(false);
     ui->PB_SubtitleDown->setEnabled(false);
 
-    TW_UpdateSerifuID();
     ResetSubtitleEditor();
 }
 
@@ -744,24 +1445,15 @@ void fcoEditorWindow::on_PB_NewSubtitle_clicked()
         return;
     }
 
-    m_fileEdited = true;
-
-    vector<string> labels;
-    vector<wstring> subtitles;
-    m_fco->GetSubgroupSubtitles(m_groupID, labels, subtitles);
-    QString string = "Subtitle" + (((subtitles.size() + 1 < 10) ? "0" : "") + QString::number(subtitles.size() + 1));
-    m_fco->AddSubtitle(m_groupID, string.toStdString());
+    MarkFileEdited();
 
-    // Add subtitle
-    labels.clear();
-    subtitles.clear();
-    m_fco->GetSubgroupSubtitles(m_groupID, labels, subtitles);
-    unsigned int subtitleID = subtitles.size() - 1;
-    QTreeWidgetItem *item = ui->TW_TreeWidget->topLevelItem(static_cast<int>(m_groupID));
-    TW_AddSubtitle(item, QString::fromStdString(labels[subtitleID]), QString::fromStdWString(subtitles[subtitleID]));
+    unsigned int subtitleID = m_fco->GetSubtitleCount(m_groupID);
+    QString string = "Subtitle" + (((subtitleID + 1 < 10) ? "0" : "") + QString::number(subtitleID + 1));
+    m_treeModel->AddSubtitle(m_groupID, string.toStdString());
+    UpdateReferenceGroup(m_groupID);
 
     // Focus on the new subtitle
-    TW_FocusItem(m_groupID, subtitleID);
+    TV_FocusItem(m_groupID, subtitleID);
 }
 
 //---------------------------------------------------------------------------
@@ -774,31 +1466,29 @@ void fcoEditorWindow::on_PB_DeleteSubtitle_clicked()
         return;
     }
 
-    QTreeWidgetItem *item = ui->TW_TreeWidget->topLevelItem(static_cast<int>(m_groupID));
-    if (item->childCount() == 1)
+    if (m_fco->GetSubtitleCount(m_groupID) == 1)
     {
         QMessageBox::critical(this, "Delete Subtitle", "Cannot delete the last remaining subtitle in a group!\nDelete the group instead.");
         return;
     }
 
     QMessageBox::StandardButton resBtn = QMessageBox::Yes;
-    QString str = "Delete current subtitle \"" + ui->TW_TreeWidget->topLevelItem(static_cast<int>(m_groupID))->child(static_cast<int>(m_subtitleID))->text(0) + "\"?\nThis may change the SerifuID in other subtitles.";
+    QString str = "Delete current subtitle \"" + QString::fromStdString(m_fco->GetLabel(m_groupID, m_subtitleID)) + "\"?\nThis may change the SerifuID in other subtitles.";
     resBtn = QMessageBox::warning(this, "Delete Subtitle", str, QMessageBox::Yes | QMessageBox::No, QMessageBox::Yes);
     if (resBtn == QMessageBox::No)
     {
         return;
     }
 
-    m_fileEdited = true;
-    m_fco->DeleteSubtitle(m_groupID, m_subtitleID);
-    delete item->takeChild(static_cast<int>(m_subtitleID));
+    MarkFileEdited();
+    m_treeModel->DeleteSubtitle(m_groupID, m_subtitleID);
+    UpdateReferenceGroup(m_groupID);
 
     m_subtitleID = (m_subtitleID == 0 ? 0 : m_subtitleID - 1);
     LoadSubtitle(m_groupID, m_subtitleID);
 
-    TW_UpdateSerifuID();
-    TW_UpdateUpDownButtons();
-    TW_FocusItem(m_groupID, m_subtitleID);
+    TV_UpdateUpDownButtons();
+    TV_FocusItem(m_groupID, m_subtitleID);
 }
 
 //---------------------------------------------------------------------------
@@ -815,7 +1505,7 @@ void fcoEditorWindow::on_PB_GroupUp_clicked()
     {
 
         QMessageBox::StandardButton resBtn = QMessageBox::Yes;
-        QString str = "Move up the current group \"" + ui->TW_TreeWidget->topLevelItem(static_cast<int>(m_groupID))->text(0) + "\"?\nThis will change the SerifuID in subtitles.\n(This message will not be shown again upon confirmation)";
+        QString str = "Move up the current group \"" + QString::fromStdString(m_fco->GetGroupName(m_groupID)) + "\"?\nThis will change the SerifuID in subtitles.\n(This message will not be shown again upon confirmation)";
         resBtn = QMessageBox::warning(this, "Move Group", str, QMessageBox::Yes | QMessageBox::No, QMessageBox::Yes);
         if (resBtn == QMessageBox::No)
         {
@@ -824,14 +1514,12 @@ void fcoEditorWindow::on_PB_GroupUp_clicked()
     }
     m_moveGroup = true;
 
-    m_fileEdited = true;
-    m_fco->SwapGroup(m_groupID, m_groupID - 1);
-    QTreeWidgetItem *group = ui->TW_TreeWidget->takeTopLevelItem(static_cast<int>(m_groupID));
+    MarkFileEdited();
+    m_treeModel->MoveGroup(m_groupID, m_groupID - 1);
+    m_references->SwapGroups(m_groupID, m_groupID - 1);
     m_groupID--;
-    ui->TW_TreeWidget->insertTopLevelItem(static_cast<int>(m_groupID), group);
-    TW_UpdateSerifuID();
-    TW_UpdateUpDownButtons();
-    TW_FocusItem(m_groupID, m_subtitleID);
+    TV_UpdateUpDownButtons();
+    TV_FocusItem(m_groupID, m_subtitleID);
 }
 
 //---------------------------------------------------------------------------
@@ -847,7 +1535,7 @@ void fcoEditorWindow::on_PB_GroupDown_clicked()
     if (!m_moveGroup)
     {
         QMessageBox::StandardButton resBtn = QMessageBox::Yes;
-        QString str = "Move down the current group \"" + ui->TW_TreeWidget->topLevelItem(static_cast<int>(m_groupID))->text(0) + "\"?\nThis will change the SerifuID in subtitles.\n(This message will not be shown again upon confirmation)";
+        QString str = "Move down the current group \"" + QString::fromStdString(m_fco->GetGroupName(m_groupID)) + "\"?\nThis will change the SerifuID in subtitles.\n(This message will not be shown again upon confirmation)";
         resBtn = QMessageBox::warning(this, "Move Group", str, QMessageBox::Yes | QMessageBox::No, QMessageBox::Yes);
         if (resBtn == QMessageBox::No)
         {
@@ -856,14 +1544,12 @@ void fcoEditorWindow::on_PB_GroupDown_clicked()
     }
     m_moveGroup = true;
 
-    m_fileEdited = true;
-    m_fco->SwapGroup(m_groupID, m_groupID + 1);
-    QTreeWidgetItem *group = ui->TW_TreeWidget->takeTopLevelItem(static_cast<int>(m_groupID));
+    MarkFileEdited();
+    m_treeModel->MoveGroup(m_groupID, m_groupID + 1);
+    m_references->SwapGroups(m_groupID, m_groupID + 1);
     m_groupID++;
-    ui->TW_TreeWidget->insertTopLevelItem(static_cast<int>(m_groupID), group);
-    TW_UpdateSerifuID();
-    TW_UpdateUpDownButtons();
-    TW_FocusItem(m_groupID, m_subtitleID);
+    TV_UpdateUpDownButtons();
+    TV_FocusItem(m_groupID, m_subtitleID);
 }
 
 //---------------------------------------------------------------------------
@@ -879,7 +1565,7 @@ void fcoEditorWindow::on_PB_SubtitleUp_clicked()
     if (!m_moveSubtitle)
     {
         QMessageBox::StandardButton resBtn = QMessageBox::Yes;
-        QString str = "Move up current subtitle \"" + ui->TW_TreeWidget->topLevelItem(static_cast<int>(m_groupID))->child(static_cast<int>(m_subtitleID))->text(0) + "\"?\nThis will change the SerifuID in subtitles.\n(This message will not be shown again upon confirmation)";
+        QString str = "Move up current subtitle \"" + QString::fromStdString(m_fco->GetLabel(m_groupID, m_subtitleID)) + "\"?\nThis will change the SerifuID in subtitles.\n(This message will not be shown again upon confirmation)";
         resBtn = QMessageBox::warning(this, "Move Subtitle", str, QMessageBox::Yes | QMessageBox::No, QMessageBox::Yes);
         if (resBtn == QMessageBox::No)
         {
@@ -888,15 +1574,12 @@ void fcoEditorWindow::on_PB_SubtitleUp_clicked()
     }
     m_moveSubtitle = true;
 
-    m_fileEdited = true;
-    m_fco->SwapSubtitle(m_groupID, m_subtitleID, m_subtitleID - 1);
-    QTreeWidgetItem *group = ui->TW_TreeWidget->topLevelItem(static_cast<int>(m_groupID));
-    QTreeWidgetItem *subtitle = group->takeChild(static_cast<int>(m_subtitleID));
+    MarkFileEdited();
+    m_treeModel->MoveSubtitle(m_groupID, m_subtitleID, m_subtitleID - 1);
+    UpdateReferenceGroup(m_groupID);
     m_subtitleID--;
-    group->insertChild(static_cast<int>(m_subtitleID), subtitle);
-    TW_UpdateSerifuID();
-    TW_UpdateUpDownButtons();
-    TW_FocusItem(m_groupID, m_subtitleID);
+    TV_UpdateUpDownButtons();
+    TV_FocusItem(m_groupID, m_subtitleID);
 }
 
 //---------------------------------------------------------------------------
@@ -912,7 +1595,7 @@ void fcoEditorWindow::on_PB_SubtitleDown_clicked()
     if (!m_moveSubtitle)
     {
         QMessageBox::StandardButton resBtn = QMessageBox::Yes;
-        QString str = "Move down current subtitle \"" + ui->TW_TreeWidget->topLevelItem(static_cast<int>(m_groupID))->child(static_cast<int>(m_subtitleID))->text(0) + "\"?\nThis will change the SerifuID in subtitles.\n(This message will not be shown again upon confirmation)";
+        QString str = "Move down current subtitle \"" + QString::fromStdString(m_fco->GetLabel(m_groupID, m_subtitleID)) + "\"?\nThis will change the SerifuID in subtitles.\n(This message will not be shown again upon confirmation)";
         resBtn = QMessageBox::warning(this, "Move Subtitle", str, QMessageBox::Yes | QMessageBox::No, QMessageBox::Yes);
         if (resBtn == QMessageBox::No)
         {
@@ -921,15 +1604,12 @@ void fcoEditorWindow::on_PB_SubtitleDown_clicked()
     }
     m_moveSubtitle = true;
 
-    m_fileEdited = true;
-    m_fco->SwapSubtitle(m_groupID, m_subtitleID, m_subtitleID + 1);
-    QTreeWidgetItem *group = ui->TW_TreeWidget->topLevelItem(static_cast<int>(m_groupID));
-    QTreeWidgetItem *subtitle = group->takeChild(static_cast<int>(m_subtitleID));
+    MarkFileEdited();
+    m_treeModel->MoveSubtitle(m_groupID, m_subtitleID, m_subtitleID + 1);
+    UpdateReferenceGroup(m_groupID);
     m_subtitleID++;
-    group->insertChild(static_cast<int>(m_subtitleID), subtitle);
-    TW_UpdateSerifuID();
-    TW_UpdateUpDownButtons();
-    TW_FocusItem(m_groupID, m_subtitleID);
+    TV_UpdateUpDownButtons();
+    TV_FocusItem(m_groupID, m_subtitleID);
 }
 
 //---------------------------------------------------------------------------
@@ -937,14 +1617,14 @@ void fcoEditorWindow::on_PB_SubtitleDown_clicked()
 //---------------------------------------------------------------------------
 void fcoEditorWindow::on_PB_SerifuID_clicked()
 {
-    if (ui->TW_TreeWidget->isColumnHidden(1))
+    if (ui->TV_TreeView->isColumnHidden(1))
     {
-        ui->TW_TreeWidget->showColumn(1);
+        ui->TV_TreeView->showColumn(1);
         ui->PB_SerifuID->setText("Hide SerifuID");
     }
     else
     {
-        ui->TW_TreeWidget->hideColumn(1);
+        ui->TV_TreeView->hideColumn(1);
         ui->PB_SerifuID->setText("Show SerifuID");
     }
 }
@@ -952,20 +1632,17 @@ void fcoEditorWindow::on_PB_SerifuID_clicked()
 //---------------------------------------------------------------------------
 // Selected a subtitle to edit
 //---------------------------------------------------------------------------
-void fcoEditorWindow::on_TW_TreeWidget_itemDoubleClicked(QTreeWidgetItem *item, int column)
+void fcoEditorWindow::on_TV_TreeView_doubleClicked(const QModelIndex &index)
 {
     // Check if clicking on subtitle and not sub-group
-    QTreeWidgetItem *parent = item->parent();
-    if (parent != Q_NULLPTR)
+    if (m_treeModel->IsSubtitle(index))
     {
         if (!DiscardSaveMessage("Discard", "Discard unsaved changes?"))
         {
            return;
         }
 
-        int groupID = ui->TW_TreeWidget->indexOfTopLevelItem(parent);
-        int subtitleID = parent->indexOfChild(item);
-        LoadSubtitle(static_cast<unsigned int>(groupID), static_cast<unsigned int>(subtitleID));
+        LoadSubtitle(m_treeModel->GetGroupID(index), m_treeModel->GetSubtitleID(index));
     }
 }
 
@@ -993,13 +1670,12 @@ void fcoEditorWindow::on_LE_GroupName_textEdited(const QString &text)
 {
     if (m_groupID != INT_MAX && m_subtitleID != INT_MAX)
     {
-        m_fileEdited = true;
-
-        QTreeWidgetItem *group = ui->TW_TreeWidget->topLevelItem(static_cast<int>(m_groupID));
+        MarkFileEdited();
 
         QString finalText = text.isEmpty() ? "NO_NAME" : text;
-        group->setText(0, finalText);
         m_fco->ModifyGroupName(m_groupID, finalText.toStdString());
+        m_treeModel->UpdateGroup(m_groupID);
+        UpdateReferenceGroup(m_groupID);
     }
 }
 
@@ -1010,14 +1686,14 @@ void fcoEditorWindow::on_LE_SubtitleName_textEdited(const QString &text)
 {
     if (m_groupID != INT_MAX && m_subtitleID != INT_MAX)
     {
-        m_fileEdited = true;
-
-        QTreeWidgetItem *group = ui->TW_TreeWidget->topLevelItem(static_cast<int>(m_groupID));
-        QTreeWidgetItem *subtitle = group->child(static_cast<int>(m_subtitleID));
+        MarkFileEdited();
 
         QString finalText = text.isEmpty() ? "NO_NAME" : text;
-        subtitle->setText(0, finalText);
         m_fco->ModifySubtitleName(m_groupID, m_subtitleID, finalText.toStdString());
+        m_treeModel->UpdateSubtitle(m_groupID, m_subtitleID);
+
+        // Only captions naming the old or new label are checked again
+        m_references->RenameLabel(m_groupID, m_subtitleID, finalText);
     }
 }
 
@@ -1028,13 +1704,13 @@ void fcoEditorWindow::on_TE_TextEditor_textChanged()
 {
     if (ui->TE_TextEditor->isEnabled())
     {
+        TRACE_SCOPE("ui", "Text Changed");
         m_textEdited = true;
 
-        QString str = ui->TE_TextEditor->toPlainText();
-        wstring errorMsg;
-        if (!m_fco->ValidateString(str.toStdWString(), errorMsg, m_characterArray))
+        // Already tokenized in TE_TextEditor_contentsChange()
+        if (!m_tokenizer.IsValid())
         {
-            UpdateStatus(QString::fromStdWString(errorMsg), "color: rgb(255, 0, 0);");
+            UpdateStatus(QString::fromStdWString(m_tokenizer.GetErrorMsg()), "color: rgb(255, 0, 0);");
             m_textValid = false;
             ui->PB_Save->setEnabled(false);
             ui->PB_Reset->setEnabled(true);
@@ -1047,7 +1723,7 @@ void fcoEditorWindow::on_TE_TextEditor_textChanged()
             ui->PB_Reset->setEnabled(m_textEdited || m_colorEdited);
         }
 
-        if (m_characterArray.empty())
+        if (CharacterArray().empty())
         {
             // Empty string auto removes all color blocks
             ui->PB_AddColorBlock->setEnabled(false);
@@ -1055,16 +1731,44 @@ void fcoEditorWindow::on_TE_TextEditor_textChanged()
         }
         else
         {
-            // Update limits of color blocks
+            // Update limits of color blocks (only depend on the symbol count)
             ui->PB_AddColorBlock->setEnabled(true);
-            for (unsigned int i = 0; i < m_colorBlocks.size(); i++)
+            if (CharacterArray().size() != m_characterCount)
             {
-                UpdateStartEndLimits(i);
+                m_colorBlockModel->SetSymbolCount(static_cast<unsigned int>(CharacterArray().size()));
             }
         }
+        m_characterCount = CharacterArray().size();
+
+        // Coalesce fast typing and pasting into one preview update
+        m_previewTimer->start();
+    }
+}
+
+//---------------------------------------------------------------------------
+// Re-tokenize only the edited range of the text editor
+//---------------------------------------------------------------------------
+void fcoEditorWindow::TE_TextEditor_contentsChange(int position, int charsRemoved, int charsAdded)
+{
+    QTextDocument* document = ui->TE_TextEditor->document();
+    int const oldLength = static_cast<int>(m_tokenizer.GetLength());
+    int const newLength = document->characterCount() - 1;
 
-        UpdateSubtitlePreview();
+    // Replacing the whole document also reports the final block separator, tokenize everything
+    if (position + charsRemoved > oldLength || position + charsAdded > newLength || oldLength - charsRemoved + charsAdded != newLength)
+    {
+        m_tokenizer.Reset(document->toPlainText().toStdWString());
+        return;
     }
+
+    QTextCursor cursor(document);
+    cursor.setPosition(position);
+    cursor.setPosition(position + charsAdded, QTextCursor::KeepAnchor);
+
+    // Same conversion as toPlainText()
+    QString added = cursor.selectedText();
+    added.replace(QChar::ParagraphSeparator, '\n').replace(QChar::LineSeparator, '\n').replace(QChar::Nbsp, ' ');
+    m_tokenizer.Update(static_cast<unsigned int>(position), static_cast<unsigned int>(charsRemoved), added.toStdWString());
 }
 
 //---------------------------------------------------------------------------
@@ -1122,140 +1826,92 @@ void fcoEditorWindow::SearchForSubtitle(QString _group, QString _cell)
         return;
     }
 
-    for (int i = 0; i < ui->TW_TreeWidget->topLevelItemCount() ; i++)
+    // Hash lookup into the labels of the open document
+    unsigned int groupID = 0;
+    unsigned int subtitleID = 0;
+    if (m_references->Find(m_fileName, _group, _cell, groupID, subtitleID))
     {
-        // Go through tree view
-        QTreeWidgetItem const* item = ui->TW_TreeWidget->topLevelItem(i);
-        if (item->text(0) == _group)
-        {
-            for (int j = 0; j < item->childCount(); j++)
-            {
-                QTreeWidgetItem const* child = item->child(j);
-                if (child->text(0) == _cell)
-                {
-                    m_eventCaptionEditor->SetPreviewText(child->text(2));
-                    return;
-                }
-            }
-        }
+        m_eventCaptionEditor->SetPreviewText(QString::fromStdWString(m_fco->GetSubtitle(groupID, subtitleID)));
+        return;
     }
 
     m_eventCaptionEditor->SetPreviewText("***Subtitle Not Found***");
 }
 
 //---------------------------------------------------------------------------
-// Message box when user have unsaved changed
+// Subtitles of every text of a cutscene for playback
 //---------------------------------------------------------------------------
-bool fcoEditorWindow::DiscardSaveMessage(QString _title, QString _message, bool _checkFileEdited)
+void fcoEditorWindow::SearchForSubtitles(QStringList _groups, QStringList _cells)
 {
-    if (m_textEdited || m_colorEdited || (_checkFileEdited && m_fileEdited))
+    QStringList subtitles;
+    subtitles.reserve(_cells.size());
+    for (int i = 0; i < _cells.size(); i++)
     {
-        QMessageBox::StandardButton resBtn = QMessageBox::Yes;
-        resBtn = QMessageBox::warning(this, _title, _message, QMessageBox::Yes | QMessageBox::No, QMessageBox::Yes);
-        if (resBtn == QMessageBox::No)
+        unsigned int groupID = 0;
+        unsigned int subtitleID = 0;
+        if (!m_fco->IsLoaded())
         {
-            return false;
+            subtitles << "***Load .fco file to preview subtitle!***";
+        }
+        else if (m_references->Find(m_fileName, _groups[i], _cells[i], groupID, subtitleID))
+        {
+            subtitles << QString::fromStdWString(m_fco->GetSubtitle(groupID, subtitleID));
+        }
+        else
+        {
+            subtitles << "***Subtitle Not Found***";
         }
     }
 
-    return true;
+    m_eventCaptionEditor->SetPlaybackSubtitles(subtitles);
 }
 
 //---------------------------------------------------------------------------
-// Add subgroup to tree view widget
+// Message box when user have unsaved changed
 //---------------------------------------------------------------------------
-void fcoEditorWindow::TW_Refresh()
+bool fcoEditorWindow::DiscardSaveMessage(QString _title, QString _message, bool _checkFileEdited, bool _checkProject)
 {
-    // Reset tree view and push buttons
-    ui->TW_TreeWidget->clear();
-
-    vector<string> groupNames;
-    m_fco->GetGroupNames(groupNames);
-    for (unsigned int groupID = 0; groupID < groupNames.size(); groupID++)
+    // Project documents keep their edits unless the project itself is closed
+    bool fileEdited = _checkFileEdited && m_fileEdited && m_projectIndex == -1;
+    if (_checkProject && m_project)
     {
-        // Add sub-group names
-        string const& groupName = groupNames[groupID];
-        TW_AddSubgroup(QString::fromStdString(groupName), groupID);
-
-        // Add subtitles
-        vector<string> labels;
-        vector<wstring> subtitles;
-        m_fco->GetSubgroupSubtitles(groupID, labels, subtitles);
-        QTreeWidgetItem *item = ui->TW_TreeWidget->topLevelItem(static_cast<int>(groupID));
-        for (unsigned int subtitleID = 0; subtitleID < subtitles.size(); subtitleID++)
-        {
-            string const& label = labels[subtitleID];
-            wstring const& subtitle = subtitles[subtitleID];
-            TW_AddSubtitle(item, QString::fromStdString(label), QString::fromStdWString(subtitle));
-        }
+        fileEdited |= m_fileEdited || m_project->HasDirtyFiles();
     }
-}
 
-//---------------------------------------------------------------------------
-// Update serifu ID (after deleting group or subtitle)
-//---------------------------------------------------------------------------
-void fcoEditorWindow::TW_UpdateSerifuID()
-{
-    for (int i = 0; i < ui->TW_TreeWidget->topLevelItemCount(); i++)
+    if (m_textEdited || m_colorEdited || fileEdited)
     {
-        QTreeWidgetItem *group = ui->TW_TreeWidget->topLevelItem(i);
-        group->setText(1, i == 0 ? "" : QString::number(i) + "xxx");
-        for (int j = 0; j < group->childCount(); j++)
+        QMessageBox::StandardButton resBtn = QMessageBox::Yes;
+        resBtn = QMessageBox::warning(this, _title, _message, QMessageBox::Yes | QMessageBox::No, QMessageBox::Yes);
+        if (resBtn == QMessageBox::No)
         {
-            QTreeWidgetItem *subtitle = group->child(j);
-            unsigned int serifuID = static_cast<unsigned int>(i * 1000 + j);
-            subtitle->setText(1, serifuID < 1000 ? "" : QString::number(serifuID));
+            return false;
         }
     }
+
+    return true;
 }
 
 //---------------------------------------------------------------------------
 // Update serifu ID (after loading subtitle or reordering tree view)
 //---------------------------------------------------------------------------
-void fcoEditorWindow::TW_UpdateUpDownButtons()
+void fcoEditorWindow::TV_UpdateUpDownButtons()
 {
     ui->PB_GroupUp->setEnabled(m_groupID != 0);
-    ui->PB_GroupDown->setEnabled(static_cast<int>(m_groupID) < ui->TW_TreeWidget->topLevelItemCount() - 1);
+    ui->PB_GroupDown->setEnabled(m_groupID + 1 < m_fco->GetGroupCount());
     ui->PB_SubtitleUp->setEnabled(m_subtitleID != 0);
-    ui->PB_SubtitleDown->setEnabled(static_cast<int>(m_subtitleID) < ui->TW_TreeWidget->topLevelItem(static_cast<int>(m_groupID))->childCount() - 1);
-}
-
-//---------------------------------------------------------------------------
-// Add subgroup to tree view widget
-//---------------------------------------------------------------------------
-void fcoEditorWindow::TW_AddSubgroup(QString _groupName, unsigned int _groupID)
-{
-    QTreeWidgetItem *item = new QTreeWidgetItem(ui->TW_TreeWidget);
-    item->setText(0, _groupName);
-    item->setText(1, _groupID == 0 ? "" : QString::number(_groupID) + "xxx");
-    item->setTextAlignment(1, Qt::AlignCenter);
-    ui->TW_TreeWidget->addTopLevelItem(item);
-}
-
-//---------------------------------------------------------------------------
-// Add subtitle to tree view widget
-//---------------------------------------------------------------------------
-void fcoEditorWindow::TW_AddSubtitle(QTreeWidgetItem *_parent, QString _label, QString _subtitle)
-{
-    int serifuID = ui->TW_TreeWidget->indexOfTopLevelItem(_parent) * 1000 + _parent->childCount();
-    QTreeWidgetItem *item = new QTreeWidgetItem();
-    item->setText(0, _label);
-    item->setText(1, serifuID < 1000 ? "" : QString::number(serifuID));
-    item->setText(2, _subtitle);
-    item->setTextAlignment(1, Qt::AlignCenter);
-    _parent->addChild(item);
+    ui->PB_SubtitleDown->setEnabled(m_subtitleID + 1 < m_fco->GetSubtitleCount(m_groupID));
 }
 
 //---------------------------------------------------------------------------
 // Focus item in tree view (default current group and subtitle)
 //---------------------------------------------------------------------------
-void fcoEditorWindow::TW_FocusItem(unsigned int _groupID, unsigned int _subtitleID)
+void fcoEditorWindow::TV_FocusItem(unsigned int _groupID, unsigned int _subtitleID)
 {
     // Focus on item
-    QTreeWidgetItem *child = ui->TW_TreeWidget->topLevelItem(static_cast<int>(_groupID))->child(static_cast<int>(_subtitleID));
-    ui->TW_TreeWidget->setCurrentItem(child);
-    ui->TW_TreeWidget->scrollTo(ui->TW_TreeWidget->currentIndex(), QAbstractItemView::ScrollHint::PositionAtCenter);
-    ui->TW_TreeWidget->setFocus();
+    QModelIndex const index = m_treeModel->SubtitleIndex(_groupID, _subtitleID);
+    ui->TV_TreeView->setCurrentIndex(index);
+    ui->TV_TreeView->scrollTo(index, QAbstractItemView::ScrollHint::PositionAtCenter);
+    ui->TV_TreeView->setFocus();
 }
 
 //---------------------------------------------------------------------------
@@ -1273,6 +1929,7 @@ void fcoEditorWindow::ResetSubtitleEditor()
     ui->TE_TextEditor->setText("");
     ui->PB_Save->setEnabled(false);
     ui->PB_Reset->setEnabled(false);
+    m_previewTimer->stop();
     m_previewLabel->setText("");
     ClearColorBlocks();
     ui->DefaultAlpha->setEnabled(false);
@@ -1287,6 +1944,7 @@ void fcoEditorWindow::ResetSubtitleEditor()
     // Reset Variables
     m_groupID = INT_MAX;
     m_subtitleID = INT_MAX;
+    m_treeModel->SetHighlight(INT_MAX, INT_MAX);
     m_textEdited = false;
     m_textValid = false;
     m_colorEdited = false;
@@ -1303,133 +1961,62 @@ void fcoEditorWindow::UpdateStatus(QString _status, QString _styleSheet)
 }
 
 //---------------------------------------------------------------------------
-// Update subtitle preview from reading m_characterArray
+// Update subtitle preview from the tokenized text
 //---------------------------------------------------------------------------
 void fcoEditorWindow::UpdateSubtitlePreview()
 {
-    if (m_characterArray.empty())
-    {
-        m_previewLabel->setText("");
-        return;
-    }
+    TRACE_SCOPE("ui", "Preview Render");
 
-    // Initialize color index for each character
-    vector<int> colorIndices;
-    colorIndices.resize(m_characterArray.size(), -1);
+    vector<wstring> const& characterArray = CharacterArray();
 
-    // Read color blocks with priority and fill the array
-    for (unsigned int id = 0; id < m_colorBlocks.size(); id++)
+    if (characterArray.empty())
     {
-        QSpinBox* start = reinterpret_cast<QSpinBox*>(ui->VL_Start->layout()->itemAt(static_cast<int>(id + 1))->widget());
-        QSpinBox* end = reinterpret_cast<QSpinBox*>(ui->VL_End->layout()->itemAt(static_cast<int>(id + 1))->widget());
-        for (unsigned int i = static_cast<unsigned int>(start->value()); i <= static_cast<unsigned int>(end->value()); i++)
-        {
-            if (i < m_characterArray.size())
-            {
-                QString chr = QString::fromStdWString(m_characterArray[i]);
-                if (chr != " " && chr != "　")
-                {
-                    colorIndices[i] = static_cast<int>(id);
-                }
-            }
-        }
+        m_previewLabel->clear();
+        return;
     }
 
+    // Resolve overlapping color blocks into runs
+    vector<fco::ColorBlock> const& colorBlocks = m_colorBlockModel->GetColorBlocks();
+    vector<fco::ColorRun> colorRuns;
+    fco::ResolveColorRuns(colorBlocks, static_cast<unsigned int>(characterArray.size()), colorRuns);
+
     // Count how many line breaks
     int lineBreakCount = 0;
-    for (unsigned int i = 0; i < m_characterArray.size(); i++)
+    for (unsigned int i = 0; i < characterArray.size(); i++)
     {
-        QString chr = QString::fromStdWString(m_characterArray[i]);
-        if (chr == "\n") lineBreakCount++;
+        if (characterArray[i] == L"\n") lineBreakCount++;
     }
 
-    QString htmlString;
-    for (unsigned int i = 0; i < m_characterArray.size(); i++)
-    {
-        QString chr = QString::fromStdWString(m_characterArray[i]);
-
-        // Larger than and smaller than
-        if (chr == "<") chr = "&lt;";
-        if (chr == ">") chr = "&gt;";
-
-        // Line break in html
-        if (chr == "\n") chr = "<br>";
-
-        // Space in html
-        if (chr == " ") chr = "<font color=\"#00000000\">]</font>";
-
-        // Japanese Space in html
-        if (chr == "　") chr = "<font color=\"#00000000\">]ii</font>";
-
-        // Button images
-        if (chr.startsWith('\\'))
-        {
-            chr = "<img src=\":/resources/" + chr.mid(1, chr.size() - 2) + ".png\">";
-        }
-
-        if (colorIndices[i] != -1)
-        {
-            // New start (current not equal to previous)
-            if (i == 0 || colorIndices[i] != colorIndices[i - 1])
-            {
-                fco::Color color = m_colorBlocks[static_cast<unsigned int>(colorIndices[i])].m_color;
-                QString r,g,b,a;
-
-                QCheckBox* checkbox = reinterpret_cast<QCheckBox*>(ui->VL_Hardcoded->layout()->itemAt(colorIndices[i] + 1)->widget());
-                if (checkbox->isChecked())
-                {
-                    if (lineBreakCount < 2)
-                    {
-                        r = "FF"; g = "FF"; b = "FF";
-                    }
-                    else
-                    {
-                        r = "00"; g = "00"; b = "00";
-                    }
-                }
-                else
-                {
-                    r.setNum(color.r, 16); if (color.r < 0x10) r = "0" + r;
-                    g.setNum(color.g, 16); if (color.g < 0x10) g = "0" + g;
-                    b.setNum(color.b, 16); if (color.b < 0x10) b = "0" + b;
-                }
-                a.setNum(color.a, 16); if (color.a < 0x10) a = "0" + a;
-                chr = "<font color=\"#" + a + r + g + b + "\">" + chr;
-            }
-
-            // Color block ended (reached the end or next index is different)
-            if (i == m_characterArray.size() - 1 || colorIndices[i] != colorIndices[i + 1])
-            {
-                chr = chr + "</font>";
-            }
-        }
+    // Hardcoded colors are white on the Omochao box, black otherwise
+    QColor const hardcodedColor = (lineBreakCount < 2) ? QColor(255, 255, 255) : QColor(0, 0, 0);
 
-        htmlString += chr;
-    }
+    QColor defaultColor = m_defaultColor.IsHardcoded() ? hardcodedColor : QColor(m_defaultColor.r, m_defaultColor.g, m_defaultColor.b);
+    defaultColor.setAlpha(m_defaultColor.a);
 
-    // Check if default color is using hardcoded or not
-    QString r,g,b,a;
-    if (!m_defaultColor.IsHardcoded())
+    vector<QColor> blockColors;
+    blockColors.reserve(colorBlocks.size());
+    for (unsigned int id = 0; id < colorBlocks.size(); id++)
     {
-        r.setNum(m_defaultColor.r, 16); if (m_defaultColor.r < 0x10) r = "0" + r;
-        g.setNum(m_defaultColor.g, 16); if (m_defaultColor.g < 0x10) g = "0" + g;
-        b.setNum(m_defaultColor.b, 16); if (m_defaultColor.b < 0x10) b = "0" + b;
+        fco::Color color = colorBlocks[id].m_color;
+        QColor blockColor = color.IsHardcoded() ? hardcodedColor : QColor(color.r, color.g, color.b);
+        blockColor.setAlpha(color.a);
+        blockColors.push_back(blockColor);
     }
-    else
+
+    // Spaces keep the default color
+    vector<QColor> colors;
+    colors.reserve(characterArray.size());
+    for (fco::ColorRun const& colorRun : colorRuns)
     {
-        if (lineBreakCount < 2)
-        {
-            r = "FF"; g = "FF"; b = "FF";
-        }
-        else
+        QColor const& runColor = (colorRun.m_colorBlockID == -1) ? defaultColor : blockColors[static_cast<unsigned int>(colorRun.m_colorBlockID)];
+        for (unsigned int i = colorRun.m_start; i <= colorRun.m_end; i++)
         {
-            r = "00"; g = "00"; b = "00";
+            wstring const& chr = characterArray[i];
+            colors.push_back((chr == L" " || chr == L"　") ? defaultColor : runColor);
         }
     }
-    a.setNum(m_defaultColor.a, 16); if (m_defaultColor.a < 0x10) a = "0" + a;
-    htmlString = "<font color=\"#" + a + r + g + b + "\">" + htmlString + "</font>";
 
-    m_previewLabel->setText(htmlString);
+    m_previewLabel->setPixmap(m_subtitleRenderer.Render(characterArray, colors));
 
     if(lineBreakCount < 2)
     {
@@ -1447,6 +2034,7 @@ void fcoEditorWindow::UpdateSubtitlePreview()
         ui->SA_Preview->setMinimumHeight(110 + qMin((lineBreakCount - 1), 6) * 27);
         ui->L_Preview->setPixmap(QPixmap());
     }
+    m_colorBlockModel->SetTextIsOmochao(m_textIsOmochao);
 }
 
 //---------------------------------------------------------------------------
@@ -1454,36 +2042,18 @@ void fcoEditorWindow::UpdateSubtitlePreview()
 //---------------------------------------------------------------------------
 void fcoEditorWindow::LoadSubtitle(unsigned int _groupID, unsigned int _subtitleID)
 {
-    // Un-highlight previous selection
-    if (m_groupID != INT_MAX && m_subtitleID != INT_MAX)
-    {
-        QTreeWidgetItem* parent = ui->TW_TreeWidget->topLevelItem(static_cast<int>(m_groupID));
-        parent->setForeground(0, QColor(0,0,0));
-        parent->setForeground(1, QColor(0,0,0));
-        QTreeWidgetItem* child = parent->child(static_cast<int>(m_subtitleID));
-        child->setForeground(0, QColor(0,0,0));
-        child->setForeground(1, QColor(0,0,0));
-        child->setForeground(2, QColor(0,0,0));
-    }
-
     // Save IDs
     m_groupID = _groupID;
     m_subtitleID = _subtitleID;
 
     // Highlight selected
-    QTreeWidgetItem* parent = ui->TW_TreeWidget->topLevelItem(static_cast<int>(m_groupID));
-    QString group = parent->text(0);
-    parent->setForeground(0, QColor(255,0,0));
-    parent->setForeground(1, QColor(255,0,0));
-    QTreeWidgetItem* child = parent->child(static_cast<int>(m_subtitleID));
-    child->setForeground(0, QColor(255,0,0));
-    child->setForeground(1, QColor(255,0,0));
-    child->setForeground(2, QColor(255,0,0));
+    m_treeModel->SetHighlight(m_groupID, m_subtitleID);
+    QString group = QString::fromStdString(m_fco->GetGroupName(m_groupID));
 
     ui->PB_NewSubtitle->setEnabled(true);
     ui->PB_DeleteGroup->setEnabled(true);
     ui->PB_DeleteSubtitle->setEnabled(true);
-    TW_UpdateUpDownButtons();
+    TV_UpdateUpDownButtons();
 
     // Load subtitle
     QString label = QString::fromStdString(m_fco->GetLabel(m_groupID, m_subtitleID));
@@ -1499,9 +2069,7 @@ void fcoEditorWindow::LoadSubtitle(unsigned int _groupID, unsigned int _subtitle
     m_textValid = true;
     m_textEdited = false;
 
-    // Validate once to get individual characters (should always be valid)
-    wstring errorMsg;
-    m_fco->ValidateString(ui->TE_TextEditor->toPlainText().toStdWString(), errorMsg, m_characterArray);
+    m_characterCount = CharacterArray().size();
 
     // Load default color
     ui->DefaultHardcoded->setChecked(false);
@@ -1535,9 +2103,19 @@ void fcoEditorWindow::LoadSubtitle(unsigned int _groupID, unsigned int _subtitle
 
     ui->PB_Save->setEnabled(false);
     ui->PB_Reset->setEnabled(false);
+    m_previewTimer->stop();
     UpdateSubtitlePreview();
 }
 
+//---------------------------------------------------------------------------
+// Symbols of the text editor, empty while the text is invalid
+//---------------------------------------------------------------------------
+vector<wstring> const& fcoEditorWindow::CharacterArray() const
+{
+    static vector<wstring> const s_empty;
+    return m_tokenizer.IsValid() ? m_tokenizer.GetSymbols() : s_empty;
+}
+
 //---------------------------------------------------------------------------
 // Remove all color blocks in the editor
 //---------------------------------------------------------------------------
@@ -1546,15 +2124,8 @@ void fcoEditorWindow::ClearColorBlocks()
     ui->PB_AddColorBlock->setEnabled(false);
 
     // Reset color block editor
-    m_colorBlocks.clear();
-    for (unsigned int i = 0; i <= 8; i++)
-    {
-        QLayout* vBox = ui->HL_ColorBlocks->layout()->itemAt(static_cast<int>(i))->layout();
-        while (vBox->count() > 2)
-        {
-            delete vBox->takeAt(1)->widget();
-        }
-    }
+    m_colorBlockModel->Clear();
+    UpdateColorBlockButtons();
 }
 
 //---------------------------------------------------------------------------
@@ -1562,260 +2133,50 @@ void fcoEditorWindow::ClearColorBlocks()
 //---------------------------------------------------------------------------
 void fcoEditorWindow::LoadColorBlocks(unsigned int _groupID, unsigned int _subtitleID)
 {
-    ClearColorBlocks();
-
     // Enable add button
     ui->PB_AddColorBlock->setEnabled(true);
 
     // Load color blocks
-    m_fco->GetSubtitleColorBlocks(_groupID, _subtitleID, m_colorBlocks);
-    for (unsigned int colorBlockID = 0; colorBlockID < m_colorBlocks.size(); colorBlockID++)
-    {
-        AddColorBlock(colorBlockID, m_colorBlocks[colorBlockID]);
-    }
-    EnableUpDownButtons();
-}
-
-//---------------------------------------------------------------------------
-// Add a new color block for the editor
-//---------------------------------------------------------------------------
-void fcoEditorWindow::AddColorBlock(unsigned int _id, fco::ColorBlock _colorBlock)
-{
-    // ALL WIDGETS MUST HAVE MINIMUM HEIGHT 26
-    // 0: ID, 1: Hardcoded, 2: Color, 3: Alpha, 4: Start, 5: End, 6: Move Up, 7: Move Down, 8: Delete
-
-    QLabel *label = new QLabel();
-    label->setSizePolicy(QSizePolicy::Ignored, QSizePolicy::Fixed);
-    label->setMinimumHeight(26);
-    label->setText(QString::number(_id + 1) + ": ");
-    label->setStyleSheet("font-size: 12px;");
-    ui->VL_ID->insertWidget(static_cast<int>(_id + 1), label);
-
-    QCheckBox *checkbox = new QCheckBox();
-    checkbox->setSizePolicy(QSizePolicy::Ignored, QSizePolicy::Fixed);
-    checkbox->setMinimumHeight(26);
-    checkbox->setChecked(_colorBlock.m_color.IsHardcoded());
-    checkbox->setStyleSheet("margin-left:32%;");
-    ui->VL_Hardcoded->insertWidget(static_cast<int>(_id + 1), checkbox);
-    connect(checkbox, SIGNAL(stateChanged(int)), this, SLOT(SetHardcoded(int)));
-
-    QTextBrowser *colorBrowser = new QTextBrowser();
-    colorBrowser->setSizePolicy(QSizePolicy::Ignored, QSizePolicy::Fixed);
-    colorBrowser->setMaximumHeight(26);
-    QColor currentColor;
-    if (_colorBlock.m_color.IsHardcoded())
-    {
-        currentColor.setRgb(240, 240, 240);
-        colorBrowser->setEnabled(false);
-    }
-    else
-    {
-        currentColor.setRgb(_colorBlock.m_color.r, _colorBlock.m_color.g, _colorBlock.m_color.b);
-        colorBrowser->setEnabled(true);
-    }
-    QPalette pal = palette();
-    pal.setColor(QPalette::Base, currentColor);
-    colorBrowser->setPalette(pal);
-    colorBrowser->installEventFilter(this);
-    ui->VL_Color->insertWidget(static_cast<int>(_id + 1), colorBrowser);
-
-    QSpinBox *alpha = new QSpinBox();
-    alpha->setSizePolicy(QSizePolicy::Ignored, QSizePolicy::Fixed);
-    alpha->setMinimumHeight(26);
-    alpha->setMinimum(0);
-    alpha->setMaximum(255);
-    alpha->setValue(_colorBlock.m_color.a);
-    alpha->setCursor(Qt::SizeVerCursor);
-    alpha->installEventFilter(this);
-    ui->VL_Alpha->insertWidget(static_cast<int>(_id + 1), alpha);
-    connect(alpha, SIGNAL(valueChanged(int)), this, SLOT(ColorSpinBoxChanged(int)));
-
-    QSpinBox *start = new QSpinBox();
-    start->setSizePolicy(QSizePolicy::Ignored, QSizePolicy::Fixed);
-    start->setMinimumHeight(26);
-    start->setMinimum(0);
-    start->setMaximum(static_cast<int>(m_characterArray.size() - 1));
-    start->setValue(static_cast<int>(_colorBlock.m_start));
-    start->setCursor(Qt::SizeVerCursor);
-    start->installEventFilter(this);
-    ui->VL_Start->insertWidget(static_cast<int>(_id + 1), start);
-    connect(start, SIGNAL(valueChanged(int)), this, SLOT(ColorSpinBoxChanged(int)));
-
-    QSpinBox *end = new QSpinBox();
-    end->setSizePolicy(QSizePolicy::Ignored, QSizePolicy::Fixed);
-    end->setMinimumHeight(26);
-    end->setMinimum(0);
-    end->setMaximum(static_cast<int>(m_characterArray.size() - 1));
-    end->setValue(static_cast<int>(_colorBlock.m_end));
-    end->setCursor(Qt::SizeVerCursor);
-    end->installEventFilter(this);
-    ui->VL_End->insertWidget(static_cast<int>(_id + 1), end);
-    connect(end, SIGNAL(valueChanged(int)), this, SLOT(ColorSpinBoxChanged(int)));
-
-    UpdateStartEndLimits(_id);
-
-    QToolButton *moveUp = new QToolButton();
-    moveUp->setSizePolicy(QSizePolicy::Ignored, QSizePolicy::Fixed);
-    moveUp->setMinimumHeight(26);
-    moveUp->setArrowType(Qt::ArrowType::UpArrow);
-    ui->VL_Up->insertWidget(static_cast<int>(_id + 1), moveUp);
-    connect(moveUp, SIGNAL(clicked(bool)), this, SLOT(SwapColorBlocks()));
-
-    QToolButton *moveDown = new QToolButton();
-    moveDown->setSizePolicy(QSizePolicy::Ignored, QSizePolicy::Fixed);
-    moveDown->setMinimumHeight(26);
-    moveDown->setArrowType(Qt::ArrowType::DownArrow);
-    ui->VL_Down->insertWidget(static_cast<int>(_id + 1), moveDown);
-    connect(moveDown, SIGNAL(clicked(bool)), this, SLOT(SwapColorBlocks()));
-
-    QPushButton *del = new QPushButton();
-    del->setSizePolicy(QSizePolicy::Ignored, QSizePolicy::Fixed);
-    del->setMinimumHeight(26);
-    del->setMaximumHeight(26);
-    del->setText("X");
-    del->setMaximumWidth(20);
-    ui->VL_Delete->insertWidget(static_cast<int>(_id + 1), del);
-    connect(del, SIGNAL(clicked()), this, SLOT(RemoveColorBlock()));
-}
-
-//---------------------------------------------------------------------------
-// Signal sent when delete button is pressed
-//---------------------------------------------------------------------------
-void fcoEditorWindow::RemoveColorBlock()
-{
-    QWidget* widget = reinterpret_cast<QWidget*>(sender());
-    int index = ui->VL_Delete->indexOf(widget);
-    m_colorBlocks.erase(m_colorBlocks.begin() + index - 1);
-
-    delete ui->VL_ID->layout()->takeAt(index)->widget();
-    delete ui->VL_Hardcoded->layout()->takeAt(index)->widget();
-    delete ui->VL_Color->layout()->takeAt(index)->widget();
-    delete ui->VL_Alpha->layout()->takeAt(index)->widget();
-    delete ui->VL_Start->layout()->takeAt(index)->widget();
-    delete ui->VL_End->layout()->takeAt(index)->widget();
-    delete ui->VL_Up->layout()->takeAt(index)->widget();
-    delete ui->VL_Down->layout()->takeAt(index)->widget();
-    delete ui->VL_Delete->layout()->takeAt(index)->widget();
-
-    // Rename id
-    for (int i = 1; i < ui->VL_ID->layout()->count() - 1; i++)
-    {
-        QLabel* label = reinterpret_cast<QLabel*>(ui->VL_ID->itemAt(i)->widget());
-        label->setText(QString::number(i) + ": ");
-    }
-
-    // Save & Reset buttons
-    m_colorEdited = true;
-    ui->PB_Save->setEnabled(true);
-    ui->PB_Reset->setEnabled(true);
-
-    EnableUpDownButtons();
-    UpdateSubtitlePreview();
+    vector<fco::ColorBlock> colorBlocks;
+    m_fco->GetSubtitleColorBlocks(_groupID, _subtitleID, colorBlocks);
+    m_colorBlockModel->SetColorBlocks(colorBlocks);
+    m_colorBlockModel->SetSymbolCount(static_cast<unsigned int>(CharacterArray().size()));
+    UpdateColorBlockButtons();
 }
 
 //---------------------------------------------------------------------------
-// When color blocks changed, need to fix up down button enability
+// Delete/up/down buttons follow the selected color block
 //---------------------------------------------------------------------------
-void fcoEditorWindow::EnableUpDownButtons()
+void fcoEditorWindow::UpdateColorBlockButtons()
 {
-    int count = ui->VL_Up->layout()->count();
-    for (int i = 1; i < count - 1; i++)
-    {
-        QToolButton* upButton = reinterpret_cast<QToolButton*>(ui->VL_Up->itemAt(i)->widget());
-        QToolButton* downButton = reinterpret_cast<QToolButton*>(ui->VL_Down->itemAt(i)->widget());
+    int const row = ui->TV_ColorBlocks->currentIndex().row();
+    int const count = m_colorBlockModel->rowCount();
 
-        upButton->setEnabled(i != 1);
-        downButton->setEnabled(i != count - 2);
-    }
+    ui->PB_DeleteColorBlock->setEnabled(row >= 0 && row < count);
+    ui->PB_ColorBlockUp->setEnabled(row > 0 && row < count);
+    ui->PB_ColorBlockDown->setEnabled(row >= 0 && row < count - 1);
 }
 
 //---------------------------------------------------------------------------
-// Aplha, start or end spin box changed
+// Any color block edited, added, removed or moved
 //---------------------------------------------------------------------------
-void fcoEditorWindow::ColorSpinBoxChanged(int _value)
+void fcoEditorWindow::ColorBlocksEdited()
 {
-    QWidget* widget = reinterpret_cast<QWidget*>(sender());
-    bool isHardcoded = (widget == ui->DefaultAlpha);
-    int index1 = ui->VL_Alpha->indexOf(widget);
-    int index2 = ui->VL_Start->indexOf(widget);
-    int index3 = ui->VL_End->indexOf(widget);
-
-    if (isHardcoded)
-    {
-        m_defaultColor.a = static_cast<unsigned char>(_value);
-    }
-    else if (index1 > 0)
-    {
-        m_colorBlocks[static_cast<unsigned int>(index1 - 1)].m_color.a = static_cast<unsigned char>(_value);
-    }
-    else if (index2 > 0)
-    {
-        m_colorBlocks[static_cast<unsigned int>(index2 - 1)].m_start = static_cast<unsigned int>(_value);
-        UpdateStartEndLimits(static_cast<unsigned int>(index2 - 1));
-    }
-    else if (index3 > 0)
-    {
-        m_colorBlocks[static_cast<unsigned int>(index3 - 1)].m_end = static_cast<unsigned int>(_value);
-        UpdateStartEndLimits(static_cast<unsigned int>(index3 - 1));
-    }
-    else
-    {
-        return;
-    }
-
     // Save & Reset buttons
     m_colorEdited = true;
     ui->PB_Save->setEnabled(true);
     ui->PB_Reset->setEnabled(true);
 
+    UpdateColorBlockButtons();
     UpdateSubtitlePreview();
 }
 
 //---------------------------------------------------------------------------
-// Swap two color blocks
+// Default alpha spin box changed
 //---------------------------------------------------------------------------
-void fcoEditorWindow::SwapColorBlocks()
+void fcoEditorWindow::ColorSpinBoxChanged(int _value)
 {
-    QWidget* widget = reinterpret_cast<QWidget*>(sender());
-    int index1 = ui->VL_Up->indexOf(widget);
-    int index2 = ui->VL_Down->indexOf(widget);
-
-    if (index1 > 1)
-    {
-        // Move up
-        fco::ColorBlock temp = m_colorBlocks[static_cast<unsigned int>(index1 - 1)];
-        m_colorBlocks[static_cast<unsigned int>(index1 - 1)] = m_colorBlocks[static_cast<unsigned int>(index1 - 2)];
-        m_colorBlocks[static_cast<unsigned int>(index1 - 2)] = temp;
-
-        // 1:Hardcoded, 2: Color, 3: Alpha, 4: Start, 5: End
-        for (int i = 1; i <= 5; i++)
-        {
-            QVBoxLayout* vBox = reinterpret_cast<QVBoxLayout*>(ui->HL_ColorBlocks->layout()->itemAt(i)->layout());
-            widget = vBox->itemAt(index1)->widget();
-            vBox->removeWidget(widget);
-            vBox->insertWidget(index1 - 1, widget);
-        }
-    }
-    else if (index2 > 0)
-    {
-        // Move down
-        fco::ColorBlock temp = m_colorBlocks[static_cast<unsigned int>(index2 - 1)];
-        m_colorBlocks[static_cast<unsigned int>(index2 - 1)] = m_colorBlocks[static_cast<unsigned int>(index2)];
-        m_colorBlocks[static_cast<unsigned int>(index2)] = temp;
-
-        // 1:Hardcoded, 2: Color, 3: Alpha, 4: Start, 5: End
-        for (int i = 1; i <= 5; i++)
-        {
-            QVBoxLayout* vBox = reinterpret_cast<QVBoxLayout*>(ui->HL_ColorBlocks->layout()->itemAt(i)->layout());
-            widget = vBox->itemAt(index2)->widget();
-            vBox->removeWidget(widget);
-            vBox->insertWidget(index2 + 1, widget);
-        }
-    }
-    else
-    {
-        return;
-    }
+    m_defaultColor.a = static_cast<unsigned char>(_value);
 
     // Save & Reset buttons
     m_colorEdited = true;
@@ -1826,49 +2187,14 @@ void fcoEditorWindow::SwapColorBlocks()
 }
 
 //---------------------------------------------------------------------------
-// Update the upper and lower limit of start and end spin box
-//---------------------------------------------------------------------------
-void fcoEditorWindow::UpdateStartEndLimits(unsigned int _id)
-{
-    if (m_characterArray.empty())
-    {
-        return;
-    }
-
-    QSpinBox* start = reinterpret_cast<QSpinBox*>(ui->VL_Start->layout()->itemAt(static_cast<int>(_id + 1))->widget());
-    QSpinBox* end = reinterpret_cast<QSpinBox*>(ui->VL_End->layout()->itemAt(static_cast<int>(_id + 1))->widget());
-
-    // Clamp it first
-    start->setMinimum(0);
-    end->setMinimum(0);
-    start->setMaximum(static_cast<int>(m_characterArray.size() - 1));
-    end->setMaximum(static_cast<int>(m_characterArray.size() - 1));
-
-    start->setMaximum(end->value());
-    end->setMinimum(start->value());
-}
-
-//---------------------------------------------------------------------------
-// Hardcoded checkbox is changed
+// Default hardcoded checkbox is changed
 //---------------------------------------------------------------------------
 void fcoEditorWindow::SetHardcoded(int _state)
 {
-    QCheckBox* checkbox = reinterpret_cast<QCheckBox*>(sender());
-
-    int index = ui->VL_Hardcoded->indexOf(checkbox);
-    bool isHardcoded = (checkbox == ui->DefaultHardcoded);
-    QTextBrowser *colorBrowser;
-    if (isHardcoded)
-    {
-        colorBrowser = ui->DefaultColor;
-    }
-    else
-    {
-        colorBrowser = reinterpret_cast<QTextBrowser*>(ui->VL_Color->itemAt(index)->widget());
-    }
+    QTextBrowser *colorBrowser = ui->DefaultColor;
 
     QColor currentColor;
-    fco::Color& color = isHardcoded ? m_defaultColor : m_colorBlocks[static_cast<unsigned int>(index - 1)].m_color;
+    fco::Color& color = m_defaultColor;
     if (_state == Qt::CheckState::Unchecked)
     {
         if (m_textIsOmochao)
@@ -6,13 +6,18 @@
 #include <QFileDialog>
 #include <QFileInfo>
 #include <QFile>
+#include <QSaveFile>
 #include <QFontDatabase>
 #include <QSpinBox>
 #include <QMessageBox>
 #include <QMouseEvent>
 #include <QHBoxLayout>
 #include <QVBoxLayout>
-#include <QTreeWidgetItem>
+#include <QTreeView>
+#include <QTableView>
+#include <QHeaderView>
+#include <QTextDocument>
+#include <QTimer>
 #include <QTextBrowser>
 #include <QToolButton>
 #include <QCommonStyle>
@@ -21,9 +26,22 @@
 #include <QShortcut>
 #include <QMimeData>
 #include <QDebug>
+#include <QFutureWatcher>
+#include <QProgressDialog>
+#include <QtConcurrent>
+
+#include <atomic>
 
 #include "fco.h"
+#include "fcoproject.h"
+#include "fcoprojectpanel.h"
+#include "colorblockmodel.h"
+#include "fcotreemodel.h"
+#include "subtitlerenderer.h"
+#include "subtitletokenizer.h"
+#include "tracer.h"
 #include "eventcaptioneditor.h"
+#include "captionreferences.h"
 #include "databasegenerator.h"
 
 using namespace std;
@@ -59,12 +77,19 @@ private slots:
     void on_actionAbout_Qt_triggered();
     void on_actionEvent_Caption_Editor_cap_triggered();
     void on_actionDatabase_Generator_fte_triggered();
+    void on_actionRecord_Performance_Trace_triggered(bool checked);
+    void on_actionOpen_Project_triggered();
+    void on_actionSave_All_Project_triggered();
+    void on_actionFind_in_All_Files_triggered();
 
     // Push buttons
     void on_PB_Find_clicked();
     void on_PB_Reset_clicked();
     void on_PB_Save_clicked();
     void on_PB_AddColorBlock_clicked();
+    void on_PB_DeleteColorBlock_clicked();
+    void on_PB_ColorBlockUp_clicked();
+    void on_PB_ColorBlockDown_clicked();
     void on_PB_Expand_clicked();
     void on_PB_Collapse_clicked();
     void on_PB_NewGroup_clicked();
@@ -78,7 +103,7 @@ private slots:
     void on_PB_SerifuID_clicked();
 
     // Tree view
-    void on_TW_TreeWidget_itemDoubleClicked(QTreeWidgetItem *item, int column);
+    void on_TV_TreeView_doubleClicked(const QModelIndex &index);
 
     // Line edit
     void on_LE_Find_textEdited(const QString &text);
@@ -89,11 +114,11 @@ private slots:
     // Subtitle editor
     void on_TE_TextEditor_textChanged();
     void on_TE_TextEditor_undoAvailable(bool b);
+    void TE_TextEditor_contentsChange(int position, int charsRemoved, int charsAdded);
 
     // Color blocks editor
-    void RemoveColorBlock();
+    void ColorBlocksEdited();
     void ColorSpinBoxChanged(int _value);
-    void SwapColorBlocks();
     void SetHardcoded(int _state);
 
     // Shortcuts
@@ -103,31 +128,57 @@ private slots:
 
     // Pass subtitle to caption editor
     void SearchForSubtitle(QString _group, QString _cell);
+    void SearchForSubtitles(QStringList _groups, QStringList _cells);
+
+    // Background loading/saving
+    void LoadFinished();
+    void SaveFinished();
+    void Autosave();
+    void AutosaveFinished();
+
+    // Project
+    void ProjectFileActivated(int _fileIndex);
+    void ProjectResultActivated(int _fileIndex, unsigned int _groupID, unsigned int _subtitleID);
+    void ProjectSearchRequested();
+    void ProjectFileIndexed(int _fileIndex);
+    void SaveAllFinished();
+
+private:
+    struct ProjectSaveJob
+    {
+        int m_fileIndex;
+        fco* m_snapshot;
+        QString m_fileName;
+    };
 
 private:
     void OpenFile(QString const& fcoFile, bool showSuccess = true);
-    bool DiscardSaveMessage(QString _title, QString _message, bool _checkFileEdited = false);
+    bool OpenProjectFile(int _fileIndex);
+    void ShowDocument(QString const& _fileName);
+    void UpdateReferenceLabels();
+    void UpdateReferenceGroup(unsigned int _groupID);
+    QStringList GetGroupLabels(unsigned int _groupID);
+    static QString SaveProjectFile(ProjectSaveJob const& _job);
+    bool DiscardSaveMessage(QString _title, QString _message, bool _checkFileEdited = false, bool _checkProject = false);
+    void StartSave(QString const& _fileName, QString const& _title);
+    QString AutosaveFile() const;
+    void MarkFileEdited();
 
-    // Tree widget
-    void TW_Refresh();
-    void TW_UpdateSerifuID();
-    void TW_UpdateUpDownButtons();
-    void TW_AddSubgroup(QString _groupName, unsigned int _groupID);
-    void TW_AddSubtitle(QTreeWidgetItem *_parent, QString _label, QString _subtitle);
-    void TW_FocusItem(unsigned int _groupID, unsigned int _subtitleID);
+    // Tree view
+    void TV_UpdateUpDownButtons();
+    void TV_FocusItem(unsigned int _groupID, unsigned int _subtitleID);
 
     // Subtitle editor
     void ResetSubtitleEditor();
     void UpdateStatus(QString _status, QString _styleSheet = "color: rgb(0, 0, 0);");
     void UpdateSubtitlePreview();
     void LoadSubtitle(unsigned int _groupID, unsigned int _subtitleID);
+    vector<wstring> const& CharacterArray() const;
 
     // Color blocks editor
     void ClearColorBlocks();
     void LoadColorBlocks(unsigned int _groupID, unsigned int _subtitleID);
-    void AddColorBlock(unsigned int _id, fco::ColorBlock _colorBlock = fco::ColorBlock());
-    void EnableUpDownButtons();
-    void UpdateStartEndLimits(unsigned int _id);
+    void UpdateColorBlockButtons();
 
 private:
     Ui::fcoEditorWindow *ui;
@@ -136,26 +187,60 @@ private:
     DatabaseGenerator *m_databaseGenerator = Q_NULLPTR;
 
     fco* m_fco;
+    fcoTreeModel* m_treeModel;
     QString m_path;
     QString m_fileName;
     bool m_fileEdited;
 
+    // Background loading, m_loading stays set until LoadFinished ran
+    bool m_loading;
+    QFutureWatcher<QString>* m_loadWatcher;
+    QProgressDialog* m_loadProgress;
+    fco* m_loadingDocument;
+    QString m_loadingFile;
+    bool m_loadShowSuccess;
+    bool m_loadRecovered;
+    atomic<bool> m_loadCancel;
+
+    // Background saving, revision counts document edits
+    QFutureWatcher<QString>* m_saveWatcher;
+    QFutureWatcher<QString>* m_autosaveWatcher;
+    QTimer* m_autosaveTimer;
+    QString m_savingFile;
+    QString m_savingTitle;
+    unsigned int m_revision;
+    unsigned int m_savingRevision;
+    unsigned int m_autosavedRevision;
+
+    // Project, m_fco is borrowed from it when m_projectIndex != -1
+    fcoProject* m_project;
+    CaptionReferences* m_references;
+    fcoProjectPanel* m_projectPanel;
+    int m_projectIndex;
+    QFutureWatcher<QString>* m_saveAllWatcher;
+    QProgressDialog* m_saveAllProgress;
+    QVector<ProjectSaveJob> m_saveAllJobs;
+    unsigned int m_saveAllRevision;
+
     // Tree view button warning
     bool m_moveGroup;
     bool m_moveSubtitle;
 
     // Subtitle editor
-    vector<wstring> m_characterArray;
+    SubtitleTokenizer m_tokenizer;
+    size_t m_characterCount;
+    QTimer* m_previewTimer;
     unsigned int m_groupID;
     unsigned int m_subtitleID;
     bool m_textValid;
     bool m_textEdited;
     bool m_textIsOmochao;
     QLabel* m_previewLabel;
+    SubtitleRenderer m_subtitleRenderer;
 
     // Color blocks editor
     fco::Color m_defaultColor;
-    vector<fco::ColorBlock> m_colorBlocks;
+    ColorBlockModel* m_colorBlockModel;
     bool m_colorEdited;
 
     // Dragging spin box
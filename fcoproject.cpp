@@ -0,0 +1,413 @@
+#include "fcoproject.h"
+
+#include <QDir>
+#include <QFileInfo>
+#include <QtConcurrent>
+
+#include "tracer.h"
+
+fcoProject::fcoProject(fco const* _database, QObject *parent) :
+    QObject(parent),
+    m_database(_database)
+{
+    m_indexing = false;
+    m_indexWatcher = new QFutureWatcher<Scan>(this);
+    connect(m_indexWatcher, &QFutureWatcher<Scan>::finished, this, &fcoProject::IndexFinished);
+}
+
+//-----------------------------------------------------
+// Taken documents belong to the editor
+//-----------------------------------------------------
+fcoProject::~fcoProject()
+{
+    StopIndexing();
+
+    for (File& file : m_files)
+    {
+        delete file.m_document;
+    }
+}
+
+//-----------------------------------------------------
+// List the files, reading them happens in the background
+//-----------------------------------------------------
+bool fcoProject::Open(QString const& _directory, QString& _errorMsg)
+{
+    TRACE_SCOPE("project", "Open");
+
+    StopIndexing();
+    for (File& file : m_files)
+    {
+        delete file.m_document;
+    }
+    m_files.clear();
+    m_indices.clear();
+
+    QDir dir(_directory);
+    QStringList const names = dir.entryList(QStringList() << "*.fco", QDir::Files, QDir::Name);
+    if (names.isEmpty())
+    {
+        _errorMsg = "No .fco files found in " + _directory;
+        return false;
+    }
+    m_directory = dir.absolutePath();
+
+    // Not valid until their header has been read
+    QStringList fileNames;
+    for (QString const& name : names)
+    {
+        File file;
+        file.m_fileName = dir.absoluteFilePath(name);
+        file.m_groupCount = 0;
+        file.m_valid = false;
+        file.m_document = Q_NULLPTR;
+        file.m_taken = false;
+        file.m_dirty = false;
+        m_files.push_back(file);
+        fileNames << file.m_fileName;
+    }
+    m_indices.resize(m_files.size());
+
+    // Every file is parsed once for its header and index
+    m_indexing = true;
+    m_indexWatcher->setFuture(QtConcurrent::mapped(fileNames, ScanFile(&m_database)));
+
+    return true;
+}
+
+//-----------------------------------------------------
+// Parse and index one file (worker thread), only the
+// header and index are kept
+//-----------------------------------------------------
+fcoProject::Scan fcoProject::ScanFile::operator()(QString const& _fileName) const
+{
+    TRACE_SCOPE("project", "Scan File");
+
+    Scan scan;
+    File& file = scan.m_file;
+    file.m_fileName = _fileName;
+    file.m_groupCount = 0;
+    file.m_document = Q_NULLPTR;
+    file.m_taken = false;
+    file.m_dirty = false;
+
+    // A file that fails here reports its error when it is opened,
+    // its header may still be readable
+    fco document(m_database);
+    string errorMsg;
+    if (!document.Load(_fileName.toStdString(), errorMsg))
+    {
+        string groupName;
+        file.m_valid = fco::ReadHeader(_fileName.toStdString(), groupName, file.m_groupCount);
+        file.m_groupName = QString::fromStdString(groupName);
+        return scan;
+    }
+
+    file.m_valid = true;
+    file.m_groupName = QString::fromStdString(document.GetFileGroupName());
+    file.m_groupCount = document.GetGroupCount();
+    scan.m_index = BuildIndex(&document);
+    return scan;
+}
+
+//-----------------------------------------------------
+// Index of a file by path, -1 if not in the project
+//-----------------------------------------------------
+int fcoProject::FindFile(QString const& _fileName) const
+{
+    QString const path = QFileInfo(_fileName).absoluteFilePath();
+    for (int i = 0; i < m_files.size(); i++)
+    {
+        if (m_files[i].m_fileName.compare(path, Qt::CaseInsensitive) == 0)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+bool fcoProject::HasDirtyFiles() const
+{
+    for (File const& file : m_files)
+    {
+        if (file.m_dirty) return true;
+    }
+    return false;
+}
+
+void fcoProject::SetDirty(int _index, bool _dirty)
+{
+    m_files[_index].m_dirty = _dirty;
+}
+
+//-----------------------------------------------------
+// Lend a document to the editor, parsed on first use
+//-----------------------------------------------------
+fco* fcoProject::TakeDocument(int _index, QString& _errorMsg)
+{
+    TRACE_SCOPE("project", "Take Document");
+
+    File& file = m_files[_index];
+    if (file.m_taken)
+    {
+        _errorMsg = file.m_fileName + " is already open!";
+        return Q_NULLPTR;
+    }
+
+    if (!file.m_document)
+    {
+        fco* document = new fco(&m_database);
+        string errorMsg;
+        if (!document->Load(file.m_fileName.toStdString(), errorMsg))
+        {
+            delete document;
+            _errorMsg = QString::fromStdString(errorMsg);
+            return Q_NULLPTR;
+        }
+        file.m_document = document;
+    }
+
+    fco* document = file.m_document;
+    file.m_document = Q_NULLPTR;
+    file.m_taken = true;
+    return document;
+}
+
+//-----------------------------------------------------
+// Editor is done with a document, keep unsaved edits
+//-----------------------------------------------------
+void fcoProject::ReturnDocument(int _index, fco* _document, bool _dirty)
+{
+    File& file = m_files[_index];
+    file.m_document = _document;
+    file.m_taken = false;
+    file.m_dirty = _dirty;
+
+    if (_dirty)
+    {
+        Reindex(_index, _document);
+    }
+}
+
+//-----------------------------------------------------
+// Dirty documents the editor is not holding
+//-----------------------------------------------------
+QVector<int> fcoProject::GetDirtyDocuments() const
+{
+    QVector<int> indices;
+    for (int i = 0; i < m_files.size(); i++)
+    {
+        if (m_files[i].m_dirty && m_files[i].m_document)
+        {
+            indices.push_back(i);
+        }
+    }
+    return indices;
+}
+
+//-----------------------------------------------------
+// Refresh the search index of one file
+//-----------------------------------------------------
+void fcoProject::Reindex(int _index, fco* _document)
+{
+    // The background index would overwrite this
+    if (!IsIndexReady()) return;
+
+    m_indices[_index] = BuildIndex(_document);
+    emit FileIndexed(_index);
+}
+
+//-----------------------------------------------------
+// Subtitles containing _text, in file order
+//-----------------------------------------------------
+QVector<fcoProject::SearchResult> fcoProject::Search(wstring const& _text, int _maxResults) const
+{
+    TRACE_SCOPE("project", "Search");
+
+    QVector<SearchResult> results;
+    if (_text.empty()) return results;
+
+    for (int fileIndex = 0; fileIndex < m_indices.size() && results.size() < _maxResults; fileIndex++)
+    {
+        FileIndex const& fileIndexData = m_indices[fileIndex];
+        auto addResult = [&](IndexEntry const& _entry)
+        {
+            SearchResult result;
+            result.m_fileIndex = fileIndex;
+            result.m_groupID = _entry.m_groupID;
+            result.m_subtitleID = _entry.m_subtitleID;
+            result.m_label = QString::fromStdWString(_entry.m_label);
+            result.m_subtitle = QString::fromStdWString(_entry.m_subtitle);
+            results.push_back(result);
+        };
+
+        if (_text.size() < 3)
+        {
+            // Too short for trigrams
+            for (IndexEntry const& entry : fileIndexData.m_entries)
+            {
+                if (results.size() >= _maxResults) break;
+                if (entry.m_subtitle.find(_text) != wstring::npos) addResult(entry);
+            }
+            continue;
+        }
+
+        // Candidates come from the rarest trigram of the query
+        vector<unsigned int> const* candidates = Q_NULLPTR;
+        for (size_t i = 0; i + 3 <= _text.size(); i++)
+        {
+            auto iter = fileIndexData.m_trigrams.find(TrigramKey(&_text[i]));
+            if (iter == fileIndexData.m_trigrams.end())
+            {
+                candidates = Q_NULLPTR;
+                break;
+            }
+            if (!candidates || iter->second.size() < candidates->size())
+            {
+                candidates = &iter->second;
+            }
+        }
+        if (!candidates) continue;
+
+        for (unsigned int entryID : *candidates)
+        {
+            if (results.size() >= _maxResults) break;
+            IndexEntry const& entry = fileIndexData.m_entries[entryID];
+            if (entry.m_subtitle.find(_text) != wstring::npos) addResult(entry);
+        }
+    }
+
+    return results;
+}
+
+//-----------------------------------------------------
+// Subtitles and trigram postings (sorted, unique)
+//-----------------------------------------------------
+fcoProject::FileIndex fcoProject::BuildIndex(fco* _document)
+{
+    FileIndex index;
+    for (unsigned int groupID = 0; groupID < _document->GetGroupCount(); groupID++)
+    {
+        index.m_groupNames.push_back(_document->GetGroupName(groupID));
+        for (unsigned int subtitleID = 0; subtitleID < _document->GetSubtitleCount(groupID); subtitleID++)
+        {
+            IndexEntry entry;
+            entry.m_groupID = groupID;
+            entry.m_subtitleID = subtitleID;
+            entry.m_label = QString::fromStdString(_document->GetLabel(groupID, subtitleID)).toStdWString();
+            entry.m_subtitle = _document->GetSubtitle(groupID, subtitleID);
+
+            unsigned int const entryID = static_cast<unsigned int>(index.m_entries.size());
+            for (size_t i = 0; i + 3 <= entry.m_subtitle.size(); i++)
+            {
+                vector<unsigned int>& postings = index.m_trigrams[TrigramKey(&entry.m_subtitle[i])];
+                if (postings.empty() || postings.back() != entryID)
+                {
+                    postings.push_back(entryID);
+                }
+            }
+            index.m_entries.push_back(entry);
+        }
+    }
+    return index;
+}
+
+//-----------------------------------------------------
+// Labels kept by the index, empty until it is built
+//-----------------------------------------------------
+QVector<fcoProject::Label> fcoProject::GetLabels(int _index) const
+{
+    FileIndex const& index = m_indices[_index];
+
+    QVector<Label> labels;
+    labels.reserve(static_cast<int>(index.m_entries.size()));
+    for (IndexEntry const& entry : index.m_entries)
+    {
+        Label label;
+        label.m_groupID = entry.m_groupID;
+        label.m_subtitleID = entry.m_subtitleID;
+        label.m_group = QString::fromStdString(index.m_groupNames[entry.m_groupID]);
+        label.m_cell = QString::fromStdWString(entry.m_label);
+        labels.push_back(label);
+    }
+    return labels;
+}
+
+//-----------------------------------------------------
+// Labels of a loaded document
+//-----------------------------------------------------
+QVector<fcoProject::Label> fcoProject::CollectLabels(fco* _document)
+{
+    QVector<Label> labels;
+    for (unsigned int groupID = 0; groupID < _document->GetGroupCount(); groupID++)
+    {
+        QString const group = QString::fromStdString(_document->GetGroupName(groupID));
+        for (unsigned int subtitleID = 0; subtitleID < _document->GetSubtitleCount(groupID); subtitleID++)
+        {
+            Label label;
+            label.m_groupID = groupID;
+            label.m_subtitleID = subtitleID;
+            label.m_group = group;
+            label.m_cell = QString::fromStdString(_document->GetLabel(groupID, subtitleID));
+            labels.push_back(label);
+        }
+    }
+    return labels;
+}
+
+//-----------------------------------------------------
+// Three characters packed into 63 bits
+//-----------------------------------------------------
+unsigned long long fcoProject::TrigramKey(wchar_t const* _text)
+{
+    unsigned long long const mask = 0x1FFFFF;
+    return ((static_cast<unsigned long long>(_text[0]) & mask) << 42)
+         | ((static_cast<unsigned long long>(_text[1]) & mask) << 21)
+         |  (static_cast<unsigned long long>(_text[2]) & mask);
+}
+
+//-----------------------------------------------------
+// Cancel the background scan, its results are dropped
+//-----------------------------------------------------
+void fcoProject::StopIndexing()
+{
+    m_indexWatcher->cancel();
+    m_indexWatcher->waitForFinished();
+    m_indexing = false;
+}
+
+//-----------------------------------------------------
+// Background scan done, documents edited in the
+// meantime are indexed again
+//-----------------------------------------------------
+void fcoProject::IndexFinished()
+{
+    if (m_indexWatcher->isCanceled()) return;
+    m_indexing = false;
+
+    QFuture<Scan> const future = m_indexWatcher->future();
+    for (int i = 0; i < m_files.size() && i < future.resultCount(); i++)
+    {
+        Scan scan = future.resultAt(i);
+        File& file = m_files[i];
+        file.m_groupName = scan.m_file.m_groupName;
+        file.m_groupCount = scan.m_file.m_groupCount;
+        file.m_valid = scan.m_file.m_valid;
+        m_indices[i] = std::move(scan.m_index);
+    }
+
+    // Documents edited while indexing
+    for (int i = 0; i < m_files.size(); i++)
+    {
+        if (m_files[i].m_dirty && m_files[i].m_document)
+        {
+            m_indices[i] = BuildIndex(m_files[i].m_document);
+        }
+    }
+
+    for (int i = 0; i < m_files.size(); i++)
+    {
+        emit FileIndexed(i);
+    }
+    emit IndexReady();
+}
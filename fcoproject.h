@@ -0,0 +1,135 @@
+#ifndef FCOPROJECT_H
+#define FCOPROJECT_H
+
+#include <QFutureWatcher>
+#include <QObject>
+#include <QString>
+
+#include <unordered_map>
+
+#include "fco.h"
+
+//-----------------------------------------------------
+// A directory of fco files, headers and search index
+// are read in the background, documents are parsed
+// when they are opened
+//-----------------------------------------------------
+class fcoProject : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct File
+    {
+        QString m_fileName;
+        QString m_groupName;
+        unsigned int m_groupCount;
+        bool m_valid;       // Header could be read
+
+        fco* m_document;    // nullptr until opened or while taken
+        bool m_taken;
+        bool m_dirty;
+    };
+
+    struct Label
+    {
+        unsigned int m_groupID;
+        unsigned int m_subtitleID;
+        QString m_group;
+        QString m_cell;
+    };
+
+    struct SearchResult
+    {
+        int m_fileIndex;
+        unsigned int m_groupID;
+        unsigned int m_subtitleID;
+        QString m_label;
+        QString m_subtitle;
+    };
+
+public:
+    explicit fcoProject(fco const* _database, QObject *parent = nullptr);
+    ~fcoProject() override;
+
+    // List the .fco files of a directory, they are read in
+    // the background and IndexReady is emitted when done
+    bool Open(QString const& _directory, QString& _errorMsg);
+    QString const& GetDirectory() const { return m_directory; }
+
+    // Files
+    int GetFileCount() const { return m_files.size(); }
+    File const& GetFile(int _index) const { return m_files[_index]; }
+    int FindFile(QString const& _fileName) const;
+    bool HasDirtyFiles() const;
+    void SetDirty(int _index, bool _dirty);
+
+    // The editor owns a document while it is taken
+    fco* TakeDocument(int _index, QString& _errorMsg);
+    void ReturnDocument(int _index, fco* _document, bool _dirty);
+    QVector<int> GetDirtyDocuments() const;
+    fco const* GetDocument(int _index) const { return m_files[_index].m_document; }
+
+    // Cross-file search
+    bool IsIndexReady() const { return !m_indexing; }
+    void Reindex(int _index, fco* _document);
+    QVector<SearchResult> Search(wstring const& _text, int _maxResults) const;
+
+    // Group and subtitle names of a file from the index
+    QVector<Label> GetLabels(int _index) const;
+    static QVector<Label> CollectLabels(fco* _document);
+
+signals:
+    // Index of one file was (re)built, then the whole scan is done
+    void FileIndexed(int _index);
+    void IndexReady();
+
+private:
+    struct IndexEntry
+    {
+        unsigned int m_groupID;
+        unsigned int m_subtitleID;
+        wstring m_label;
+        wstring m_subtitle;
+    };
+
+    struct FileIndex
+    {
+        vector<string> m_groupNames;
+        vector<IndexEntry> m_entries;
+        unordered_map<unsigned long long, vector<unsigned int>> m_trigrams;
+    };
+
+    // Header and index of one file
+    struct Scan
+    {
+        File m_file;
+        FileIndex m_index;
+    };
+
+    // QtConcurrent functors
+    struct ScanFile
+    {
+        typedef Scan result_type;
+
+        explicit ScanFile(fco const* _database) : m_database(_database) {}
+        Scan operator()(QString const& _fileName) const;
+
+        fco const* m_database;
+    };
+
+    static FileIndex BuildIndex(fco* _document);
+    static unsigned long long TrigramKey(wchar_t const* _text);
+    void StopIndexing();
+    void IndexFinished();
+
+private:
+    fco m_database;
+    QString m_directory;
+    QVector<File> m_files;
+    QVector<FileIndex> m_indices;
+    QFutureWatcher<Scan>* m_indexWatcher;
+    bool m_indexing;    // Until IndexFinished took the results
+};
+
+#endif // FCOPROJECT_H
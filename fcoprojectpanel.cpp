@@ -0,0 +1,184 @@
+#include "fcoprojectpanel.h"
+
+#include <QFileInfo>
+#include <QHeaderView>
+#include <QSplitter>
+#include <QVBoxLayout>
+
+fcoProjectPanel::fcoProjectPanel(QWidget *parent) :
+    QDockWidget("Project", parent)
+{
+    m_project = Q_NULLPTR;
+    m_currentFile = -1;
+    setObjectName("DW_Project");
+
+    QWidget* contents = new QWidget(this);
+    QVBoxLayout* layout = new QVBoxLayout(contents);
+    layout->setContentsMargins(4, 4, 4, 4);
+
+    m_fileList = new QListWidget(contents);
+    connect(m_fileList, &QListWidget::itemActivated, this, &fcoProjectPanel::FileList_itemActivated);
+
+    m_find = new QLineEdit(contents);
+    m_find->setPlaceholderText("Find in all files...");
+    connect(m_find, &QLineEdit::returnPressed, this, &fcoProjectPanel::RunSearch);
+
+    // Search as you type, once typing pauses
+    m_searchTimer = new QTimer(this);
+    m_searchTimer->setSingleShot(true);
+    m_searchTimer->setInterval(250);
+    connect(m_searchTimer, &QTimer::timeout, this, &fcoProjectPanel::RunSearch);
+    connect(m_find, &QLineEdit::textEdited, m_searchTimer, static_cast<void (QTimer::*)()>(&QTimer::start));
+
+    m_status = new QLabel(contents);
+
+    m_results = new QTreeWidget(contents);
+    m_results->setRootIsDecorated(false);
+    m_results->setUniformRowHeights(true);
+    m_results->setHeaderLabels(QStringList() << "File" << "Label" << "Subtitle");
+    m_results->header()->setSectionResizeMode(QHeaderView::ResizeToContents);
+    connect(m_results, &QTreeWidget::itemActivated, this, &fcoProjectPanel::Results_itemActivated);
+
+    QWidget* searchWidget = new QWidget(contents);
+    QVBoxLayout* searchLayout = new QVBoxLayout(searchWidget);
+    searchLayout->setContentsMargins(0, 0, 0, 0);
+    searchLayout->addWidget(m_find);
+    searchLayout->addWidget(m_status);
+    searchLayout->addWidget(m_results);
+
+    QSplitter* splitter = new QSplitter(Qt::Vertical, contents);
+    splitter->addWidget(m_fileList);
+    splitter->addWidget(searchWidget);
+    layout->addWidget(splitter);
+
+    setWidget(contents);
+}
+
+//-----------------------------------------------------
+// Show a project (nullptr to clear)
+//-----------------------------------------------------
+void fcoProjectPanel::SetProject(fcoProject* _project)
+{
+    if (m_project)
+    {
+        disconnect(m_project, Q_NULLPTR, this, Q_NULLPTR);
+    }
+
+    m_project = _project;
+    m_currentFile = -1;
+    m_results->clear();
+    m_status->clear();
+
+    if (m_project)
+    {
+        setWindowTitle("Project: " + QFileInfo(m_project->GetDirectory()).fileName());
+        m_status->setText("Indexing...");
+        connect(m_project, &fcoProject::IndexReady, this, [this]()
+        {
+            m_status->setText("Index ready");
+            UpdateFiles();
+            if (!m_find->text().isEmpty()) RunSearch();
+        });
+    }
+    else
+    {
+        setWindowTitle("Project");
+    }
+
+    UpdateFiles();
+}
+
+//-----------------------------------------------------
+// File names, group count and unsaved marker
+//-----------------------------------------------------
+void fcoProjectPanel::UpdateFiles()
+{
+    m_fileList->clear();
+    if (!m_project) return;
+
+    for (int i = 0; i < m_project->GetFileCount(); i++)
+    {
+        fcoProject::File const& file = m_project->GetFile(i);
+        QString text = QFileInfo(file.m_fileName).fileName();
+        if (!file.m_valid)
+        {
+            text += m_project->IsIndexReady() ? " (unreadable)" : " (scanning)";
+        }
+        else
+        {
+            text += " (" + QString::number(file.m_groupCount) + " groups)";
+        }
+        if (file.m_dirty) text += " *";
+
+        QListWidgetItem* item = new QListWidgetItem(text, m_fileList);
+        item->setData(Qt::UserRole, i);
+        if (i == m_currentFile)
+        {
+            QFont font = item->font();
+            font.setBold(true);
+            item->setFont(font);
+        }
+    }
+}
+
+//-----------------------------------------------------
+// Bold the file being edited
+//-----------------------------------------------------
+void fcoProjectPanel::SetCurrentFile(int _fileIndex)
+{
+    m_currentFile = _fileIndex;
+    UpdateFiles();
+}
+
+void fcoProjectPanel::FocusSearch()
+{
+    m_find->setFocus();
+    m_find->selectAll();
+}
+
+//-----------------------------------------------------
+// Query the project index
+//-----------------------------------------------------
+void fcoProjectPanel::RunSearch()
+{
+    m_searchTimer->stop();
+    m_results->clear();
+    if (!m_project || m_find->text().isEmpty()) return;
+
+    // Let the editor refresh the index of its document first
+    emit SearchRequested();
+
+    QVector<fcoProject::SearchResult> const results = m_project->Search(m_find->text().toStdWString(), c_maxResults);
+    QList<QTreeWidgetItem*> items;
+    items.reserve(results.size());
+    for (fcoProject::SearchResult const& result : results)
+    {
+        QString subtitle = result.m_subtitle;
+        subtitle.replace('\n', ' ');
+
+        QTreeWidgetItem* item = new QTreeWidgetItem();
+        item->setText(0, QFileInfo(m_project->GetFile(result.m_fileIndex).m_fileName).fileName());
+        item->setText(1, result.m_label);
+        item->setText(2, subtitle);
+        item->setData(0, Qt::UserRole, result.m_fileIndex);
+        item->setData(1, Qt::UserRole, result.m_groupID);
+        item->setData(2, Qt::UserRole, result.m_subtitleID);
+        items.push_back(item);
+    }
+    m_results->addTopLevelItems(items);
+
+    QString status = QString::number(results.size()) + (results.size() >= c_maxResults ? "+ results" : " results");
+    if (!m_project->IsIndexReady()) status += " (still indexing)";
+    m_status->setText(status);
+}
+
+void fcoProjectPanel::FileList_itemActivated(QListWidgetItem* _item)
+{
+    emit FileActivated(_item->data(Qt::UserRole).toInt());
+}
+
+void fcoProjectPanel::Results_itemActivated(QTreeWidgetItem* _item, int _column)
+{
+    Q_UNUSED(_column)
+    emit ResultActivated(_item->data(0, Qt::UserRole).toInt(), _item->data(1, Qt::UserRole).toUInt(), _item->data(2, Qt::UserRole).toUInt());
+}
@@ -0,0 +1,54 @@
+#ifndef FCOPROJECTPANEL_H
+#define FCOPROJECTPANEL_H
+
+#include <QDockWidget>
+#include <QLabel>
+#include <QLineEdit>
+#include <QListWidget>
+#include <QTimer>
+#include <QTreeWidget>
+
+#include "fcoproject.h"
+
+//-----------------------------------------------------
+// Dock listing the files of a project with a "find in
+// all files" search over the project index
+//-----------------------------------------------------
+class fcoProjectPanel : public QDockWidget
+{
+    Q_OBJECT
+
+public:
+    explicit fcoProjectPanel(QWidget *parent = nullptr);
+
+    void SetProject(fcoProject* _project);
+    void UpdateFiles();
+    void SetCurrentFile(int _fileIndex);
+    void FocusSearch();
+
+signals:
+    void FileActivated(int _fileIndex);
+    void ResultActivated(int _fileIndex, unsigned int _groupID, unsigned int _subtitleID);
+    void SearchRequested();
+
+public slots:
+    void RunSearch();
+
+private slots:
+    void FileList_itemActivated(QListWidgetItem* _item);
+    void Results_itemActivated(QTreeWidgetItem* _item, int _column);
+
+private:
+    static int const c_maxResults = 1000;
+
+    fcoProject* m_project;
+    int m_currentFile;
+
+    QListWidget* m_fileList;
+    QLineEdit* m_find;
+    QLabel* m_status;
+    QTreeWidget* m_results;
+    QTimer* m_searchTimer;
+};
+
+#endif // FCOPROJECTPANEL_H
@@ -0,0 +1,569 @@
+#include "fcotreemodel.h"
+
+#include <climits>
+
+#include "tracer.h"
+
+//-----------------------------------------------------
+// Group rows have no internal pointer, subtitle rows
+// point to the GroupNode of their parent
+//-----------------------------------------------------
+fcoTreeModel::fcoTreeModel(QObject *parent) :
+    QAbstractItemModel(parent)
+{
+    m_fco = Q_NULLPTR;
+    m_highlightGroupID = INT_MAX;
+    m_highlightSubtitleID = INT_MAX;
+}
+
+fcoTreeModel::~fcoTreeModel()
+{
+    ClearGroups();
+}
+
+//-----------------------------------------------------
+// Attach a document (nullptr shows an empty tree)
+//-----------------------------------------------------
+void fcoTreeModel::SetDocument(fco* _fco)
+{
+    m_fco = _fco;
+    m_highlightGroupID = INT_MAX;
+    m_highlightSubtitleID = INT_MAX;
+    Refresh();
+}
+
+//-----------------------------------------------------
+// Full reset, only used when a document is (re)loaded
+//-----------------------------------------------------
+void fcoTreeModel::Refresh()
+{
+    TRACE_SCOPE("ui", "Tree Rebuild");
+
+    beginResetModel();
+    ClearGroups();
+    int const groupCount = (m_fco && m_fco->IsLoaded()) ? static_cast<int>(m_fco->GetGroupCount()) : 0;
+    m_groups.reserve(groupCount);
+    for (int i = 0; i < groupCount; i++)
+    {
+        m_groups.push_back(new GroupNode{i, 0});
+    }
+    endResetModel();
+}
+
+//-----------------------------------------------------
+// Append a new group (with its default subtitle)
+//-----------------------------------------------------
+unsigned int fcoTreeModel::AddGroup()
+{
+    int const row = m_groups.size();
+    beginInsertRows(QModelIndex(), row, row);
+    m_fco->AddGroup();
+    m_groups.push_back(new GroupNode{row, 0});
+    endInsertRows();
+
+    return static_cast<unsigned int>(row);
+}
+
+//-----------------------------------------------------
+// Remove a group, only IDs of the groups after it change
+//-----------------------------------------------------
+void fcoTreeModel::DeleteGroup(unsigned int _groupID)
+{
+    int const row = static_cast<int>(_groupID);
+    if (row >= m_groups.size())
+    {
+        return;
+    }
+
+    beginRemoveRows(QModelIndex(), row, row);
+    m_fco->DeleteGroup(_groupID);
+    delete m_groups.takeAt(row);
+    UpdateGroupRows(row);
+
+    if (m_highlightGroupID == _groupID)
+    {
+        m_highlightGroupID = INT_MAX;
+        m_highlightSubtitleID = INT_MAX;
+    }
+    else if (m_highlightGroupID != INT_MAX && m_highlightGroupID > _groupID)
+    {
+        m_highlightGroupID--;
+    }
+    endRemoveRows();
+
+    for (int i = row; i < m_groups.size(); i++)
+    {
+        EmitSerifuIDChanged(static_cast<unsigned int>(i), 0, m_groups[i]->m_fetched - 1);
+    }
+}
+
+//-----------------------------------------------------
+// Swap a group with its neighbour
+//-----------------------------------------------------
+void fcoTreeModel::MoveGroup(unsigned int _groupID, unsigned int _newGroupID)
+{
+    int const from = static_cast<int>(_groupID);
+    int const to = static_cast<int>(_newGroupID);
+    if (from >= m_groups.size() || to >= m_groups.size() || qAbs(from - to) != 1)
+    {
+        return;
+    }
+
+    // Destination is the row before which the moved row is placed
+    if (!beginMoveRows(QModelIndex(), from, from, QModelIndex(), to > from ? to + 1 : to))
+    {
+        return;
+    }
+    m_fco->SwapGroup(_groupID, _newGroupID);
+    qSwap(m_groups[from], m_groups[to]);
+    m_groups[from]->m_row = from;
+    m_groups[to]->m_row = to;
+
+    if (m_highlightGroupID == _groupID)
+    {
+        m_highlightGroupID = _newGroupID;
+    }
+    else if (m_highlightGroupID == _newGroupID)
+    {
+        m_highlightGroupID = _groupID;
+    }
+    endMoveRows();
+
+    EmitSerifuIDChanged(_groupID, 0, m_groups[from]->m_fetched - 1);
+    EmitSerifuIDChanged(_newGroupID, 0, m_groups[to]->m_fetched - 1);
+}
+
+//-----------------------------------------------------
+// Append a subtitle to a group
+//-----------------------------------------------------
+unsigned int fcoTreeModel::AddSubtitle(unsigned int _groupID, string const& _label)
+{
+    GroupNode* node = m_groups[static_cast<int>(_groupID)];
+    int const row = static_cast<int>(m_fco->GetSubtitleCount(_groupID));
+
+    // Rows not fetched yet will show up through fetchMore()
+    if (node->m_fetched < row)
+    {
+        m_fco->AddSubtitle(_groupID, _label);
+        return static_cast<unsigned int>(row);
+    }
+
+    beginInsertRows(GroupIndex(_groupID), row, row);
+    m_fco->AddSubtitle(_groupID, _label);
+    node->m_fetched++;
+    endInsertRows();
+
+    return static_cast<unsigned int>(row);
+}
+
+//-----------------------------------------------------
+// Remove a subtitle, only IDs after it in the group change
+//-----------------------------------------------------
+void fcoTreeModel::DeleteSubtitle(unsigned int _groupID, unsigned int _subtitleID)
+{
+    GroupNode* node = m_groups[static_cast<int>(_groupID)];
+    int const row = static_cast<int>(_subtitleID);
+    bool const fetched = row < node->m_fetched;
+
+    if (fetched)
+    {
+        beginRemoveRows(GroupIndex(_groupID), row, row);
+    }
+    m_fco->DeleteSubtitle(_groupID, _subtitleID);
+
+    if (m_highlightGroupID == _groupID)
+    {
+        if (m_highlightSubtitleID == _subtitleID)
+        {
+            m_highlightGroupID = INT_MAX;
+            m_highlightSubtitleID = INT_MAX;
+        }
+        else if (m_highlightSubtitleID > _subtitleID)
+        {
+            m_highlightSubtitleID--;
+        }
+    }
+
+    if (fetched)
+    {
+        node->m_fetched--;
+        endRemoveRows();
+        EmitSerifuIDChanged(_groupID, row, node->m_fetched - 1);
+    }
+}
+
+//-----------------------------------------------------
+// Swap a subtitle with its neighbour
+//-----------------------------------------------------
+void fcoTreeModel::MoveSubtitle(unsigned int _groupID, unsigned int _subtitleID, unsigned int _newSubtitleID)
+{
+    int const from = static_cast<int>(_subtitleID);
+    int const to = static_cast<int>(_newSubtitleID);
+    if (qAbs(from - to) != 1 || static_cast<unsigned int>(qMax(from, to)) >= m_fco->GetSubtitleCount(_groupID))
+    {
+        return;
+    }
+
+    FetchTo(_groupID, static_cast<unsigned int>(qMax(from, to)));
+
+    QModelIndex const parent = GroupIndex(_groupID);
+    if (!beginMoveRows(parent, from, from, parent, to > from ? to + 1 : to))
+    {
+        return;
+    }
+    m_fco->SwapSubtitle(_groupID, _subtitleID, _newSubtitleID);
+
+    if (m_highlightGroupID == _groupID)
+    {
+        if (m_highlightSubtitleID == _subtitleID)
+        {
+            m_highlightSubtitleID = _newSubtitleID;
+        }
+        else if (m_highlightSubtitleID == _newSubtitleID)
+        {
+            m_highlightSubtitleID = _subtitleID;
+        }
+    }
+    endMoveRows();
+
+    EmitSerifuIDChanged(_groupID, qMin(from, to), qMax(from, to));
+}
+
+//-----------------------------------------------------
+// Group name changed
+//-----------------------------------------------------
+void fcoTreeModel::UpdateGroup(unsigned int _groupID)
+{
+    QModelIndex const index = GroupIndex(_groupID);
+    if (index.isValid())
+    {
+        emit dataChanged(index, index);
+    }
+}
+
+//-----------------------------------------------------
+// Subtitle label or text changed
+//-----------------------------------------------------
+void fcoTreeModel::UpdateSubtitle(unsigned int _groupID, unsigned int _subtitleID)
+{
+    EmitRowChanged(_groupID, _subtitleID);
+}
+
+//-----------------------------------------------------
+// Mark the subtitle currently loaded in the editor
+//-----------------------------------------------------
+void fcoTreeModel::SetHighlight(unsigned int _groupID, unsigned int _subtitleID)
+{
+    unsigned int const oldGroupID = m_highlightGroupID;
+    unsigned int const oldSubtitleID = m_highlightSubtitleID;
+    m_highlightGroupID = _groupID;
+    m_highlightSubtitleID = _subtitleID;
+
+    EmitRowChanged(oldGroupID, oldSubtitleID);
+    EmitRowChanged(_groupID, _subtitleID);
+}
+
+//-----------------------------------------------------
+// Index of a group row
+//-----------------------------------------------------
+QModelIndex fcoTreeModel::GroupIndex(unsigned int _groupID, int _column) const
+{
+    if (_groupID >= static_cast<unsigned int>(m_groups.size()))
+    {
+        return QModelIndex();
+    }
+
+    return createIndex(static_cast<int>(_groupID), _column, nullptr);
+}
+
+//-----------------------------------------------------
+// Index of a subtitle row, fetching rows up to it
+//-----------------------------------------------------
+QModelIndex fcoTreeModel::SubtitleIndex(unsigned int _groupID, unsigned int _subtitleID, int _column)
+{
+    if (_groupID >= static_cast<unsigned int>(m_groups.size()) || _subtitleID >= m_fco->GetSubtitleCount(_groupID))
+    {
+        return QModelIndex();
+    }
+
+    FetchTo(_groupID, _subtitleID);
+    return createIndex(static_cast<int>(_subtitleID), _column, m_groups[static_cast<int>(_groupID)]);
+}
+
+//-----------------------------------------------------
+// Index type helpers
+//-----------------------------------------------------
+bool fcoTreeModel::IsSubtitle(QModelIndex const& _index) const
+{
+    return _index.isValid() && _index.internalPointer() != nullptr;
+}
+
+unsigned int fcoTreeModel::GetGroupID(QModelIndex const& _index) const
+{
+    if (!_index.isValid()) return INT_MAX;
+    return IsSubtitle(_index) ? static_cast<unsigned int>(static_cast<GroupNode*>(_index.internalPointer())->m_row) : static_cast<unsigned int>(_index.row());
+}
+
+unsigned int fcoTreeModel::GetSubtitleID(QModelIndex const& _index) const
+{
+    return IsSubtitle(_index) ? static_cast<unsigned int>(_index.row()) : INT_MAX;
+}
+
+//-----------------------------------------------------
+// QAbstractItemModel
+//-----------------------------------------------------
+QModelIndex fcoTreeModel::index(int row, int column, QModelIndex const& parent) const
+{
+    if (row < 0 || column < 0 || column >= CT_COUNT)
+    {
+        return QModelIndex();
+    }
+
+    if (!parent.isValid())
+    {
+        return row < m_groups.size() ? createIndex(row, column, nullptr) : QModelIndex();
+    }
+
+    // Subtitles have no children
+    if (IsSubtitle(parent) || row >= m_groups[parent.row()]->m_fetched)
+    {
+        return QModelIndex();
+    }
+
+    return createIndex(row, column, m_groups[parent.row()]);
+}
+
+QModelIndex fcoTreeModel::parent(QModelIndex const& child) const
+{
+    if (!IsSubtitle(child))
+    {
+        return QModelIndex();
+    }
+
+    GroupNode const* node = static_cast<GroupNode const*>(child.internalPointer());
+    return createIndex(node->m_row, CT_Name, nullptr);
+}
+
+int fcoTreeModel::rowCount(QModelIndex const& parent) const
+{
+    if (!parent.isValid())
+    {
+        return m_groups.size();
+    }
+
+    if (IsSubtitle(parent) || parent.column() != CT_Name)
+    {
+        return 0;
+    }
+
+    return m_groups[parent.row()]->m_fetched;
+}
+
+int fcoTreeModel::columnCount(QModelIndex const& parent) const
+{
+    Q_UNUSED(parent);
+    return CT_COUNT;
+}
+
+bool fcoTreeModel::hasChildren(QModelIndex const& parent) const
+{
+    if (!parent.isValid())
+    {
+        return !m_groups.isEmpty();
+    }
+
+    if (IsSubtitle(parent) || parent.column() != CT_Name)
+    {
+        return false;
+    }
+
+    return m_fco->GetSubtitleCount(static_cast<unsigned int>(parent.row())) > 0;
+}
+
+bool fcoTreeModel::canFetchMore(QModelIndex const& parent) const
+{
+    if (!parent.isValid() || IsSubtitle(parent))
+    {
+        return false;
+    }
+
+    unsigned int const groupID = static_cast<unsigned int>(parent.row());
+    return static_cast<unsigned int>(m_groups[parent.row()]->m_fetched) < m_fco->GetSubtitleCount(groupID);
+}
+
+void fcoTreeModel::fetchMore(QModelIndex const& parent)
+{
+    if (!canFetchMore(parent))
+    {
+        return;
+    }
+
+    unsigned int const groupID = static_cast<unsigned int>(parent.row());
+    unsigned int const fetched = static_cast<unsigned int>(m_groups[parent.row()]->m_fetched);
+    FetchTo(groupID, fetched + c_fetchBatch - 1);
+}
+
+QVariant fcoTreeModel::data(QModelIndex const& index, int role) const
+{
+    if (!index.isValid())
+    {
+        return QVariant();
+    }
+
+    bool const isSubtitle = IsSubtitle(index);
+    unsigned int const groupID = GetGroupID(index);
+    unsigned int const subtitleID = GetSubtitleID(index);
+
+    switch (role)
+    {
+    case Qt::DisplayRole:
+    {
+        if (isSubtitle)
+        {
+            switch (index.column())
+            {
+            case CT_Name:
+                return QString::fromStdString(m_fco->GetLabel(groupID, subtitleID));
+            case CT_SerifuID:
+            {
+                unsigned int const serifuID = groupID * 1000 + subtitleID;
+                return serifuID < 1000 ? QString() : QString::number(serifuID);
+            }
+            case CT_Subtitle:
+                return QString::fromStdWString(m_fco->GetSubtitle(groupID, subtitleID));
+            }
+        }
+        else
+        {
+            switch (index.column())
+            {
+            case CT_Name:
+                return QString::fromStdString(m_fco->GetGroupName(groupID));
+            case CT_SerifuID:
+                return groupID == 0 ? QString() : QString::number(groupID) + "xxx";
+            }
+        }
+        break;
+    }
+    case Qt::TextAlignmentRole:
+    {
+        if (index.column() == CT_SerifuID)
+        {
+            return static_cast<int>(Qt::AlignCenter);
+        }
+        break;
+    }
+    case Qt::ForegroundRole:
+    {
+        // Group row only highlights name and ID
+        bool const highlighted = isSubtitle
+                ? (groupID == m_highlightGroupID && subtitleID == m_highlightSubtitleID)
+                : (groupID == m_highlightGroupID && index.column() != CT_Subtitle);
+        if (highlighted)
+        {
+            return QColor(255,0,0);
+        }
+        break;
+    }
+    }
+
+    return QVariant();
+}
+
+QVariant fcoTreeModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole)
+    {
+        return QVariant();
+    }
+
+    switch (section)
+    {
+    case CT_Name:       return QString("Name");
+    case CT_SerifuID:   return QString("SerifuID");
+    case CT_Subtitle:   return QString("Subtitle");
+    }
+
+    return QVariant();
+}
+
+//-----------------------------------------------------
+// Free all group nodes
+//-----------------------------------------------------
+void fcoTreeModel::ClearGroups()
+{
+    qDeleteAll(m_groups);
+    m_groups.clear();
+}
+
+//-----------------------------------------------------
+// Re-number group nodes from _first onwards
+//-----------------------------------------------------
+void fcoTreeModel::UpdateGroupRows(int _first)
+{
+    for (int i = _first; i < m_groups.size(); i++)
+    {
+        m_groups[i]->m_row = i;
+    }
+}
+
+//-----------------------------------------------------
+// Expose subtitle rows of a group up to _subtitleID
+//-----------------------------------------------------
+void fcoTreeModel::FetchTo(unsigned int _groupID, unsigned int _subtitleID)
+{
+    GroupNode* node = m_groups[static_cast<int>(_groupID)];
+    unsigned int const count = m_fco->GetSubtitleCount(_groupID);
+    unsigned int const fetched = static_cast<unsigned int>(node->m_fetched);
+    unsigned int const target = qMin(_subtitleID + 1, count);
+    if (target <= fetched)
+    {
+        return;
+    }
+
+    beginInsertRows(GroupIndex(_groupID), static_cast<int>(fetched), static_cast<int>(target) - 1);
+    node->m_fetched = static_cast<int>(target);
+    endInsertRows();
+}
+
+//-----------------------------------------------------
+// Repaint a subtitle row and its group row
+//-----------------------------------------------------
+void fcoTreeModel::EmitRowChanged(unsigned int _groupID, unsigned int _subtitleID)
+{
+    QModelIndex const group = GroupIndex(_groupID);
+    if (!group.isValid())
+    {
+        return;
+    }
+
+    emit dataChanged(group, GroupIndex(_groupID, CT_SerifuID));
+
+    GroupNode* node = m_groups[static_cast<int>(_groupID)];
+    if (static_cast<int>(_subtitleID) < node->m_fetched)
+    {
+        emit dataChanged(createIndex(static_cast<int>(_subtitleID), CT_Name, node), createIndex(static_cast<int>(_subtitleID), CT_Subtitle, node));
+    }
+}
+
+//-----------------------------------------------------
+// Serifu IDs follow the row, repaint a group's ID and
+// the given range of its fetched subtitles
+//-----------------------------------------------------
+void fcoTreeModel::EmitSerifuIDChanged(unsigned int _groupID, int _firstSubtitle, int _lastSubtitle)
+{
+    QModelIndex const group = GroupIndex(_groupID, CT_SerifuID);
+    if (!group.isValid())
+    {
+        return;
+    }
+
+    emit dataChanged(group, group, {Qt::DisplayRole});
+
+    GroupNode* node = m_groups[static_cast<int>(_groupID)];
+    _lastSubtitle = qMin(_lastSubtitle, node->m_fetched - 1);
+    if (_firstSubtitle <= _lastSubtitle)
+    {
+        emit dataChanged(createIndex(_firstSubtitle, CT_SerifuID, node), createIndex(_lastSubtitle, CT_SerifuID, node), {Qt::DisplayRole});
+    }
+}
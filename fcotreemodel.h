@@ -0,0 +1,93 @@
+#ifndef FCOTREEMODEL_H
+#define FCOTREEMODEL_H
+
+#include <QAbstractItemModel>
+#include <QColor>
+#include <QVector>
+
+#include "fco.h"
+
+//-----------------------------------------------------
+// Tree model reading groups/subtitles straight from an
+// fco document, subtitle rows are exposed in batches
+// as the view expands and scrolls through a group
+//-----------------------------------------------------
+class fcoTreeModel : public QAbstractItemModel
+{
+    Q_OBJECT
+
+public:
+    enum ColumnType : int
+    {
+        CT_Name = 0,
+        CT_SerifuID,
+        CT_Subtitle,
+
+        CT_COUNT
+    };
+
+public:
+    explicit fcoTreeModel(QObject *parent = nullptr);
+    ~fcoTreeModel() override;
+
+    // Document
+    void SetDocument(fco* _fco);
+    void Refresh();
+
+    // Structural edits (forwarded to the document)
+    unsigned int AddGroup();
+    void DeleteGroup(unsigned int _groupID);
+    void MoveGroup(unsigned int _groupID, unsigned int _newGroupID);
+    unsigned int AddSubtitle(unsigned int _groupID, string const& _label);
+    void DeleteSubtitle(unsigned int _groupID, unsigned int _subtitleID);
+    void MoveSubtitle(unsigned int _groupID, unsigned int _subtitleID, unsigned int _newSubtitleID);
+
+    // Row updates
+    void UpdateGroup(unsigned int _groupID);
+    void UpdateSubtitle(unsigned int _groupID, unsigned int _subtitleID);
+    void SetHighlight(unsigned int _groupID, unsigned int _subtitleID);
+
+    // Index helpers
+    QModelIndex GroupIndex(unsigned int _groupID, int _column = CT_Name) const;
+    QModelIndex SubtitleIndex(unsigned int _groupID, unsigned int _subtitleID, int _column = CT_Name);
+    bool IsSubtitle(QModelIndex const& _index) const;
+    unsigned int GetGroupID(QModelIndex const& _index) const;
+    unsigned int GetSubtitleID(QModelIndex const& _index) const;
+
+    // QAbstractItemModel
+    QModelIndex index(int row, int column, QModelIndex const& parent = QModelIndex()) const override;
+    QModelIndex parent(QModelIndex const& child) const override;
+    int rowCount(QModelIndex const& parent = QModelIndex()) const override;
+    int columnCount(QModelIndex const& parent = QModelIndex()) const override;
+    bool hasChildren(QModelIndex const& parent = QModelIndex()) const override;
+    bool canFetchMore(QModelIndex const& parent) const override;
+    void fetchMore(QModelIndex const& parent) override;
+    QVariant data(QModelIndex const& index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+private:
+    // Subtitle indices point to their group node, so they
+    // stay valid while groups are inserted/removed/moved
+    struct GroupNode
+    {
+        int m_row;
+        int m_fetched;  // Number of subtitle rows exposed so far
+    };
+
+    void ClearGroups();
+    void UpdateGroupRows(int _first);
+    void FetchTo(unsigned int _groupID, unsigned int _subtitleID);
+    void EmitRowChanged(unsigned int _groupID, unsigned int _subtitleID);
+    void EmitSerifuIDChanged(unsigned int _groupID, int _firstSubtitle, int _lastSubtitle);
+
+private:
+    static int const c_fetchBatch = 256;
+
+    fco* m_fco;
+    QVector<GroupNode*> m_groups;
+
+    unsigned int m_highlightGroupID;
+    unsigned int m_highlightSubtitleID;
+};
+
+#endif // FCOTREEMODEL_H
@@ -1,4 +1,5 @@
 #include "fte.h"
+#include "tracer.h"
 
 #include <assert.h>
 #include <stdlib.h>
@@ -11,6 +12,136 @@
 #include <codecvt>
 #include <locale>
 
+#include <emmintrin.h>
+
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+
+namespace
+{
+    // Size of one glyph record and the slots before characters
+    size_t const c_recordSize = 0x18;
+    uint32_t const c_recordWords = 6;
+    uint32_t const c_buttonRecords = 12;
+    uint32_t const c_dpadRecord = 0x78 - 0x64;
+    uint32_t const c_firstCharacter = 0x82 - 0x64;
+
+    // Records byte-swapped per pass, small enough for the stack
+    uint32_t const c_blockRecords = 64;
+
+    //-----------------------------------------------------
+    // Read-only view of a whole file, unmapped when it
+    // goes out of scope
+    //-----------------------------------------------------
+    class MappedFile
+    {
+    public:
+        MappedFile() : m_file(INVALID_HANDLE_VALUE), m_mapping(NULL), m_data(nullptr), m_size(0) {}
+        ~MappedFile()
+        {
+            if (m_data) UnmapViewOfFile(m_data);
+            if (m_mapping) CloseHandle(m_mapping);
+            if (m_file != INVALID_HANDLE_VALUE) CloseHandle(m_file);
+        }
+
+        bool Open(string const& _fileName)
+        {
+            m_file = CreateFileA(_fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+            if (m_file == INVALID_HANDLE_VALUE) return false;
+
+            LARGE_INTEGER size;
+            if (!GetFileSizeEx(m_file, &size) || size.QuadPart == 0) return false;
+            m_size = static_cast<size_t>(size.QuadPart);
+
+            m_mapping = CreateFileMappingA(m_file, NULL, PAGE_READONLY, 0, 0, NULL);
+            if (!m_mapping) return false;
+
+            m_data = static_cast<uint8_t const*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+            return m_data != nullptr;
+        }
+
+        uint8_t const* Data() const { return m_data; }
+        size_t Size() const { return m_size; }
+
+    private:
+        HANDLE m_file;
+        HANDLE m_mapping;
+        uint8_t const* m_data;
+        size_t m_size;
+    };
+
+    //-----------------------------------------------------
+    // Big-endian reads from the mapped header, every read
+    // is checked against the end of the file
+    //-----------------------------------------------------
+    struct Cursor
+    {
+        uint8_t const* m_data;
+        size_t m_size;
+        size_t m_offset;
+
+        bool ReadInt(uint32_t& _value)
+        {
+            if (m_offset > m_size || m_size - m_offset < 4) return false;
+            memcpy(&_value, m_data + m_offset, 4);
+            _value = _byteswap_ulong(_value);
+            m_offset += 4;
+            return true;
+        }
+
+        bool ReadAscii(string& _value)
+        {
+            uint32_t length = 0;
+            if (!ReadInt(length) || m_size - m_offset < length) return false;
+            _value.assign(reinterpret_cast<char const*>(m_data + m_offset), length);
+            m_offset += length;
+
+            // Skip @ padding
+            m_offset = (m_offset + 0x03) & ~size_t(0x03);
+            return m_offset <= m_size;
+        }
+    };
+
+    //-----------------------------------------------------
+    // Big-endian words to native, four per SSE2 register:
+    // swap the bytes of each half, then the halves
+    //-----------------------------------------------------
+    void SwapWords(uint8_t const* _source, uint32_t* _words, size_t _count)
+    {
+        size_t i = 0;
+        for (; i + 4 <= _count; i += 4)
+        {
+            __m128i words = _mm_loadu_si128(reinterpret_cast<__m128i const*>(_source + i * 4));
+            words = _mm_or_si128(_mm_slli_epi16(words, 8), _mm_srli_epi16(words, 8));
+            words = _mm_shufflelo_epi16(words, _MM_SHUFFLE(2, 3, 0, 1));
+            words = _mm_shufflehi_epi16(words, _MM_SHUFFLE(2, 3, 0, 1));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(_words + i), words);
+        }
+
+        for (; i < _count; i++)
+        {
+            uint32_t word;
+            memcpy(&word, _source + i * 4, 4);
+            _words[i] = _byteswap_ulong(word);
+        }
+    }
+
+    //-----------------------------------------------------
+    // One swapped record into a table slot, the character
+    // is the high half of the last word
+    //-----------------------------------------------------
+    void StoreRecord(fte::GlyphTable& _table, size_t _slot, uint32_t const* _words)
+    {
+        _table.m_textureIndex[_slot] = _words[0];
+        memcpy(&_table.m_left[_slot], &_words[1], 4);
+        memcpy(&_table.m_top[_slot], &_words[2], 4);
+        memcpy(&_table.m_right[_slot], &_words[3], 4);
+        memcpy(&_table.m_bottom[_slot], &_words[4], 4);
+        _table.m_wchar[_slot] = static_cast<uint16_t>(_words[5] >> 16);
+    }
+}
+
 fte::fte()
 {
     Reset();
@@ -22,62 +153,36 @@ void fte::Reset()
     m_textures.clear();
     m_buttonData.clear();
     m_data.clear();
+    m_buttonTable.Clear();
+    m_glyphTable.Clear();
+    m_lookup.clear();
 }
 
-//-----------------------------------------------------
-// Read an int from 4 bytes
-//-----------------------------------------------------
-unsigned int fte::ReadInt
-(
-    FILE * _file
-)
+void fte::GlyphTable::Resize(size_t _size)
 {
-    // Read int, require flipping bytes
-    unsigned int flippedInt;
-    fread(&flippedInt, sizeof(unsigned int), 1, _file);
-    return _byteswap_ulong(flippedInt);
+    m_textureIndex.resize(_size);
+    m_left.resize(_size);
+    m_top.resize(_size);
+    m_right.resize(_size);
+    m_bottom.resize(_size);
+    m_wchar.resize(_size);
 }
 
-float fte::ReadFloat(FILE *_file)
+void fte::GlyphTable::Clear()
 {
-    float f;
-    unsigned int i = ReadInt(_file);
-
-    assert(sizeof f == sizeof(i));
-    memcpy(&f, &i, sizeof(f));
-
-    return f;
+    Resize(0);
 }
 
-//-----------------------------------------------------
-// Read a string from bytes
-//-----------------------------------------------------
-string fte::ReadAscii
-(
-    FILE* _file
-)
+fte::Data fte::GlyphTable::Get(size_t _index) const
 {
-    // Get string length, require flipping bytes
-    unsigned int stringLength = ReadInt(_file);
-
-    // Read bytes as ascii
-    char *stringBuffer = new char[stringLength + 1];
-    stringBuffer[stringLength] = '\0';
-    fread(stringBuffer, 1, stringLength, _file);
-
-    // Check for @ padding
-    while (ftell(_file) % 0x04 != 0x00)
-    {
-        char padding;
-        fread(&padding, 1, 1, _file);
-        assert(padding == '@');
-    }
-
-    // Cast to string and clean up
-    string stringReturn(stringBuffer);
-    delete[] stringBuffer;
-
-    return stringReturn;
+    Data data;
+    data.m_textureIndex = m_textureIndex[_index];
+    data.m_left = m_left[_index];
+    data.m_top = m_top[_index];
+    data.m_right = m_right[_index];
+    data.m_bottom = m_bottom[_index];
+    data.m_wchar = static_cast<wchar_t>(m_wchar[_index]);
+    return data;
 }
 
 //-----------------------------------------------------
@@ -129,59 +234,151 @@ void fte::WriteAscii
     delete[] stringBuffer;
 }
 
+//-----------------------------------------------------
+// Records as the database generator edits them
+//-----------------------------------------------------
 bool fte::Import(const string &_fileName, string &_errorMsg)
 {
+    if (!ReadTables(_fileName, _errorMsg))
+    {
+        return false;
+    }
+
+    m_buttonData.resize(m_buttonTable.Size());
+    for (size_t i = 0; i < m_buttonTable.Size(); i++)
+    {
+        m_buttonData[i] = m_buttonTable.Get(i);
+    }
+
+    m_data.resize(m_glyphTable.Size());
+    for (size_t i = 0; i < m_glyphTable.Size(); i++)
+    {
+        m_data[i] = m_glyphTable.Get(i);
+    }
+
+    // Edits only go to the records from here on
+    m_buttonTable.Clear();
+    m_glyphTable.Clear();
+    return true;
+}
+
+//-----------------------------------------------------
+// Glyph tables and the lookup, for rendering text
+//-----------------------------------------------------
+bool fte::ImportTable(const string &_fileName, string &_errorMsg)
+{
+    if (!ReadTables(_fileName, _errorMsg))
+    {
+        return false;
+    }
+
+    BuildLookup();
+    return true;
+}
+
+//-----------------------------------------------------
+// Map the file and decode the record array in blocks,
+// buttons and characters go to their own tables
+//-----------------------------------------------------
+bool fte::ReadTables(const string &_fileName, string &_errorMsg)
+{
+    TRACE_SCOPE("fte", "Import");
+
     Reset();
 
-    FILE* fteFile;
-    fopen_s(&fteFile, _fileName.c_str(), "rb");
-    if (!fteFile)
+    MappedFile file;
+    if (!file.Open(_fileName))
     {
         _errorMsg = "Unable to open file!";
         return false;
     }
 
     // Header
-    fseek(fteFile, 0x8, SEEK_SET);
+    Cursor cursor{file.Data(), file.Size(), 0x8};
 
-    uint32_t textureCount = ReadInt(fteFile);
-    for (uint32_t i = 0; i < textureCount; i++)
+    uint32_t textureCount = 0;
+    bool valid = cursor.ReadInt(textureCount);
+    for (uint32_t i = 0; valid && i < textureCount; i++)
     {
         Texture texture;
-        texture.m_name = ReadAscii(fteFile);
-        texture.m_width = ReadInt(fteFile);
-        texture.m_height = ReadInt(fteFile);
+        valid = cursor.ReadAscii(texture.m_name) && cursor.ReadInt(texture.m_width) && cursor.ReadInt(texture.m_height);
         m_textures.push_back(texture);
     }
 
-    uint32_t characterCount = ReadInt(fteFile);
-    m_buttonData.reserve(13);
-    m_data.reserve(characterCount - 29);
-    uint32_t index = 0x64; // A button
-    for (uint32_t i = 0; i < characterCount; i++)
+    uint32_t characterCount = 0;
+    valid = valid && cursor.ReadInt(characterCount);
+    if (!valid || (file.Size() - cursor.m_offset) / c_recordSize < characterCount)
     {
-        Data data;
-        data.Read(fteFile);
+        Reset();
+        _errorMsg = "File is truncated!";
+        return false;
+    }
 
-        if (index <= 0x6F || index == 0x78)
-        {
-            m_buttonData.push_back(data);
-            m_buttonTextureIndex = data.m_textureIndex;
-        }
-        else if (index >= 0x82)
+    // A-RStick, DPad, then characters after the unused slots
+    m_buttonTable.Resize(min(characterCount, c_buttonRecords) + (characterCount > c_dpadRecord ? 1 : 0));
+    m_glyphTable.Resize(characterCount > c_firstCharacter ? characterCount - c_firstCharacter : 0);
+
+    uint8_t const* records = file.Data() + cursor.m_offset;
+    uint32_t words[c_blockRecords * c_recordWords];
+    for (uint32_t block = 0; block < characterCount; block += c_blockRecords)
+    {
+        uint32_t const count = min(c_blockRecords, characterCount - block);
+        SwapWords(records + block * c_recordSize, words, count * c_recordWords);
+
+        for (uint32_t i = 0; i < count; i++)
         {
-            m_data.push_back(data);
+            uint32_t const record = block + i;
+            uint32_t const* recordWords = words + i * c_recordWords;
+            if (record >= c_firstCharacter)
+            {
+                StoreRecord(m_glyphTable, record - c_firstCharacter, recordWords);
+            }
+            else if (record < c_buttonRecords)
+            {
+                StoreRecord(m_buttonTable, record, recordWords);
+            }
+            else if (record == c_dpadRecord)
+            {
+                StoreRecord(m_buttonTable, c_buttonRecords, recordWords);
+            }
         }
+    }
 
-        index++;
+    if (m_buttonTable.Size() > 0)
+    {
+        m_buttonTextureIndex = m_buttonTable.m_textureIndex.back();
     }
 
-    fclose(fteFile);
     return true;
 }
 
+//-----------------------------------------------------
+// Fill the lookup from the tables, a character listed
+// twice keeps its last record
+//-----------------------------------------------------
+void fte::BuildLookup()
+{
+    TRACE_SCOPE("fte", "Build Lookup");
+
+    m_lookup.assign(c_bmpSize + c_buttonCount, Glyph{c_noGlyph, 0.0f, 0.0f, 0.0f, 0.0f});
+
+    GlyphTable const& glyphs = m_glyphTable;
+    for (size_t i = 0; i < glyphs.Size(); i++)
+    {
+        m_lookup[glyphs.m_wchar[i]] = Glyph{glyphs.m_textureIndex[i], glyphs.m_left[i], glyphs.m_top[i], glyphs.m_right[i], glyphs.m_bottom[i]};
+    }
+
+    GlyphTable const& buttons = m_buttonTable;
+    for (size_t i = 0; i < buttons.Size() && i < c_buttonCount; i++)
+    {
+        m_lookup[c_bmpSize + i] = Glyph{buttons.m_textureIndex[i], buttons.m_left[i], buttons.m_top[i], buttons.m_right[i], buttons.m_bottom[i]};
+    }
+}
+
 bool fte::Export(const string &_path, string &_errorMsg)
 {
+    TRACE_SCOPE("fte", "Export");
+
     FILE* output;
     fopen_s(&output, (_path + "/All.fte").c_str(), "wb");
 
@@ -308,18 +505,6 @@ void fte::GenerateFcoDatabase(const wstring &content)
 }
 
 
-void fte::Data::Read(FILE *_file)
-{
-    m_textureIndex = ReadInt(_file);
-    m_left = ReadFloat(_file);
-    m_top = ReadFloat(_file);
-    m_right = ReadFloat(_file);
-    m_bottom = ReadFloat(_file);
-    fread(&m_wchar, 2, 1, _file);
-    m_wchar = _byteswap_ushort(m_wchar);
-    fseek(_file, 0x2, SEEK_CUR);
-}
-
 void fte::Data::Write(FILE *_file, uint16_t unknown) const
 {
     WriteInt(_file, m_textureIndex);
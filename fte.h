@@ -1,6 +1,7 @@
 #ifndef FTE_H
 #define FTE_H
 
+#include <cstdint>
 #include <string>
 #include <map>
 #include <vector>
@@ -20,7 +21,6 @@ public:
         wchar_t m_wchar;
 
     public:
-        void Read(FILE* _file);
         void Write(FILE* _file, uint16_t unknown) const;
     };
 
@@ -31,21 +31,67 @@ public:
         uint32_t m_height;
     };
 
+    // Glyph records split into one array per field
+    struct GlyphTable
+    {
+        vector<uint32_t> m_textureIndex;
+        vector<float> m_left;
+        vector<float> m_top;
+        vector<float> m_right;
+        vector<float> m_bottom;
+        vector<uint16_t> m_wchar;
+
+    public:
+        size_t Size() const { return m_wchar.size(); }
+        void Resize(size_t _size);
+        void Clear();
+        Data Get(size_t _index) const;
+    };
+
+    // Texture and UV rectangle of one lookup slot
+    struct Glyph
+    {
+        uint32_t m_textureIndex;
+        float m_left;
+        float m_top;
+        float m_right;
+        float m_bottom;
+    };
+
+    // Lookup has a slot per UTF-16 code unit, then the buttons
+    static uint32_t const c_noGlyph = 0xFFFFFFFF;
+    static size_t const c_bmpSize = 0x10000;
+    static size_t const c_buttonCount = 13;
+
     fte();
     void Reset();
-    bool IsLoaded() { return !m_data.empty(); }
+    bool IsLoaded() { return !m_data.empty() || m_glyphTable.Size() > 0; }
 
-    // Import & Export
+    // Import & Export, Import fills the records for editing,
+    // ImportTable the glyph tables and lookup for rendering
     bool Import(string const& _fileName, string& _errorMsg);
+    bool ImportTable(string const& _fileName, string& _errorMsg);
     bool Export(string const& _path, string& _errorMsg);
 
+    // Direct lookup, only built by ImportTable
+    Glyph const* FindGlyph(wchar_t _wchar) const
+    {
+        if (m_lookup.empty()) return nullptr;
+        Glyph const& glyph = m_lookup[static_cast<uint16_t>(_wchar)];
+        return glyph.m_textureIndex != c_noGlyph ? &glyph : nullptr;
+    }
+    Glyph const* FindButton(size_t _button) const
+    {
+        if (m_lookup.empty() || _button >= c_buttonCount) return nullptr;
+        Glyph const& glyph = m_lookup[c_bmpSize + _button];
+        return glyph.m_textureIndex != c_noGlyph ? &glyph : nullptr;
+    }
+
     static void GenerateFcoDatabase(wstring const& content);
 
 private:
-    // Reading from bytes
-    static unsigned int ReadInt(FILE* _file);
-    static float ReadFloat(FILE* _file);
-    static string ReadAscii(FILE* _file);
+    bool ReadTables(string const& _fileName, string& _errorMsg);
+    void BuildLookup();
 
     // Writing bytes
     static void WriteInt(FILE* _file, unsigned int _writeInt);
@@ -58,6 +104,12 @@ public:
 
     vector<Data> m_buttonData;
     vector<Data> m_data;
+
+    GlyphTable m_buttonTable;
+    GlyphTable m_glyphTable;
+
+private:
+    vector<Glyph> m_lookup;
 };
 
 #endif // FTE_H
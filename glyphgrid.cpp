@@ -0,0 +1,112 @@
+#include "glyphgrid.h"
+
+#include <algorithm>
+
+GlyphGrid::GlyphGrid()
+{
+    m_columns = 0;
+    m_rows = 0;
+}
+
+void GlyphGrid::Reset(QSize const& _pageSize)
+{
+    m_columns = qMax(1, (_pageSize.width() + c_cellSize - 1) / c_cellSize);
+    m_rows = qMax(1, (_pageSize.height() + c_cellSize - 1) / c_cellSize);
+    m_cells.clear();
+    m_cells.resize(m_columns * m_rows);
+    m_rects.clear();
+}
+
+void GlyphGrid::Insert(int _id, QRect const& _rect)
+{
+    if (_id >= m_rects.size())
+    {
+        m_rects.resize(_id + 1);
+    }
+    m_rects[_id] = _rect;
+    AddToCells(_id, _rect);
+}
+
+//-----------------------------------------------------
+// Only the cells under the old and new rectangle change
+//-----------------------------------------------------
+void GlyphGrid::Move(int _id, QRect const& _rect)
+{
+    RemoveFromCells(_id, m_rects[_id]);
+    m_rects[_id] = _rect;
+    AddToCells(_id, _rect);
+}
+
+//-----------------------------------------------------
+// Same answer as scanning the list in order
+//-----------------------------------------------------
+int GlyphGrid::Find(QPoint const& _pos) const
+{
+    if (m_cells.isEmpty()) return -1;
+
+    // Cells are sorted by id
+    for (int id : m_cells[Row(_pos.y()) * m_columns + Column(_pos.x())])
+    {
+        QRect const& rect = m_rects[id];
+        if (_pos.x() >= rect.x() && _pos.x() < rect.x() + rect.width() && _pos.y() >= rect.y() && _pos.y() < rect.y() + rect.height())
+        {
+            return id;
+        }
+    }
+
+    return -1;
+}
+
+//-----------------------------------------------------
+// Anything off the page belongs to the nearest edge
+// cell, so points and rectangles there still meet
+//-----------------------------------------------------
+int GlyphGrid::Column(int _x) const
+{
+    return _x < 0 ? 0 : qMin(m_columns - 1, _x / c_cellSize);
+}
+
+int GlyphGrid::Row(int _y) const
+{
+    return _y < 0 ? 0 : qMin(m_rows - 1, _y / c_cellSize);
+}
+
+//-----------------------------------------------------
+// Cells a rectangle touches, false if it is empty
+//-----------------------------------------------------
+bool GlyphGrid::CellRange(QRect const& _rect, QRect& _cells) const
+{
+    if (_rect.width() <= 0 || _rect.height() <= 0) return false;
+
+    _cells = QRect(QPoint(Column(_rect.x()), Row(_rect.y())), QPoint(Column(_rect.x() + _rect.width() - 1), Row(_rect.y() + _rect.height() - 1)));
+    return true;
+}
+
+void GlyphGrid::AddToCells(int _id, QRect const& _rect)
+{
+    QRect cells;
+    if (!CellRange(_rect, cells)) return;
+
+    for (int row = cells.top(); row <= cells.bottom(); row++)
+    {
+        for (int column = cells.left(); column <= cells.right(); column++)
+        {
+            QVector<int>& cell = m_cells[row * m_columns + column];
+            cell.insert(std::lower_bound(cell.begin(), cell.end(), _id), _id);
+        }
+    }
+}
+
+void GlyphGrid::RemoveFromCells(int _id, QRect const& _rect)
+{
+    QRect cells;
+    if (!CellRange(_rect, cells)) return;
+
+    for (int row = cells.top(); row <= cells.bottom(); row++)
+    {
+        for (int column = cells.left(); column <= cells.right(); column++)
+        {
+            m_cells[row * m_columns + column].removeOne(_id);
+        }
+    }
+}
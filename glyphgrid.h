@@ -0,0 +1,46 @@
+#ifndef GLYPHGRID_H
+#define GLYPHGRID_H
+
+#include <QPoint>
+#include <QRect>
+#include <QSize>
+#include <QVector>
+
+//-----------------------------------------------------
+// Uniform grid over one atlas page, every cell lists
+// the glyph rectangles that touch it so a hit test
+// only looks at the cell under the point
+//-----------------------------------------------------
+class GlyphGrid
+{
+public:
+    GlyphGrid();
+
+    void Reset(QSize const& _pageSize);
+    int GetCount() const { return m_rects.size(); }
+
+    // Ids are positions in the page's character list,
+    // added in order
+    void Insert(int _id, QRect const& _rect);
+    void Move(int _id, QRect const& _rect);
+
+    // Lowest id containing _pos, -1 if none
+    int Find(QPoint const& _pos) const;
+
+private:
+    int Column(int _x) const;
+    int Row(int _y) const;
+    bool CellRange(QRect const& _rect, QRect& _cells) const;
+    void AddToCells(int _id, QRect const& _rect);
+    void RemoveFromCells(int _id, QRect const& _rect);
+
+private:
+    static int const c_cellSize = 32;
+
+    int m_columns;
+    int m_rows;
+    QVector<QVector<int>> m_cells;
+    QVector<QRect> m_rects;
+};
+
+#endif // GLYPHGRID_H
@@ -1,4 +1,5 @@
 #include "fcoeditorwindow.h"
+#include "tracer.h"
 #include <QApplication>
 
 using namespace std;
@@ -6,6 +7,8 @@ using namespace std;
 int main(int argc, char *argv[])
 {
     QApplication a(argc, argv);
+    Tracer::SetThreadName("GUI");
+
     fcoEditorWindow w;
     w.show();
 
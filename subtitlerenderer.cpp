@@ -0,0 +1,280 @@
+#include "subtitlerenderer.h"
+#include "ddsreader.h"
+#include "tracer.h"
+
+#include <QFileInfo>
+#include <QFontMetrics>
+#include <QPainter>
+
+namespace
+{
+    // Same order as fte's button slots
+    char const* const c_buttonNames[] =
+    {
+        "A", "B", "X", "Y", "LB", "RB", "LT", "RT", "Start", "Back", "LStick", "RStick", "DPad"
+    };
+}
+
+SubtitleRenderer::SubtitleRenderer()
+{
+    m_font = QFont("FOT-Seurat Pro B");
+    m_font.setPixelSize(21);
+    m_atlasGlyphCount = 0;
+}
+
+//-----------------------------------------------------
+// Read glyph rectangles from an fte and its .dds pages
+//-----------------------------------------------------
+bool SubtitleRenderer::LoadAtlas(QString const& _fteFile, QString& _errorMsg)
+{
+    TRACE_SCOPE("preview", "Load Atlas");
+
+    m_textures.clear();
+    m_glyphs.clear();
+    m_atlasGlyphCount = 0;
+    ClearCache();
+
+    fte atlas;
+    string errorMsg;
+    if (!atlas.ImportTable(_fteFile.toStdString(), errorMsg))
+    {
+        _errorMsg = QString::fromStdString(errorMsg);
+        return false;
+    }
+
+    // Textures are next to the fte file
+    QString const path = QFileInfo(_fteFile).absolutePath();
+    for (fte::Texture const& texture : atlas.m_textures)
+    {
+        m_textures.push_back(DdsReader::Load(path + "/" + QString::fromStdString(texture.m_name) + ".dds"));
+    }
+
+    auto toGlyph = [this](fte::Glyph const* _data, Glyph& _glyph) -> bool
+    {
+        if (!_data || _data->m_textureIndex >= static_cast<uint32_t>(m_textures.size())) return false;
+
+        QImage const& texture = m_textures[static_cast<int>(_data->m_textureIndex)];
+        if (texture.isNull()) return false;
+
+        int const left = qRound(_data->m_left * texture.width());
+        int const top = qRound(_data->m_top * texture.height());
+        int const right = qRound(_data->m_right * texture.width());
+        int const bottom = qRound(_data->m_bottom * texture.height());
+        if (right <= left || bottom <= top) return false;
+
+        _glyph.m_textureIndex = static_cast<int>(_data->m_textureIndex);
+        _glyph.m_rect = QRect(left, top, right - left, bottom - top);
+        return true;
+    };
+
+    // Same slots as the fte lookup, resolved to pixels once
+    m_glyphs.fill(Glyph{-1, QRect()}, static_cast<int>(fte::c_bmpSize + fte::c_buttonCount));
+    for (size_t i = 0; i < fte::c_bmpSize; i++)
+    {
+        if (toGlyph(atlas.FindGlyph(static_cast<wchar_t>(i)), m_glyphs[static_cast<int>(i)]))
+        {
+            m_atlasGlyphCount++;
+        }
+    }
+
+    for (size_t i = 0; i < fte::c_buttonCount; i++)
+    {
+        toGlyph(atlas.FindButton(i), m_glyphs[static_cast<int>(fte::c_bmpSize + i)]);
+    }
+
+    if (m_atlasGlyphCount == 0)
+    {
+        m_textures.clear();
+        m_glyphs.clear();
+        _errorMsg = "Unable to find font textures of " + _fteFile;
+        return false;
+    }
+
+    return true;
+}
+
+//-----------------------------------------------------
+// Button slot of a \Name\ symbol, -1 if unknown
+//-----------------------------------------------------
+int SubtitleRenderer::ButtonSlot(QString const& _name)
+{
+    for (int i = 0; i < static_cast<int>(sizeof(c_buttonNames) / sizeof(c_buttonNames[0])); i++)
+    {
+        if (_name == QLatin1String(c_buttonNames[i])) return i;
+    }
+    return -1;
+}
+
+//-----------------------------------------------------
+// Drop all cached glyph/button pixmaps
+//-----------------------------------------------------
+void SubtitleRenderer::ClearCache()
+{
+    m_glyphCache.clear();
+    m_buttonCache.clear();
+}
+
+//-----------------------------------------------------
+// Lay out symbols line by line and paint them
+//-----------------------------------------------------
+QPixmap SubtitleRenderer::Render(vector<wstring> const& _characters, vector<QColor> const& _colors)
+{
+    // Collect pixmaps per line first so the result is sized once
+    QVector<QVector<QPixmap>> lines(1);
+    QVector<int> lineWidths(1, 0);
+    for (size_t i = 0; i < _characters.size(); i++)
+    {
+        wstring const& symbol = _characters[i];
+        if (symbol.empty()) continue;
+
+        if (symbol == L"\n")
+        {
+            lines.push_back(QVector<QPixmap>());
+            lineWidths.push_back(0);
+            continue;
+        }
+
+        QPixmap pixmap;
+        if (symbol.size() > 2 && symbol.front() == L'\\')
+        {
+            pixmap = GetButton(QString::fromStdWString(symbol.substr(1, symbol.size() - 2)));
+        }
+        else
+        {
+            pixmap = GetGlyph(symbol[0], i < _colors.size() ? _colors[i] : QColor(Qt::white));
+        }
+
+        lines.back().push_back(pixmap);
+        lineWidths.back() += pixmap.width();
+    }
+
+    int width = 1;
+    for (int lineWidth : lineWidths)
+    {
+        width = qMax(width, lineWidth);
+    }
+
+    QPixmap result(width, lines.size() * c_lineHeight);
+    result.fill(Qt::transparent);
+
+    QPainter painter(&result);
+    for (int line = 0; line < lines.size(); line++)
+    {
+        int x = 0;
+        for (QPixmap const& pixmap : lines[line])
+        {
+            int const y = line * c_lineHeight + (c_lineHeight - pixmap.height()) / 2;
+            painter.drawPixmap(x, y, pixmap);
+            x += pixmap.width();
+        }
+    }
+
+    return result;
+}
+
+//-----------------------------------------------------
+// Cached tinted glyph
+//-----------------------------------------------------
+QPixmap SubtitleRenderer::GetGlyph(wchar_t _wchar, QColor const& _color)
+{
+    quint64 const key = (static_cast<quint64>(_wchar) << 32) | _color.rgba();
+    auto iter = m_glyphCache.constFind(key);
+    if (iter != m_glyphCache.constEnd())
+    {
+        return iter.value();
+    }
+
+    if (m_glyphCache.size() >= c_maxCachedGlyphs)
+    {
+        m_glyphCache.clear();
+    }
+
+    Glyph const* glyph = m_glyphs.isEmpty() ? nullptr : &m_glyphs.at(static_cast<uint16_t>(_wchar));
+    QPixmap pixmap = (glyph && glyph->m_textureIndex != -1) ? RenderAtlasGlyph(*glyph, _color) : RenderFontGlyph(_wchar, _color);
+    m_glyphCache.insert(key, pixmap);
+    return pixmap;
+}
+
+//-----------------------------------------------------
+// Cached button image, from the atlas when available
+//-----------------------------------------------------
+QPixmap SubtitleRenderer::GetButton(QString const& _name)
+{
+    auto iter = m_buttonCache.constFind(_name);
+    if (iter != m_buttonCache.constEnd())
+    {
+        return iter.value();
+    }
+
+    QPixmap pixmap;
+    int const slot = ButtonSlot(_name);
+    Glyph const* button = (slot == -1 || m_glyphs.isEmpty()) ? nullptr : &m_glyphs.at(static_cast<int>(fte::c_bmpSize) + slot);
+    if (button && button->m_textureIndex != -1)
+    {
+        Glyph const& glyph = *button;
+        QImage const image = m_textures[glyph.m_textureIndex].copy(glyph.m_rect);
+        pixmap = QPixmap::fromImage(image.scaledToHeight(c_lineHeight, Qt::SmoothTransformation));
+    }
+    else
+    {
+        pixmap = QPixmap(":/resources/" + _name + ".png");
+    }
+
+    m_buttonCache.insert(_name, pixmap);
+    return pixmap;
+}
+
+//-----------------------------------------------------
+// Cut a glyph out of its page, scale it and use it as
+// the coverage of a block of the color
+//-----------------------------------------------------
+QPixmap SubtitleRenderer::RenderAtlasGlyph(Glyph const& _glyph, QColor const& _color) const
+{
+    QImage const glyph = m_textures[_glyph.m_textureIndex].copy(_glyph.m_rect)
+            .scaledToHeight(c_lineHeight, Qt::SmoothTransformation)
+            .convertToFormat(QImage::Format_ARGB32);
+
+    // Coverage is the alpha of pages that have one, generated pages
+    // are opaque white on black so it is their brightness instead
+    bool const hasAlpha = m_textures[_glyph.m_textureIndex].hasAlphaChannel();
+    QImage mask(glyph.size(), QImage::Format_Grayscale8);
+    for (int y = 0; y < glyph.height(); y++)
+    {
+        QRgb const* source = reinterpret_cast<QRgb const*>(glyph.constScanLine(y));
+        uchar* coverage = mask.scanLine(y);
+        for (int x = 0; x < glyph.width(); x++)
+        {
+            coverage[x] = uchar(hasAlpha ? qAlpha(source[x]) : qRed(source[x]));
+        }
+    }
+
+    QImage image(glyph.size(), QImage::Format_ARGB32);
+    image.fill(_color);
+    image.setAlphaChannel(mask);
+    return QPixmap::fromImage(image);
+}
+
+//-----------------------------------------------------
+// Glyph drawn with the bundled font
+//-----------------------------------------------------
+QPixmap SubtitleRenderer::RenderFontGlyph(wchar_t _wchar, QColor const& _color) const
+{
+    QFontMetrics const metrics(m_font);
+    QString const text = QString::fromWCharArray(&_wchar, 1);
+
+    // Spaces take the width the game gives them
+    bool const isSpace = (_wchar == L' ' || _wchar == L'　');
+    int const width = metrics.horizontalAdvance(_wchar == L' ' ? "]" : (_wchar == L'　' ? "]ii" : text));
+
+    QPixmap pixmap(qMax(width, 1), c_lineHeight);
+    pixmap.fill(Qt::transparent);
+    if (!isSpace)
+    {
+        QPainter painter(&pixmap);
+        painter.setFont(m_font);
+        painter.setPen(_color);
+        painter.drawText(pixmap.rect(), Qt::AlignLeft | Qt::AlignVCenter, text);
+    }
+
+    return pixmap;
+}
@@ -0,0 +1,62 @@
+#ifndef SUBTITLERENDERER_H
+#define SUBTITLERENDERER_H
+
+#include <QColor>
+#include <QFont>
+#include <QHash>
+#include <QImage>
+#include <QPixmap>
+#include <QVector>
+
+#include "fte.h"
+
+//-----------------------------------------------------
+// Draws subtitle previews with the glyphs of the game's
+// fte atlas, glyphs missing from the atlas (or no atlas
+// at all) are drawn with the bundled font instead
+//-----------------------------------------------------
+class SubtitleRenderer
+{
+public:
+    SubtitleRenderer();
+
+    bool LoadAtlas(QString const& _fteFile, QString& _errorMsg);
+    bool IsAtlasLoaded() const { return m_atlasGlyphCount > 0; }
+    void ClearCache();
+
+    // One color per symbol, buttons ignore their color
+    QPixmap Render(vector<wstring> const& _characters, vector<QColor> const& _colors);
+
+    static int const c_lineHeight = 27;
+
+private:
+    struct Glyph
+    {
+        int m_textureIndex;
+        QRect m_rect;
+    };
+
+    static int ButtonSlot(QString const& _name);
+
+    QPixmap GetGlyph(wchar_t _wchar, QColor const& _color);
+    QPixmap GetButton(QString const& _name);
+    QPixmap RenderAtlasGlyph(Glyph const& _glyph, QColor const& _color) const;
+    QPixmap RenderFontGlyph(wchar_t _wchar, QColor const& _color) const;
+
+private:
+    static int const c_maxCachedGlyphs = 8192;
+
+    QFont m_font;
+
+    // Atlas, pixel rectangles indexed like fte's lookup
+    // (code unit, then buttons), -1 texture for none
+    QVector<QImage> m_textures;
+    QVector<Glyph> m_glyphs;
+    int m_atlasGlyphCount;
+
+    // Caches, glyphs are keyed by character and rgba
+    QHash<quint64, QPixmap> m_glyphCache;
+    QHash<QString, QPixmap> m_buttonCache;
+};
+
+#endif // SUBTITLERENDERER_H
@@ -0,0 +1,180 @@
+#include "subtitletokenizer.h"
+#include "tracer.h"
+
+#include <algorithm>
+
+SubtitleTokenizer::SubtitleTokenizer(fco const* _fco)
+    : m_fco(_fco)
+    , m_invalidCount(0)
+{
+}
+
+//-----------------------------------------------------
+// Tokenize the whole text
+//-----------------------------------------------------
+void SubtitleTokenizer::Reset
+(
+    wstring const& _text
+)
+{
+    m_text = _text;
+    m_symbols.clear();
+    m_offsets.clear();
+    m_states.clear();
+    m_invalidCount = 0;
+
+    unsigned int offset = 0;
+    while (offset < m_text.size())
+    {
+        wstring symbol;
+        TokenState state;
+        unsigned int next = Lex(offset, symbol, state);
+
+        m_symbols.push_back(symbol);
+        m_offsets.push_back(offset);
+        m_states.push_back(state);
+        if (state != TS_Valid) m_invalidCount++;
+
+        offset = next;
+    }
+}
+
+//-----------------------------------------------------
+// Re-lex only the symbols affected by an edit
+//-----------------------------------------------------
+void SubtitleTokenizer::Update
+(
+    unsigned int _position,
+    unsigned int _removed,
+    wstring const& _added
+)
+{
+    TRACE_SCOPE("ui", "Tokenize Edit");
+
+    if (_position > m_text.size())
+    {
+        _position = static_cast<unsigned int>(m_text.size());
+    }
+    _removed = min(_removed, static_cast<unsigned int>(m_text.size()) - _position);
+
+    m_text.replace(_position, _removed, _added);
+    int const delta = static_cast<int>(_added.size()) - static_cast<int>(_removed);
+    unsigned int const oldEditEnd = _position + _removed;
+    unsigned int const newEditEnd = _position + static_cast<unsigned int>(_added.size());
+
+    // Start from the symbol containing the edit, a symbol only depends on text after its start
+    size_t first = upper_bound(m_offsets.begin(), m_offsets.end(), _position) - m_offsets.begin();
+    if (first > 0) first--;
+
+    vector<wstring> symbols;
+    vector<unsigned int> offsets;
+    vector<TokenState> states;
+
+    // Lex until a new boundary past the edit matches an old boundary past the edit
+    size_t resync = m_offsets.size();
+    size_t oldIndex = first;
+    unsigned int offset = first < m_offsets.size() ? m_offsets[first] : 0;
+    while (offset < m_text.size())
+    {
+        if (offset >= newEditEnd)
+        {
+            unsigned int const oldOffset = static_cast<unsigned int>(static_cast<int>(offset) - delta);
+            while (oldIndex < m_offsets.size() && m_offsets[oldIndex] < oldOffset)
+            {
+                oldIndex++;
+            }
+
+            if (oldIndex < m_offsets.size() && m_offsets[oldIndex] == oldOffset && oldOffset >= oldEditEnd)
+            {
+                resync = oldIndex;
+                break;
+            }
+        }
+
+        wstring symbol;
+        TokenState state;
+        unsigned int next = Lex(offset, symbol, state);
+
+        symbols.push_back(symbol);
+        offsets.push_back(offset);
+        states.push_back(state);
+        offset = next;
+    }
+
+    // Splice the re-lexed symbols in
+    for (size_t i = first; i < resync; i++)
+    {
+        if (m_states[i] != TS_Valid) m_invalidCount--;
+    }
+    for (TokenState state : states)
+    {
+        if (state != TS_Valid) m_invalidCount++;
+    }
+
+    m_symbols.erase(m_symbols.begin() + static_cast<int>(first), m_symbols.begin() + static_cast<int>(resync));
+    m_offsets.erase(m_offsets.begin() + static_cast<int>(first), m_offsets.begin() + static_cast<int>(resync));
+    m_states.erase(m_states.begin() + static_cast<int>(first), m_states.begin() + static_cast<int>(resync));
+
+    m_symbols.insert(m_symbols.begin() + static_cast<int>(first), make_move_iterator(symbols.begin()), make_move_iterator(symbols.end()));
+    m_offsets.insert(m_offsets.begin() + static_cast<int>(first), offsets.begin(), offsets.end());
+    m_states.insert(m_states.begin() + static_cast<int>(first), states.begin(), states.end());
+
+    // Symbols after the resync point only moved
+    if (delta != 0)
+    {
+        for (size_t i = first + offsets.size(); i < m_offsets.size(); i++)
+        {
+            m_offsets[i] = static_cast<unsigned int>(static_cast<int>(m_offsets[i]) + delta);
+        }
+    }
+}
+
+//-----------------------------------------------------
+// Error of the first invalid symbol
+//-----------------------------------------------------
+wstring SubtitleTokenizer::GetErrorMsg() const
+{
+    for (size_t i = 0; i < m_states.size(); i++)
+    {
+        if (m_states[i] == TS_Unterminated)
+        {
+            return L"Error in special character formating, must be \\xxxx\\";
+        }
+        else if (m_states[i] == TS_Unsupported)
+        {
+            return L"Unsupported character \"" + m_symbols[i] + L"\"";
+        }
+    }
+
+    return wstring();
+}
+
+//-----------------------------------------------------
+// Read one symbol at _offset, returns the next offset
+//-----------------------------------------------------
+unsigned int SubtitleTokenizer::Lex
+(
+    unsigned int _offset,
+    wstring& _symbol,
+    TokenState& _state
+) const
+{
+    unsigned int next = _offset + 1;
+    if (m_text[_offset] == L'\\')
+    {
+        // Special characters \A\, \B\ etc.
+        size_t endOfSpecial = m_text.find(L'\\', _offset + 1);
+        if (endOfSpecial == wstring::npos)
+        {
+            _symbol = m_text.substr(_offset);
+            _state = TS_Unterminated;
+            return static_cast<unsigned int>(m_text.size());
+        }
+
+        next = static_cast<unsigned int>(endOfSpecial) + 1;
+    }
+
+    _symbol = m_text.substr(_offset, next - _offset);
+    _state = (m_fco && m_fco->IsSymbolSupported(_symbol)) ? TS_Valid : TS_Unsupported;
+    return next;
+}
@@ -0,0 +1,56 @@
+#ifndef SUBTITLETOKENIZER_H
+#define SUBTITLETOKENIZER_H
+
+#include <string>
+#include <vector>
+
+#include "fco.h"
+
+using namespace std;
+
+//-----------------------------------------------------
+// Keeps the symbols of a subtitle being edited, same
+// rules as fco::ValidateString(), but an edit only
+// re-lexes from the symbol it touches until the old
+// symbol boundaries line up again
+//-----------------------------------------------------
+class SubtitleTokenizer
+{
+public:
+    SubtitleTokenizer(fco const* _fco = nullptr);
+
+    void SetDatabase(fco const* _fco) { m_fco = _fco; }
+
+    // Full tokenize
+    void Reset(wstring const& _text);
+
+    // Replace _removed characters at _position with _added
+    void Update(unsigned int _position, unsigned int _removed, wstring const& _added);
+
+    bool IsValid() const { return m_invalidCount == 0; }
+    wstring GetErrorMsg() const;
+
+    size_t GetLength() const { return m_text.size(); }
+    vector<wstring> const& GetSymbols() const { return m_symbols; }
+
+private:
+    enum TokenState : char
+    {
+        TS_Valid,
+        TS_Unsupported,
+        TS_Unterminated,
+    };
+
+    unsigned int Lex(unsigned int _offset, wstring& _symbol, TokenState& _state) const;
+
+private:
+    fco const* m_fco;
+
+    wstring m_text;
+    vector<wstring> m_symbols;
+    vector<unsigned int> m_offsets;     // start of each symbol in m_text
+    vector<TokenState> m_states;
+    unsigned int m_invalidCount;
+};
+
+#endif // SUBTITLETOKENIZER_H
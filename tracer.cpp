@@ -0,0 +1,228 @@
+#include "tracer.h"
+
+#include <stdio.h>
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace
+{
+    // Fixed size block of events, only the owner thread appends to it
+    struct Chunk
+    {
+        static uint32_t const c_capacity = 4096;
+
+        Chunk() : m_count(0), m_next(nullptr) {}
+
+        Tracer::Event m_events[c_capacity];
+        atomic<uint32_t> m_count;
+        atomic<Chunk*> m_next;
+    };
+
+    struct ThreadBuffer
+    {
+        ThreadBuffer(uint32_t _tid) : m_tid(_tid), m_session(0), m_head(nullptr), m_tail(nullptr) {}
+        ~ThreadBuffer() { Clear(); }
+
+        void Clear()
+        {
+            Chunk* chunk = m_head;
+            while (chunk)
+            {
+                Chunk* next = chunk->m_next.load(memory_order_acquire);
+                delete chunk;
+                chunk = next;
+            }
+            m_head = nullptr;
+            m_tail = nullptr;
+        }
+
+        uint32_t m_tid;
+        string m_name;
+        atomic<uint32_t> m_session;
+        Chunk* m_head;
+        Chunk* m_tail;
+    };
+
+    mutex s_registryMutex;
+    vector<unique_ptr<ThreadBuffer>> s_registry;
+    atomic<uint32_t> s_session(0);
+    atomic<int64_t> s_epoch(0);
+
+    thread_local ThreadBuffer* t_buffer = nullptr;
+
+    //-----------------------------------------------------
+    // Get (or register) the calling thread's buffer
+    //-----------------------------------------------------
+    ThreadBuffer* LocalBuffer()
+    {
+        if (!t_buffer)
+        {
+            lock_guard<mutex> lock(s_registryMutex);
+            s_registry.emplace_back(new ThreadBuffer(static_cast<uint32_t>(s_registry.size() + 1)));
+            t_buffer = s_registry.back().get();
+        }
+        return t_buffer;
+    }
+
+    //-----------------------------------------------------
+    // Write a string as a JSON literal
+    //-----------------------------------------------------
+    void WriteJsonString(FILE* _file, char const* _string)
+    {
+        fputc('"', _file);
+        for (char const* c = _string; *c; c++)
+        {
+            switch (*c)
+            {
+            case '"':  fputs("\\\"", _file); break;
+            case '\\': fputs("\\\\", _file); break;
+            case '\n': fputs("\\n", _file); break;
+            case '\t': fputs("\\t", _file); break;
+            default:
+                if (static_cast<unsigned char>(*c) < 0x20) fprintf(_file, "\\u%04x", *c);
+                else fputc(*c, _file);
+            }
+        }
+        fputc('"', _file);
+    }
+}
+
+atomic<bool> Tracer::s_enabled(false);
+
+//-----------------------------------------------------
+// Begin a new recording session
+//-----------------------------------------------------
+void Tracer::Start()
+{
+    s_enabled.store(false);
+    s_epoch.store(chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now().time_since_epoch()).count());
+    s_session.fetch_add(1);
+    s_enabled.store(true);
+}
+
+//-----------------------------------------------------
+// Stop recording, scopes already open are still closed
+//-----------------------------------------------------
+void Tracer::Stop()
+{
+    s_enabled.store(false);
+}
+
+//-----------------------------------------------------
+// Name the calling thread in the trace
+//-----------------------------------------------------
+void Tracer::SetThreadName(string const& _name)
+{
+    ThreadBuffer* buffer = LocalBuffer();
+    lock_guard<mutex> lock(s_registryMutex);
+    buffer->m_name = _name;
+}
+
+//-----------------------------------------------------
+// Microseconds since the session started
+//-----------------------------------------------------
+int64_t Tracer::Now()
+{
+    return chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now().time_since_epoch()).count() - s_epoch.load(memory_order_relaxed);
+}
+
+//-----------------------------------------------------
+// Append an event to the calling thread's buffer
+//-----------------------------------------------------
+void Tracer::Record(char const* _category, char const* _name, int64_t _begin, int64_t _end)
+{
+    ThreadBuffer* buffer = LocalBuffer();
+
+    // Drop events of previous sessions, only the owner touches its chunks
+    uint32_t session = s_session.load(memory_order_acquire);
+    if (buffer->m_session.load(memory_order_relaxed) != session)
+    {
+        buffer->m_session.store(0, memory_order_release);
+        buffer->Clear();
+        buffer->m_session.store(session, memory_order_release);
+    }
+
+    if (!buffer->m_tail || buffer->m_tail->m_count.load(memory_order_relaxed) == Chunk::c_capacity)
+    {
+        Chunk* chunk = new Chunk();
+        if (buffer->m_tail)
+        {
+            buffer->m_tail->m_next.store(chunk, memory_order_release);
+        }
+        else
+        {
+            buffer->m_head = chunk;
+        }
+        buffer->m_tail = chunk;
+    }
+
+    Chunk* chunk = buffer->m_tail;
+    uint32_t index = chunk->m_count.load(memory_order_relaxed);
+    Event& event = chunk->m_events[index];
+    event.m_category = _category;
+    event.m_name = _name;
+    event.m_begin = _begin;
+    event.m_end = _end;
+    chunk->m_count.store(index + 1, memory_order_release);
+}
+
+//-----------------------------------------------------
+// Write all events of the current session as trace JSON
+// (call after Stop(), before the next Start())
+//-----------------------------------------------------
+bool Tracer::Dump(string const& _fileName, string& _errorMsg)
+{
+    FILE* output;
+    fopen_s(&output, _fileName.c_str(), "w");
+    if (!output)
+    {
+        _errorMsg = "Unable to write trace file!";
+        return false;
+    }
+
+    uint32_t const session = s_session.load(memory_order_acquire);
+    bool first = true;
+
+    fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", output);
+
+    lock_guard<mutex> lock(s_registryMutex);
+    for (unique_ptr<ThreadBuffer> const& buffer : s_registry)
+    {
+        if (!buffer->m_name.empty())
+        {
+            fputs(first ? "" : ",\n", output);
+            fprintf(output, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":", buffer->m_tid);
+            WriteJsonString(output, buffer->m_name.c_str());
+            fputs("}}", output);
+            first = false;
+        }
+
+        // Buffers still holding an older session haven't recorded anything since Start()
+        if (buffer->m_session.load(memory_order_acquire) != session) continue;
+
+        Chunk* chunk = buffer->m_head;
+        while (chunk)
+        {
+            uint32_t count = chunk->m_count.load(memory_order_acquire);
+            for (uint32_t i = 0; i < count; i++)
+            {
+                Event const& event = chunk->m_events[i];
+                fputs(first ? "" : ",\n", output);
+                fputs("{\"name\":", output);
+                WriteJsonString(output, event.m_name);
+                fputs(",\"cat\":", output);
+                WriteJsonString(output, event.m_category);
+                fprintf(output, ",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%lld,\"dur\":%lld}", buffer->m_tid, static_cast<long long>(event.m_begin), static_cast<long long>(event.m_end - event.m_begin));
+                first = false;
+            }
+            chunk = chunk->m_next.load(memory_order_acquire);
+        }
+    }
+
+    fputs("\n]}\n", output);
+    fclose(output);
+    return true;
+}
@@ -0,0 +1,58 @@
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+using namespace std;
+
+//-----------------------------------------------------
+// Records begin/end timestamps of named scopes into
+// per-thread buffers, dumped as Chrome trace-event JSON
+// (open with chrome://tracing or ui.perfetto.dev)
+//-----------------------------------------------------
+class Tracer
+{
+public:
+    struct Event
+    {
+        char const* m_category;
+        char const* m_name;
+        int64_t m_begin;    // microseconds since Start()
+        int64_t m_end;
+    };
+
+    class Scope
+    {
+    public:
+        Scope(char const* _category, char const* _name)
+            : m_category(_category), m_name(_name), m_begin(IsEnabled() ? Now() : -1) {}
+        ~Scope() { if (m_begin >= 0) Record(m_category, m_name, m_begin, Now()); }
+
+    private:
+        char const* m_category;
+        char const* m_name;
+        int64_t m_begin;
+    };
+
+public:
+    static bool IsEnabled() { return s_enabled.load(memory_order_relaxed); }
+
+    static void Start();
+    static void Stop();
+    static bool Dump(string const& _fileName, string& _errorMsg);
+
+    static void SetThreadName(string const& _name);
+    static int64_t Now();
+    static void Record(char const* _category, char const* _name, int64_t _begin, int64_t _end);
+
+private:
+    static atomic<bool> s_enabled;
+};
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_SCOPE(category, name) Tracer::Scope TRACE_CONCAT(traceScope, __LINE__)(category, name)
+
+#endif // TRACER_H